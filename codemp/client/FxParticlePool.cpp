@@ -0,0 +1,456 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+#include "client.h"
+#include "FxScheduler.h"
+#include "FxParticlePool.h"
+
+extern int		drawnFx;
+extern void		ClampRGB( const vec3_t in, byte *out );
+
+CFxParticlePool	theFxParticlePools[2];
+
+//-------------------------
+// FX_GroupParm
+//
+// Converts a transition parm the way the FX_Add* functions do, group being
+// the generic FX_* flags of the alpha, rgb, size or length group
+//-------------------------
+static float FX_GroupParm( int group, float parm, int killTime )
+{
+	if (( group & FX_PARM_MASK ) == FX_WAVE )
+	{
+		return parm * 3.14159f * 0.001f;
+	}
+	else if ( group & FX_PARM_MASK )
+	{
+		// parm should be a value from 0-100..
+		return parm * 0.01f * killTime + theFxHelper.mTime;
+	}
+
+	return 0.0f;
+}
+
+//-------------------------
+// FX_GroupPerc
+//
+// How far towards the start value a group is, as in CParticle::UpdateSize()
+// and friends, linear being the FX_LINEAR percent. Any FX_RAND is left to
+// the caller.
+//-------------------------
+static float FX_GroupPerc( int group, float linear, float parm, int timeStart, int timeEnd )
+{
+	const int time = theFxHelper.mTime;
+
+	// completely biased towards start if it doesn't get overridden
+	float	perc1 = 1.0f, perc2 = 1.0f;
+
+	if ( group & FX_LINEAR )
+	{
+		perc1 = linear;
+	}
+
+	// We can combine FX_LINEAR with _either_ FX_NONLINEAR, FX_WAVE, or FX_CLAMP
+	if (( group & FX_PARM_MASK ) == FX_NONLINEAR )
+	{
+		if ( time > parm )
+		{
+			// get percent done, using parm as the start of the non-linear fade
+			perc2 = 1.0f - (float)(time - parm) / (float)(timeEnd - parm);
+		}
+
+		perc1 = ( group & FX_LINEAR ) ? perc1 * 0.5f + perc2 * 0.5f : perc2;
+	}
+	else if (( group & FX_PARM_MASK ) == FX_WAVE )
+	{
+		// wave gen, with parm being the frequency multiplier
+		perc1 = perc1 * cosf( (time - timeStart) * parm );
+	}
+	else if (( group & FX_PARM_MASK ) == FX_CLAMP )
+	{
+		if ( time < parm )
+		{
+			// get percent done, using parm as the start of the non-linear fade
+			perc2 = (float)(parm - time) / (float)(parm - timeStart);
+		}
+		else
+		{
+			perc2 = 0.0f;
+		}
+
+		perc1 = ( group & FX_LINEAR ) ? perc1 * 0.5f + perc2 * 0.5f : perc2;
+	}
+
+	return perc1;
+}
+
+//-------------------------
+// Add
+//
+// Returns false if the particle has to be a CEffect, or the pool is full
+//-------------------------
+bool CFxParticlePool::Add( EPooledParticle type, vec3_t org, vec3_t norm, vec3_t vel, vec3_t accel,
+							float size1, float size2, float sizeParm,
+							float length1, float length2, float lengthParm,
+							float alpha1, float alpha2, float alphaParm,
+							vec3_t rgb1, vec3_t rgb2, float rgbParm,
+							float rotation, float rotationDelta,
+							int deathID, int killTime, qhandle_t shader, int flags )
+{
+	if (( flags & FX_POOL_EXCLUDED_FLAGS ) || mCount >= MAX_POOLED_PARTICLES )
+	{
+		return false;
+	}
+
+	const int		i = mCount++;
+	miniRefEntity_t	*ent = &mRefEnt[i];
+
+	for ( int k = 0; k < 3; k++ )
+	{
+		mOrigin[k][i] = org ? org[k] : 0.0f;
+		mOldOrigin[k][i] = mOrigin[k][i];
+		mVel[k][i] = vel ? vel[k] : 0.0f;
+		mAccel[k][i] = accel ? accel[k] : 0.0f;
+	}
+	mTimeStart[i] = theFxHelper.mTime;
+	mTimeEnd[i] = theFxHelper.mTime + killTime;
+
+	mType[i] = type;
+	mFlags[i] = flags;
+	mDeathFxID[i] = deathID;
+
+	mSizeStart[i] = size1;
+	mSizeEnd[i] = size2;
+	mSizeParm[i] = FX_GroupParm( flags >> FX_SIZE_SHIFT, sizeParm, killTime );
+
+	mLengthStart[i] = length1;
+	mLengthEnd[i] = length2;
+	mLengthParm[i] = FX_GroupParm( flags >> FX_LENGTH_SHIFT, lengthParm, killTime );
+
+	if ( rgb1 ) { VectorCopy( rgb1, mRGBStart[i] ); } else { VectorClear( mRGBStart[i] ); }
+	if ( rgb2 ) { VectorCopy( rgb2, mRGBEnd[i] ); } else { VectorClear( mRGBEnd[i] ); }
+	mRGBParm[i] = FX_GroupParm( flags >> FX_RGB_SHIFT, rgbParm, killTime );
+
+	mAlphaStart[i] = alpha1;
+	mAlphaEnd[i] = alpha2;
+	mAlphaParm[i] = FX_GroupParm( flags >> FX_ALPHA_SHIFT, alphaParm, killTime );
+
+	mRotationDelta[i] = rotationDelta;
+
+	memset( ent, 0, sizeof( *ent ) );
+	ent->customShader = shader;
+	ent->radius = size1;
+	ent->rotation = rotation;
+
+	if ( flags & FX_DEPTH_HACK )
+	{
+		ent->renderfx |= RF_DEPTHHACK;
+	}
+
+	if ( flags & FX_SET_SHADER_TIME )
+	{
+		ent->shaderTime = theFxHelper.mTime * 0.001f;
+	}
+
+	switch ( type )
+	{
+	case POOLED_PARTICLE:
+		ent->reType = RT_SPRITE;
+		mCullBehind[i] = 1;
+		mCullNear[i] = !( flags & FX_DEPTH_HACK );
+		break;
+
+	case POOLED_ORIENTED_PARTICLE:
+		// the normal never changes without a bolt, so the axis doesn't either
+		ent->reType = RT_ORIENTED_QUAD;
+		VectorCopy( norm, ent->axis[0] );
+		MakeNormalVectors( ent->axis[0], ent->axis[1], ent->axis[2] );
+		mCullBehind[i] = 1;
+		mCullNear[i] = 0;
+		break;
+
+	case POOLED_TAIL:
+		ent->reType = RT_LINE;
+		ent->shaderTexCoord[0] = 1.0f;
+		ent->shaderTexCoord[1] = 1.0f;
+		mCullBehind[i] = 0;
+		mCullNear[i] = !( flags & FX_DEPTH_HACK );
+		break;
+	}
+
+	return true;
+}
+
+//-------------------------
+// Die
+//
+// CParticle::Die(), expired being true when the particle lived out its kill time
+//-------------------------
+void CFxParticlePool::Die( int i, bool expired )
+{
+	unsigned int flags = mFlags[i];
+
+	if ( expired )
+	{
+		// this flag just has to be cleared otherwise death effects might not happen correctly
+		flags &= ~FX_KILL_ON_IMPACT;
+	}
+
+	if ( flags & FX_DEATH_RUNS_FX && !(flags & FX_KILL_ON_IMPACT) )
+	{
+		vec3_t	org, norm;
+
+		VectorSet( org, mOrigin[0][i], mOrigin[1][i], mOrigin[2][i] );
+		VectorSet( norm, flrand(-1.0f, 1.0f), flrand(-1.0f, 1.0f), flrand(-1.0f, 1.0f));
+		VectorNormalize( norm );
+
+		theFxScheduler.PlayEffect( mDeathFxID[i], org, norm );
+	}
+}
+
+//-------------------------
+// Remove
+//
+// Moves the last particle into the hole so the arrays stay packed
+//-------------------------
+void CFxParticlePool::Remove( int i )
+{
+	const int last = --mCount;
+
+	if ( i == last )
+	{
+		return;
+	}
+
+	for ( int k = 0; k < 3; k++ )
+	{
+		mOrigin[k][i] = mOrigin[k][last];
+		mOldOrigin[k][i] = mOldOrigin[k][last];
+		mVel[k][i] = mVel[k][last];
+		mAccel[k][i] = mAccel[k][last];
+	}
+	mTimeStart[i] = mTimeStart[last];
+	mTimeEnd[i] = mTimeEnd[last];
+	mCullBehind[i] = mCullBehind[last];
+	mCullNear[i] = mCullNear[last];
+
+	mType[i] = mType[last];
+	mFlags[i] = mFlags[last];
+	mDeathFxID[i] = mDeathFxID[last];
+
+	mSizeStart[i] = mSizeStart[last];
+	mSizeEnd[i] = mSizeEnd[last];
+	mSizeParm[i] = mSizeParm[last];
+
+	mLengthStart[i] = mLengthStart[last];
+	mLengthEnd[i] = mLengthEnd[last];
+	mLengthParm[i] = mLengthParm[last];
+
+	VectorCopy( mRGBStart[last], mRGBStart[i] );
+	VectorCopy( mRGBEnd[last], mRGBEnd[i] );
+	mRGBParm[i] = mRGBParm[last];
+
+	mAlphaStart[i] = mAlphaStart[last];
+	mAlphaEnd[i] = mAlphaEnd[last];
+	mAlphaParm[i] = mAlphaParm[last];
+
+	mRotationDelta[i] = mRotationDelta[last];
+
+	mRefEnt[i] = mRefEnt[last];
+}
+
+//-------------------------
+// Draw
+//
+// Fades a particle that survived the cull and adds it to the scene, doing what
+// the Update() of its CEffect does after Cull()
+//-------------------------
+void CFxParticlePool::Draw( int i )
+{
+	const unsigned int	flags = mFlags[i];
+	const float			linear = mLinear[i];
+	miniRefEntity_t		*ent = &mRefEnt[i];
+	float				perc;
+
+	// Size----------------
+	perc = FX_GroupPerc( flags >> FX_SIZE_SHIFT, linear, mSizeParm[i], mTimeStart[i], mTimeEnd[i] );
+	if ( flags & FX_SIZE_RAND )
+	{
+		perc = flrand( 0.0f, perc );
+	}
+	ent->radius = (mSizeStart[i] * perc) + (mSizeEnd[i] * (1.0f - perc));
+
+	// Length----------------
+	float length = 0.0f;
+	if ( mType[i] == POOLED_TAIL )
+	{
+		perc = FX_GroupPerc( flags >> FX_LENGTH_SHIFT, linear, mLengthParm[i], mTimeStart[i], mTimeEnd[i] );
+		if ( flags & FX_LENGTH_RAND )
+		{
+			perc = flrand( 0.0f, perc );
+		}
+		length = (mLengthStart[i] * perc) + (mLengthEnd[i] * (1.0f - perc));
+	}
+
+	// RGB----------------
+	vec3_t	res;
+
+	perc = FX_GroupPerc( flags >> FX_RGB_SHIFT, linear, mRGBParm[i], mTimeStart[i], mTimeEnd[i] );
+	if ( flags & FX_RGB_RAND )
+	{
+		perc = flrand( 0.0f, perc );
+	}
+	VectorScale( mRGBStart[i], perc, res );
+	VectorMA( res, 1.0f - perc, mRGBEnd[i], res );
+
+	ClampRGB( res, ent->shaderRGBA );
+
+	// Alpha----------------
+	perc = FX_GroupPerc( flags >> FX_ALPHA_SHIFT, linear, mAlphaParm[i], mTimeStart[i], mTimeEnd[i] );
+	perc = (mAlphaStart[i] * perc) + (mAlphaEnd[i] * (1.0f - perc));
+
+	// We should be in the right range, but clamp to ensure
+	perc = Com_Clamp( 0.0f, 1.0f, perc );
+	if ( flags & FX_ALPHA_RAND )
+	{
+		perc = flrand( 0.0f, perc );
+	}
+
+	const int alpha = Com_Clamp( 0, 255, perc * 255.0f );
+	if ( flags & FX_USE_ALPHA )
+	{
+		ent->shaderRGBA[3] = (byte)alpha;
+	}
+	else
+	{
+		ent->shaderRGBA[0] = ((int)ent->shaderRGBA[0] * alpha) >> 8;
+		ent->shaderRGBA[1] = ((int)ent->shaderRGBA[1] * alpha) >> 8;
+		ent->shaderRGBA[2] = ((int)ent->shaderRGBA[2] * alpha) >> 8;
+	}
+
+	VectorSet( ent->origin, mOrigin[0][i], mOrigin[1][i], mOrigin[2][i] );
+
+	if ( mType[i] == POOLED_TAIL )
+	{
+		vec3_t	dir;
+
+		VectorSet( dir, mOldOrigin[0][i] - ent->origin[0], mOldOrigin[1][i] - ent->origin[1], mOldOrigin[2][i] - ent->origin[2] );
+		VectorNormalize( dir );
+
+		VectorMA( ent->origin, length, dir, ent->oldorigin );
+	}
+	else
+	{
+		// Rotation----------------
+		ent->rotation += theFxHelper.mFrameTime * 0.01f * mRotationDelta[i];
+		mRotationDelta[i] *= ( 1.0f - ( theFxHelper.mFrameTime * 0.0007f )); // decay rotationDelta
+	}
+
+	theFxHelper.AddFxToScene( ent );
+	drawnFx++;
+}
+
+//-------------------------
+// Update
+//
+// Moves, culls and draws the whole pool, called from FX_Add
+//-------------------------
+void CFxParticlePool::Update( void )
+{
+	const int	time = theFxHelper.mTime;
+	int			i, k;
+
+	// Game pausing can cause dumb time things to happen, so kill anything from the future too
+	for ( i = 0; i < mCount; )
+	{
+		if ( time > mTimeEnd[i] || mTimeStart[i] > time )
+		{
+			Die( i, time > mTimeEnd[i] );
+			Remove( i );
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	if ( !mCount )
+	{
+		return;
+	}
+
+#ifdef _DEBUG
+	if ( !fx_freeze->integer )
+#endif
+	{
+		// tails trail back to where they were last frame
+		for ( k = 0; k < 3; k++ )
+		{
+			memcpy( mOldOrigin[k], mOrigin[k], mCount * sizeof( float ) );
+		}
+	}
+
+	// Nothing moves on the frame it was spawned
+	const float dt = theFxHelper.mRealTime;
+
+	for ( k = 0; k < 3; k++ )
+	{
+		float		*org = mOrigin[k];
+		float		*vel = mVel[k];
+		const float	*accel = mAccel[k];
+
+		for ( i = 0; i < mCount; i++ )
+		{
+			const float t = ( mTimeStart[i] < time ) ? dt : 0.0f;
+
+			vel[i] += t * accel[i];
+			org[i] += t * vel[i];
+		}
+	}
+
+	// Cull against the view and work out the FX_LINEAR percent for everyone
+	const float	*vieworg = theFxHelper.refdef->vieworg;
+	const float	*forward = theFxHelper.refdef->viewaxis[0];
+	const float	nearCull = fx_nearCull->value;
+
+	for ( i = 0; i < mCount; i++ )
+	{
+		const float dx = mOrigin[0][i] - vieworg[0];
+		const float dy = mOrigin[1][i] - vieworg[1];
+		const float dz = mOrigin[2][i] - vieworg[2];
+		const float dot = forward[0] * dx + forward[1] * dy + forward[2] * dz;
+		const float lenSq = dx * dx + dy * dy + dz * dz;
+
+		mCulled[i] = ( mCullBehind[i] & ( dot < 0 ) ) | ( mCullNear[i] & ( lenSq < nearCull ) );
+		mLinear[i] = 1.0f - (float)(time - mTimeStart[i]) / (float)(mTimeEnd[i] - mTimeStart[i]);
+	}
+
+	int numVisible = 0;
+	for ( i = 0; i < mCount; i++ )
+	{
+		mVisible[numVisible] = i;
+		numVisible += !mCulled[i];
+	}
+
+	for ( i = 0; i < numVisible; i++ )
+	{
+		Draw( mVisible[i] );
+	}
+}
@@ -0,0 +1,113 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+#pragma once
+
+#include "FxPrimitives.h"
+
+#define MAX_POOLED_PARTICLES	2048	// per scene, the portal scene gets its own pool
+
+// Anything that needs a trace, a bolt or a 2D draw can't be pooled
+#define FX_POOL_EXCLUDED_FLAGS	( FX_RELATIVE | FX_APPLY_PHYSICS | FX_PLAYER_VIEW )
+
+enum EPooledParticle
+{
+	POOLED_PARTICLE = 0,		// CParticle
+	POOLED_ORIENTED_PARTICLE,	// COrientedParticle
+	POOLED_TAIL					// CTail
+};
+
+//------------------------------
+// CFxParticlePool
+//
+// The common particles, tails and oriented particles without physics or bolts
+// don't need their own heap object and virtual Update(). They're kept here
+// instead, one array per field, so a frame can move, cull and fade the whole
+// pool in a few flat loops the compiler can vectorize, and only visits the
+// particles that end up drawn one at a time. They look and die exactly like
+// their CEffect counterparts.
+//------------------------------
+class CFxParticlePool
+{
+private:
+	int		mCount;
+
+	// walked every frame
+	float	mOrigin[3][MAX_POOLED_PARTICLES];
+	float	mOldOrigin[3][MAX_POOLED_PARTICLES];	// tails only
+	float	mVel[3][MAX_POOLED_PARTICLES];
+	float	mAccel[3][MAX_POOLED_PARTICLES];
+	int		mTimeStart[MAX_POOLED_PARTICLES];
+	int		mTimeEnd[MAX_POOLED_PARTICLES];
+	byte	mCullBehind[MAX_POOLED_PARTICLES];
+	byte	mCullNear[MAX_POOLED_PARTICLES];
+
+	// scratch for the frame
+	float	mLinear[MAX_POOLED_PARTICLES];			// FX_LINEAR percent, same for every group
+	byte	mCulled[MAX_POOLED_PARTICLES];
+	int		mVisible[MAX_POOLED_PARTICLES];
+
+	// only touched for particles that are drawn or die
+	byte	mType[MAX_POOLED_PARTICLES];
+	unsigned int mFlags[MAX_POOLED_PARTICLES];
+	int		mDeathFxID[MAX_POOLED_PARTICLES];
+
+	float	mSizeStart[MAX_POOLED_PARTICLES];
+	float	mSizeEnd[MAX_POOLED_PARTICLES];
+	float	mSizeParm[MAX_POOLED_PARTICLES];
+
+	float	mLengthStart[MAX_POOLED_PARTICLES];
+	float	mLengthEnd[MAX_POOLED_PARTICLES];
+	float	mLengthParm[MAX_POOLED_PARTICLES];
+
+	vec3_t	mRGBStart[MAX_POOLED_PARTICLES];
+	vec3_t	mRGBEnd[MAX_POOLED_PARTICLES];
+	float	mRGBParm[MAX_POOLED_PARTICLES];
+
+	float	mAlphaStart[MAX_POOLED_PARTICLES];
+	float	mAlphaEnd[MAX_POOLED_PARTICLES];
+	float	mAlphaParm[MAX_POOLED_PARTICLES];
+
+	float	mRotationDelta[MAX_POOLED_PARTICLES];
+
+	miniRefEntity_t	mRefEnt[MAX_POOLED_PARTICLES];
+
+	void	Die( int i, bool expired );
+	void	Remove( int i );
+	void	Draw( int i );
+
+public:
+
+	CFxParticlePool() : mCount(0) {}
+
+	bool	Add( EPooledParticle type, vec3_t org, vec3_t norm, vec3_t vel, vec3_t accel,
+					float size1, float size2, float sizeParm,
+					float length1, float length2, float lengthParm,
+					float alpha1, float alpha2, float alphaParm,
+					vec3_t rgb1, vec3_t rgb2, float rgbParm,
+					float rotation, float rotationDelta,
+					int deathID, int killTime, qhandle_t shader, int flags );
+	void	Update( void );
+	void	Clear( void )	{ mCount = 0;		}
+
+	inline	int	GetCount( void ) const { return mCount; }
+};
+
+extern CFxParticlePool	theFxParticlePools[2];	// [portal]
@@ -23,8 +23,10 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "client.h"
 #include "cl_cgameapi.h"
 #include "FxScheduler.h"
+#include "FxTraceBatch.h"
 
 extern int		drawnFx;
+extern bool		gEffectsInPortal;
 
 //--------------------------
 //
@@ -217,6 +219,28 @@ bool CParticle::UpdateOrigin(void)
 {
 	vec3_t	new_origin;
 
+	if ( mTraceSlot != -1 )
+	{
+		// finish the move that went to the trace batch last update
+		trace_t	trace;
+
+		if ( theFxTraceBatches[gEffectsInPortal].GetResult( mTraceSlot, trace ) )
+		{
+			EFxImpact impact = Impact( trace, mTraceTime );
+
+			if ( impact == FX_IMPACT_DIED )
+			{
+				mTraceSlot = -1;
+				return false;
+			}
+			else if ( impact == FX_IMPACT_NONE )
+			{
+				VectorCopy( trace.endpos, mOrigin1 );
+			}
+		}
+		mTraceSlot = -1;
+	}
+
 	VectorMA( mVel, theFxHelper.mRealTime, mAccel, mVel );
 
 	// Predict the new position
@@ -230,86 +254,39 @@ bool CParticle::UpdateOrigin(void)
 		if ( fx_physics->integer > 1 && ((mFlags & FX_EXPENSIVE_PHYSICS) || fx_physics->integer > 2) )
 		{
 			trace_t	trace;
-			float	dot;
 
-			if ( mFlags & FX_USE_BBOX )
+			if (mFlags & FX_GHOUL2_TRACE)
 			{
-				if (mFlags & FX_GHOUL2_TRACE)
+				if ( mFlags & FX_USE_BBOX )
 				{
 					theFxHelper.G2Trace( trace, mOrigin1, mMin, mMax, new_origin, -1, MASK_SOLID );
 				}
 				else
-				{
-					theFxHelper.Trace( trace, mOrigin1, mMin, mMax, new_origin, -1, MASK_SOLID );
-				}
-			}
-			else
-			{
-				if (mFlags & FX_GHOUL2_TRACE)
 				{
 					theFxHelper.G2Trace( trace, mOrigin1, NULL, NULL, new_origin, -1, MASK_PLAYERSOLID );
 				}
-				else
-				{
-					theFxHelper.Trace( trace, mOrigin1, NULL, NULL, new_origin, -1, MASK_SOLID );
-				}
 			}
-
-			// Hit something
-			if (trace.startsolid || trace.allsolid)
+			else if ( theFxTraceBatches[gEffectsInPortal].Queue( mOrigin1, (mFlags & FX_USE_BBOX) ? mMin : NULL,
+						(mFlags & FX_USE_BBOX) ? mMax : NULL, new_origin, mTraceSlot ) )
 			{
-				VectorClear( mVel );
-				VectorClear( mAccel );
-
-				if ((mFlags & FX_GHOUL2_TRACE) && (mFlags & FX_IMPACT_RUNS_FX))
-				{
-					static vec3_t bsNormal = {0, 1, 0};
-
-					theFxScheduler.PlayEffect( mImpactFxID, trace.endpos, bsNormal );
-				}
-
-				mFlags &= ~(FX_APPLY_PHYSICS | FX_IMPACT_RUNS_FX);
-
+				// stay put until the batch has traced the move
+				mTraceTime = theFxHelper.mRealTime;
 				return true;
 			}
-			else if ( trace.fraction < 1.0f )//&& !trace.startsolid && !trace.allsolid )
+			else
 			{
-				if ( mFlags & FX_IMPACT_RUNS_FX && !(trace.surfaceFlags & SURF_NOIMPACT ))
-				{
-					theFxScheduler.PlayEffect( mImpactFxID, trace.endpos, trace.plane.normal );
-				}
-
-				// may need to interact with the material type we hit
-				theFxScheduler.MaterialImpact(&trace, (CEffect*)this);
-
-				if ( mFlags & FX_KILL_ON_IMPACT	)
-				{
-					// time to die
-					return false;
-				}
-
-				VectorMA( mVel, theFxHelper.mRealTime * trace.fraction, mAccel, mVel );
-
-				dot = DotProduct( mVel, trace.plane.normal );
-
-				VectorMA( mVel, -2.0f * dot, trace.plane.normal, mVel );
-
-				VectorScale( mVel, mElasticity, mVel );
-				mElasticity *= 0.5f;
-
-				// If the velocity is too low, make it stop moving, rotating, and turn off physics to avoid
-				//	doing expensive operations when they aren't needed
-				//if ( trace.plane.normal[2] > 0.33f && mVel[2] < 10.0f )
-				if (VectorLengthSquared(mVel) < 100.0f)
-				{
-					VectorClear( mVel );
-					VectorClear( mAccel );
+				theFxHelper.Trace( trace, mOrigin1, (mFlags & FX_USE_BBOX) ? mMin : NULL,
+						(mFlags & FX_USE_BBOX) ? mMax : NULL, new_origin, -1, MASK_SOLID );
+			}
 
-					mFlags &= ~(FX_APPLY_PHYSICS | FX_IMPACT_RUNS_FX);
-				}
+			EFxImpact impact = Impact( trace, theFxHelper.mRealTime );
 
-				// Set the origin to the exact impact point
-				VectorMA( trace.endpos, 1.0f, trace.plane.normal, mOrigin1 );
+			if ( impact == FX_IMPACT_DIED )
+			{
+				return false;
+			}
+			else if ( impact == FX_IMPACT_STOPPED )
+			{
 				return true;
 			}
 		}
@@ -329,6 +306,77 @@ bool CParticle::UpdateOrigin(void)
 	return true;
 }
 
+//----------------------------
+// Impact
+//
+// Bounces, stops or kills the particle if the trace of its move hit something,
+// frameTime being the theFxHelper.mRealTime the move was made with
+//----------------------------
+EFxImpact CParticle::Impact( trace_t &trace, float frameTime )
+{
+	float	dot;
+
+	// Hit something
+	if (trace.startsolid || trace.allsolid)
+	{
+		VectorClear( mVel );
+		VectorClear( mAccel );
+
+		if ((mFlags & FX_GHOUL2_TRACE) && (mFlags & FX_IMPACT_RUNS_FX))
+		{
+			static vec3_t bsNormal = {0, 1, 0};
+
+			theFxScheduler.PlayEffect( mImpactFxID, trace.endpos, bsNormal );
+		}
+
+		mFlags &= ~(FX_APPLY_PHYSICS | FX_IMPACT_RUNS_FX);
+
+		return FX_IMPACT_STOPPED;
+	}
+	else if ( trace.fraction < 1.0f )//&& !trace.startsolid && !trace.allsolid )
+	{
+		if ( mFlags & FX_IMPACT_RUNS_FX && !(trace.surfaceFlags & SURF_NOIMPACT ))
+		{
+			theFxScheduler.PlayEffect( mImpactFxID, trace.endpos, trace.plane.normal );
+		}
+
+		// may need to interact with the material type we hit
+		theFxScheduler.MaterialImpact(&trace, (CEffect*)this);
+
+		if ( mFlags & FX_KILL_ON_IMPACT	)
+		{
+			// time to die
+			return FX_IMPACT_DIED;
+		}
+
+		VectorMA( mVel, frameTime * trace.fraction, mAccel, mVel );
+
+		dot = DotProduct( mVel, trace.plane.normal );
+
+		VectorMA( mVel, -2.0f * dot, trace.plane.normal, mVel );
+
+		VectorScale( mVel, mElasticity, mVel );
+		mElasticity *= 0.5f;
+
+		// If the velocity is too low, make it stop moving, rotating, and turn off physics to avoid
+		//	doing expensive operations when they aren't needed
+		//if ( trace.plane.normal[2] > 0.33f && mVel[2] < 10.0f )
+		if (VectorLengthSquared(mVel) < 100.0f)
+		{
+			VectorClear( mVel );
+			VectorClear( mAccel );
+
+			mFlags &= ~(FX_APPLY_PHYSICS | FX_IMPACT_RUNS_FX);
+		}
+
+		// Set the origin to the exact impact point
+		VectorMA( trace.endpos, 1.0f, trace.plane.normal, mOrigin1 );
+		return FX_IMPACT_STOPPED;
+	}
+
+	return FX_IMPACT_NONE;
+}
+
 //----------------------------
 // Update Size
 //----------------------------
@@ -121,6 +121,14 @@ enum EMatImpactEffect
 	MATIMPACTFX_SHELLSOUND
 };
 
+// what a physics trace did to a particle
+enum EFxImpact
+{
+	FX_IMPACT_NONE = 0,		// didn't hit anything, carry on to the end of the move
+	FX_IMPACT_STOPPED,		// bounced or got stuck, the particle has been moved
+	FX_IMPACT_DIED
+};
+
 //------------------------------
 class CEffect
 {
@@ -308,7 +316,11 @@ protected:
 	char		mModelNum;
 	char		mBoltNum;
 
+	int			mTraceSlot;		// move queued with the trace batch last update, -1 if none
+	float		mTraceTime;		// theFxHelper.mRealTime of that update
+
 	bool		UpdateOrigin();
+	EFxImpact	Impact( trace_t &trace, float frameTime );
 	void		UpdateSize();
 	void		UpdateRGB();
 	void		UpdateAlpha();
@@ -327,7 +339,7 @@ public:
 
 	inline CParticle(void)
 	{
-		mRefEnt.reType = RT_SPRITE; mEntNum = -1; mModelNum = -1; mBoltNum = -1;
+		mRefEnt.reType = RT_SPRITE; mEntNum = -1; mModelNum = -1; mBoltNum = -1; mTraceSlot = -1;
 	}
 
 	virtual void Init();
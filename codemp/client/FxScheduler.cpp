@@ -47,10 +47,76 @@ CMediaHandles &CMediaHandles::operator=(const CMediaHandles &that )
 CFxScheduler::CFxScheduler()
 {
 	mNextFree2DEffect = 0;
+	mNumScheduledFx = 0;
 	memset( &mEffectTemplates, 0, sizeof( mEffectTemplates ));
+	memset( &mEffectIDs, 0, sizeof( mEffectIDs ));
+	memset( &mFxSchedule, 0, sizeof( mFxSchedule ));
 	memset( &mLoopedEffectArray, 0, sizeof( mLoopedEffectArray ));
 }
 
+//------------------------------------------------------
+// FX_HashEffectName
+//	FNV-1a, names are matched case sensitively
+//------------------------------------------------------
+static unsigned int FX_HashEffectName( const char *file )
+{
+	unsigned int hash = 2166136261u;
+
+	while ( *file )
+	{
+		hash ^= (byte)*file++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+//------------------------------------------------------
+// FindEffectID
+//	Looks up the id an effect file was registered under
+//
+// Return:
+//	the id, 0 if the effect isn't registered
+//------------------------------------------------------
+int CFxScheduler::FindEffectID( const char *file ) const
+{
+	unsigned int slot = FX_HashEffectName( file );
+
+	for ( int i = 0; i < FX_EFFECT_HASH_SIZE; i++, slot++ )
+	{
+		const int id = mEffectIDs[slot & (FX_EFFECT_HASH_SIZE - 1)];
+
+		if ( !id )
+		{
+			break;
+		}
+
+		if ( !strcmp( mEffectTemplates[id].mEffectName, file ) )
+		{
+			return id;
+		}
+	}
+
+	return 0;
+}
+
+//------------------------------------------------------
+// AddEffectID
+//	There are never more names than templates, so the
+//	table can't fill up
+//------------------------------------------------------
+void CFxScheduler::AddEffectID( const char *file, int id )
+{
+	unsigned int slot = FX_HashEffectName( file );
+
+	while ( mEffectIDs[slot & (FX_EFFECT_HASH_SIZE - 1)] )
+	{
+		slot++;
+	}
+
+	mEffectIDs[slot & (FX_EFFECT_HASH_SIZE - 1)] = id;
+}
+
 int CFxScheduler::ScheduleLoopedEffect( int id, int boltInfo, CGhoul2Info_v *ghoul2, bool isPortal, int iLoopTime, bool isRelative  )
 {
 	int i;
@@ -106,7 +172,7 @@ void CFxScheduler::StopEffect( const char *file, int boltInfo, bool isPortal )
 
 	// Get an extenstion stripped version of the file
 	COM_StripExtension( file, sfile, sizeof( sfile ) );
-	const int id = mEffectIDs[sfile];
+	const int id = FindEffectID( sfile );
 #ifndef FINAL_BUILD
 	if ( id == 0 )
 	{
@@ -190,22 +256,28 @@ SEffectTemplate &SEffectTemplate::operator=(const SEffectTemplate &that)
 void CFxScheduler::Clean(bool bRemoveTemplates /*= true*/, int idToPreserve /*= 0*/)
 {
 	int								i, j;
-	TScheduledEffect::iterator		itr, next;
 
 	// Ditch any scheduled effects
-	itr = mFxSchedule.begin();
-
-	while ( itr != mFxSchedule.end() )
+	for ( i = 0; i < 2; i++ )
 	{
-		next = itr;
-		++next;
+		for ( j = 0; j < FX_SCHEDULE_SLOTS; j++ )
+		{
+			SScheduledEffect *effect = mFxSchedule[i].mSlots[j];
 
-		mScheduledEffectsPool.Free (*itr);
-		mFxSchedule.erase(itr);
+			while ( effect )
+			{
+				SScheduledEffect *next = effect->mNext;
 
-		itr = next;
+				mScheduledEffectsPool.Free (effect);
+				effect = next;
+			}
+
+			mFxSchedule[i].mSlots[j] = NULL;
+		}
 	}
 
+	mNumScheduledFx = 0;
+
 	if (bRemoveTemplates)
 	{
 		// Ditch any effect templates
@@ -228,29 +300,24 @@ void CFxScheduler::Clean(bool bRemoveTemplates /*= true*/, int idToPreserve /*=
 			mEffectTemplates[i].mInUse = false;
 		}
 
-		if (idToPreserve == 0)
-		{
-			mEffectIDs.clear();
-		}
-		else
-		{
-			// Clear the effect names, but first get the name of the effect to preserve,
-			// and restore it after clearing.
-			std::string str;
-			TEffectID::iterator iter;
+		// Clear the effect names, but first see if the effect to preserve has one,
+		// and restore it after clearing.
+		bool preserveName = false;
 
-			for (iter = mEffectIDs.begin(); iter != mEffectIDs.end(); ++iter)
+		for ( i = 0; i < FX_EFFECT_HASH_SIZE && idToPreserve; i++ )
+		{
+			if ( mEffectIDs[i] == idToPreserve )
 			{
-				if ((*iter).second == idToPreserve)
-				{
-					str = (*iter).first;
-					break;
-				}
+				preserveName = true;
+				break;
 			}
+		}
 
-			mEffectIDs.clear();
+		memset( &mEffectIDs, 0, sizeof( mEffectIDs ));
 
-			mEffectIDs[str] = idToPreserve;
+		if ( preserveName )
+		{
+			AddEffectID( mEffectTemplates[idToPreserve].mEffectName, idToPreserve );
 		}
 	}
 }
@@ -284,13 +351,11 @@ int CFxScheduler::RegisterEffect( const char *file, bool bHasCorrectPath /*= fal
 	Com_DPrintf("Registering effect : %s\n", sfile);
 
 	// see if the specified file is already registered.  If it is, just return the id of that file
-	TEffectID::iterator itr;
-
-	itr = mEffectIDs.find( sfile );
+	const int id = FindEffectID( sfile );
 
-	if ( itr != mEffectIDs.end() )
+	if ( id )
 	{
-		return (*itr).second;
+		return id;
 	}
 
 	CGenericParser2	parser;
@@ -518,8 +583,8 @@ SEffectTemplate *CFxScheduler::GetNewEffectTemplate( int *id, const char *file )
 			// If we are a copy, we really won't have a name that we care about saving for later
 			if ( file )
 			{
-				mEffectIDs[file] = i;
 				strcpy( effect->mEffectName, file );
+				AddEffectID( file, i );
 			}
 
 			effect->mInUse = true;
@@ -548,7 +613,7 @@ SEffectTemplate *CFxScheduler::GetNewEffectTemplate( int *id, const char *file )
 //------------------------------------------------------
 SEffectTemplate *CFxScheduler::GetEffectCopy( const char *file, int *newHandle )
 {
-	return ( GetEffectCopy( mEffectIDs[file], newHandle ) );
+	return ( GetEffectCopy( FindEffectID( file ), newHandle ) );
 }
 
 //------------------------------------------------------
@@ -741,16 +806,17 @@ void CFxScheduler::PlayEffect( const char *file, vec3_t origin, matrix3_t axis,
 
 	// Get an extenstion stripped version of the file
 	COM_StripExtension( file, sfile, sizeof( sfile ) );
+	const int id = FindEffectID( sfile );
 
 #ifndef FINAL_BUILD
-	if ( mEffectIDs[sfile] == 0 )
+	if ( id == 0 )
 	{
 		theFxHelper.Print( "CFxScheduler::PlayEffect unregistered/non-existent effect: %s\n", sfile );
 		return;
 	}
 #endif
 
-	PlayEffect( mEffectIDs[sfile], origin, axis, boltInfo, ghoul2, fxParm, vol, rad, qfalse, iLoopTime, isRelative );
+	PlayEffect( id, origin, axis, boltInfo, ghoul2, fxParm, vol, rad, qfalse, iLoopTime, isRelative );
 }
 
 int	totalPrimitives = 0;
@@ -981,7 +1047,7 @@ void CFxScheduler::PlayEffect( int id, vec3_t origin, matrix3_t axis, const int
 					sfx->mStartTime++;
 				}
 
-				mFxSchedule.push_front( sfx );
+				ScheduleEffect( sfx );
 			}
 		}
 	}
@@ -1014,7 +1080,7 @@ void CFxScheduler::PlayEffect( const char *file, vec3_t origin, int vol, int rad
 	// Get an extenstion stripped version of the file
 	COM_StripExtension( file, sfile, sizeof(sfile) );
 
-	PlayEffect( mEffectIDs[sfile], origin, vol, rad );
+	PlayEffect( FindEffectID( sfile ), origin, vol, rad );
 }
 */
 //------------------------------------------------------
@@ -1036,7 +1102,25 @@ void CFxScheduler::PlayEffect( const char *file, vec3_t origin, vec3_t forward,
 	// Get an extenstion stripped version of the file
 	COM_StripExtension( file, sfile, sizeof( sfile ) );
 
-	PlayEffect( mEffectIDs[sfile], origin, forward, vol, rad );
+	PlayEffect( FindEffectID( sfile ), origin, forward, vol, rad );
+}
+
+//------------------------------------------------------
+// ScheduleEffect
+//	Drops a scheduled effect into the bucket of its start
+//	time.  Anything already late goes into the first
+//	bucket the next pass looks at.
+//------------------------------------------------------
+void CFxScheduler::ScheduleEffect( SScheduledEffect *sfx )
+{
+	SScheduleWheel	*wheel = &mFxSchedule[sfx->mPortalEffect];
+	const int		tick = Q_max( sfx->mStartTime >> FX_SCHEDULE_SHIFT, wheel->mTick );
+	SScheduledEffect **slot = &wheel->mSlots[tick & (FX_SCHEDULE_SLOTS - 1)];
+
+	sfx->mNext = *slot;
+	*slot = sfx;
+
+	mNumScheduledFx++;
 }
 
 //------------------------------------------------------
@@ -1055,7 +1139,7 @@ bool gEffectsInPortal = qfalse; //this is just because I don't want to have to a
 
 void CFxScheduler::AddScheduledEffects( bool portal )
 {
-	TScheduledEffect::iterator	itr, next;
+	SScheduleWheel				*wheel = &mFxSchedule[portal];	//only render portal fx on the skyportal pass and vice versa
 	vec3_t						origin;
 	matrix3_t					axis;
 	int							oldEntNum = -1, oldBoltIndex = -1, oldModelNum = -1;
@@ -1070,12 +1154,34 @@ void CFxScheduler::AddScheduledEffects( bool portal )
 		AddLoopedEffects();
 	}
 
-	for ( itr = mFxSchedule.begin(); itr != mFxSchedule.end(); /* do nothing */ )
+	// Look at every bucket we moved through since the last pass, or at all of them once if time jumped
+	//	by more than a lap or went backwards.  Anything created from here on that is already due lands
+	//	in the current bucket, which the next pass looks at again.
+	const int now = theFxHelper.mTime >> FX_SCHEDULE_SHIFT;
+	const int firstTick = ( wheel->mTick <= now ) ? wheel->mTick : now - FX_SCHEDULE_SLOTS + 1;
+	const int lastTick = Q_min( now, firstTick + FX_SCHEDULE_SLOTS - 1 );
+
+	wheel->mTick = now;
+
+	for ( int tick = firstTick; tick <= lastTick; tick++ )
 	{
-		SScheduledEffect *effect = *itr;
+		SScheduledEffect **slot = &wheel->mSlots[tick & (FX_SCHEDULE_SLOTS - 1)];
+		SScheduledEffect *effect = *slot, *next;
+
+		*slot = NULL;
+
+		for ( ; effect; effect = next )
+		{
+			next = effect->mNext;
+
+			if ( effect->mStartTime > theFxHelper.mTime )
+			{
+				// later this bucket, or a lap or more away
+				effect->mNext = *slot;
+				*slot = effect;
+				continue;
+			}
 
-		if (portal == effect->mPortalEffect && effect->mStartTime <= theFxHelper.mTime )
-		{ //only render portal fx on the skyportal pass and vice versa
 			if (effect->mBoltNum == -1)
 			{// ok, are we spawning a bolt on effect or a normal one?
 				if ( effect->mEntNum != ENTITYNUM_NONE )
@@ -1129,11 +1235,7 @@ void CFxScheduler::AddScheduledEffects( bool portal )
 			}
 
 			mScheduledEffectsPool.Free (effect);
-			itr = mFxSchedule.erase(itr);
-		}
-		else
-		{
-			++itr;
+			mNumScheduledFx--;
 		}
 	}
 
@@ -27,8 +27,6 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 
 #include <algorithm>
 #include <vector>
-#include <map>
-#include <list>
 #include <string>
 
 #define FX_FILE_PATH	"effects"
@@ -38,6 +36,10 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #define FX_MAX_2DEFFECTS			64		// how many 2d effects the system can store
 #define FX_MAX_EFFECT_COMPONENTS	24		// how many primitives an effect can hold, this should be plenty
 #define FX_MAX_PRIM_NAME			32
+#define FX_EFFECT_HASH_SIZE			( FX_MAX_EFFECTS * 2 )	// effect name lookup, must be a power of two
+
+#define FX_SCHEDULE_SLOTS			256		// buckets in the timing wheel of scheduled effects, must be a power of two
+#define FX_SCHEDULE_SHIFT			4		// each bucket covers 1 << FX_SCHEDULE_SHIFT msec
 
 //-----------------------------------------------
 // These are spawn flags for primitiveTemplates
@@ -376,13 +378,15 @@ class PoolAllocator
 public:
 	PoolAllocator()
 		: pool (new T[N])
-		, freeAndAllocated (new int[N])
+		, freeSlots (new int[N])
+		, inUse (new bool[N]())
 		, numFree (N)
 		, highWatermark (0)
 	{
+		// hand out the low slots first
 		for ( int i = 0; i < N; i++ )
 		{
-			freeAndAllocated[i] = i;
+			freeSlots[i] = N - 1 - i;
 		}
 	}
 
@@ -393,11 +397,10 @@ public:
 			return NULL;
 		}
 
-		T *ptr = new (&pool[freeAndAllocated[0]]) T;
-
-		std::rotate (freeAndAllocated, freeAndAllocated + 1, freeAndAllocated + N);
-		numFree--;
+		const int slot = freeSlots[--numFree];
+		T *ptr = new (&pool[slot]) T;
 
+		inUse[slot] = true;
 		highWatermark = Q_max(highWatermark, N - numFree);
 
 		return ptr;
@@ -405,14 +408,16 @@ public:
 
 	void TransferTo ( PoolAllocator<T, N>& allocator )
 	{
-		allocator.freeAndAllocated = freeAndAllocated;
+		allocator.freeSlots = freeSlots;
+		allocator.inUse = inUse;
 		allocator.highWatermark = highWatermark;
 		allocator.numFree = numFree;
 		allocator.pool = pool;
 
 		highWatermark = 0;
 		numFree = N;
-		freeAndAllocated = NULL;
+		freeSlots = NULL;
+		inUse = NULL;
 		pool = NULL;
 	}
 
@@ -423,22 +428,13 @@ public:
 
 	void Free ( T *ptr )
 	{
-		for ( int i = numFree; i < N; i++ )
-		{
-			T *p = &pool[freeAndAllocated[i]];
+		const int slot = (int)(ptr - pool);
 
-			if ( p == ptr )
-			{
-				if ( i > numFree )
-				{
-					std::rotate (freeAndAllocated + numFree, freeAndAllocated + i, freeAndAllocated + i + 1);
-				}
-
-				p->~T();
-				numFree++;
-
-				break;
-			}
+		if ( inUse[slot] )
+		{
+			ptr->~T();
+			inUse[slot] = false;
+			freeSlots[numFree++] = slot;
 		}
 	}
 
@@ -446,14 +442,19 @@ public:
 
 	~PoolAllocator()
 	{
-		for ( int i = numFree; i < N; i++ )
+		if ( inUse )
 		{
-			T *p = &pool[freeAndAllocated[i]];
-
-			p->~T();
+			for ( int i = 0; i < N; i++ )
+			{
+				if ( inUse[i] )
+				{
+					pool[i].~T();
+				}
+			}
 		}
 
-		delete [] freeAndAllocated;
+		delete [] freeSlots;
+		delete [] inUse;
 		delete [] pool;
 	}
 
@@ -463,9 +464,9 @@ private:
 
 	T *pool;
 
-	// The first 'numFree' elements are the indexes of the free slots.
-	// The remaining elements are the indexes of the allocated slots.
-	int *freeAndAllocated;
+	// The first 'numFree' elements are the indexes of the free slots, the last one freed goes out first.
+	int *freeSlots;
+	bool *inUse;
 	int numFree;
 
 	int highWatermark;
@@ -571,6 +572,15 @@ private:
 		CGhoul2Info_v *ghoul2;
 		vec3_t	mOrigin;
 		matrix3_t	mAxis;
+		SScheduledEffect	*mNext;	// next effect in the same bucket
+	};
+
+	// Scheduled effects are hashed into a bucket by their start time, so a frame only looks at the
+	//	buckets it has moved through.  Anything due a lap or more ahead simply waits in its bucket.
+	struct SScheduleWheel
+	{
+		SScheduledEffect	*mSlots[FX_SCHEDULE_SLOTS];
+		int					mTick;		// the earliest bucket that still has to be looked at
 	};
 
 /* Looped Effects get stored and reschedule at mRepeatRate */
@@ -613,27 +623,29 @@ private:
 		qhandle_t	mShaderHandle;
 	};
 
-	// this makes looking up the index based on the string name much easier
-	typedef std::map<std::string, int>				TEffectID;
-
-	typedef std::list<SScheduledEffect*>			TScheduledEffect;
-
 	// Effects
 	SEffectTemplate		mEffectTemplates[FX_MAX_EFFECTS];
-	TEffectID			mEffectIDs;								// if you only have the unique effect name, you'll have to use this to get the ID.
+	int					mEffectIDs[FX_EFFECT_HASH_SIZE];		// if you only have the unique effect name, you'll have to use this to get the ID.
+																//	open addressed on the name, the name itself lives in the template
 
 	// 2D effects
 	CScheduled2DEffect	m2DEffects[FX_MAX_2DEFFECTS];
 	int					mNextFree2DEffect;
 
-	// List of scheduled effects that will need to be created at the correct time.
-	TScheduledEffect	mFxSchedule;
+	// Scheduled effects that will need to be created at the correct time.
+	SScheduleWheel		mFxSchedule[2];		// [portal]
+	int					mNumScheduledFx;
 
 	PagedPoolAllocator<SScheduledEffect, 1024> mScheduledEffectsPool;
 
 	// Private function prototypes
 	SEffectTemplate *GetNewEffectTemplate( int *id, const char *file );
 
+	int		FindEffectID( const char *file ) const;
+	void	AddEffectID( const char *file, int id );
+
+	void	ScheduleEffect( SScheduledEffect *sfx );
+
 	void	AddPrimitiveToEffect( SEffectTemplate *fx, CPrimitiveTemplate *prim );
 	int		ParseEffect( const char *file, CGPGroup *base );
 
@@ -666,7 +678,7 @@ public:
 	void	Draw2DEffects(float screenXScale, float screenYScale);
 
 	int		GetHighWatermark() const { return mScheduledEffectsPool.GetHighWatermark(); }
-	int		NumScheduledFx()	{ return (int)mFxSchedule.size();	}
+	int		NumScheduledFx()	{ return mNumScheduledFx;	}
 	void	Clean(bool bRemoveTemplates = true, int idToPreserve = 0);	// clean out the system
 
 	// FX Override functions
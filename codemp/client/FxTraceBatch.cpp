@@ -0,0 +1,212 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+#include "client.h"
+#include "FxTraceBatch.h"
+#include "qcommon/cm_public.h"
+
+#include <algorithm>
+
+CFxTraceBatch	theFxTraceBatches[2];
+
+//-------------------------
+// Queue
+//
+// Takes the move that would have gone to theFxHelper.Trace with MASK_SOLID,
+// slot is where to find the result after the next Resolve(). Returns false if
+// the batch is full.
+//-------------------------
+bool CFxTraceBatch::Queue( vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int &slot )
+{
+	if ( mNumMoves >= MAX_BATCHED_TRACES )
+	{
+		return false;
+	}
+
+	SFxTraceMove *move = &mMoves[mNumMoves];
+
+	VectorCopy( start, move->mStart );
+	VectorCopy( end, move->mEnd );
+	VectorCopy( mins ? mins : vec3_origin, move->mMins );
+	VectorCopy( maxs ? maxs : vec3_origin, move->mMaxs );
+
+	for ( int i = 0; i < 3; i++ )
+	{
+		move->mAbsMins[i] = Q_min( start[i], end[i] ) + move->mMins[i];
+		move->mAbsMaxs[i] = Q_max( start[i], end[i] ) + move->mMaxs[i];
+	}
+
+	slot = mNumMoves++;
+	return true;
+}
+
+//-------------------------
+// GetResult
+//-------------------------
+bool CFxTraceBatch::GetResult( int slot, trace_t &tr ) const
+{
+	if ( slot < 0 || slot >= mNumResults )
+	{
+		return false;
+	}
+
+	tr = mResults[slot];
+	return true;
+}
+
+//-------------------------
+// TraceMove
+//-------------------------
+void CFxTraceBatch::TraceMove( int move )
+{
+	SFxTraceMove *m = &mMoves[move];
+
+	theFxHelper.Trace( mResults[move], m->mStart, m->mMins, m->mMaxs, m->mEnd, -1, MASK_SOLID );
+}
+
+//-------------------------
+// TraceCluster
+//-------------------------
+void CFxTraceBatch::TraceCluster( const int *order, int count )
+{
+	for ( int i = 0; i < count; i++ )
+	{
+		TraceMove( order[i] );
+	}
+	mNumTraced += count;
+}
+
+//-------------------------
+// ResolveCluster
+//
+// Clears every move of the cluster with one test if nothing solid is near
+// them. A cluster that's too wide, or has an entity in the way, is split along
+// its longest side and tried again. One that reaches into the world is just
+// traced: halves of it would mostly touch the same brushes (debris settling
+// on a floor), so splitting it further only adds tests.
+//-------------------------
+void CFxTraceBatch::ResolveCluster( int *order, int count )
+{
+	vec3_t	mins, maxs;
+	int		i, k;
+
+	if ( count < FX_TRACE_LEAF_MOVES )
+	{
+		TraceCluster( order, count );
+		return;
+	}
+
+	ClearBounds( mins, maxs );
+	for ( i = 0; i < count; i++ )
+	{
+		AddPointToBounds( mMoves[order[i]].mAbsMins, mins, maxs );
+		AddPointToBounds( mMoves[order[i]].mAbsMaxs, mins, maxs );
+	}
+
+	// pad it out a bit, traces stop a little short of what they hit
+	int axis = 0;
+	for ( k = 0; k < 3; k++ )
+	{
+		mins[k] -= 1.0f;
+		maxs[k] += 1.0f;
+
+		if ( maxs[k] - mins[k] > maxs[axis] - mins[axis] )
+		{
+			axis = k;
+		}
+	}
+
+	if ( maxs[axis] - mins[axis] <= FX_TRACE_CLUSTER_SIZE )
+	{
+		mNumTests++;
+
+		if ( CM_BoxMayTouch( mins, maxs, MASK_SOLID ) )
+		{
+			TraceCluster( order, count );
+			return;
+		}
+
+		// The world is clear, a box trace that doesn't move only starts solid if an entity is in the way.
+		//	NOTE: a bmodel made of patches won't show up here
+		trace_t	tr;
+		vec3_t	center, boxMins, boxMaxs;
+
+		for ( k = 0; k < 3; k++ )
+		{
+			center[k] = ( mins[k] + maxs[k] ) * 0.5f;
+			boxMaxs[k] = maxs[k] - center[k];
+			boxMins[k] = -boxMaxs[k];
+		}
+
+		theFxHelper.Trace( tr, center, boxMins, boxMaxs, center, -1, MASK_SOLID );
+		mNumTests++;
+
+		if ( !tr.startsolid && !tr.allsolid )
+		{
+			for ( i = 0; i < count; i++ )
+			{
+				trace_t *result = &mResults[order[i]];
+
+				memset( result, 0, sizeof( *result ) );
+				result->fraction = 1.0f;
+				result->entityNum = ENTITYNUM_NONE;
+				VectorCopy( mMoves[order[i]].mEnd, result->endpos );
+			}
+			return;
+		}
+	}
+
+	if ( count == FX_TRACE_LEAF_MOVES )
+	{
+		TraceCluster( order, count );
+		return;
+	}
+
+	// split at the middle move along the longest side
+	const int half = count / 2;
+	const SFxTraceMove *moves = mMoves;
+
+	std::nth_element( order, order + half, order + count, [moves, axis]( int a, int b ) {
+		return moves[a].mAbsMins[axis] + moves[a].mAbsMaxs[axis] < moves[b].mAbsMins[axis] + moves[b].mAbsMaxs[axis];
+	} );
+
+	ResolveCluster( order, half );
+	ResolveCluster( order + half, count - half );
+}
+
+//-------------------------
+// Resolve
+//
+// Traces everything queued since the last call, called from FX_Add once the
+// scene has updated
+//-------------------------
+void CFxTraceBatch::Resolve( void )
+{
+	for ( int i = 0; i < mNumMoves; i++ )
+	{
+		mOrder[i] = i;
+	}
+
+	mNumTests = mNumTraced = 0;
+	ResolveCluster( mOrder, mNumMoves );
+
+	mNumResults = mNumMoves;
+	mNumMoves = 0;
+}
@@ -0,0 +1,82 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+#pragma once
+
+#include "FxSystem.h"
+
+#define MAX_BATCHED_TRACES		1024	// per scene, moves past this get traced right away
+#define FX_TRACE_CLUSTER_SIZE	256		// moves spread wider than this don't share a test
+#define FX_TRACE_LEAF_MOVES		2		// fewer moves than this are just traced
+
+struct SFxTraceMove
+{
+	vec3_t	mStart;
+	vec3_t	mEnd;
+	vec3_t	mMins;
+	vec3_t	mMaxs;
+	vec3_t	mAbsMins;	// everything the swept box covers
+	vec3_t	mAbsMaxs;
+};
+
+//------------------------------
+// CFxTraceBatch
+//
+// Particles with physics queue their move here instead of tracing it on the
+// spot. Once every effect of the scene has updated, the batch sorts the moves
+// into clusters and tests each cluster's bounds once: against the world's
+// brushes and patches, then with a single box trace for the entities. Only
+// the moves of clusters that touch something get traced one by one. The
+// particles pick up their result on their next update. fx_debug shows how
+// many tests and traces the last Resolve() took.
+//------------------------------
+class CFxTraceBatch
+{
+private:
+	SFxTraceMove	mMoves[MAX_BATCHED_TRACES];
+	int				mNumMoves;
+
+	trace_t			mResults[MAX_BATCHED_TRACES];
+	int				mNumResults;
+
+	int				mOrder[MAX_BATCHED_TRACES];
+
+	int				mNumTests;		// cluster tests and ...
+	int				mNumTraced;		// ... moves traced one by one, by the last Resolve()
+
+	void	ResolveCluster( int *order, int count );
+	void	TraceCluster( const int *order, int count );
+	void	TraceMove( int move );
+
+public:
+
+	CFxTraceBatch() : mNumMoves(0), mNumResults(0), mNumTests(0), mNumTraced(0) {}
+
+	bool	Queue( vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int &slot );
+	bool	GetResult( int slot, trace_t &tr ) const;
+	void	Resolve( void );
+	void	Clear( void )	{ mNumMoves = mNumResults = 0;	}
+
+	int		GetNumMoves( void ) const	{ return mNumResults;	}
+	int		GetNumTests( void ) const	{ return mNumTests;		}
+	int		GetNumTraced( void ) const	{ return mNumTraced;	}
+};
+
+extern CFxTraceBatch	theFxTraceBatches[2];	// [portal]
@@ -22,6 +22,8 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 
 #include "client.h"
 #include "FxScheduler.h"
+#include "FxParticlePool.h"
+#include "FxTraceBatch.h"
 
 vec3_t	WHITE = {1.0f, 1.0f, 1.0f};
 
@@ -60,6 +62,10 @@ bool FX_Free( bool templates )
 	}
 
 	activeFx = 0;
+	theFxParticlePools[0].Clear();
+	theFxParticlePools[1].Clear();
+	theFxTraceBatches[0].Clear();
+	theFxTraceBatches[1].Clear();
 
 	theFxScheduler.Clean( templates );
 	return true;
@@ -83,6 +89,10 @@ void FX_Stop( void )
 	}
 
 	activeFx = 0;
+	theFxParticlePools[0].Clear();
+	theFxParticlePools[1].Clear();
+	theFxTraceBatches[0].Clear();
+	theFxTraceBatches[1].Clear();
 
 	theFxScheduler.Clean(false);
 }
@@ -224,12 +234,18 @@ void FX_Add( bool portal )
 		}
 	}
 
+	theFxParticlePools[portal].Update();
+
+	// trace all the moves the physics particles queued, they'll get the results next time round
+	theFxTraceBatches[portal].Resolve();
 
 	if ( fx_debug->integer && !portal)
 	{
 		theFxHelper.Print( "Active    FX: %i\n", activeFx );
+		theFxHelper.Print( "Pooled    FX: %i\n", theFxParticlePools[0].GetCount() + theFxParticlePools[1].GetCount() );
 		theFxHelper.Print( "Drawn     FX: %i\n", drawnFx );
 		theFxHelper.Print( "Scheduled FX: %i High: %i\n", theFxScheduler.NumScheduledFx(), theFxScheduler.GetHighWatermark() );
+		theFxHelper.Print( "Batched   FX traces: %i tests: %i traced: %i\n", theFxTraceBatches[0].GetNumMoves(), theFxTraceBatches[0].GetNumTests(), theFxTraceBatches[0].GetNumTraced() );
 	}
 }
 
@@ -275,6 +291,13 @@ CParticle *FX_AddParticle( vec3_t org, vec3_t vel, vec3_t accel, float size1, fl
 		return 0;
 	}
 
+	if ( theFxParticlePools[gEffectsInPortal].Add( POOLED_PARTICLE, org, NULL, vel, accel,
+			size1, size2, sizeParm, 0.0f, 0.0f, 0.0f, alpha1, alpha2, alphaParm, sRGB, eRGB, rgbParm,
+			rotation, rotationDelta, deathID, killTime, shader, flags ) )
+	{
+		return NULL;
+	}
+
 	CParticle *fx = new CParticle;
 
 	if ( fx )
@@ -552,6 +575,13 @@ CTail *FX_AddTail( vec3_t org, vec3_t vel, vec3_t accel,
 		return 0;
 	}
 
+	if ( theFxParticlePools[gEffectsInPortal].Add( POOLED_TAIL, org, NULL, vel, accel,
+			size1, size2, sizeParm, length1, length2, lengthParm, alpha1, alpha2, alphaParm, sRGB, eRGB, rgbParm,
+			0.0f, 0.0f, deathID, killTime, shader, flags ) )
+	{
+		return NULL;
+	}
+
 	CTail *fx = new CTail;
 
 	if ( fx )
@@ -940,6 +970,13 @@ COrientedParticle *FX_AddOrientedParticle( vec3_t org, vec3_t norm, vec3_t vel,
 		return 0;
 	}
 
+	if ( theFxParticlePools[gEffectsInPortal].Add( POOLED_ORIENTED_PARTICLE, org, norm, vel, accel,
+			size1, size2, sizeParm, 0.0f, 0.0f, 0.0f, alpha1, alpha2, alphaParm, rgb1, rgb2, rgbParm,
+			rotation, rotationDelta, deathID, killTime, shader, flags ) )
+	{
+		return NULL;
+	}
+
 	COrientedParticle *fx = new COrientedParticle;
 
 	if ( fx )
@@ -31,6 +31,8 @@ void	FX_Add( bool portal );		// called every cgame frame to add all fx into the
 void	FX_Stop( void );	// ditches all active effects without touching the templates.
 
 
+// Particles, tails and oriented particles that fit in theFxParticlePools go there
+// and these return NULL for them
 CParticle *FX_AddParticle( vec3_t org, vec3_t vel, vec3_t accel,
 							float size1, float size2, float sizeParm,
 							float alpha1, float alpha2, float alphaParm,
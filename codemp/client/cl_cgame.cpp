@@ -740,6 +740,14 @@ void CL_InitCGame( void ) {
 	// otherwise server commands sent just before a gamestate are dropped
 	CGVM_Init( clc.serverMessageSequence, clc.lastExecutedServerCommand, clc.clientNum );
 
+	// the sounds cgame registered may still be decoding, keep the loading screen
+	// up until they're in rather than stall the first frames that start them
+	int soundsLoaded, soundsTotal;
+	for ( S_GetLoadProgress( &soundsLoaded, &soundsTotal ) ; soundsLoaded < soundsTotal ; S_GetLoadProgress( &soundsLoaded, &soundsTotal ) ) {
+		S_UpdateSoundLoads( 50 );
+		SCR_UpdateScreen();
+	}
+
 	int clRate = Cvar_VariableIntegerValue( "rate" );
 	if ( clRate == 4000 ) {
 		Com_Printf( S_COLOR_YELLOW "WARNING: Old default /rate value detected (4000). Suggest typing /rate 25000 into console for a smoother connection!\n" );
@@ -193,6 +193,7 @@ cvar_t		*s_dynamix;
 cvar_t		*s_debugdynamic;
 
 cvar_t		*s_doppler;
+cvar_t		*s_loadThreads;
 
 cvar_t		*snd_mute_losefocus;
 
@@ -476,6 +477,7 @@ void S_Init( void ) {
 	s_language = Cvar_Get("s_language","english",CVAR_ARCHIVE | CVAR_NORESTART, "Sound language" );
 
 	s_doppler = Cvar_Get("s_doppler", "1", CVAR_ARCHIVE_ND);
+	s_loadThreads = Cvar_Get("s_loadThreads", "2", CVAR_ARCHIVE_ND, "Threads decoding sounds as they're registered, 0 = decode them on the main thread" );
 
 	snd_mute_losefocus = Cvar_Get("snd_mute_losefocus", "1", CVAR_ARCHIVE, "Mute sound when game window is unfocused/minimized");
 
@@ -497,6 +499,7 @@ void S_Init( void ) {
 	Cmd_AddCommand("soundstop", S_StopAllSounds, "Stops all sounds including music" );
 	Cmd_AddCommand("mp3_calcvols", S_MP3_CalcVols_f);
 	Cmd_AddCommand("s_dynamic", S_SetDynamicMusic_f, "Change dynamic music state" );
+	Cmd_AddCommand("s_mixrecord", S_MixRecord_f, "Records what the software mixer paints, for the mixer benchmark" );
 
 #ifdef USE_OPENAL
 	cv = Cvar_Get("s_UseOpenAL" , "0",CVAR_ARCHIVE|CVAR_LATCH);
@@ -682,6 +685,7 @@ void S_Shutdown( void )
 	}
 
 	S_FreeAllSFXMem();
+	S_ShutdownSoundLoadThreads();
 	S_UnCacheDynamicMusic();
 
 #ifdef USE_OPENAL
@@ -744,6 +748,8 @@ void S_Shutdown( void )
 	Cmd_RemoveCommand("soundstop");
 	Cmd_RemoveCommand("mp3_calcvols");
 	Cmd_RemoveCommand("s_dynamic");
+	Cmd_RemoveCommand("s_mixrecord");
+	S_StopMixRecord();
 	AS_Free();
 }
 
@@ -1045,6 +1051,10 @@ sfxHandle_t	S_RegisterSound( const char *name)
 	if ( sfx->bDefaultSound )
 		return 0;
 
+	// still decoding from an earlier registration, which has neither pSoundData nor Buffer yet
+	if ( sfx->pLoadJob )
+		return sfx - s_knownSfx;
+
 #ifdef USE_OPENAL
 	if (s_UseOpenAL)
 	{
@@ -1062,7 +1072,15 @@ sfxHandle_t	S_RegisterSound( const char *name)
 
 	sfx->bInMemory = qfalse;
 
-	S_memoryLoad(sfx);
+	// the decode may carry on in the background, S_memoryLoad() finishes it if the sound's started before then
+	if ( !S_LoadSoundAsync( sfx ) )
+	{
+		sfx->bDefaultSound = qtrue;
+	}
+	if ( !sfx->pLoadJob )
+	{
+		sfx->bInMemory = qtrue;
+	}
 
 	if ( sfx->bDefaultSound ) {
 #ifndef FINAL_BUILD
@@ -1079,6 +1097,14 @@ sfxHandle_t	S_RegisterSound( const char *name)
 
 void S_memoryLoad(sfx_t	*sfx)
 {
+	// registered, but still decoding...
+	//
+	if ( sfx->pLoadJob )
+	{
+		S_FinishSoundLoad( sfx );
+		return;
+	}
+
 	// load the sound file...
 	//
 	if ( !S_LoadSound( sfx ) )
@@ -1970,6 +1996,9 @@ void S_AddLoopingSound( int entityNum, const vec3_t origin, const vec3_t velocit
 	}
 
 	sfx = &s_knownSfx[ sfxHandle ];
+	if ( sfx->pLoadJob ) {
+		return;		// still decoding, it gets added again next frame
+	}
 	if (sfx->bInMemory == qfalse) {
 		S_memoryLoad(sfx);
 	}
@@ -2037,6 +2066,9 @@ void S_AddAmbientLoopingSound( const vec3_t origin, unsigned char volume, sfxHan
 	}
 
 	sfx = &s_knownSfx[ sfxHandle ];
+	if ( sfx->pLoadJob ) {
+		return;		// still decoding, it gets added again next frame
+	}
 	if (sfx->bInMemory == qfalse){
 		S_memoryLoad(sfx);
 	}
@@ -2778,6 +2810,9 @@ void S_Update( void ) {
 	int			total;
 	channel_t	*ch;
 
+	// take in the sounds the load threads have finished with
+	S_UpdateSoundLoads( 0 );
+
 	if ( !s_soundStarted || s_soundMuted ) {
 		return;
 	}
@@ -5210,6 +5245,8 @@ void SND_TouchSFX(sfx_t *sfx)
 //
 void S_FreeAllSFXMem(void)
 {
+	S_FinishAllSoundLoads();
+
 	for (int i=1 ; i < s_numSfx ; i++)	// start @ 1 to skip freeing default sound
 	{
 		SND_FreeSFXMem(&s_knownSfx[i]);
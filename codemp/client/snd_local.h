@@ -57,7 +57,7 @@ extern void AS_Free( void );
 #define	PAINTBUFFER_SIZE	1024
 
 
-// !!! if this is changed, the asm code must change !!!
+// !!! if this is changed, the mix kernels in snd_mixkernels.cpp must change !!!
 typedef struct portable_samplepair_s {
 	int			left;	// the final values will be clamped to +/- 0x00ffff00 and shifted down
 	int			right;
@@ -94,6 +94,8 @@ typedef struct sfx_s {
 #endif
 	char		*lipSyncData;
 
+	struct soundLoadJob_s	*pLoadJob;		// non-NULL while a load thread is still decoding it, see snd_mem.cpp
+
 	struct sfx_s	*next;					// only used because of hash table when registering
 } sfx_t;
 
@@ -207,15 +209,22 @@ extern cvar_t	*s_testsound;
 extern cvar_t	*s_separation;
 
 extern cvar_t	*s_doppler;
+extern cvar_t	*s_loadThreads;
 
 extern cvar_t	*snd_mute_losefocus;
 
 wavinfo_t GetWavinfo (const char *name, byte *wav, int wavlength);
 
 qboolean S_LoadSound( sfx_t *sfx );
+qboolean S_LoadSoundAsync( sfx_t *sfx );	// may leave the decoding to the load threads, sfx->pLoadJob is set until it's done
+void	 S_FinishSoundLoad( sfx_t *sfx );
+void	 S_FinishAllSoundLoads( void );
+void	 S_ShutdownSoundLoadThreads( void );
 
 
 void S_PaintChannels(int endtime);
+void S_MixRecord_f( void );
+void S_StopMixRecord( void );
 
 // picks a channel based on priorities, empty slots, number of channels
 channel_t *S_PickChannel(int entnum, int entchannel);
@@ -27,7 +27,14 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "snd_mp3.h"
 #include "snd_ambient.h"
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #ifdef USE_OPENAL
 // Open AL
@@ -207,49 +214,66 @@ ResampleSfx
 resample / decimate to the current source rate
 ================
 */
-void ResampleSfx (sfx_t *sfx, int iInRate, int iInWidth, byte *pData)
+
+// sets the sfx up for the current rate and allocates its samples, returns the step to resample them with
+static float ResampleSfx_Alloc (sfx_t *sfx, int iInRate)
 {
-	int		iOutCount;
-	int		iSrcSample;
 	float	fStepScale;
-	int		i;
-	int		iSample;
-	unsigned int uiSampleFrac, uiFracStep;	// uiSampleFrac MUST be unsigned, or large samples (eg music tracks) crash
 
 	fStepScale = (float)iInRate / dma.speed;	// this is usually 0.5, 1, or 2
 
 	// When stepscale is > 1 (we're downsampling), we really ought to run a low pass filter on the samples
 
-	iOutCount = (int)(sfx->iSoundLengthInSamples / fStepScale);
-	sfx->iSoundLengthInSamples = iOutCount;
+	sfx->iSoundLengthInSamples = (int)(sfx->iSoundLengthInSamples / fStepScale);
 
 	sfx->pSoundData = (short *) SND_malloc( sfx->iSoundLengthInSamples*2 ,sfx );
 
-	sfx->fVolRange	= 0;
+	return fStepScale;
+}
+
+// only touches the buffers it's handed, so it's safe on the load threads. Returns the max vol
+static int ResampleSfx_Samples (short *pOut, int iOutCount, float fStepScale, int iInWidth, const byte *pData)
+{
+	int		iSrcSample;
+	int		i;
+	int		iSample;
+	int		iVolRange;
+	unsigned int uiSampleFrac, uiFracStep;	// uiSampleFrac MUST be unsigned, or large samples (eg music tracks) crash
+
+	iVolRange		= 0;
 	uiSampleFrac	= 0;
 	uiFracStep		= (int)(fStepScale*256);
 
-	for (i=0 ; i<sfx->iSoundLengthInSamples ; i++)
+	for (i=0 ; i<iOutCount ; i++)
 	{
 		iSrcSample = uiSampleFrac >> 8;
 		uiSampleFrac += uiFracStep;
 		if (iInWidth == 2) {
-			iSample = LittleShort ( ((short *)pData)[iSrcSample] );
+			iSample = LittleShort ( ((const short *)pData)[iSrcSample] );
 		} else {
 			iSample = (int)( (unsigned char)(pData[iSrcSample]) - 128) << 8;
 		}
 
-		sfx->pSoundData[i] = (short)iSample;
+		pOut[i] = (short)iSample;
 
 		// work out max vol for this sample...
 		//
 		if (iSample < 0)
 			iSample = -iSample;
-		if (sfx->fVolRange < (iSample >> 8) )
+		if (iVolRange < (iSample >> 8) )
 		{
-			sfx->fVolRange =  iSample >> 8;
+			iVolRange =  iSample >> 8;
 		}
 	}
+
+	return iVolRange;
+}
+
+void ResampleSfx (sfx_t *sfx, int iInRate, int iInWidth, byte *pData)
+{
+	float	fStepScale = ResampleSfx_Alloc( sfx, iInRate );
+
+	sfx->fVolRange = ResampleSfx_Samples( sfx->pSoundData, sfx->iSoundLengthInSamples, fStepScale, iInWidth, pData );
 }
 
 
@@ -720,19 +744,388 @@ static qboolean S_LoadSound_DirIsAllowedToKeepMP3s(const char *psFilename)
 	return qfalse;
 }
 
+qboolean gbInsideLoadSound = qfalse;
+
+#ifdef USE_OPENAL
+// hands the samples over to an AL buffer (working out the lipsync values for voices first)
+static void S_LoadSound_OpenALBuffer( sfx_t *sfx )
+{
+	if (s_UseOpenAL)
+	{
+		if ((strstr(sfx->sSoundName, "chars")) || (strstr(sfx->sSoundName, "CHARS")))
+		{
+			sfx->lipSyncData = (char *)Z_Malloc((sfx->iSoundLengthInSamples / 1000) + 1, TAG_SND_RAWDATA, qfalse);
+			S_PreProcessLipSync(sfx);
+		}
+		else
+			sfx->lipSyncData = NULL;
+
+		// Clear Open AL Error State
+		alGetError();
+
+		// Generate AL Buffer
+		ALuint Buffer;
+		alGenBuffers(1, &Buffer);
+		if (alGetError() == AL_NO_ERROR)
+		{
+			// Copy audio data to AL Buffer
+			alBufferData(Buffer, AL_FORMAT_MONO16, sfx->pSoundData, sfx->iSoundLengthInSamples*2, 22050);
+			if (alGetError() == AL_NO_ERROR)
+			{
+				// Store AL Buffer in sfx struct, and release sample data
+				sfx->Buffer = Buffer;
+				Z_Free(sfx->pSoundData);
+				sfx->pSoundData = NULL;
+			}
+		}
+	}
+}
+#endif
+
+// everything after the unpack of an MP3 that isn't worth keeping as one, frees pbUnpackBuffer
+//
+static void S_LoadSound_UnpackedMP3( sfx_t *sfx, const char *sLoadName, byte *data, int size, byte *pbUnpackBuffer, int iResultBytes, int iRawPCMDataSize )
+{
+	wavinfo_t	info;
+
+	if (iResultBytes!= iRawPCMDataSize){
+		Com_Printf(S_COLOR_YELLOW"**** MP3 %s final unpack size %d different to previous value %d\n",sLoadName,iResultBytes,iRawPCMDataSize);
+		//assert (iResultBytes == iRawPCMDataSize);
+	}
+
+
+	// fake up a WAV structure so I can use the other post-load sound code such as volume calc for lip-synching
+	//
+	// (this is a bit crap really, but it lets me drop through into existing code)...
+	//
+	MP3_FakeUpWAVInfo( sLoadName, data, size, iResultBytes,
+						// these params are all references...
+						info.format, info.rate, info.width, info.channels, info.samples, info.dataofs,
+						qfalse
+					);
+
+	S_LoadSound_Finalize(&info,sfx,pbUnpackBuffer);
+
+#ifdef Q3_BIG_ENDIAN
+	// the MP3 decoder returns the samples in the correct endianness, but ResampleSfx byteswaps them,
+	// so we have to swap them again...
+	sfx->fVolRange	= 0;
+
+	for (int i = 0; i < sfx->iSoundLengthInSamples; i++)
+	{
+		sfx->pSoundData[i] = LittleShort(sfx->pSoundData[i]);
+		// C++11 defines double abs(short) which is not what we want here,
+		// because double >> int is not defined. Force interpretation as int
+		if (sfx->fVolRange < (abs(static_cast<int>(sfx->pSoundData[i])) >> 8))
+		{
+			sfx->fVolRange = abs(static_cast<int>(sfx->pSoundData[i])) >> 8;
+		}
+	}
+#endif
+
+	// Open AL
+#ifdef USE_OPENAL
+	S_LoadSound_OpenALBuffer(sfx);
+#endif
+
+	Z_Free(pbUnpackBuffer);
+}
+
+
+/*
+===============================================================================
+
+Sound load threads
+
+S_RegisterSound no longer waits for the decode. Reading the file, parsing the
+header and allocating the samples still happen on the main thread (the file
+system, zone and printing aren't thread safe), then the resample of a WAV is
+handed to a load thread and the sfx is left with pLoadJob set and bInMemory
+clear. S_Update takes in whatever has finished since
+the last frame. Anything that wants the sound before then (S_StartSound etc,
+via S_memoryLoad) finishes its job on the spot, doing the work itself if no
+load thread has picked it up yet. Looping sounds just skip the frame instead.
+
+Errors that would make a default sound all turn up on the main thread, so
+S_RegisterSound returns 0 for missing sounds just as before.
+
+MP3s are all loaded as they always were. The mp3code decoder keeps its state
+in globals that the mixer and music streaming use every frame, so unpacking
+one on a load thread would mean locking them out for the whole file.
+
+===============================================================================
+*/
+
+#define MAX_SOUND_LOAD_THREADS	8
+
+typedef enum {
+	SOUNDLOAD_QUEUED,
+	SOUNDLOAD_RUNNING,
+	SOUNDLOAD_DECODED
+} soundLoadState_t;
+
+typedef struct soundLoadJob_s {
+	sfx_t				*sfx;
+	char				sLoadName[MAX_QPATH];	// after the language and wav/mp3 substitutions
+	byte				*pbFileData;			// as FS_ReadFile gave it, freed once the job is taken in
+	int					iFileSize;
+
+	// resampled straight into sfx->pSoundData
+	short				*pOut;
+	int					iOutCount;
+	float				fStepScale;
+	int					iInWidth;
+	const byte			*pbInData;
+	int					iVolRange;
+
+	soundLoadState_t	state;
+} soundLoadJob_t;
+
+static struct soundLoadPool_s {
+	std::thread						*threads[MAX_SOUND_LOAD_THREADS];
+	int								numThreads;
+	std::mutex						lock;
+	std::condition_variable			wake;
+	std::condition_variable			done;
+	std::deque<soundLoadJob_t *>	queue;		// not picked up by a load thread yet
+	int								numDecoded;	// waiting to be taken in
+	qboolean						quit;
+
+	// main thread only
+	std::vector<soundLoadJob_t *>	pending;
+	int								numLoaded;	// since pending was last empty
+	int								numTotal;
+} soundLoadPool;
+
+// only touches the job and the buffers it was handed
+static void S_RunSoundLoadJob( soundLoadJob_t *job )
+{
+	job->iVolRange = ResampleSfx_Samples( job->pOut, job->iOutCount, job->fStepScale, job->iInWidth, job->pbInData );
+}
+
+static void S_SoundLoadWorker( void )
+{
+	std::unique_lock<std::mutex>	l( soundLoadPool.lock );
+
+	while ( 1 )
+	{
+		soundLoadPool.wake.wait( l, [] { return soundLoadPool.quit || !soundLoadPool.queue.empty(); } );
+		if ( soundLoadPool.quit ) {
+			return;
+		}
+
+		soundLoadJob_t *job = soundLoadPool.queue.front();
+		soundLoadPool.queue.pop_front();
+		job->state = SOUNDLOAD_RUNNING;
+
+		l.unlock();
+		S_RunSoundLoadJob( job );
+		l.lock();
+
+		job->state = SOUNDLOAD_DECODED;
+		soundLoadPool.numDecoded++;
+		soundLoadPool.done.notify_all();
+	}
+}
+
+void S_ShutdownSoundLoadThreads( void )
+{
+	int i;
+
+	S_FinishAllSoundLoads();
+
+	if ( !soundLoadPool.numThreads ) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> l( soundLoadPool.lock );
+		soundLoadPool.quit = qtrue;
+	}
+	soundLoadPool.wake.notify_all();
+
+	for ( i = 0 ; i < soundLoadPool.numThreads ; i++ ) {
+		soundLoadPool.threads[i]->join();
+		delete soundLoadPool.threads[i];
+		soundLoadPool.threads[i] = nullptr;
+	}
+	soundLoadPool.numThreads = 0;
+	soundLoadPool.quit = qfalse;
+}
+
+static void S_StartSoundLoadThreads( int numThreads )
+{
+	int i;
+
+	S_ShutdownSoundLoadThreads();
+
+	for ( i = 0 ; i < numThreads ; i++ ) {
+		soundLoadPool.threads[i] = new std::thread( S_SoundLoadWorker );
+	}
+	soundLoadPool.numThreads = numThreads;
+}
+
+static soundLoadJob_t *S_NewSoundLoadJob( sfx_t *sfx, const char *sLoadName, byte *data, int size )
+{
+	soundLoadJob_t *job = new soundLoadJob_t();
+
+	job->sfx = sfx;
+	Q_strncpyz( job->sLoadName, sLoadName, sizeof(job->sLoadName) );
+	job->pbFileData = data;
+	job->iFileSize = size;
+	job->state = SOUNDLOAD_QUEUED;
+
+	return job;
+}
+
+static void S_QueueSoundLoadJob( soundLoadJob_t *job )
+{
+	job->sfx->pLoadJob = job;
+	soundLoadPool.pending.push_back( job );
+	soundLoadPool.numTotal++;
+
+	{
+		std::lock_guard<std::mutex> l( soundLoadPool.lock );
+		soundLoadPool.queue.push_back( job );
+	}
+	soundLoadPool.wake.notify_one();
+}
+
+// takes a decoded job back in on the main thread and deletes it
+static void S_CompleteSoundLoadJob( soundLoadJob_t *job )
+{
+	sfx_t *sfx = job->sfx;
+	const qboolean bWasInsideLoadSound = gbInsideLoadSound;
+
+	{
+		std::lock_guard<std::mutex> l( soundLoadPool.lock );
+		soundLoadPool.numDecoded--;
+	}
+
+	gbInsideLoadSound = qtrue;	// !!!!!!!!!!!!!
+
+	sfx->fVolRange = job->iVolRange;
+
+	// Open AL
+#ifdef USE_OPENAL
+	S_LoadSound_OpenALBuffer(sfx);
+#endif
+
+	FS_FreeFile( job->pbFileData );
+
+	gbInsideLoadSound = bWasInsideLoadSound;
+
+	sfx->pLoadJob = NULL;
+	sfx->bInMemory = qtrue;
+
+	std::vector<soundLoadJob_t *> &pending = soundLoadPool.pending;
+	pending.erase( std::find( pending.begin(), pending.end(), job ) );
+	if ( pending.empty() ) {
+		soundLoadPool.numLoaded = soundLoadPool.numTotal = 0;
+	} else {
+		soundLoadPool.numLoaded++;
+	}
+
+	delete job;
+}
+
+/*
+==============
+S_FinishSoundLoad
+
+Called when a sound that's still decoding is wanted right now
+==============
+*/
+void S_FinishSoundLoad( sfx_t *sfx )
+{
+	soundLoadJob_t *job = sfx->pLoadJob;
+
+	if ( !job ) {
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> l( soundLoadPool.lock );
+
+		if ( job->state == SOUNDLOAD_QUEUED )
+		{
+			// quicker to do it here than wait for the ones in front of it
+			soundLoadPool.queue.erase( std::find( soundLoadPool.queue.begin(), soundLoadPool.queue.end(), job ) );
+			job->state = SOUNDLOAD_RUNNING;
+
+			l.unlock();
+			S_RunSoundLoadJob( job );
+			l.lock();
+
+			job->state = SOUNDLOAD_DECODED;
+			soundLoadPool.numDecoded++;
+		}
+		else
+		{
+			soundLoadPool.done.wait( l, [job] { return job->state == SOUNDLOAD_DECODED; } );
+		}
+	}
+
+	S_CompleteSoundLoadJob( job );
+}
+
+void S_FinishAllSoundLoads( void )
+{
+	while ( !soundLoadPool.pending.empty() ) {
+		S_FinishSoundLoad( soundLoadPool.pending.back()->sfx );
+	}
+}
+
+void S_UpdateSoundLoads( int msec )
+{
+	std::vector<soundLoadJob_t *> decoded;
+
+	if ( soundLoadPool.pending.empty() ) {
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> l( soundLoadPool.lock );
+
+		if ( msec > 0 ) {
+			soundLoadPool.done.wait_for( l, std::chrono::milliseconds( msec ), [] { return soundLoadPool.numDecoded > 0; } );
+		}
+		if ( !soundLoadPool.numDecoded ) {
+			return;
+		}
+
+		for ( soundLoadJob_t *job : soundLoadPool.pending ) {
+			if ( job->state == SOUNDLOAD_DECODED ) {
+				decoded.push_back( job );
+			}
+		}
+	}
+
+	for ( soundLoadJob_t *job : decoded ) {
+		S_CompleteSoundLoadJob( job );
+	}
+}
+
+void S_GetLoadProgress( int *piLoaded, int *piTotal )
+{
+	*piLoaded = soundLoadPool.numLoaded;
+	*piTotal = soundLoadPool.numTotal;
+}
+
+
 /*
 ==============
 S_LoadSound
 
 The filename may be different than sfx->name in the case
 of a forced fallback of a player specific sound	(or of a wav/mp3 substitution now -Ste)
+
+With bAsync the decode may be left to the load threads (see above)
 ==============
 */
-qboolean gbInsideLoadSound = qfalse;
-static qboolean S_LoadSound_Actual( sfx_t *sfx )
+static qboolean S_LoadSound_Actual( sfx_t *sfx, qboolean bAsync )
 {
 	byte	*data;
-	short	*samples;
 	wavinfo_t	info;
 	int		size;
 	char	*psExt;
@@ -807,82 +1200,11 @@ static qboolean S_LoadSound_Actual( sfx_t *sfx )
 				//
 				// unpack and convert into WAV...
 				//
-				{
-					byte *pbUnpackBuffer = (byte *) Z_Malloc( iRawPCMDataSize+10 +2304 /* <g> */, TAG_TEMP_WORKSPACE, qfalse );	// won't return if fails
+				byte *pbUnpackBuffer = (byte *) Z_Malloc( iRawPCMDataSize+10 +2304 /* <g> */, TAG_TEMP_WORKSPACE, qfalse );	// won't return if fails
 
-					{
-						int iResultBytes = MP3_UnpackRawPCM( sLoadName, data, size, pbUnpackBuffer, qfalse );
-
-						if (iResultBytes!= iRawPCMDataSize){
-							Com_Printf(S_COLOR_YELLOW"**** MP3 %s final unpack size %d different to previous value %d\n",sLoadName,iResultBytes,iRawPCMDataSize);
-							//assert (iResultBytes == iRawPCMDataSize);
-						}
-
-
-						// fake up a WAV structure so I can use the other post-load sound code such as volume calc for lip-synching
-						//
-						// (this is a bit crap really, but it lets me drop through into existing code)...
-						//
-						MP3_FakeUpWAVInfo( sLoadName, data, size, iResultBytes,
-											// these params are all references...
-											info.format, info.rate, info.width, info.channels, info.samples, info.dataofs,
-											qfalse
-										);
-
-						S_LoadSound_Finalize(&info,sfx,pbUnpackBuffer);
-
-#ifdef Q3_BIG_ENDIAN
-						// the MP3 decoder returns the samples in the correct endianness, but ResampleSfx byteswaps them,
-						// so we have to swap them again...
-						sfx->fVolRange	= 0;
-
-						for (int i = 0; i < sfx->iSoundLengthInSamples; i++)
-						{
-							sfx->pSoundData[i] = LittleShort(sfx->pSoundData[i]);
-							// C++11 defines double abs(short) which is not what we want here,
-							// because double >> int is not defined. Force interpretation as int
-							if (sfx->fVolRange < (abs(static_cast<int>(sfx->pSoundData[i])) >> 8))
-							{
-								sfx->fVolRange = abs(static_cast<int>(sfx->pSoundData[i])) >> 8;
-							}
-						}
-#endif
+				int iResultBytes = MP3_UnpackRawPCM( sLoadName, data, size, pbUnpackBuffer, qfalse );
 
-						// Open AL
-#ifdef USE_OPENAL
-						if (s_UseOpenAL)
-						{
-							if ((strstr(sfx->sSoundName, "chars")) || (strstr(sfx->sSoundName, "CHARS")))
-							{
-								sfx->lipSyncData = (char *)Z_Malloc((sfx->iSoundLengthInSamples / 1000) + 1, TAG_SND_RAWDATA, qfalse);
-								S_PreProcessLipSync(sfx);
-							}
-							else
-								sfx->lipSyncData = NULL;
-
-							// Clear Open AL Error state
-							alGetError();
-
-							// Generate AL Buffer
-                            ALuint Buffer;
-							alGenBuffers(1, &Buffer);
-							if (alGetError() == AL_NO_ERROR)
-							{
-								// Copy audio data to AL Buffer
-								alBufferData(Buffer, AL_FORMAT_MONO16, sfx->pSoundData, sfx->iSoundLengthInSamples*2, 22050);
-								if (alGetError() == AL_NO_ERROR)
-								{
-									sfx->Buffer = Buffer;
-									Z_Free(sfx->pSoundData);
-									sfx->pSoundData = NULL;
-								}
-							}
-						}
-#endif
-
-						Z_Free(pbUnpackBuffer);
-					}
-				}
+				S_LoadSound_UnpackedMP3( sfx, sLoadName, data, size, pbUnpackBuffer, iResultBytes, iRawPCMDataSize );
 			}
 		}
 		else
@@ -914,47 +1236,32 @@ static qboolean S_LoadSound_Actual( sfx_t *sfx )
 			Com_Printf(S_COLOR_YELLOW "WARNING: %s is not a 22kHz wav file\n", sLoadName);
 		}
 */
-		samples = (short *)Z_Malloc(info.samples * sizeof(short) * 2, TAG_TEMP_WORKSPACE, qfalse);
-
 		sfx->eSoundCompressionMethod = ct_16;
 		sfx->iSoundLengthInSamples	 = info.samples;
 		sfx->pSoundData = NULL;
-		ResampleSfx( sfx, info.rate, info.width, data + info.dataofs );
 
-		// Open AL
-#ifdef USE_OPENAL
-		if (s_UseOpenAL)
+		float fStepScale = ResampleSfx_Alloc( sfx, info.rate );
+
+		if (bAsync)
 		{
-			if ((strstr(sfx->sSoundName, "chars")) || (strstr(sfx->sSoundName, "CHARS")))
-			{
-				sfx->lipSyncData = (char *)Z_Malloc((sfx->iSoundLengthInSamples / 1000) + 1, TAG_SND_RAWDATA, qfalse);
-				S_PreProcessLipSync(sfx);
-			}
-			else
-				sfx->lipSyncData = NULL;
+			soundLoadJob_t *job = S_NewSoundLoadJob( sfx, sLoadName, data, size );
 
-			// Clear Open AL Error State
-			alGetError();
+			job->pOut = sfx->pSoundData;
+			job->iOutCount = sfx->iSoundLengthInSamples;
+			job->fStepScale = fStepScale;
+			job->iInWidth = info.width;
+			job->pbInData = data + info.dataofs;
+			S_QueueSoundLoadJob( job );
 
-			// Generate AL Buffer
-            ALuint Buffer;
-			alGenBuffers(1, &Buffer);
-			if (alGetError() == AL_NO_ERROR)
-			{
-				// Copy audio data to AL Buffer
-				alBufferData(Buffer, AL_FORMAT_MONO16, sfx->pSoundData, sfx->iSoundLengthInSamples*2, 22050);
-				if (alGetError() == AL_NO_ERROR)
-				{
-					// Store AL Buffer in sfx struct, and release sample data
-					sfx->Buffer = Buffer;
-					Z_Free(sfx->pSoundData);
-					sfx->pSoundData = NULL;
-				}
-			}
+			return qtrue;	// the file stays loaded until the job's taken in
 		}
-#endif
 
-		Z_Free(samples);
+		sfx->fVolRange = ResampleSfx_Samples( sfx->pSoundData, sfx->iSoundLengthInSamples, fStepScale, info.width, data + info.dataofs );
+
+		// Open AL
+#ifdef USE_OPENAL
+		S_LoadSound_OpenALBuffer(sfx);
+#endif
 	}
 
 	FS_FreeFile( data );
@@ -970,7 +1277,29 @@ qboolean S_LoadSound( sfx_t *sfx )
 {
 	gbInsideLoadSound = qtrue;	// !!!!!!!!!!!!!
 
-		qboolean bReturn = S_LoadSound_Actual( sfx );
+		qboolean bReturn = S_LoadSound_Actual( sfx, qfalse );
+
+	gbInsideLoadSound = qfalse;	// !!!!!!!!!!!!!
+
+	return bReturn;
+}
+
+// as above, but only waits for what can't be done on a load thread
+//
+qboolean S_LoadSoundAsync( sfx_t *sfx )
+{
+	const int numThreads = Com_Clampi( 0, MAX_SOUND_LOAD_THREADS, s_loadThreads->integer );
+	if ( numThreads != soundLoadPool.numThreads ) {
+		S_StartSoundLoadThreads( numThreads );
+	}
+
+	if ( !numThreads ) {
+		return S_LoadSound( sfx );
+	}
+
+	gbInsideLoadSound = qtrue;	// !!!!!!!!!!!!!
+
+		qboolean bReturn = S_LoadSound_Actual( sfx, qtrue );
 
 	gbInsideLoadSound = qfalse;	// !!!!!!!!!!!!!
 
@@ -25,6 +25,9 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 
 #include "client.h"
 #include "snd_local.h"
+#include "snd_mixkernels.h"
+
+static_assert( sizeof( portable_samplepair_t ) == 2 * sizeof( int ), "the mix kernels treat the paint buffer as ints" );
 
 portable_samplepair_t paintbuffer[PAINTBUFFER_SIZE];
 int 	*snd_p, snd_linear_count, snd_vol;
@@ -32,122 +35,11 @@ short	*snd_out;
 
 
 
-// FIXME: proper fix for that ?
-#if !defined(_MSC_VER) || !id386
 void S_WriteLinearBlastStereo16 (void)
 {
-	int		i;
-	int		val;
-
-	for (i=0 ; i<snd_linear_count ; i+=2)
-	{
-		val = snd_p[i]>>8;
-		if (val > 0x7fff)
-			snd_out[i] = 0x7fff;
-		else if (val < (short)0x8000)
-			snd_out[i] = (short)0x8000;
-		else
-			snd_out[i] = val;
-
-		val = snd_p[i+1]>>8;
-		if (val > 0x7fff)
-			snd_out[i+1] = 0x7fff;
-		else if (val < (short)0x8000)
-			snd_out[i+1] = (short)0x8000;
-		else
-			snd_out[i+1] = val;
-	}
-}
-#else
-unsigned int uiMMXAvailable = 0;	// leave as 32 bit
-__declspec( naked ) void S_WriteLinearBlastStereo16 (void)
-{
-	__asm {
-
- push edi
- push ebx
-
- mov ecx,ds:dword ptr[snd_linear_count]		// snd_linear_count is always even at this point, but not nec. mult of 4
- mov ebx,ds:dword ptr[snd_p]
- mov edi,ds:dword ptr[snd_out]
-
- cmp		[uiMMXAvailable], dword ptr 0
- je			NoMMX
-
-// writes 8 items (128 bits) per loop pass...
-//
- cmp		ecx,8
- jb			NoMMX
-
-LWLBLoopTop_MMX:
-
- movq		mm1,[-8+ebx+ecx*4]
- movq		mm0,[-16+ebx+ecx*4]
- movq		mm3,[-24+ebx+ecx*4]
- movq		mm2,[-32+ebx+ecx*4]
- psrad		mm0,8
- psrad		mm1,8
- psrad		mm2,8
- psrad		mm3,8
- packssdw	mm0,mm1
- packssdw	mm2,mm3
- movq		[-8+edi+ecx*2],mm0
- movq		[-16+edi+ecx*2],mm2
-
- sub		ecx,8
- cmp		ecx,8
- jae		LWLBLoopTop_MMX
-
- emms
-
- // now deal with any remaining count...
- //
- jecxz		LExit
-
-NoMMX:
-
-// writes 2 items (32 bits) per loop pass...
-//
-LWLBLoopTop:
- mov eax,ds:dword ptr[-8+ebx+ecx*4]
- sar eax,8
- cmp eax,07FFFh
- jg LClampHigh
- cmp eax,0FFFF8000h
- jnl LClampDone
- mov eax,0FFFF8000h
- jmp LClampDone
-LClampHigh:
- mov eax,07FFFh
-LClampDone:
- mov edx,ds:dword ptr[-4+ebx+ecx*4]
- sar edx,8
- cmp edx,07FFFh
- jg LClampHigh2
- cmp edx,0FFFF8000h
- jnl LClampDone2
- mov edx,0FFFF8000h
- jmp LClampDone2
-LClampHigh2:
- mov edx,07FFFh
-LClampDone2:
- shl edx,16
- and eax,0FFFFh
- or edx,eax
- mov ds:dword ptr[-4+edi+ecx*2],edx
-
- sub ecx,2
- jnz LWLBLoopTop
-
-LExit:
- pop ebx
- pop edi
- ret
-	}
+	S_MixClip16( snd_out, snd_p, snd_linear_count );
 }
 
-#endif
-
 
 void S_TransferStereo16 (unsigned long *pbuf, int endtime)
 {
@@ -261,6 +153,84 @@ void S_TransferPaintBuffer(int endtime)
 }
 
 
+/*
+===============================================================================
+
+MIX RECORDING
+
+===============================================================================
+*/
+static fileHandle_t	mixRecordFile;
+static int			mixRecordPasses;	// paint buffer fills left to capture
+
+static void S_MixRecord( sndMixRecordType_t type, int count, int bufferOffset, int leftVol, int rightVol, int sampleOffset, float dopplerScale, const void *data, int numData, int dataSize )
+{
+	sndMixRecord_t rec;
+
+	rec.type = type;
+	rec.count = count;
+	rec.bufferOffset = bufferOffset;
+	rec.leftVol = leftVol;
+	rec.rightVol = rightVol;
+	rec.sampleOffset = sampleOffset;
+	rec.dopplerScale = dopplerScale;
+	rec.numData = numData;
+
+	FS_Write( &rec, sizeof( rec ), mixRecordFile );
+	if ( numData ) {
+		FS_Write( data, numData * dataSize, mixRecordFile );
+	}
+}
+
+void S_StopMixRecord( void )
+{
+	if ( !mixRecordFile ) {
+		return;
+	}
+
+	FS_FCloseFile( mixRecordFile );
+	mixRecordFile = 0;
+	mixRecordPasses = 0;
+	Com_Printf( "Stopped mix recording\n" );
+}
+
+/*
+=================
+S_MixRecord_f
+
+s_mixrecord <file> [passes], writes what the software mixer paints for the
+mixer benchmark in tests/client/mix.cpp
+=================
+*/
+void S_MixRecord_f( void )
+{
+	char name[MAX_QPATH];
+	int ident = SNDMIX_RECORD_IDENT;
+
+	if ( Cmd_Argc() < 2 ) {
+		Com_Printf( "Usage: s_mixrecord <file> [passes]\n" );
+		return;
+	}
+
+	S_StopMixRecord();
+
+	Q_strncpyz( name, Cmd_Argv( 1 ), sizeof( name ) );
+	COM_DefaultExtension( name, sizeof( name ), ".mix" );
+
+	mixRecordFile = FS_FOpenFileWrite( name );
+	if ( !mixRecordFile ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: couldn't open %s\n", name );
+		return;
+	}
+
+	FS_Write( &ident, sizeof( ident ), mixRecordFile );
+	mixRecordPasses = Cmd_Argc() > 2 ? atoi( Cmd_Argv( 2 ) ) : 500;
+	if ( mixRecordPasses <= 0 ) {
+		mixRecordPasses = 500;
+	}
+	Com_Printf( "Recording %i mixer passes to %s\n", mixRecordPasses, name );
+}
+
 /*
 ===============================================================================
 
@@ -279,66 +249,51 @@ static void S_PaintChannelFrom16( channel_t *ch, const sfx_t *sfx, int count, in
 
 	pSamplesDest	= &paintbuffer[ bufferOffset ];
 
+	if ( !ch->doppler || !(ch->dopplerScale > 1) )
+	{
+		// fixed rate, every sample is used once
+		if ( mixRecordFile ) {
+			S_MixRecord( SNDMIXREC_CHANNEL, count, bufferOffset, iLeftVol, iRightVol, sampleOffset, 1.0f, &sfx->pSoundData[ sampleOffset ], count, sizeof( short ) );
+		}
+		S_MixPaint16( (int *)pSamplesDest, &sfx->pSoundData[ sampleOffset ], count, iLeftVol, iRightVol );
+		return;
+	}
+
+	if ( mixRecordFile && count > 0 ) {
+		// same float steps as below, to find the last sample read
+		for ( int i=1 ; i<count ; i++ )
+		{
+			ofst += 1 * ch->dopplerScale;
+		}
+		S_MixRecord( SNDMIXREC_CHANNEL, count, bufferOffset, iLeftVol, iRightVol, sampleOffset, ch->dopplerScale, &sfx->pSoundData[ sampleOffset ], (int)ofst - sampleOffset + 1, sizeof( short ) );
+		ofst = sampleOffset;
+	}
+
 	for ( int i=0 ; i<count ; i++ )
 	{
 		iData = sfx->pSoundData[ (int)ofst ];
 
 		pSamplesDest[i].left  += (iData * iLeftVol )>>8;
 		pSamplesDest[i].right += (iData * iRightVol)>>8;
-		if (ch->doppler && ch->dopplerScale > 1) {
-			ofst += 1 * ch->dopplerScale;
-		} else {
-			ofst++;
-		}
+		ofst += 1 * ch->dopplerScale;
 	}
 }
 
 
 void S_PaintChannelFromMP3( channel_t *ch, const sfx_t *sc, int count, int sampleOffset, int bufferOffset )
 {
-	int data;
 	int leftvol, rightvol;
-	signed short *sfx;
-	int	i;
-	portable_samplepair_t	*samp;
 	static short tempMP3Buffer[PAINTBUFFER_SIZE];
 
 	MP3Stream_GetSamples( ch, sampleOffset, count, tempMP3Buffer, qfalse );	// qfalse = not stereo
 
 	leftvol = ch->leftvol*snd_vol;
 	rightvol = ch->rightvol*snd_vol;
-	sfx = tempMP3Buffer;
-
-	samp = &paintbuffer[ bufferOffset ];
-
-
-	while ( count & 3 ) {
-		data = *sfx;
-		samp->left += (data * leftvol)>>8;
-		samp->right += (data * rightvol)>>8;
 
-		sfx++;
-		samp++;
-		count--;
-	}
-
-	for ( i=0 ; i<count ; i += 4 ) {
-		data = sfx[i];
-		samp[i].left += (data * leftvol)>>8;
-		samp[i].right += (data * rightvol)>>8;
-
-		data = sfx[i+1];
-		samp[i+1].left += (data * leftvol)>>8;
-		samp[i+1].right += (data * rightvol)>>8;
-
-		data = sfx[i+2];
-		samp[i+2].left += (data * leftvol)>>8;
-		samp[i+2].right += (data * rightvol)>>8;
-
-		data = sfx[i+3];
-		samp[i+3].left += (data * leftvol)>>8;
-		samp[i+3].right += (data * rightvol)>>8;
+	if ( mixRecordFile ) {
+		S_MixRecord( SNDMIXREC_CHANNEL, count, bufferOffset, leftvol, rightvol, 0, 1.0f, tempMP3Buffer, count, sizeof( short ) );
 	}
+	S_MixPaint16( (int *)&paintbuffer[ bufferOffset ], tempMP3Buffer, count, leftvol, rightvol );
 }
 
 
@@ -415,6 +370,10 @@ void S_PaintChannels( int endtime ) {
 			}
 		}
 
+		if ( mixRecordFile ) {
+			S_MixRecord( SNDMIXREC_BEGIN, end - s_paintedtime, s_paintedtime, 0, 0, 0, 1.0f, paintbuffer, (end - s_paintedtime) * 2, sizeof( int ) );
+		}
+
 		// paint in the channels.
 		ch = s_channels;
 		for ( i = 0; i < MAX_CHANNELS ; i++, ch++ ) {
@@ -492,6 +451,12 @@ void S_PaintChannels( int endtime ) {
 */
 		// transfer out according to DMA format
 		S_TransferPaintBuffer( end );
+		if ( mixRecordFile ) {
+			S_MixRecord( SNDMIXREC_TRANSFER, end - s_paintedtime, s_paintedtime, 0, 0, 0, 1.0f, NULL, 0, 0 );
+			if ( --mixRecordPasses <= 0 ) {
+				S_StopMixRecord();
+			}
+		}
 		s_paintedtime = end;
 	}
 }
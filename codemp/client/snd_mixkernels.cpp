@@ -0,0 +1,172 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+#include "snd_mixkernels.h"
+
+#include <stddef.h>
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#define SNDMIX_X86
+#include <emmintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define SNDMIX_TARGET(x)
+#else
+#define SNDMIX_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+static void S_MixPaint16Scalar( int *paint, const short *data, int count, int leftVol, int rightVol )
+{
+	for ( int i = 0; i < count; i++ )
+	{
+		const int iData = data[i];
+
+		paint[i*2+0] += ( iData * leftVol ) >> 8;
+		paint[i*2+1] += ( iData * rightVol ) >> 8;
+	}
+}
+
+static void S_MixClip16Scalar( short *out, const int *in, int count )
+{
+	for ( int i = 0; i < count; i++ )
+	{
+		const int val = in[i] >> 8;
+
+		if ( val > 0x7fff )
+			out[i] = 0x7fff;
+		else if ( val < (short)0x8000 )
+			out[i] = (short)0x8000;
+		else
+			out[i] = val;
+	}
+}
+
+static const sndMixFuncs_t mixScalar = { S_MixPaint16Scalar, S_MixClip16Scalar };
+
+#ifdef SNDMIX_X86
+
+// low 32 bits of a * b for the pairs (a0, a1) and (a2, a3) of a against (b0, b1) of b,
+// SSE2 has no 32 bit multiply so it's done as two 64 bit ones
+SNDMIX_TARGET("sse2")
+static inline __m128i S_MixMulPairs( __m128i a, __m128i b )
+{
+	const __m128i even = _mm_mul_epu32( a, b );
+	const __m128i odd = _mm_mul_epu32( _mm_srli_epi64( a, 32 ), _mm_srli_epi64( b, 32 ) );
+
+	return _mm_unpacklo_epi32( _mm_shuffle_epi32( even, _MM_SHUFFLE( 0, 0, 2, 0 ) ),
+								_mm_shuffle_epi32( odd, _MM_SHUFFLE( 0, 0, 2, 0 ) ) );
+}
+
+SNDMIX_TARGET("sse2")
+static void S_MixPaint16SSE2( int *paint, const short *data, int count, int leftVol, int rightVol )
+{
+	const __m128i vol = _mm_set_epi32( rightVol, leftVol, rightVol, leftVol );
+	int i = 0;
+
+	for ( ; i + 4 <= count; i += 4 )
+	{
+		// sign extend 4 samples, then double each up for left and right
+		const __m128i d16 = _mm_loadl_epi64( (const __m128i *)( data + i ) );
+		const __m128i d32 = _mm_srai_epi32( _mm_unpacklo_epi16( d16, d16 ), 16 );
+		const __m128i lo = S_MixMulPairs( _mm_unpacklo_epi32( d32, d32 ), vol );
+		const __m128i hi = S_MixMulPairs( _mm_unpackhi_epi32( d32, d32 ), vol );
+
+		__m128i *p = (__m128i *)( paint + i*2 );
+		_mm_storeu_si128( p + 0, _mm_add_epi32( _mm_loadu_si128( p + 0 ), _mm_srai_epi32( lo, 8 ) ) );
+		_mm_storeu_si128( p + 1, _mm_add_epi32( _mm_loadu_si128( p + 1 ), _mm_srai_epi32( hi, 8 ) ) );
+	}
+
+	S_MixPaint16Scalar( paint + i*2, data + i, count - i, leftVol, rightVol );
+}
+
+SNDMIX_TARGET("sse2")
+static void S_MixClip16SSE2( short *out, const int *in, int count )
+{
+	int i = 0;
+
+	// the saturating pack is the clamp
+	for ( ; i + 8 <= count; i += 8 )
+	{
+		const __m128i a = _mm_srai_epi32( _mm_loadu_si128( (const __m128i *)( in + i ) ), 8 );
+		const __m128i b = _mm_srai_epi32( _mm_loadu_si128( (const __m128i *)( in + i + 4 ) ), 8 );
+
+		_mm_storeu_si128( (__m128i *)( out + i ), _mm_packs_epi32( a, b ) );
+	}
+
+	S_MixClip16Scalar( out + i, in + i, count - i );
+}
+
+static const sndMixFuncs_t mixSSE2 = { S_MixPaint16SSE2, S_MixClip16SSE2 };
+
+static bool S_MixCpuHasSSE2( void )
+{
+#if defined(_M_X64) || defined(__x86_64__)
+	return true;
+#elif defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid( info, 1 );
+	return ( info[3] & ( 1 << 26 ) ) != 0;
+#else
+	return __builtin_cpu_supports( "sse2" ) != 0;
+#endif
+}
+
+#endif // SNDMIX_X86
+
+const sndMixFuncs_t *S_GetMixKernel( sndMixKernel_t kernel )
+{
+	switch ( kernel )
+	{
+	case SNDMIX_SCALAR:
+		return &mixScalar;
+#ifdef SNDMIX_X86
+	case SNDMIX_SSE2:
+		return S_MixCpuHasSSE2() ? &mixSSE2 : NULL;
+#endif
+	default:
+		return NULL;
+	}
+}
+
+static const sndMixFuncs_t *S_MixFuncs( void )
+{
+	static const sndMixFuncs_t *mixFuncs = NULL;
+
+	if ( !mixFuncs )
+	{
+		for ( int kernel = SNDMIX_NUM_KERNELS - 1 ; !mixFuncs ; kernel-- )
+		{
+			mixFuncs = S_GetMixKernel( (sndMixKernel_t)kernel );
+		}
+	}
+
+	return mixFuncs;
+}
+
+void S_MixPaint16( int *paint, const short *data, int count, int leftVol, int rightVol )
+{
+	S_MixFuncs()->paint16( paint, data, count, leftVol, rightVol );
+}
+
+void S_MixClip16( short *out, const int *in, int count )
+{
+	S_MixFuncs()->clip16( out, in, count );
+}
@@ -0,0 +1,74 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+#pragma once
+
+// Inner loops of the software mixer, several samples at a time.
+//
+// The paint buffer is handled as plain ints, a left and a right value per
+// sample as in portable_samplepair_t. The SSE2 kernels do the same integer
+// operations as the scalar loops of snd_mix.cpp, wrapping included, so they
+// give bit identical output.
+
+typedef enum {
+	SNDMIX_SCALAR,
+	SNDMIX_SSE2,
+	SNDMIX_NUM_KERNELS
+} sndMixKernel_t;
+
+typedef struct sndMixFuncs_s {
+	// adds ( data[i] * vol ) >> 8 of count mono samples to the left/right pairs of paint
+	void	(*paint16)( int *paint, const short *data, int count, int leftVol, int rightVol );
+
+	// clamps in[i] >> 8 to a short, count is in values rather than pairs
+	void	(*clip16)( short *out, const int *in, int count );
+} sndMixFuncs_t;
+
+// best kernel the cpu supports, picked on first use
+void				S_MixPaint16( int *paint, const short *data, int count, int leftVol, int rightVol );
+void				S_MixClip16( short *out, const int *in, int count );
+
+// NULL if the kernel isn't built in or the cpu can't run it
+const sndMixFuncs_t	*S_GetMixKernel( sndMixKernel_t kernel );
+
+// The s_mixrecord command captures what S_PaintChannels mixes, so the mixer
+// benchmark in tests/client/mix.cpp can replay real play. The file is
+// SNDMIX_RECORD_IDENT followed by records, each followed by numData values:
+// ints for SNDMIXREC_BEGIN and shorts for SNDMIXREC_CHANNEL, in the byte order
+// of the machine that recorded it.
+
+#define SNDMIX_RECORD_IDENT		(('1'<<24)+('X'<<16)+('I'<<8)+'M')
+
+typedef enum {
+	SNDMIXREC_BEGIN,		// the paint buffer before any channel, count left/right pairs of raw stream
+	SNDMIXREC_CHANNEL,		// one ChannelPaint
+	SNDMIXREC_TRANSFER		// count samples of the paint buffer clipped into dma
+} sndMixRecordType_t;
+
+typedef struct sndMixRecord_s {
+	int		type;			// sndMixRecordType_t
+	int		count;			// samples painted or transferred
+	int		bufferOffset;	// into the paint buffer, s_paintedtime for BEGIN and TRANSFER
+	int		leftVol;		// snd_vol already applied
+	int		rightVol;
+	int		sampleOffset;	// the doppler loop's float offset starts here, the data is from this sample on
+	float	dopplerScale;	// 1 unless the doppler loop painted it
+	int		numData;
+} sndMixRecord_t;
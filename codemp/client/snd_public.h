@@ -76,6 +76,12 @@ void S_BeginRegistration( void );
 // checks for missing files
 sfxHandle_t	S_RegisterSound( const char *sample );
 
+// registered sounds may still be decoding on the load threads, loaded counts up to
+// total as they come in and both drop back to 0 once nothing is left
+void S_GetLoadProgress( int *piLoaded, int *piTotal );
+// takes in the sounds that finished decoding, waiting up to msec for one if none have
+void S_UpdateSoundLoads( int msec );
+
 extern qboolean s_shutUp;
 
 void S_FreeAllSFXMem(void);
@@ -64,12 +64,17 @@ determine if NPC can see an entity
 This is a straight line trace check.  This function does not look at PVS or FOV,
 or take any AI related factors (for example, the NPC's reaction time) into account
 
+The origin is tried on its own since it's usually enough, if it's blocked the head
+and legs are traced together so the engine only gathers the entities around them once
+
 FIXME do we need fat and thin version of this?
 */
 qboolean CanSee ( gentity_t *ent )
 {
-	trace_t		tr;
+	trace_t		tr, spotTraces[2];
+	traceRequest_t	spots[2];
 	vec3_t		eyes, spot;
+	int			i;
 
 	CalcEntitySpot( NPCS.NPC, SPOT_HEAD_LEAN, eyes );
 
@@ -81,20 +86,33 @@ qboolean CanSee ( gentity_t *ent )
 		return qtrue;
 	}
 
-	CalcEntitySpot( ent, SPOT_HEAD, spot );
-	trap->Trace ( &tr, eyes, NULL, NULL, spot, NPCS.NPC->s.number, MASK_OPAQUE, qfalse, 0, 0 );
-	ShotThroughGlass (&tr, ent, spot, MASK_OPAQUE);
-	if ( tr.fraction == 1.0 )
+	memset( spots, 0, sizeof( spots ) );
+	for ( i = 0; i < 2; i++ )
 	{
-		return qtrue;
+		VectorCopy( eyes, spots[i].start );
+		CalcEntitySpot( ent, i ? SPOT_LEGS : SPOT_HEAD, spots[i].end );
+		spots[i].passEntityNum = NPCS.NPC->s.number;
+		spots[i].contentmask = MASK_OPAQUE;
+	}
+	if ( trap->TraceBatch )
+	{
+		trap->TraceBatch( spots, spotTraces, 2 );
+	}
+	else
+	{ //older engine
+		for ( i = 0; i < 2; i++ )
+		{
+			trap->Trace( &spotTraces[i], spots[i].start, NULL, NULL, spots[i].end, spots[i].passEntityNum, spots[i].contentmask, qfalse, 0, 0 );
+		}
 	}
 
-	CalcEntitySpot( ent, SPOT_LEGS, spot );
-	trap->Trace ( &tr, eyes, NULL, NULL, spot, NPCS.NPC->s.number, MASK_OPAQUE, qfalse, 0, 0 );
-	ShotThroughGlass (&tr, ent, spot, MASK_OPAQUE);
-	if ( tr.fraction == 1.0 )
+	for ( i = 0; i < 2; i++ )
 	{
-		return qtrue;
+		ShotThroughGlass (&spotTraces[i], ent, spots[i].end, MASK_OPAQUE);
+		if ( spotTraces[i].fraction == 1.0 )
+		{
+			return qtrue;
+		}
 	}
 
 	return qfalse;
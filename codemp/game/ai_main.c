@@ -1138,13 +1138,13 @@ qboolean BotPVSCheck( const vec3_t p1, const vec3_t p2 )
 //get the index to the nearest visible waypoint in the global trail
 int GetNearestVisibleWP(vec3_t org, int ignore)
 {
+	static int candidates[MAX_WPARRAY_SIZE];
 	int i;
 	float bestdist;
-	float flLen;
-	int bestindex;
-	vec3_t a, mins, maxs;
+	int numCandidates;
+	wpobject_t *wp;
+	vec3_t mins, maxs;
 
-	i = 0;
 	if (RMG.integer)
 	{
 		bestdist = 300;
@@ -1154,7 +1154,6 @@ int GetNearestVisibleWP(vec3_t org, int ignore)
 		bestdist = 800;//99999;
 				   //don't trace over 800 units away to avoid GIANT HORRIBLE SPEED HITS ^_^
 	}
-	bestindex = -1;
 
 	mins[0] = -15;
 	mins[1] = -15;
@@ -1163,24 +1162,20 @@ int GetNearestVisibleWP(vec3_t org, int ignore)
 	maxs[1] = 15;
 	maxs[2] = 1;
 
-	while (i < gWPNum)
+	numCandidates = GetWPGridCandidates(org, bestdist, candidates);
+
+	//nearest first, so the first visible one is it
+	for (i = 0; i < numCandidates; i++)
 	{
-		if (gWPArray[i] && gWPArray[i]->inuse)
-		{
-			VectorSubtract(org, gWPArray[i]->origin, a);
-			flLen = VectorLength(a);
+		wp = gWPArray[candidates[i]];
 
-			if (flLen < bestdist && (RMG.integer || BotPVSCheck(org, gWPArray[i]->origin)) && OrgVisibleBox(org, mins, maxs, gWPArray[i]->origin, ignore))
-			{
-				bestdist = flLen;
-				bestindex = i;
-			}
+		if ((RMG.integer || BotPVSCheck(org, wp->origin)) && OrgVisibleBox(org, mins, maxs, wp->origin, ignore))
+		{
+			return candidates[i];
 		}
-
-		i++;
 	}
 
-	return bestindex;
+	return -1;
 }
 
 //wpDirection
@@ -1227,70 +1222,9 @@ int PassWayCheck(bot_state_t *bs, int windex)
 //tally up the distance between two waypoints
 float TotalTrailDistance(int start, int end, bot_state_t *bs)
 {
-	int beginat;
-	int endat;
-	float distancetotal;
-
-	distancetotal = 0;
-
-	if (start > end)
-	{
-		beginat = end;
-		endat = start;
-	}
-	else
-	{
-		beginat = start;
-		endat = end;
-	}
-
-	while (beginat < endat)
-	{
-		if (beginat >= gWPNum || !gWPArray[beginat] || !gWPArray[beginat]->inuse)
-		{ //invalid waypoint index
-			return -1;
-		}
-
-		if (!RMG.integer)
-		{
-			if ((end > start && gWPArray[beginat]->flags & WPFLAG_ONEWAY_BACK) ||
-				(start > end && gWPArray[beginat]->flags & WPFLAG_ONEWAY_FWD))
-			{ //a one-way point, this means this path cannot be travelled to the final point
-				return -1;
-			}
-		}
-
-#if 0 //disabled force jump checks for now
-		if (gWPArray[beginat]->forceJumpTo)
-		{
-			if (gWPArray[beginat-1] && gWPArray[beginat-1]->origin[2]+64 < gWPArray[beginat]->origin[2])
-			{
-				gdif = gWPArray[beginat]->origin[2] - gWPArray[beginat-1]->origin[2];
-			}
-
-			if (gdif)
-			{
-				if (bs && bs->cur_ps.fd.forcePowerLevel[FP_LEVITATION] < gWPArray[beginat]->forceJumpTo)
-				{
-					return -1;
-				}
-			}
-		}
-
-		if (bs->wpCurrent && gWPArray[windex]->forceJumpTo &&
-			gWPArray[windex]->origin[2] > (bs->wpCurrent->origin[2]+64) &&
-			bs->cur_ps.fd.forcePowerLevel[FP_LEVITATION] < gWPArray[windex]->forceJumpTo)
-		{
-			return -1;
-		}
-#endif
-
-		distancetotal += gWPArray[beginat]->disttonext;
-
-		beginat++;
-	}
-
-	return distancetotal;
+	//force jump checks are disabled for now, so this doesn't depend on the bot
+	//and comes straight out of the trail table
+	return GetWPTrailDistance(start, end);
 }
 
 //see if there's a route shorter than our current one to get
@@ -374,6 +374,10 @@ void BotWaypointRender(void);
 int OrgVisibleBox(vec3_t org1, vec3_t mins, vec3_t maxs, vec3_t org2, int ignore);
 int BotIsAChickenWuss(bot_state_t *bs);
 int GetNearestVisibleWP(vec3_t org, int ignore);
+void BuildWPGrid(void);
+int GetWPGridCandidates(vec3_t org, float range, int *list);
+void BuildWPTrail(void);
+float GetWPTrailDistance(int start, int end);
 int GetBestIdleGoal(bot_state_t *bs);
 
 char *ConcatArgs( int start );
@@ -365,8 +365,298 @@ checkprint:
 	}
 }
 
+/*
+=================
+Waypoint grid
+
+Uniform grid over gWPArray on the XY plane, so the nearest waypoint queries
+only look at the cells within their range.  It's rebuilt when the path data
+is loaded, and lazily after the waypoints are edited.
+=================
+*/
+#define WPGRID_CELL_SIZE		256
+#define WPGRID_MAX_CELLS		64		//per axis, the cells get bigger on huge maps
+
+typedef struct wpGrid_s
+{
+	qboolean	dirty;
+	vec2_t		mins;
+	float		cellSize;
+	int			size[2];
+	int			cellStart[WPGRID_MAX_CELLS*WPGRID_MAX_CELLS+1];
+	int			indexes[MAX_WPARRAY_SIZE];
+} wpGrid_t;
+
+typedef struct wpGridCandidate_s
+{
+	float		dist;
+	int			index;
+} wpGridCandidate_t;
+
+static wpGrid_t wpGrid = { qtrue };
+static wpGridCandidate_t wpGridCandidates[MAX_WPARRAY_SIZE];
+
+/*
+=================
+Trail distances
+
+Running totals of disttonext and of the points that block travel along
+the trail, so the distance between any two points is a subtraction instead
+of a walk over every point in between.  The totals are kept in doubles, but
+a difference of two of them is not summed in the same order as the old float
+walk, so distances match it up to float rounding rather than bit for bit.
+=================
+*/
+typedef struct wpTrail_s
+{
+	qboolean	dirty;
+	int			numWPs;
+	double		dist[MAX_WPARRAY_SIZE+1];		//trail distance from point 0 to point i
+	int			invalid[MAX_WPARRAY_SIZE+1];	//missing or unused points before i
+	int			onewayFwd[MAX_WPARRAY_SIZE+1];	//WPFLAG_ONEWAY_FWD points before i
+	int			onewayBack[MAX_WPARRAY_SIZE+1];	//WPFLAG_ONEWAY_BACK points before i
+} wpTrail_t;
+
+static wpTrail_t wpTrail = { qtrue };
+
+//anything that moves, adds, removes or reflags a waypoint has to call this
+static void WaypointsChanged(void)
+{
+	wpGrid.dirty = qtrue;
+	wpTrail.dirty = qtrue;
+}
+
+void BuildWPTrail(void)
+{
+	wpobject_t *wp;
+	int i;
+
+	wpTrail.dirty = qfalse;
+	wpTrail.numWPs = gWPNum;
+	wpTrail.dist[0] = 0;
+	wpTrail.invalid[0] = wpTrail.onewayFwd[0] = wpTrail.onewayBack[0] = 0;
+
+	for (i = 0; i < gWPNum; i++)
+	{
+		wp = gWPArray[i];
+
+		wpTrail.dist[i+1] = wpTrail.dist[i];
+		wpTrail.invalid[i+1] = wpTrail.invalid[i];
+		wpTrail.onewayFwd[i+1] = wpTrail.onewayFwd[i];
+		wpTrail.onewayBack[i+1] = wpTrail.onewayBack[i];
+
+		if (!wp || !wp->inuse)
+		{
+			wpTrail.invalid[i+1]++;
+			continue;
+		}
+
+		wpTrail.dist[i+1] += wp->disttonext;
+		if (wp->flags & WPFLAG_ONEWAY_FWD)
+		{
+			wpTrail.onewayFwd[i+1]++;
+		}
+		if (wp->flags & WPFLAG_ONEWAY_BACK)
+		{
+			wpTrail.onewayBack[i+1]++;
+		}
+	}
+}
+
+//trail distance from start to end, -1 if it can't be travelled
+float GetWPTrailDistance(int start, int end)
+{
+	int beginat, endat;
+
+	if (wpTrail.dirty || wpTrail.numWPs != gWPNum)
+	{
+		BuildWPTrail();
+	}
+
+	if (start > end)
+	{
+		beginat = end;
+		endat = start;
+	}
+	else
+	{
+		beginat = start;
+		endat = end;
+	}
+
+	if (beginat == endat)
+	{
+		return 0;
+	}
+
+	if (beginat < 0 || endat > gWPNum || wpTrail.invalid[endat] != wpTrail.invalid[beginat])
+	{ //invalid waypoint index
+		return -1;
+	}
+
+	if (!RMG.integer)
+	{
+		if ((end > start && wpTrail.onewayBack[endat] != wpTrail.onewayBack[beginat]) ||
+			(start > end && wpTrail.onewayFwd[endat] != wpTrail.onewayFwd[beginat]))
+		{ //a one-way point, this means this path cannot be travelled to the final point
+			return -1;
+		}
+	}
+
+	return (float)(wpTrail.dist[endat] - wpTrail.dist[beginat]);
+}
+
+static int WPGridCell(float v, int axis)
+{
+	int c = (int)((v - wpGrid.mins[axis]) / wpGrid.cellSize);
+
+	if (c < 0)
+	{
+		return 0;
+	}
+	if (c >= wpGrid.size[axis])
+	{
+		return wpGrid.size[axis]-1;
+	}
+	return c;
+}
+
+void BuildWPGrid(void)
+{
+	vec2_t maxs;
+	int i, cell, numCells;
+
+	wpGrid.dirty = qfalse;
+	wpGrid.mins[0] = wpGrid.mins[1] = 0;
+	maxs[0] = maxs[1] = 0;
+
+	for (i = 0; i < gWPNum; i++)
+	{
+		if (!gWPArray[i])
+		{
+			continue;
+		}
+		if (i == 0 || gWPArray[i]->origin[0] < wpGrid.mins[0]) wpGrid.mins[0] = gWPArray[i]->origin[0];
+		if (i == 0 || gWPArray[i]->origin[1] < wpGrid.mins[1]) wpGrid.mins[1] = gWPArray[i]->origin[1];
+		if (i == 0 || gWPArray[i]->origin[0] > maxs[0]) maxs[0] = gWPArray[i]->origin[0];
+		if (i == 0 || gWPArray[i]->origin[1] > maxs[1]) maxs[1] = gWPArray[i]->origin[1];
+	}
+
+	wpGrid.cellSize = WPGRID_CELL_SIZE;
+	for (i = 0; i < 2; i++)
+	{
+		if ((maxs[i] - wpGrid.mins[i]) / wpGrid.cellSize >= WPGRID_MAX_CELLS)
+		{
+			wpGrid.cellSize = (maxs[i] - wpGrid.mins[i]) / (WPGRID_MAX_CELLS-1);
+		}
+	}
+	wpGrid.size[0] = (int)((maxs[0] - wpGrid.mins[0]) / wpGrid.cellSize) + 1;
+	wpGrid.size[1] = (int)((maxs[1] - wpGrid.mins[1]) / wpGrid.cellSize) + 1;
+	wpGrid.size[0] = Com_Clampi(1, WPGRID_MAX_CELLS, wpGrid.size[0]);
+	wpGrid.size[1] = Com_Clampi(1, WPGRID_MAX_CELLS, wpGrid.size[1]);
+	numCells = wpGrid.size[0]*wpGrid.size[1];
+
+	//count the waypoints per cell, then turn that into where each cell starts
+	memset(wpGrid.cellStart, 0, sizeof(wpGrid.cellStart));
+	for (i = 0; i < gWPNum; i++)
+	{
+		if (gWPArray[i])
+		{
+			cell = WPGridCell(gWPArray[i]->origin[1], 1)*wpGrid.size[0] + WPGridCell(gWPArray[i]->origin[0], 0);
+			wpGrid.cellStart[cell+1]++;
+		}
+	}
+	for (i = 0; i < numCells; i++)
+	{
+		wpGrid.cellStart[i+1] += wpGrid.cellStart[i];
+	}
+	for (i = 0; i < gWPNum; i++)
+	{
+		if (gWPArray[i])
+		{
+			cell = WPGridCell(gWPArray[i]->origin[1], 1)*wpGrid.size[0] + WPGridCell(gWPArray[i]->origin[0], 0);
+			wpGrid.indexes[wpGrid.cellStart[cell]++] = i;
+		}
+	}
+	//the fill moved every start to the next cell's
+	for (i = numCells; i > 0; i--)
+	{
+		wpGrid.cellStart[i] = wpGrid.cellStart[i-1];
+	}
+	wpGrid.cellStart[0] = 0;
+}
+
+static int WPGridCandidateCompare(const void *a, const void *b)
+{
+	const wpGridCandidate_t *ca = (const wpGridCandidate_t *)a;
+	const wpGridCandidate_t *cb = (const wpGridCandidate_t *)b;
+
+	if (ca->dist != cb->dist)
+	{
+		return (ca->dist < cb->dist) ? -1 : 1;
+	}
+	return ca->index - cb->index; //same order as a scan of gWPArray
+}
+
+//fills list with the waypoints closer than range to org, nearest first, and returns how many
+int GetWPGridCandidates(vec3_t org, float range, int *list)
+{
+	int x, y, x0, x1, y0, y1, i, num = 0;
+	wpobject_t *wp;
+	vec3_t a;
+	float dist;
+
+	if (wpGrid.dirty)
+	{
+		BuildWPGrid();
+	}
+
+	x0 = WPGridCell(org[0] - range, 0);
+	x1 = WPGridCell(org[0] + range, 0);
+	y0 = WPGridCell(org[1] - range, 1);
+	y1 = WPGridCell(org[1] + range, 1);
+
+	for (y = y0; y <= y1; y++)
+	{
+		for (x = x0; x <= x1; x++)
+		{
+			int cell = y*wpGrid.size[0] + x;
+
+			for (i = wpGrid.cellStart[cell]; i < wpGrid.cellStart[cell+1]; i++)
+			{
+				wp = gWPArray[wpGrid.indexes[i]];
+
+				if (!wp || !wp->inuse)
+				{
+					continue;
+				}
+
+				VectorSubtract(org, wp->origin, a);
+				dist = VectorLengthSquared(a);
+
+				if (dist < range*range)
+				{
+					wpGridCandidates[num].dist = dist;
+					wpGridCandidates[num].index = wpGrid.indexes[i];
+					num++;
+				}
+			}
+		}
+	}
+
+	qsort(wpGridCandidates, num, sizeof(wpGridCandidates[0]), WPGridCandidateCompare);
+
+	for (i = 0; i < num; i++)
+	{
+		list[i] = wpGridCandidates[i].index;
+	}
+	return num;
+}
+
 void TransferWPData(int from, int to)
 {
+	WaypointsChanged();
+
 	if (!gWPArray[to])
 	{
 		gWPArray[to] = (wpobject_t *)B_Alloc(sizeof(wpobject_t));
@@ -417,6 +707,7 @@ void CreateNewWP(vec3_t origin, int flags)
 	gWPArray[gWPNum]->inuse = 1;
 	VectorCopy(origin, gWPArray[gWPNum]->origin);
 	gWPNum++;
+	WaypointsChanged();
 }
 
 void CreateNewWP_FromObject(wpobject_t *wp)
@@ -470,6 +761,7 @@ void CreateNewWP_FromObject(wpobject_t *wp)
 	}
 
 	gWPNum++;
+	WaypointsChanged();
 }
 
 void RemoveWP(void)
@@ -480,6 +772,7 @@ void RemoveWP(void)
 	}
 
 	gWPNum--;
+	WaypointsChanged();
 
 	if (!gWPArray[gWPNum] || !gWPArray[gWPNum]->inuse)
 	{
@@ -573,6 +866,7 @@ void RemoveWP_InTrail(int afterindex)
 		i++;
 	}
 	gWPNum--;
+	WaypointsChanged();
 }
 
 int CreateNewWP_InTrail(vec3_t origin, int flags, int afterindex)
@@ -644,6 +938,7 @@ int CreateNewWP_InTrail(vec3_t origin, int flags, int afterindex)
 			gWPArray[i]->inuse = 1;
 			VectorCopy(origin, gWPArray[i]->origin);
 			gWPNum++;
+			WaypointsChanged();
 			break;
 		}
 
@@ -723,6 +1018,7 @@ int CreateNewWP_InsertUnder(vec3_t origin, int flags, int afterindex)
 			gWPArray[i]->inuse = 1;
 			VectorCopy(origin, gWPArray[i]->origin);
 			gWPNum++;
+			WaypointsChanged();
 			break;
 		}
 
@@ -785,6 +1081,7 @@ void WPFlagsModify(int wpnum, int flags)
 	}
 
 	gWPArray[wpnum]->flags = flags;
+	WaypointsChanged();
 }
 
 static int NotWithinRange(int base, int extent)
@@ -1027,6 +1324,9 @@ int ConnectTrail(int startindex, int endindex, qboolean behindTheScenes)
 	float baseheight;
 	float branchDistance;
 	float maxDistFactor = 256;
+	traceRequest_t drops[4];
+	trace_t dropTraces[4];
+	int d;
 	vec3_t a;
 	vec3_t startplace, starttrace;
 	vec3_t mins, maxs;
@@ -1043,6 +1343,7 @@ int ConnectTrail(int startindex, int endindex, qboolean behindTheScenes)
 		{
 			gWPArray[startindex]->flags |= WPFLAG_ONEWAY_FWD;
 			gWPArray[endindex]->flags |= WPFLAG_ONEWAY_BACK;
+			WaypointsChanged();
 		}
 		return 0;
 	}
@@ -1068,6 +1369,13 @@ int ConnectTrail(int startindex, int endindex, qboolean behindTheScenes)
 	maxs[1] = 15;
 	maxs[2] = 0;
 
+	memset(drops, 0, sizeof(drops));
+	for (d = 0; d < 4; d++)
+	{
+		drops[d].passEntityNum = ENTITYNUM_NONE;
+		drops[d].contentmask = MASK_SOLID;
+	}
+
 	nodenum = 0;
 	foundit = 0;
 
@@ -1170,14 +1478,30 @@ int ConnectTrail(int startindex, int endindex, qboolean behindTheScenes)
 					break;
 				}
 
+				//the drops to the floor on all four sides don't depend on each other, trace them together
+				for (d = 0; d < 4; d++)
+				{
+					VectorCopy(nodetable[i].origin, drops[d].start);
+					drops[d].start[d >> 1] += (d & 1) ? -branchDistance : branchDistance;
+					VectorCopy(drops[d].start, drops[d].end);
+					drops[d].end[2] -= 4096;
+				}
+				if (trap->TraceBatch)
+				{
+					trap->TraceBatch(drops, dropTraces, 4);
+				}
+				else
+				{ //older engine
+					for (d = 0; d < 4; d++)
+					{
+						trap->Trace(&dropTraces[d], drops[d].start, drops[d].mins, drops[d].maxs, drops[d].end, drops[d].passEntityNum, drops[d].contentmask, drops[d].capsule, drops[d].traceFlags, drops[d].useLod);
+					}
+				}
+
 				VectorCopy(nodetable[i].origin, testspot);
 				testspot[0] += branchDistance;
 
-				VectorCopy(testspot, starttrace);
-
-				starttrace[2] -= 4096;
-
-				trap->Trace(&tr, testspot, NULL, NULL, starttrace, ENTITYNUM_NONE, MASK_SOLID, qfalse, 0, 0);
+				tr = dropTraces[0];
 
 				testspot[2] = tr.endpos[2]+baseheight;
 
@@ -1204,11 +1528,7 @@ int ConnectTrail(int startindex, int endindex, qboolean behindTheScenes)
 				VectorCopy(nodetable[i].origin, testspot);
 				testspot[0] -= branchDistance;
 
-				VectorCopy(testspot, starttrace);
-
-				starttrace[2] -= 4096;
-
-				trap->Trace(&tr, testspot, NULL, NULL, starttrace, ENTITYNUM_NONE, MASK_SOLID, qfalse, 0, 0);
+				tr = dropTraces[1];
 
 				testspot[2] = tr.endpos[2]+baseheight;
 
@@ -1235,11 +1555,7 @@ int ConnectTrail(int startindex, int endindex, qboolean behindTheScenes)
 				VectorCopy(nodetable[i].origin, testspot);
 				testspot[1] += branchDistance;
 
-				VectorCopy(testspot, starttrace);
-
-				starttrace[2] -= 4096;
-
-				trap->Trace(&tr, testspot, NULL, NULL, starttrace, ENTITYNUM_NONE, MASK_SOLID, qfalse, 0, 0);
+				tr = dropTraces[2];
 
 				testspot[2] = tr.endpos[2]+baseheight;
 
@@ -1266,11 +1582,7 @@ int ConnectTrail(int startindex, int endindex, qboolean behindTheScenes)
 				VectorCopy(nodetable[i].origin, testspot);
 				testspot[1] -= branchDistance;
 
-				VectorCopy(testspot, starttrace);
-
-				starttrace[2] -= 4096;
-
-				trap->Trace(&tr, testspot, NULL, NULL, starttrace, ENTITYNUM_NONE, MASK_SOLID, qfalse, 0, 0);
+				tr = dropTraces[3];
 
 				testspot[2] = tr.endpos[2]+baseheight;
 
@@ -1311,6 +1623,7 @@ int ConnectTrail(int startindex, int endindex, qboolean behindTheScenes)
 		}
 		gWPArray[startindex]->flags |= WPFLAG_ONEWAY_FWD;
 		gWPArray[endindex]->flags |= WPFLAG_ONEWAY_BACK;
+		WaypointsChanged();
 		if (!behindTheScenes)
 		{
 			trap->Print(S_COLOR_YELLOW "Since points cannot be connected, point %i has been flagged as only-forward and point %i has been flagged as only-backward.\n", startindex, endindex);
@@ -1828,15 +2141,11 @@ float botGlobalNavWeaponWeights[WP_NUM_WEAPONS] =
 
 int GetNearestVisibleWPToItem(vec3_t org, int ignore)
 {
+	static int candidates[MAX_WPARRAY_SIZE];
 	int i;
-	float bestdist;
-	float flLen;
-	int bestindex;
-	vec3_t a, mins, maxs;
-
-	i = 0;
-	bestdist = 64; //has to be less than 64 units to the item or it isn't safe enough
-	bestindex = -1;
+	int numCandidates;
+	wpobject_t *wp;
+	vec3_t mins, maxs;
 
 	mins[0] = -15;
 	mins[1] = -15;
@@ -1845,26 +2154,23 @@ int GetNearestVisibleWPToItem(vec3_t org, int ignore)
 	maxs[1] = 15;
 	maxs[2] = 0;
 
-	while (i < gWPNum)
+	//has to be less than 64 units to the item or it isn't safe enough
+	numCandidates = GetWPGridCandidates(org, 64, candidates);
+
+	//nearest first, so the first visible one is it
+	for (i = 0; i < numCandidates; i++)
 	{
-		if (gWPArray[i] && gWPArray[i]->inuse &&
-			gWPArray[i]->origin[2]-15 < org[2] &&
-			gWPArray[i]->origin[2]+15 > org[2])
-		{
-			VectorSubtract(org, gWPArray[i]->origin, a);
-			flLen = VectorLength(a);
+		wp = gWPArray[candidates[i]];
 
-			if (flLen < bestdist && trap->InPVS(org, gWPArray[i]->origin) && OrgVisibleBox(org, mins, maxs, gWPArray[i]->origin, ignore))
-			{
-				bestdist = flLen;
-				bestindex = i;
-			}
+		if (wp->origin[2]-15 < org[2] &&
+			wp->origin[2]+15 > org[2] &&
+			trap->InPVS(org, wp->origin) && OrgVisibleBox(org, mins, maxs, wp->origin, ignore))
+		{
+			return candidates[i];
 		}
-
-		i++;
 	}
 
-	return bestindex;
+	return -1;
 }
 
 void CalculateWeightGoals(void)
@@ -2259,6 +2565,9 @@ int LoadPathData(const char *filename)
 	//Look at jump points and mark them as requiring
 	//force jumping as needed
 
+	BuildWPGrid();
+	BuildWPTrail();
+
 	return 1;
 }
 
@@ -2498,6 +2807,8 @@ int SavePathData(const char *filename)
 		i++;
 	}
 
+	WaypointsChanged(); //new disttonext values
+
 	trap->FS_Write(fileString, strlen(fileString), f);
 
 	B_TempFree(524288); //fileString
@@ -3275,6 +3586,9 @@ void BeginAutoPathRoutine(void)
 	}
 
 	RemoveWP(); //remove the dummy point at the end of the trail
+
+	BuildWPGrid();
+	BuildWPTrail();
 }
 
 extern vmCvar_t bot_normgpath;
@@ -3721,6 +4035,7 @@ int AcceptBotCommand(char *cmd, gentity_t *pl)
 			i++;
 		}
 
+		WaypointsChanged();
 		return 1;
 	}
 
@@ -1,5 +1,3 @@
-#if 0
-
 #ifndef __CURL_MULTI_H
 #define __CURL_MULTI_H
 /***************************************************************************
@@ -344,5 +342,3 @@ CURL_EXTERN CURLMcode curl_multi_assign(CURLM *multi_handle,
 #endif
 
 #endif
-
-#endif
\ No newline at end of file
@@ -4,11 +4,19 @@
 #include <string.h>
 #include "sqlite3.h"
 
-#define _USE_CURL 0
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
 
 #if _USE_CURL
 #include "curl/curl.h"
 #include "curl/easy.h"
+#include "curl/multi.h"
+
+void G_AddRunToWebServer( const char *username, const char *coursename, int duration_ms, int topspeed, int average, int style, int end_time );
 #endif
 
 #define LOCAL_DB_PATH "japro/data.db"
@@ -33,6 +41,718 @@
         }                                                       \
     }   
 
+/*
+=============================================================================
+
+PERSISTENT DATABASE CONNECTION
+
+One connection to LOCAL_DB_PATH is kept open for the lifetime of the game
+module instead of opening and closing the file for every query.  Prepared
+statements are cached by their SQL text and reset instead of finalized, and
+all work done during a server frame is batched into a single transaction
+that is committed at the end of G_RunFrame.
+
+The database worker thread below owns a second connection with its own
+statement cache, so the cache is kept per connection.
+
+=============================================================================
+*/
+
+#define MAX_DB_CACHED_STATEMENTS	64
+
+typedef struct dbCachedStatement_s {
+	char			*sql;
+	unsigned int	hash;
+	sqlite3_stmt	*stmt;
+	qboolean		inUse;
+	int				lastUsed;
+} dbCachedStatement_t;
+
+typedef struct dbConnection_s {
+	sqlite3				*db;
+	qboolean			inTransaction;
+	int					useCount;
+	dbCachedStatement_t	statements[MAX_DB_CACHED_STATEMENTS];
+} dbConnection_t;
+
+static dbConnection_t	localDB;	//game thread
+static dbConnection_t	workerDB;	//database worker thread
+
+#define MAX_DB_DEFERRED_WRITES		256
+#define G_DB_DEFERRED				-1	//G_DBStep result for a write put off until the worker lets go, never an sqlite code
+
+//game thread writes that found the worker holding the write lock, see G_DBStep
+static sqlite3_stmt		*dbDeferredWrites[MAX_DB_DEFERRED_WRITES];
+static int				dbNumDeferredWrites;
+
+static unsigned int G_DBHashSQL( const char *sql ) {
+	unsigned int hash = 2166136261u;
+
+	while ( *sql ) {
+		hash = (hash ^ (unsigned char)*sql++) * 16777619u;
+	}
+	return hash;
+}
+
+static void G_DBExec( sqlite3 *db, const char *sql ) {
+	char *errmsg = NULL;
+
+	if ( sqlite3_exec( db, sql, NULL, NULL, &errmsg ) != SQLITE_OK ) {
+		fprintf( stderr, "%s failed: %s\n", sql, errmsg ? errmsg : "unknown error" );
+		sqlite3_free( errmsg );
+	}
+}
+
+static dbConnection_t *G_DBConnectionForHandle( sqlite3 *db ) {
+	if ( db && db == localDB.db )
+		return &localDB;
+	if ( db && db == workerDB.db )
+		return &workerDB;
+	return NULL;
+}
+
+static qboolean G_DBConnect( dbConnection_t *conn, int busyTimeout ) {
+	int s = sqlite3_open( LOCAL_DB_PATH, &conn->db );
+
+	if ( s != SQLITE_OK ) {
+		fprintf( stderr, "open failed with status %d: %s\n", s, conn->db ? sqlite3_errmsg( conn->db ) : "out of memory" );
+		sqlite3_close( conn->db );
+		conn->db = NULL;
+		return qfalse;
+	}
+
+	//WAL lets outside readers (websites, stat scripts) and our worker thread read while we write, and makes commits cheap
+	G_DBExec( conn->db, "PRAGMA journal_mode=WAL" );
+	G_DBExec( conn->db, "PRAGMA synchronous=NORMAL" );
+	sqlite3_busy_timeout( conn->db, busyTimeout );
+
+	conn->inTransaction = qfalse;
+	conn->useCount = 0;
+	memset( conn->statements, 0, sizeof( conn->statements ) );
+
+	return qtrue;
+}
+
+static void G_DBDisconnect( dbConnection_t *conn ) {
+	int i;
+
+	if ( !conn->db ) {
+		return;
+	}
+
+	for ( i = 0; i < MAX_DB_CACHED_STATEMENTS; i++ ) {
+		if ( conn->statements[i].stmt ) {
+			sqlite3_finalize( conn->statements[i].stmt );
+			free( conn->statements[i].sql );
+		}
+	}
+	memset( conn->statements, 0, sizeof( conn->statements ) );
+
+	sqlite3_close( conn->db );
+	conn->db = NULL;
+}
+
+static void G_DBCommit( dbConnection_t *conn ) {
+	int i;
+
+	if ( !conn->db || !conn->inTransaction ) {
+		return;
+	}
+
+	//nothing should be mid-query here, make sure a leaked statement can't hold the transaction open
+	for ( i = 0; i < MAX_DB_CACHED_STATEMENTS; i++ ) {
+		if ( conn->statements[i].stmt && conn->statements[i].inUse ) {
+			sqlite3_reset( conn->statements[i].stmt );
+			conn->statements[i].inUse = qfalse;
+		}
+	}
+
+	if ( !sqlite3_get_autocommit( conn->db ) ) {
+		G_DBExec( conn->db, "COMMIT" );
+	}
+	conn->inTransaction = qfalse;
+}
+
+/*
+==================
+G_DBAcquire
+
+Returns the shared game thread connection, opening it on first use, and starts
+the transaction for the current frame if one is not already running.
+==================
+*/
+sqlite3 *G_DBAcquire( void ) {
+	//never wait for the worker's write lock inside a server frame, G_DBStep puts the write off instead
+	if ( !localDB.db && !G_DBConnect( &localDB, 0 ) ) {
+		return NULL;
+	}
+
+	if ( !localDB.inTransaction && sqlite3_get_autocommit( localDB.db ) ) {
+		G_DBExec( localDB.db, "BEGIN" );
+		localDB.inTransaction = qtrue;
+	}
+
+	return localDB.db;
+}
+
+/*
+==================
+G_DBRelease
+
+Counterpart of G_DBAcquire.  The connection itself stays open until
+G_DBShutdown, pending writes are committed by G_DBEndFrame.
+==================
+*/
+void G_DBRelease( sqlite3 *db ) {
+	assert( db == NULL || db == localDB.db || db == workerDB.db );
+}
+
+/*
+==================
+G_DBPrepare
+
+Looks up a cached statement for this SQL text, preparing and caching it if
+needed.  If the cached statement is still in use further up the stack (or the
+cache is full of in use statements) an uncached one is prepared instead.
+==================
+*/
+int G_DBPrepare( sqlite3 *db, const char *sql, sqlite3_stmt **stmt ) {
+	dbConnection_t *conn = G_DBConnectionForHandle( db );
+	dbCachedStatement_t *slot = NULL;
+	unsigned int hash;
+	int i, s;
+
+	*stmt = NULL;
+	if ( !db ) {
+		return SQLITE_MISUSE;
+	}
+
+	if ( !conn ) {
+		s = sqlite3_prepare_v2( db, sql, strlen( sql ) + 1, stmt, NULL );
+		if ( s != SQLITE_OK )
+			fprintf( stderr, "prepare_v2 failed with status %d: %s\n", s, sqlite3_errmsg( db ) );
+		return s;
+	}
+
+	hash = G_DBHashSQL( sql );
+	conn->useCount++;
+
+	for ( i = 0; i < MAX_DB_CACHED_STATEMENTS; i++ ) {
+		dbCachedStatement_t *cached = &conn->statements[i];
+
+		if ( !cached->stmt ) {
+			if ( !slot ) {
+				slot = cached;
+			}
+			continue;
+		}
+		if ( cached->hash != hash || strcmp( cached->sql, sql ) ) {
+			continue;
+		}
+		if ( cached->inUse ) {
+			break; //recursive use, hand out a private statement
+		}
+		cached->inUse = qtrue;
+		cached->lastUsed = conn->useCount;
+		*stmt = cached->stmt;
+		return SQLITE_OK;
+	}
+
+	s = sqlite3_prepare_v2( db, sql, strlen( sql ) + 1, stmt, NULL );
+	if ( s != SQLITE_OK ) {
+		fprintf( stderr, "prepare_v2 failed with status %d: %s\n", s, sqlite3_errmsg( db ) );
+		return s;
+	}
+
+	if ( i < MAX_DB_CACHED_STATEMENTS ) {
+		return s;
+	}
+
+	if ( !slot ) { //evict the least recently used idle statement
+		for ( i = 0; i < MAX_DB_CACHED_STATEMENTS; i++ ) {
+			dbCachedStatement_t *cached = &conn->statements[i];
+
+			if ( !cached->inUse && (!slot || cached->lastUsed < slot->lastUsed) ) {
+				slot = cached;
+			}
+		}
+		if ( !slot ) {
+			return s;
+		}
+		sqlite3_finalize( slot->stmt );
+		free( slot->sql );
+	}
+
+	slot->sql = (char *)malloc( strlen( sql ) + 1 );
+	if ( !slot->sql ) {
+		memset( slot, 0, sizeof( *slot ) );
+		return s;
+	}
+	strcpy( slot->sql, sql );
+	slot->hash = hash;
+	slot->stmt = *stmt;
+	slot->inUse = qtrue;
+	slot->lastUsed = conn->useCount;
+
+	return s;
+}
+
+/*
+==================
+G_DBFinalize
+
+Returns a statement from G_DBPrepare.  Cached statements are reset so they can
+be reused, uncached ones are finalized.
+==================
+*/
+void G_DBFinalize( sqlite3_stmt *stmt ) {
+	dbConnection_t *conn;
+	int i;
+
+	if ( !stmt ) {
+		return;
+	}
+
+	for ( i = 0; i < dbNumDeferredWrites; i++ ) {
+		if ( dbDeferredWrites[i] == stmt ) {
+			return; //G_DBRetryDeferredWrites finalizes it once it's written
+		}
+	}
+
+	conn = G_DBConnectionForHandle( sqlite3_db_handle( stmt ) );
+	if ( conn ) {
+		for ( i = 0; i < MAX_DB_CACHED_STATEMENTS; i++ ) {
+			if ( conn->statements[i].stmt == stmt ) {
+				sqlite3_reset( stmt );
+				sqlite3_clear_bindings( stmt );
+				conn->statements[i].inUse = qfalse;
+				return;
+			}
+		}
+	}
+
+	sqlite3_finalize( stmt );
+}
+
+/*
+==================
+G_DBStep
+
+sqlite3_step for everything in this file.  The game thread connection has no
+busy timeout, so a write that finds the worker holding the write lock fails
+right away instead of stalling the frame.  The statement is then kept, with its
+bindings (G_DBBindText copied their text), and stepped again by
+G_DBRetryDeferredWrites once the lock is free.  Writes that come after it are
+put off too, so they still land in order.  Callers get G_DB_DEFERRED for these,
+which G_ErrorPrint reports as queued rather than failed.
+==================
+*/
+static int G_DBStep( sqlite3_stmt *stmt ) {
+	int i, s;
+
+	if ( sqlite3_db_handle( stmt ) != localDB.db || sqlite3_stmt_readonly( stmt ) ) {
+		return sqlite3_step( stmt );
+	}
+
+	if ( !dbNumDeferredWrites ) {
+		s = sqlite3_step( stmt );
+		if ( s != SQLITE_BUSY ) {
+			return s;
+		}
+		sqlite3_reset( stmt ); //keeps the bindings
+	}
+
+	if ( dbNumDeferredWrites >= MAX_DB_DEFERRED_WRITES ) {
+		return SQLITE_BUSY;
+	}
+
+	//take it out of the cache so G_DBFinalize and the next G_DBPrepare leave it alone
+	for ( i = 0; i < MAX_DB_CACHED_STATEMENTS; i++ ) {
+		if ( localDB.statements[i].stmt == stmt ) {
+			free( localDB.statements[i].sql );
+			memset( &localDB.statements[i], 0, sizeof( localDB.statements[i] ) );
+			break;
+		}
+	}
+
+	dbDeferredWrites[dbNumDeferredWrites++] = stmt;
+	return G_DB_DEFERRED;
+}
+
+/*
+==================
+G_DBBindText
+
+sqlite3_bind_text for everything in this file.  A write can outlive the
+caller's buffers once G_DBStep puts it off, so its text is always copied.
+==================
+*/
+static int G_DBBindText( sqlite3_stmt *stmt, int i, const char *text, int n, void (*destructor)(void *) ) {
+	if ( destructor == SQLITE_STATIC && !sqlite3_stmt_readonly( stmt ) ) {
+		destructor = SQLITE_TRANSIENT;
+	}
+	return sqlite3_bind_text( stmt, i, text, n, destructor );
+}
+
+/*
+==================
+G_DBRetryDeferredWrites
+
+Runs the writes G_DBStep put off, in one transaction, if the worker isn't
+holding the write lock.  Otherwise they wait for the next frame.
+==================
+*/
+static void G_DBRetryDeferredWrites( void ) {
+	int i, s;
+
+	if ( !dbNumDeferredWrites || !localDB.db || !sqlite3_get_autocommit( localDB.db ) ) {
+		return;
+	}
+
+	if ( sqlite3_exec( localDB.db, "BEGIN IMMEDIATE", NULL, NULL, NULL ) != SQLITE_OK ) {
+		return;
+	}
+
+	for ( i = 0; i < dbNumDeferredWrites; i++ ) {
+		s = sqlite3_step( dbDeferredWrites[i] );
+		if ( s != SQLITE_DONE && s != SQLITE_ROW ) {
+			fprintf( stderr, "deferred write failed with status %d: %s\n", s, sqlite3_errmsg( localDB.db ) );
+		}
+		sqlite3_finalize( dbDeferredWrites[i] );
+	}
+	dbNumDeferredWrites = 0;
+
+	G_DBExec( localDB.db, "COMMIT" );
+}
+
+//every query below goes through the wrappers
+#define sqlite3_step G_DBStep
+#define sqlite3_bind_text G_DBBindText
+
+/*
+==================
+G_DBEndFrame
+
+Commits everything queued up during this frame.  Called at the end of G_RunFrame.
+==================
+*/
+void G_DBEndFrame( void ) {
+	G_DBCommit( &localDB );
+	G_DBRetryDeferredWrites();
+}
+
+/*
+=============================================================================
+
+DATABASE WORKER THREAD
+
+Race times, duel results and map stats are written by a background thread so
+rank recomputation on busy courses never runs inside the server frame.  The
+game thread queues a dbJob_t, the worker runs it against its own connection
+(all jobs it finds queued share one transaction) and hands it back, and
+G_DBRunCompletions then does the game side work (prints, sounds, demo and
+unlock bookkeeping) during G_RunFrame.
+
+Worker code must not call trap functions or va(), G_ErrorPrint is the only
+safe way to report errors from there.
+
+=============================================================================
+*/
+
+#ifdef _WIN32
+typedef HANDLE				dbThread_t;
+typedef CRITICAL_SECTION	dbMutex_t;
+typedef CONDITION_VARIABLE	dbCond_t;
+#else
+typedef pthread_t			dbThread_t;
+typedef pthread_mutex_t		dbMutex_t;
+typedef pthread_cond_t		dbCond_t;
+#endif
+
+typedef enum {
+	DBJOB_RACE,
+	DBJOB_DUEL,
+	DBJOB_SIMPLESTATS
+} dbJobType_t;
+
+typedef struct dbJobStats_s {
+	char			username[16];
+	unsigned short	kills, deaths, suicides, captures, returns;
+} dbJobStats_t;
+
+typedef struct dbJob_s {
+	struct dbJob_s	*next;
+	dbJobType_t		type;
+
+	//DBJOB_RACE and DBJOB_DUEL input
+	char			username[16];	//racer, or duel winner
+	char			otherName[16];	//duel loser
+	char			playername[MAX_NETNAME];
+	char			message[64];
+	qboolean		hasMessage;
+	char			coursename[40];
+	char			styleString[32];
+	int				clientNum;
+	int				duration_ms;	//or duel duration
+	int				style;			//or duel type
+	int				topspeed;		//or winner health
+	int				average;		//or winner shield
+	int				awesomenoise;
+	int				end_time;
+	int				playtime;		//seconds of racetime to add to the account, if any
+
+	//DBJOB_RACE results
+	qboolean		ranksKnown;		//worked out from the leaderboard cache, the worker only writes them
+	qboolean		seasonPB, globalPB, failedWrite;
+	int				season_oldRank, season_newRank, global_oldRank, global_newRank;
+	int				season_oldCount, season_newCount, global_oldCount, global_newCount;
+	float			addedScore;
+	unsigned int	unlock;
+
+	//DBJOB_SIMPLESTATS
+	dbJobStats_t	*stats;
+	int				numStats;
+	qboolean		statsWritten;
+} dbJob_t;
+
+typedef struct dbWorker_s {
+	qboolean	running;
+	qboolean	quit;
+	dbThread_t	thread;
+	dbMutex_t	lock;
+	dbCond_t	wake;
+	dbJob_t		*pending, *pendingTail;		//game thread -> worker
+	dbJob_t		*finished, *finishedTail;	//worker -> game thread
+	char		errors[8][128];				//G_ErrorPrint calls made on the worker
+	int			numErrors;
+} dbWorker_t;
+
+static dbWorker_t dbWorker;
+static qboolean dbWorkerStarted = qfalse;
+
+#ifdef _WIN32
+static DWORD dbWorkerThreadId;
+static void G_DBLock( void )		{ EnterCriticalSection( &dbWorker.lock ); }
+static void G_DBUnlock( void )		{ LeaveCriticalSection( &dbWorker.lock ); }
+static void G_DBWake( void )		{ WakeConditionVariable( &dbWorker.wake ); }
+static void G_DBSleep( void )		{ SleepConditionVariableCS( &dbWorker.wake, &dbWorker.lock, INFINITE ); }
+static qboolean G_DBOnWorker( void ) { return (qboolean)(dbWorker.running && GetCurrentThreadId() == dbWorkerThreadId); }
+#else
+static void G_DBLock( void )		{ pthread_mutex_lock( &dbWorker.lock ); }
+static void G_DBUnlock( void )		{ pthread_mutex_unlock( &dbWorker.lock ); }
+static void G_DBWake( void )		{ pthread_cond_signal( &dbWorker.wake ); }
+static void G_DBSleep( void )		{ pthread_cond_wait( &dbWorker.wake, &dbWorker.lock ); }
+static qboolean G_DBOnWorker( void ) { return (qboolean)(dbWorker.running && pthread_equal( pthread_self(), dbWorker.thread )); }
+#endif
+
+static void G_DBRunJob( dbJob_t *job, sqlite3 *db );	//worker side
+static void G_DBFinishJob( dbJob_t *job );				//game side
+
+static void G_DBWorkerLoop( void ) {
+	G_DBConnect( &workerDB, 5000 ); //we are allowed to wait for the game thread's frame transaction
+
+	G_DBLock();
+	while ( 1 ) {
+		dbJob_t *batch, *job, *last = NULL;
+
+		while ( !dbWorker.pending && !dbWorker.quit ) {
+			G_DBSleep();
+		}
+		if ( !dbWorker.pending ) {
+			break;
+		}
+
+		batch = dbWorker.pending;
+		dbWorker.pending = dbWorker.pendingTail = NULL;
+		G_DBUnlock();
+
+		if ( workerDB.db ) {
+			G_DBExec( workerDB.db, "BEGIN IMMEDIATE" );
+			workerDB.inTransaction = qtrue;
+		}
+		for ( job = batch; job; job = job->next ) {
+			G_DBRunJob( job, workerDB.db );
+			last = job;
+		}
+		G_DBCommit( &workerDB );
+
+		G_DBLock();
+		if ( dbWorker.finishedTail )
+			dbWorker.finishedTail->next = batch;
+		else
+			dbWorker.finished = batch;
+		dbWorker.finishedTail = last;
+	}
+	G_DBUnlock();
+
+	G_DBDisconnect( &workerDB );
+}
+
+#ifdef _WIN32
+static DWORD WINAPI G_DBWorkerThread( LPVOID arg ) {
+	G_DBWorkerLoop();
+	return 0;
+}
+#else
+static void *G_DBWorkerThread( void *arg ) {
+	G_DBWorkerLoop();
+	return NULL;
+}
+#endif
+
+static void G_DBStartWorker( void ) {
+	memset( &dbWorker, 0, sizeof( dbWorker ) );
+
+#ifdef _WIN32
+	InitializeCriticalSection( &dbWorker.lock );
+	InitializeConditionVariable( &dbWorker.wake );
+	dbWorker.running = qtrue;
+	dbWorker.thread = CreateThread( NULL, 0, G_DBWorkerThread, NULL, 0, &dbWorkerThreadId );
+	if ( !dbWorker.thread ) {
+		dbWorker.running = qfalse;
+		DeleteCriticalSection( &dbWorker.lock );
+	}
+#else
+	pthread_mutex_init( &dbWorker.lock, NULL );
+	pthread_cond_init( &dbWorker.wake, NULL );
+	dbWorker.running = qtrue;
+	if ( pthread_create( &dbWorker.thread, NULL, G_DBWorkerThread, NULL ) ) {
+		dbWorker.running = qfalse;
+		pthread_cond_destroy( &dbWorker.wake );
+		pthread_mutex_destroy( &dbWorker.lock );
+	}
+#endif
+
+	if ( !dbWorker.running ) {
+		trap->Print( "WARNING: Could not start database thread, race and duel results will be written synchronously\n" );
+	}
+}
+
+/*
+==================
+G_DBQueueJob
+
+Hands a malloc'd job to the worker, or runs it right away if there is no worker.
+==================
+*/
+static void G_DBQueueJob( dbJob_t *job ) {
+	if ( !dbWorkerStarted ) {
+		G_DBStartWorker();
+		dbWorkerStarted = qtrue;
+	}
+
+	job->next = NULL;
+
+	if ( !dbWorker.running ) {
+		sqlite3 *db = G_DBAcquire();
+
+		G_DBRunJob( job, db );
+		G_DBRelease( db );
+		G_DBFinishJob( job );
+		free( job );
+		return;
+	}
+
+	G_DBLock();
+	if ( dbWorker.pendingTail )
+		dbWorker.pendingTail->next = job;
+	else
+		dbWorker.pending = job;
+	dbWorker.pendingTail = job;
+	G_DBWake();
+	G_DBUnlock();
+}
+
+/*
+==================
+G_DBRunCompletions
+
+Game side of finished jobs, called every frame from G_RunFrame.
+==================
+*/
+void G_DBRunCompletions( void ) {
+	dbJob_t *job, *next;
+	char errors[8][128];
+	int i, numErrors;
+
+	if ( !dbWorker.running ) {
+		return;
+	}
+
+	G_DBLock();
+	job = dbWorker.finished;
+	dbWorker.finished = dbWorker.finishedTail = NULL;
+	numErrors = dbWorker.numErrors;
+	memcpy( errors, dbWorker.errors, sizeof( errors ) );
+	dbWorker.numErrors = 0;
+	G_DBUnlock();
+
+	for ( i = 0; i < numErrors; i++ ) {
+		trap->SendServerCommand( -1, va( "print \"%s\n\"", errors[i] ) );
+		G_SecurityLogPrintf( "%s\n", errors[i] );
+	}
+
+	for ( ; job; job = next ) {
+		next = job->next;
+		G_DBFinishJob( job );
+		free( job );
+	}
+}
+
+/*
+==================
+G_DBShutdown
+
+Lets the worker finish everything that was queued, runs the completions, then
+commits pending writes and closes the connection.  Called from G_ShutdownGame.
+==================
+*/
+void G_DBShutdown( void ) {
+	if ( dbWorker.running ) {
+		G_DBLock();
+		dbWorker.quit = qtrue;
+		G_DBWake();
+		G_DBUnlock();
+
+#ifdef _WIN32
+		WaitForSingleObject( dbWorker.thread, INFINITE );
+		CloseHandle( dbWorker.thread );
+#else
+		pthread_join( dbWorker.thread, NULL );
+#endif
+
+		G_DBRunCompletions();
+		dbWorker.running = qfalse;
+
+#ifdef _WIN32
+		DeleteCriticalSection( &dbWorker.lock );
+#else
+		pthread_cond_destroy( &dbWorker.wake );
+		pthread_mutex_destroy( &dbWorker.lock );
+#endif
+	}
+	dbWorkerStarted = qfalse; //map_restart keeps the module loaded, start a new worker on next use
+
+	G_DBCommit( &localDB );
+
+	//the worker is gone, so only an outside writer can still be in the way
+	if ( localDB.db ) {
+		sqlite3_busy_timeout( localDB.db, 5000 );
+		G_DBRetryDeferredWrites();
+	}
+	if ( dbNumDeferredWrites ) {
+		int i;
+
+		for ( i = 0; i < dbNumDeferredWrites; i++ ) {
+			sqlite3_finalize( dbDeferredWrites[i] );
+		}
+		fprintf( stderr, "G_DBShutdown: dropped %d writes, the database stayed locked\n", dbNumDeferredWrites );
+		dbNumDeferredWrites = 0;
+	}
+
+	G_DBDisconnect( &localDB );
+}
+
 #if 0
 typedef struct RaceRecord_s {
 	char				username[16];
@@ -45,86 +765,623 @@ typedef struct RaceRecord_s {
 	unsigned int		end_timeInt;
 } RaceRecord_t;
 
-RaceRecord_t	HighScores[32][MV_NUMSTYLES][10];//32 courses, 9 styles, 10 spots on highscore list
+RaceRecord_t	HighScores[32][MV_NUMSTYLES][10];//32 courses, 9 styles, 10 spots on highscore list
+
+typedef struct PersonalBests_s {
+	char				username[16];
+	char				coursename[40];
+	unsigned int		duration_ms;
+	unsigned short		style; //only needs to be 3 bits	
+} PersonalBests_t;
+
+PersonalBests_t	PersonalBests[9][50];//9 styles, 50 cached spots
+#endif
+
+#if 0
+typedef struct UserStats_s {
+	char				username[16];
+	unsigned short		kills;
+	unsigned short		deaths;
+	unsigned short		suicides;
+	unsigned short		captures;
+	unsigned short		returns;
+} UserStats_t;
+
+UserStats_t	UserStats[256];//256 max logged in users per map :/
+#endif
+
+/*
+typedef struct UserAccount_s {
+	char			username[16];
+	char			password[16];
+	int				lastIP;
+} UserAccount_t;
+*/
+
+/*
+typedef struct PlayerID_s {
+	char			name[MAX_NETNAME];
+	unsigned int	ip[NET_ADDRSTRMAXLEN];
+	int				guid[33];
+} PlayerID_t;
+*/
+
+void getDateTime(int time, char * timeStr, size_t timeStrSize) {
+	time_t	timeGMT;
+	//time -= 60*60*5; //EST timezone -5? 
+	timeGMT = (time_t)time;
+	strftime( timeStr, timeStrSize, "%m/%d/%y %I:%M %p", localtime( &timeGMT ) );
+}
+
+unsigned int ip_to_int (const char * ip) {
+    unsigned v = 0;
+    int i;
+    const char * start;
+
+    start = ip;
+    for (i = 0; i < 4; i++) {
+        char c;
+        int n = 0;
+        while (1) {
+            c = * start;
+            start++;
+            if (c >= '0' && c <= '9') {
+                n *= 10;
+                n += c - '0';
+            }
+            else if ((i < 3 && c == '.') || i == 3)
+                break;
+            else
+                return 0;
+        }
+        if (n >= 256)
+            return 0;
+        v *= 256;
+        v += n;
+    }
+    return v;
+}
+
+void G_ErrorPrint( const char *fmt, int s ) {
+	if ( s == G_DB_DEFERRED ) { //not a failure, G_DBRetryDeferredWrites writes it once the worker is done
+		trap->Print( "Database busy, write queued for a retry: %s\n", fmt );
+		return;
+	}
+	if ( G_DBOnWorker() ) { //printed by G_DBRunCompletions
+		G_DBLock();
+		if ( dbWorker.numErrors < ARRAY_LEN( dbWorker.errors ) )
+			Com_sprintf( dbWorker.errors[dbWorker.numErrors++], sizeof( dbWorker.errors[0] ), "%s %i", fmt, s );
+		G_DBUnlock();
+		return;
+	}
+	trap->SendServerCommand( -1, va("print \"%s %i\n\"", fmt, s) );
+	G_SecurityLogPrintf(fmt);
+}
+
+/*
+=============================================================================
+
+RACE LEADERBOARD CACHE
+
+The LocalRun rows of the current map are kept in memory, one board per
+(course, style, season) plus an all seasons board per (course, style) that
+holds every player's best run.  Boards are treaps ordered like the old rank
+queries (duration_ms, then end_time) and keep their subtree sizes, so a rank,
+an entry count or a top10 page is an O(log n) walk instead of a LocalRun scan.
+
+G_AddRaceTime works out a run's ranks here during the frame and the worker
+only writes them out, the database is just the persistence layer.  Anything
+else that changes LocalRun rows for the current map has to update the cache
+as well.  Game thread only.
+
+=============================================================================
+*/
+
+#define RACECACHE_ALLSEASONS	-1
+#define RACECACHE_BOARD_HASH	512
+#define RACECACHE_ENTRY_HASH	4096
+
+typedef struct raceEntry_s {
+	struct raceEntry_s	*left, *right;
+	struct raceEntry_s	*hashNext;
+	struct raceBoard_s	*board;
+	unsigned int		priority;
+	int					size;			//entries in this subtree
+	unsigned int		seq;			//last tie breaker, newer runs rank behind equal ones
+	int					id;				//LocalRun row, 0 for runs added since the map was loaded
+	char				username[16];
+	int					duration_ms, topspeed, average, end_time, season;
+} raceEntry_t;
+
+typedef struct raceBoard_s {
+	struct raceBoard_s	*hashNext;
+	char				coursename[40];
+	int					style;
+	int					season;			//or RACECACHE_ALLSEASONS
+	raceEntry_t			*root;
+} raceBoard_t;
+
+typedef struct raceCache_s {
+	qboolean		loaded;
+	unsigned int	random, seq;
+	raceBoard_t		*boards[RACECACHE_BOARD_HASH];
+	raceEntry_t		*entries[RACECACHE_ENTRY_HASH];	//by board and username
+} raceCache_t;
+
+static raceCache_t raceCache; //current map
+
+static int G_RaceCompare( const raceEntry_t *a, const raceEntry_t *b ) {
+	if ( a->duration_ms != b->duration_ms )
+		return a->duration_ms < b->duration_ms ? -1 : 1;
+	if ( a->end_time != b->end_time )
+		return a->end_time < b->end_time ? -1 : 1;
+	if ( a->seq != b->seq )
+		return a->seq < b->seq ? -1 : 1;
+	return 0;
+}
+
+static int G_RaceSize( const raceEntry_t *e ) {
+	return e ? e->size : 0;
+}
+
+static void G_RaceResize( raceEntry_t *e ) {
+	e->size = 1 + G_RaceSize( e->left ) + G_RaceSize( e->right );
+}
+
+//Splits root into the entries that sort before key and the rest
+static void G_RaceSplit( raceEntry_t *root, const raceEntry_t *key, raceEntry_t **before, raceEntry_t **after ) {
+	if ( !root ) {
+		*before = *after = NULL;
+		return;
+	}
+	if ( G_RaceCompare( root, key ) < 0 ) {
+		G_RaceSplit( root->right, key, &root->right, after );
+		*before = root;
+	}
+	else {
+		G_RaceSplit( root->left, key, before, &root->left );
+		*after = root;
+	}
+	G_RaceResize( root );
+}
+
+static raceEntry_t *G_RaceMerge( raceEntry_t *before, raceEntry_t *after ) {
+	if ( !before )
+		return after;
+	if ( !after )
+		return before;
+	if ( before->priority > after->priority ) {
+		before->right = G_RaceMerge( before->right, after );
+		G_RaceResize( before );
+		return before;
+	}
+	after->left = G_RaceMerge( before, after->left );
+	G_RaceResize( after );
+	return after;
+}
+
+static void G_RaceInsert( raceBoard_t *board, raceEntry_t *e ) {
+	raceEntry_t *before, *after;
+
+	e->left = e->right = NULL;
+	e->size = 1;
+	G_RaceSplit( board->root, e, &before, &after );
+	board->root = G_RaceMerge( G_RaceMerge( before, e ), after );
+}
+
+static void G_RaceRemove( raceBoard_t *board, raceEntry_t *e ) {
+	raceEntry_t **link = &board->root;
+
+	while ( *link && *link != e ) {
+		(*link)->size--;
+		link = (G_RaceCompare( e, *link ) < 0) ? &(*link)->left : &(*link)->right;
+	}
+	if ( *link )
+		*link = G_RaceMerge( e->left, e->right );
+}
+
+//1 for the fastest run on the board
+static int G_RaceRank( const raceEntry_t *e ) {
+	const raceEntry_t *node = e->board->root;
+	int rank = 1;
+
+	while ( node ) {
+		const int order = G_RaceCompare( e, node );
+
+		if ( order < 0 ) {
+			node = node->left;
+			continue;
+		}
+		rank += G_RaceSize( node->left );
+		if ( !order )
+			break;
+		rank++;
+		node = node->right;
+	}
+	return rank;
+}
+
+//index 0 is the fastest run on the board
+static raceEntry_t *G_RaceSelect( const raceBoard_t *board, int index ) {
+	raceEntry_t *node = board->root;
+
+	while ( node ) {
+		const int leftSize = G_RaceSize( node->left );
+
+		if ( index < leftSize ) {
+			node = node->left;
+		}
+		else if ( index == leftSize ) {
+			return node;
+		}
+		else {
+			index -= leftSize + 1;
+			node = node->right;
+		}
+	}
+	return NULL;
+}
+
+static unsigned int G_RaceBoardHash( const char *coursename, int style, int season ) {
+	unsigned int hash = G_DBHashSQL( coursename );
+
+	hash = (hash ^ (unsigned int)style) * 16777619u;
+	hash = (hash ^ (unsigned int)season) * 16777619u;
+	return hash % RACECACHE_BOARD_HASH;
+}
+
+static unsigned int G_RaceEntryHash( const raceBoard_t *board, const char *username ) {
+	return (G_DBHashSQL( username ) ^ (unsigned int)((size_t)board >> 4)) % RACECACHE_ENTRY_HASH;
+}
+
+static raceBoard_t *G_RaceGetBoard( raceCache_t *cache, const char *coursename, int style, int season, qboolean create ) {
+	const unsigned int hash = G_RaceBoardHash( coursename, style, season );
+	raceBoard_t *board;
+
+	for ( board = cache->boards[hash]; board; board = board->hashNext ) {
+		if ( board->style == style && board->season == season && !strcmp( board->coursename, coursename ) )
+			return board;
+	}
+
+	if ( !create )
+		return NULL;
+
+	board = (raceBoard_t *)calloc( 1, sizeof( raceBoard_t ) );
+	if ( !board )
+		return NULL;
+	Q_strncpyz( board->coursename, coursename, sizeof( board->coursename ) );
+	board->style = style;
+	board->season = season;
+	board->hashNext = cache->boards[hash];
+	cache->boards[hash] = board;
+	return board;
+}
+
+static raceEntry_t *G_RaceFindEntry( raceCache_t *cache, const raceBoard_t *board, const char *username ) {
+	raceEntry_t *e;
+
+	for ( e = cache->entries[G_RaceEntryHash( board, username )]; e; e = e->hashNext ) {
+		if ( e->board == board && !strcmp( e->username, username ) )
+			return e;
+	}
+	return NULL;
+}
+
+static void G_RaceUnlinkEntry( raceCache_t *cache, raceEntry_t *e ) {
+	raceEntry_t **link = &cache->entries[G_RaceEntryHash( e->board, e->username )];
+
+	while ( *link && *link != e )
+		link = &(*link)->hashNext;
+	if ( *link )
+		*link = e->hashNext;
+	e->hashNext = NULL;
+}
+
+static void G_RaceLinkEntry( raceCache_t *cache, raceEntry_t *e ) {
+	const unsigned int hash = G_RaceEntryHash( e->board, e->username );
+
+	e->hashNext = cache->entries[hash];
+	cache->entries[hash] = e;
+}
+
+static void G_RaceSetEntry( raceCache_t *cache, raceEntry_t *e, int id, int duration_ms, int topspeed, int average, int end_time, int season ) {
+	e->id = id;
+	e->duration_ms = duration_ms;
+	e->topspeed = topspeed;
+	e->average = average;
+	e->end_time = end_time;
+	e->season = season;
+	e->seq = ++cache->seq;
+}
+
+static raceEntry_t *G_RaceAddEntry( raceCache_t *cache, raceBoard_t *board, const char *username, int id, int duration_ms, int topspeed, int average, int end_time, int season ) {
+	raceEntry_t *e = (raceEntry_t *)calloc( 1, sizeof( raceEntry_t ) );
+
+	if ( !e )
+		return NULL;
+
+	//xorshift, treap priorities only need to be well spread
+	cache->random ^= cache->random << 13;
+	cache->random ^= cache->random >> 17;
+	cache->random ^= cache->random << 5;
+
+	e->board = board;
+	e->priority = cache->random;
+	Q_strncpyz( e->username, username, sizeof( e->username ) );
+	G_RaceSetEntry( cache, e, id, duration_ms, topspeed, average, end_time, season );
+	G_RaceInsert( board, e );
+	G_RaceLinkEntry( cache, e );
+	return e;
+}
+
+static void G_RaceMoveEntry( raceCache_t *cache, raceEntry_t *e, int id, int duration_ms, int topspeed, int average, int end_time, int season ) {
+	G_RaceRemove( e->board, e );
+	G_RaceSetEntry( cache, e, id, duration_ms, topspeed, average, end_time, season );
+	G_RaceInsert( e->board, e );
+}
+
+static void G_RaceCacheClear( raceCache_t *cache ) {
+	int i;
+
+	for ( i = 0; i < RACECACHE_ENTRY_HASH; i++ ) {
+		raceEntry_t *e, *next;
+
+		for ( e = cache->entries[i]; e; e = next ) {
+			next = e->hashNext;
+			free( e );
+		}
+	}
+	for ( i = 0; i < RACECACHE_BOARD_HASH; i++ ) {
+		raceBoard_t *board, *next;
+
+		for ( board = cache->boards[i]; board; board = next ) {
+			next = board->hashNext;
+			free( board );
+		}
+	}
+	memset( cache, 0, sizeof( *cache ) );
+}
+
+//Adds a LocalRun row to its season board, and to the all seasons board if it is the player's best
+static void G_RaceCacheAddRow( raceCache_t *cache, int id, const char *username, const char *coursename, int style, int season, int duration_ms, int topspeed, int average, int end_time ) {
+	raceBoard_t *board;
+	raceEntry_t *e;
+
+	board = G_RaceGetBoard( cache, coursename, style, season, qtrue );
+	if ( !board )
+		return;
+	e = G_RaceFindEntry( cache, board, username );
+	if ( !e )
+		G_RaceAddEntry( cache, board, username, id, duration_ms, topspeed, average, end_time, season );
+	else if ( duration_ms < e->duration_ms ) //CleanupLocalRun should have left one row per season, keep the best if not
+		G_RaceMoveEntry( cache, e, id, duration_ms, topspeed, average, end_time, season );
+	else
+		return;
+
+	board = G_RaceGetBoard( cache, coursename, style, RACECACHE_ALLSEASONS, qtrue );
+	if ( !board )
+		return;
+	e = G_RaceFindEntry( cache, board, username );
+	if ( !e )
+		G_RaceAddEntry( cache, board, username, id, duration_ms, topspeed, average, end_time, season );
+	else if ( duration_ms < e->duration_ms )
+		G_RaceMoveEntry( cache, e, id, duration_ms, topspeed, average, end_time, season );
+}
+
+/*
+==================
+G_RaceCacheLoad
+
+Fills the cache with the rows for mapname's courses, or every row if mapname is NULL.
+==================
+*/
+static qboolean G_RaceCacheLoad( raceCache_t *cache, const char *mapname ) {
+	sqlite3 * db;
+	char * sql;
+	sqlite3_stmt * stmt;
+	int s;
+	char prefix[MAX_QPATH];
+
+	G_RaceCacheClear( cache );
+	cache->random = 2463534242u;
+
+	db = G_DBAcquire();
+
+	if ( mapname ) {
+		Com_sprintf( prefix, sizeof( prefix ), "%s (", mapname ); //courses are named "mapname" or "mapname (message)"
+		sql = "SELECT id, username, coursename, style, season, duration_ms, topspeed, average, end_time FROM LocalRun WHERE coursename = ? OR substr(coursename, 1, ?) = ? ORDER BY id ASC";
+		G_DBPrepare(db, sql, &stmt);
+		CALL_SQLITE(bind_text(stmt, 1, mapname, -1, SQLITE_STATIC));
+		CALL_SQLITE(bind_int(stmt, 2, strlen(prefix)));
+		CALL_SQLITE(bind_text(stmt, 3, prefix, -1, SQLITE_STATIC));
+	}
+	else {
+		sql = "SELECT id, username, coursename, style, season, duration_ms, topspeed, average, end_time FROM LocalRun ORDER BY id ASC";
+		G_DBPrepare(db, sql, &stmt);
+	}
+
+	while (1) {
+		s = sqlite3_step(stmt);
+		if (s == SQLITE_ROW) {
+			const char *username = (const char *)sqlite3_column_text(stmt, 1);
+			const char *coursename = (const char *)sqlite3_column_text(stmt, 2);
+
+			G_RaceCacheAddRow(cache, sqlite3_column_int(stmt, 0), username ? username : "", coursename ? coursename : "", sqlite3_column_int(stmt, 3), sqlite3_column_int(stmt, 4),
+				sqlite3_column_int(stmt, 5), sqlite3_column_int(stmt, 6), sqlite3_column_int(stmt, 7), sqlite3_column_int(stmt, 8));
+		}
+		else if (s == SQLITE_DONE) {
+			cache->loaded = qtrue;
+			break;
+		}
+		else {
+			G_ErrorPrint("ERROR: SQL Select Failed (G_RaceCacheLoad)", s);
+			break;
+		}
+	}
+	G_DBFinalize(stmt);
+
+	G_DBRelease(db);
+
+	if ( !cache->loaded )
+		G_RaceCacheClear( cache ); //Fall back to working ranks out in the database
+	return cache->loaded;
+}
+
+/*
+==================
+G_RaceCacheAddRun
 
-typedef struct PersonalBests_s {
-	char				username[16];
-	char				coursename[40];
-	unsigned int		duration_ms;
-	unsigned short		style; //only needs to be 3 bits	
-} PersonalBests_t;
+Works out the ranks of a finished run from the cache and records it there if it
+is a season best, filling in the DBJOB_RACE results.  Returns qfalse if the
+cache is not loaded and the worker has to get the ranks from the database.
+==================
+*/
+static qboolean G_RaceCacheAddRun( dbJob_t *job, int season ) {
+	raceBoard_t *seasonBoard, *globalBoard;
+	raceEntry_t *seasonEntry, *globalEntry;
 
-PersonalBests_t	PersonalBests[9][50];//9 styles, 50 cached spots
-#endif
+	if ( !raceCache.loaded )
+		return qfalse;
 
-#if 0
-typedef struct UserStats_s {
-	char				username[16];
-	unsigned short		kills;
-	unsigned short		deaths;
-	unsigned short		suicides;
-	unsigned short		captures;
-	unsigned short		returns;
-} UserStats_t;
+	seasonBoard = G_RaceGetBoard( &raceCache, job->coursename, job->style, season, qtrue );
+	globalBoard = G_RaceGetBoard( &raceCache, job->coursename, job->style, RACECACHE_ALLSEASONS, qtrue );
+	if ( !seasonBoard || !globalBoard )
+		return qfalse;
 
-UserStats_t	UserStats[256];//256 max logged in users per map :/
-#endif
+	seasonEntry = G_RaceFindEntry( &raceCache, seasonBoard, job->username );
+	globalEntry = G_RaceFindEntry( &raceCache, globalBoard, job->username );
 
-/*
-typedef struct UserAccount_s {
-	char			username[16];
-	char			password[16];
-	int				lastIP;
-} UserAccount_t;
-*/
+	job->season_oldCount = G_RaceSize( seasonBoard->root );
+	job->global_oldCount = G_RaceSize( globalBoard->root );
+	job->season_newRank = job->global_newRank = -1;
+
+	if ( seasonEntry ) {
+		job->season_oldRank = G_RaceRank( seasonEntry );
+		job->seasonPB = (qboolean)(job->duration_ms < seasonEntry->duration_ms);
+	}
+	else { //First attempt of the season
+		job->season_oldRank = -1;
+		job->seasonPB = qtrue;
+	}
+
+	if ( globalEntry ) {
+		job->global_oldRank = G_RaceRank( globalEntry );
+		job->globalPB = (qboolean)(job->duration_ms < globalEntry->duration_ms);
+	}
+	else {
+		job->global_oldRank = -1;
+		job->globalPB = qtrue;
+	}
+
+	if ( !job->seasonPB ) //Nothing changes, ranks are only printed
+		return qtrue;
+
+	if ( seasonEntry )
+		G_RaceMoveEntry( &raceCache, seasonEntry, 0, job->duration_ms, job->topspeed, job->average, job->end_time, season );
+	else
+		seasonEntry = G_RaceAddEntry( &raceCache, seasonBoard, job->username, 0, job->duration_ms, job->topspeed, job->average, job->end_time, season );
+	if ( !seasonEntry ) { //Out of memory, the cache no longer matches the database
+		G_RaceCacheClear( &raceCache );
+		return qfalse;
+	}
+	job->season_newRank = G_RaceRank( seasonEntry );
+	job->season_newCount = G_RaceSize( seasonBoard->root );
+
+	if ( job->globalPB ) {
+		if ( globalEntry )
+			G_RaceMoveEntry( &raceCache, globalEntry, 0, job->duration_ms, job->topspeed, job->average, job->end_time, season );
+		else
+			globalEntry = G_RaceAddEntry( &raceCache, globalBoard, job->username, 0, job->duration_ms, job->topspeed, job->average, job->end_time, season );
+		if ( !globalEntry ) {
+			G_RaceCacheClear( &raceCache );
+			return qfalse;
+		}
+		job->global_newRank = G_RaceRank( globalEntry );
+	}
+	else { //Not our best time of all seasons, rank 0 keeps it out of global queries
+		job->global_newRank = 0;
+	}
+	job->global_newCount = G_RaceSize( globalBoard->root );
+
+	return qtrue;
+}
 
 /*
-typedef struct PlayerID_s {
-	char			name[MAX_NETNAME];
-	unsigned int	ip[NET_ADDRSTRMAXLEN];
-	int				guid[33];
-} PlayerID_t;
+==================
+G_RaceCacheBoard
+
+The board for a course of the current map, NULL if it is not cached.
+==================
 */
+static raceBoard_t *G_RaceCacheBoard( const char *coursename, int style, int season ) {
+	if ( !raceCache.loaded )
+		return NULL;
+	return G_RaceGetBoard( &raceCache, coursename, style, season, qfalse );
+}
 
-void getDateTime(int time, char * timeStr, size_t timeStrSize) {
-	time_t	timeGMT;
-	//time -= 60*60*5; //EST timezone -5? 
-	timeGMT = (time_t)time;
-	strftime( timeStr, timeStrSize, "%m/%d/%y %I:%M %p", localtime( &timeGMT ) );
+//Svcmd_DeleteAccount_f and Svcmd_RenameAccount_f once LocalRun is updated, newUsername NULL deletes the player's runs.
+//A renamed entry is merged with any the new name already has on its board, keeping the best time like G_RaceCacheAddRow
+static void G_RaceCacheRenameUser( const char *username, const char *newUsername ) {
+	raceEntry_t *e, *next, *moved = NULL;
+	int i;
+
+	for ( i = 0; i < RACECACHE_ENTRY_HASH; i++ ) {
+		for ( e = raceCache.entries[i]; e; e = next ) {
+			next = e->hashNext;
+			if ( strcmp( e->username, username ) )
+				continue;
+			G_RaceUnlinkEntry( &raceCache, e );
+			if ( newUsername ) { //Rehashed once all buckets are walked
+				e->hashNext = moved;
+				moved = e;
+			}
+			else {
+				G_RaceRemove( e->board, e );
+				free( e );
+			}
+		}
+	}
+
+	for ( e = moved; e; e = next ) {
+		raceEntry_t *existing = G_RaceFindEntry( &raceCache, e->board, newUsername );
+
+		next = e->hashNext;
+		if ( existing ) {
+			if ( existing->duration_ms <= e->duration_ms ) {
+				G_RaceRemove( e->board, e );
+				free( e );
+				continue;
+			}
+			G_RaceUnlinkEntry( &raceCache, existing );
+			G_RaceRemove( existing->board, existing );
+			free( existing );
+		}
+		Q_strncpyz( e->username, newUsername, sizeof( e->username ) );
+		G_RaceLinkEntry( &raceCache, e );
+	}
 }
 
-unsigned int ip_to_int (const char * ip) {
-    unsigned v = 0;
-    int i;
-    const char * start;
+/*
+==================
+G_RaceCacheInit
 
-    start = ip;
-    for (i = 0; i < 4; i++) {
-        char c;
-        int n = 0;
-        while (1) {
-            c = * start;
-            start++;
-            if (c >= '0' && c <= '9') {
-                n *= 10;
-                n += c - '0';
-            }
-            else if ((i < 3 && c == '.') || i == 3)
-                break;
-            else
-                return 0;
-        }
-        if (n >= 256)
-            return 0;
-        v *= 256;
-        v += n;
-    }
-    return v;
+Called every map load from InitGameAccountStuff, after CleanupLocalRun.
+==================
+*/
+static void G_RaceCacheInit( void ) {
+	char info[1024] = {0}, mapname[MAX_QPATH];
+
+	trap->GetServerinfo(info, sizeof(info));
+	Q_strncpyz(mapname, Info_ValueForKey(info, "mapname"), sizeof(mapname));
+	Q_strlwr(mapname);
+	Q_CleanStr(mapname);
+
+	if ( !G_RaceCacheLoad( &raceCache, mapname ) )
+		trap->Print( "WARNING: Could not load race times into memory, ranks will be worked out by the database\n" );
 }
 
-void G_ErrorPrint( const char *fmt, int s ) {
-	trap->SendServerCommand( -1, va("print \"%s %i\n\"", fmt, s) );
-	G_SecurityLogPrintf(fmt);
+void G_RaceCacheShutdown( void ) {
+	G_RaceCacheClear( &raceCache );
 }
 
 /*
@@ -150,10 +1407,10 @@ void DebugWriteToDB(char *entrypoint) {
 	Q_strncpyz(username, "test", sizeof(username));
 	Q_strncpyz(password, "test", sizeof(password));
 
-	CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+	db = G_DBAcquire();
 
 	sql = "UPDATE LocalAccount SET password = ? WHERE username = ?";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_text (stmt, 1, username, -1, SQLITE_STATIC));
 
 	s = sqlite3_step(stmt);
@@ -161,8 +1418,8 @@ void DebugWriteToDB(char *entrypoint) {
 	if (s != SQLITE_DONE)
 		G_SecurityLogPrintf( "ERROR: Could not write to database with error %i, entrypoint %s\n", s, entrypoint );
 
-	CALL_SQLITE (finalize(stmt));
-	CALL_SQLITE (close(db));
+	G_DBFinalize(stmt);
+	G_DBRelease(db);
 }
 */
 
@@ -174,9 +1431,9 @@ int CheckUserExists(char *username) { //make this accept existing DB so we dont
 
 	//load fixme replace this with simple select count
 
-	CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+	db = G_DBAcquire();
 	sql = "SELECT id FROM LocalAccount WHERE username = ?";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_text (stmt, 1, username, -1, SQLITE_STATIC));
 	
     while (1) {
@@ -192,8 +1449,8 @@ int CheckUserExists(char *username) { //make this accept existing DB so we dont
         }
     }
 
-	CALL_SQLITE (finalize(stmt));
-	CALL_SQLITE (close(db));
+	G_DBFinalize(stmt);
+	G_DBRelease(db);
 
 	//DebugWriteToDB("CheckUserExists");
 
@@ -295,7 +1552,7 @@ int GetDuelCount(char *username, int type, int end_time, sqlite3 * db) {
 
 	//Get Current Count, Get last duel id, get new duel id
 	sql = "SELECT COUNT(*) FROM LocalDuel WHERE type = ? AND (winner = ? OR loser = ?) AND end_time < ?";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_int (stmt, 1, type));
 	CALL_SQLITE (bind_text (stmt, 2, username, -1, SQLITE_STATIC));
 	CALL_SQLITE (bind_text (stmt, 3, username, -1, SQLITE_STATIC));
@@ -310,7 +1567,7 @@ int GetDuelCount(char *username, int type, int end_time, sqlite3 * db) {
 		G_ErrorPrint("ERROR: SQL Select Failed (GetDuelCount)", s);
 	}
 
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
 	return count;
 }
@@ -324,7 +1581,7 @@ float GetDuelElo( char *username, int type, int end_time, sqlite3 * db) {
 	sql = "SELECT winner_elo AS elo, end_time FROM LocalDuel where type = ? AND winner = ? AND end_time < ? "
 		"UNION ALL SELECT loser_elo AS elo, end_time FROM LocalDuel where type = ? AND loser = ? AND end_time < ? "
 		"ORDER BY end_time DESC LIMIT 1";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_int (stmt, 1, type));
 	CALL_SQLITE (bind_text (stmt, 2, username, -1, SQLITE_STATIC));
 	CALL_SQLITE (bind_int (stmt, 3, end_time));
@@ -345,7 +1602,7 @@ float GetDuelElo( char *username, int type, int end_time, sqlite3 * db) {
 		elo = 1000; //Elo not found, give them initial value
 	}
 
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
 	//Com_Printf("Getting duel elo %.2f %s %i %i\n", elo, username, type, end_time);
 
@@ -362,7 +1619,7 @@ void UpdatePlayerRating(char *username, int type, qboolean winner, float newElo,
 			sql = "UPDATE LocalDuel SET winner_elo = ?, odds = ? WHERE id = ?";
 		else
 			sql = "UPDATE LocalDuel SET loser_elo = ?, odds = ? WHERE id = ?";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_double (stmt, 1, newElo));
 		CALL_SQLITE (bind_double (stmt, 2, odds));
 		CALL_SQLITE (bind_int (stmt, 3, id));
@@ -372,7 +1629,7 @@ void UpdatePlayerRating(char *username, int type, qboolean winner, float newElo,
 			sql = "UPDATE LocalDuel SET winner_elo = ?, odds = ? WHERE type = ? AND winner = ? AND end_time = (SELECT MAX(end_time) FROM LocalDuel WHERE type = ? and winner = ?)";
 		else
 			sql = "UPDATE LocalDuel SET loser_elo = ?, odds = ? WHERE type = ? AND loser = ? AND end_time = (SELECT MAX(end_time) FROM LocalDuel WHERE type = ? and loser = ?)";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_double (stmt, 1, newElo));
 		CALL_SQLITE (bind_double (stmt, 2, odds));
 		CALL_SQLITE (bind_int (stmt, 3, type));
@@ -387,7 +1644,7 @@ void UpdatePlayerRating(char *username, int type, qboolean winner, float newElo,
 		G_ErrorPrint("ERROR: SQL Update Failed (UpdatePlayerRating)", s);
 	}
 
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 }
 
 int GetEloKValue(int numDuels) { //Also take rank into account
@@ -416,16 +1673,13 @@ int GetEloKValue(int numDuels) { //Also take rank into account
 	return k3;
 }
 
-void G_AddDuelToDB(char *winner, char *loser, int type, int duration, int winner_hp, int winner_shield, int end_time) {
-	sqlite3 * db;
+void G_AddDuelToDB(char *winner, char *loser, int type, int duration, int winner_hp, int winner_shield, int end_time, sqlite3 *db) {
     char * sql;
     sqlite3_stmt * stmt;
 	int s;
 
-	CALL_SQLITE (open (LOCAL_DB_PATH, & db));
-
 	sql = "INSERT INTO LocalDuel(winner, loser, duration, type, winner_hp, winner_shield, end_time, winner_elo, loser_elo, odds) VALUES (?, ?, ?, ?, ?, ?, ?, -999, -999, 0)";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_text (stmt, 1, winner, -1, SQLITE_STATIC));
 	CALL_SQLITE (bind_text (stmt, 2, loser, -1, SQLITE_STATIC));
 	CALL_SQLITE (bind_int (stmt, 3, duration));
@@ -438,9 +1692,7 @@ void G_AddDuelToDB(char *winner, char *loser, int type, int duration, int winner
 		G_ErrorPrint("ERROR: SQL Insert Failed (G_AddDuelToDB)", s);
 	}
 
-	CALL_SQLITE (finalize(stmt));
-
-	CALL_SQLITE (close(db));
+	G_DBFinalize(stmt);
 }
 
 void G_AddDuelElo(char *winner, char *loser, int type, int duration, int winner_hp, int winner_shield, int id, int end_time, sqlite3 *db) { //id and end_time are passed through if its a /rebuildElo 
@@ -532,7 +1784,7 @@ void G_AddDuelElo(char *winner, char *loser, int type, int duration, int winner_
 		newLoserElo = loserElo + loserK * (0 - expectedScoreLoser);
 
 	if (!id) { //We are not doing a rebuild, so add the duel here after we get the needed info
-		 G_AddDuelToDB(winner, loser, type, duration, winner_hp, winner_shield, end_time);
+		 G_AddDuelToDB(winner, loser, type, duration, winner_hp, winner_shield, end_time, db);
 	}
 
 	if (newWinnerElo != winnerElo) //Update winner elo
@@ -552,19 +1804,19 @@ void SV_RebuildElo_f() {
 	int s;
 	int time1 = trap->Milliseconds();
 
-	CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+	db = G_DBAcquire();
 
 	sql = "UPDATE LocalDuel SET winner_elo = -999, loser_elo = -999, odds = 0";//Save rank into row - use null
     //sql = "DELETE FROM DuelRanks";
-    CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+    G_DBPrepare(db, sql, &stmt);
 	s = sqlite3_step(stmt);
 	if (s != SQLITE_DONE) {
 		G_ErrorPrint("ERROR: SQL Update Failed (SV_RebuildElo_f 1)", s);
 	}
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
 	sql = "SELECT winner, loser, type, id, end_time from LocalDuel ORDER BY end_time ASC";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	
     while (1) {
         s = sqlite3_step(stmt);
@@ -580,8 +1832,8 @@ void SV_RebuildElo_f() {
         }
     }
 	
-	CALL_SQLITE (finalize(stmt));
-	CALL_SQLITE (close(db));
+	G_DBFinalize(stmt);
+	G_DBRelease(db);
 
 	Com_Printf("Duel ranks cleared in %i ms.\n", trap->Milliseconds() - time1);
 }
@@ -705,7 +1957,7 @@ void Cmd_DuelTop10_f(gentity_t *ent) {
 		int rank, count, TS, s, row = 1;
 		char msg[1024-128] = {0};
 
-		CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+		db = G_DBAcquire();
 
 		//We dont need to select from loser since we know a users highscore will always be from a winning duel.  And we can ignore users who have never won a duel(?)
 		//How to get count?
@@ -725,7 +1977,7 @@ void Cmd_DuelTop10_f(gentity_t *ent) {
 			GROUP BY username ORDER BY rank DESC LIMIT 10";
 		*/
 
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_int (stmt, 1, type));
 		CALL_SQLITE (bind_int (stmt, 2, type));
 		CALL_SQLITE (bind_int (stmt, 3, type));
@@ -765,14 +2017,13 @@ void Cmd_DuelTop10_f(gentity_t *ent) {
 			}
 		}
 
-		CALL_SQLITE (finalize(stmt));
-		CALL_SQLITE (close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 	}
 }
 #endif
 
 void G_AddDuel(char *winner, char *loser, int start_time, int type, int winner_hp, int winner_shield) {
-	sqlite3 * db;
 	time_t	rawtime;
 	char	string[256] = {0};
 	const int duration = start_time ? (level.time - start_time) : 0;
@@ -789,9 +2040,22 @@ void G_AddDuel(char *winner, char *loser, int start_time, int type, int winner_h
 
 #if _ELORANKING	
 	if (g_eloRanking.integer) {
-		CALL_SQLITE (open (LOCAL_DB_PATH, & db));
-		G_AddDuelElo(winner, loser, type, duration, winner_hp, winner_shield, 0, rawtime, db);
-		CALL_SQLITE (close(db));
+		dbJob_t *job = (dbJob_t *)calloc(1, sizeof(dbJob_t));
+
+		if (!job) {
+			G_ErrorPrint("ERROR: Out of memory (G_AddDuel)", 0);
+			return;
+		}
+
+		job->type = DBJOB_DUEL; //Elo is worked out on the database thread
+		Q_strncpyz(job->username, winner, sizeof(job->username));
+		Q_strncpyz(job->otherName, loser, sizeof(job->otherName));
+		job->style = type;
+		job->duration_ms = duration;
+		job->topspeed = winner_hp;
+		job->average = winner_shield;
+		job->end_time = rawtime;
+		G_DBQueueJob(job);
 	}
 #endif
 
@@ -847,10 +2111,10 @@ void G_AddToDBFromFile(void) { //loda fixme, we can filter out the slower times
 	buf[fLen] = 0;
 	trap->FS_Close(f);
 	
-	CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+	db = G_DBAcquire();
 	sql = "INSERT INTO LocalRun (username, coursename, duration_ms, topspeed, average, style, end_time) VALUES (?, ?, ?, ?, ?, ?, ?)";	 //loda fixme, make multiple?
 
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 
 	//Todo: make TempRaceRecord an array of structs instead, maybe like 32 long idk, and build a query to insert 32 at a time or something.. instead of 1 by 1
 	pch = strtok (buf,";\n");
@@ -939,8 +2203,8 @@ void G_AddToDBFromFile(void) { //loda fixme, we can filter out the slower times
 		good = qtrue;
 	}
 
-	CALL_SQLITE (finalize(stmt));
-	CALL_SQLITE (close(db));	
+	G_DBFinalize(stmt);
+	G_DBRelease(db);	
 
 	if (good) { //dont delete tmp file if mysql database is not responding 
 		trap->FS_Open(TEMP_RACE_LOG, &f, FS_WRITE);
@@ -1037,10 +2301,10 @@ void CleanupLocalRun() { //This should never actually change anything since we i
     sqlite3_stmt * stmt;
 	int s;
 
-	CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+	db = G_DBAcquire();
 
 	sql = "DELETE FROM LocalRun WHERE id NOT IN (SELECT id FROM (SELECT id, coursename, username, style, season FROM LocalRun ORDER BY duration_ms DESC) AS T GROUP BY T.username, T.coursename, T.style, T.season)";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	//Print to textfile what got deleted since this should never happen? failRaceLog
 
 	s = sqlite3_step(stmt);
@@ -1049,8 +2313,8 @@ void CleanupLocalRun() { //This should never actually change anything since we i
 	else 
 		G_ErrorPrint("ERROR: SQL Delete Failed (CleanupLocalRun)", s);
 
-	CALL_SQLITE (finalize(stmt));
-	CALL_SQLITE (close(db));
+	G_DBFinalize(stmt);
+	G_DBRelease(db);
 
 	//DebugWriteToDB("CleanupLocalRun");
 }
@@ -1069,7 +2333,7 @@ void G_GetRaceScore(int id, char *username, char *coursename, int style, int sea
 	//Get season count and global count of races on specified course/style
 	sql = "SELECT COUNT(*) FROM LocalRun WHERE coursename = ? AND style = ? AND season = ? "
 		"UNION ALL SELECT COUNT(DISTINCT username) FROM LocalRun WHERE coursename = ? AND style = ?";//Select count for that course,style
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_text (stmt, 1, coursename, -1, SQLITE_STATIC));
 	CALL_SQLITE (bind_int (stmt, 2, style));
 	CALL_SQLITE (bind_int (stmt, 3, season));
@@ -1089,11 +2353,11 @@ void G_GetRaceScore(int id, char *username, char *coursename, int style, int sea
 	else if (s != SQLITE_DONE) {
 		G_ErrorPrint("ERROR: SQL Select Failed (G_GetRaceScore 2)", s);
 	}
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
 	//Get season rank
 	sql = "SELECT id FROM LocalRun WHERE coursename = ? AND style = ? AND season = ? ORDER BY duration_ms ASC, end_time ASC"; //assume just one per person to speed this up..
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_text (stmt, 1, coursename, -1, SQLITE_STATIC));
 	CALL_SQLITE (bind_int (stmt, 2, style));
 	CALL_SQLITE (bind_int (stmt, 3, season));
@@ -1113,14 +2377,14 @@ void G_GetRaceScore(int id, char *username, char *coursename, int style, int sea
 			break;
         }
     }
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
 	i = 1; // AH HA ha
 
 	//can we index on duration_ms ?
 	//Get global rank - if its a season PB but not a global PB, leave global rank at 0
 	sql = "SELECT id, MIN(duration_ms) AS duration FROM LocalRun WHERE coursename = ? AND style = ? GROUP BY username ORDER BY duration ASC, end_time ASC"; 
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_text (stmt, 1, coursename, -1, SQLITE_STATIC));
 	CALL_SQLITE (bind_int (stmt, 2, style));
     while (1) {
@@ -1139,11 +2403,11 @@ void G_GetRaceScore(int id, char *username, char *coursename, int style, int sea
 			break;
         }
     }
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 	
 	//Save rank into row
 	sql = "UPDATE LocalRun SET rank = ?, entries = ?, season_rank = ?, season_entries = ?, last_update = ? WHERE id = ?";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_int (stmt, 1, global_rank));
 	CALL_SQLITE (bind_int (stmt, 2, global_count));
 	CALL_SQLITE (bind_int (stmt, 3, season_rank));
@@ -1153,81 +2417,39 @@ void G_GetRaceScore(int id, char *username, char *coursename, int style, int sea
 	s = sqlite3_step(stmt);
 	if (s != SQLITE_DONE)
 		G_ErrorPrint("ERROR: SQL Update Failed (G_GetRaceScore 5)", s);
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
 }
 #endif
 
-void G_GetRaceScore(int id, char *username, char *coursename, int style, int season, int season_count, int global_count, int time, sqlite3 * db) { //Need to use transactions here or something
+//Saves the ranks a LocalRun row has in cache back into it
+static void G_GetRaceScore(raceCache_t *cache, raceEntry_t *entry, int time, sqlite3 * db) {
 	char * sql;
 	sqlite3_stmt * stmt;
-	int s, season_rank = 0, global_rank = 0, i = 1;
-
-	//This has to be done like, 15k times currently.  15k x 10ms = like 4 minutes :(
-
-	//Get season rank
-	sql = "SELECT id FROM LocalRun WHERE coursename = ? AND style = ? AND season = ? ORDER BY duration_ms ASC, end_time ASC"; //assume just one per person to speed this up..
-	CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
-	CALL_SQLITE(bind_text(stmt, 1, coursename, -1, SQLITE_STATIC));
-	CALL_SQLITE(bind_int(stmt, 2, style));
-	CALL_SQLITE(bind_int(stmt, 3, season));
-	while (1) {
-		s = sqlite3_step(stmt);
-		if (s == SQLITE_ROW) {
-			if (id == sqlite3_column_int(stmt, 0)) {
-				season_rank = i;
-				break;
-			}
-			i++;
-		}
-		else if (s == SQLITE_DONE)
-			break;
-		else {
-			G_ErrorPrint("ERROR: SQL Select Failed (G_GetRaceScore 3)", s);
-			break;
-		}
-	}
-	CALL_SQLITE(finalize(stmt));
-
-	i = 1; // AH HA ha
+	int s, global_rank = 0;
+	raceBoard_t *globalBoard;
+	raceEntry_t *best = NULL;
 
-	//can we index on duration_ms ?
 	//Get global rank - if its a season PB but not a global PB, leave global rank at 0
-	sql = "SELECT id, MIN(duration_ms) AS duration FROM LocalRun WHERE coursename = ? AND style = ? GROUP BY username ORDER BY duration ASC, end_time ASC";
-	CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
-	CALL_SQLITE(bind_text(stmt, 1, coursename, -1, SQLITE_STATIC));
-	CALL_SQLITE(bind_int(stmt, 2, style));
-	while (1) {
-		s = sqlite3_step(stmt);
-		if (s == SQLITE_ROW) {
-			if (id == sqlite3_column_int(stmt, 0)) {
-				global_rank = i;
-				break;
-			}
-			i++;
-		}
-		else if (s == SQLITE_DONE)
-			break;
-		else {
-			G_ErrorPrint("ERROR: SQL Select Failed (G_GetRaceScore 4)", s);
-			break;
-		}
-	}
-	CALL_SQLITE(finalize(stmt));
+	globalBoard = G_RaceGetBoard(cache, entry->board->coursename, entry->board->style, RACECACHE_ALLSEASONS, qfalse);
+	if (globalBoard)
+		best = G_RaceFindEntry(cache, globalBoard, entry->username);
+	if (best && best->id == entry->id)
+		global_rank = G_RaceRank(best);
 
 	//Save rank into row
 	sql = "UPDATE LocalRun SET rank = ?, entries = ?, season_rank = ?, season_entries = ?, last_update = ? WHERE id = ?";
-	CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE(bind_int(stmt, 1, global_rank));
-	CALL_SQLITE(bind_int(stmt, 2, global_count));
-	CALL_SQLITE(bind_int(stmt, 3, season_rank));
-	CALL_SQLITE(bind_int(stmt, 4, season_count));
+	CALL_SQLITE(bind_int(stmt, 2, globalBoard ? G_RaceSize(globalBoard->root) : 0));
+	CALL_SQLITE(bind_int(stmt, 3, G_RaceRank(entry)));
+	CALL_SQLITE(bind_int(stmt, 4, G_RaceSize(entry->board->root)));
 	CALL_SQLITE(bind_int(stmt, 5, time));
-	CALL_SQLITE(bind_int(stmt, 6, id));
+	CALL_SQLITE(bind_int(stmt, 6, entry->id));
 	s = sqlite3_step(stmt);
 	if (s != SQLITE_DONE)
 		G_ErrorPrint("ERROR: SQL Update Failed (G_GetRaceScore 5)", s);
-	CALL_SQLITE(finalize(stmt));
+	G_DBFinalize(stmt);
 
 }
 
@@ -1244,10 +2466,10 @@ void SV_RebuildRaceRanks_f(void) {
 
 	CleanupLocalRun();//Make sure no duplicate entries
 
-	CALL_SQLITE (open (LOCAL_DB_PATH, & db)); 
+	db = G_DBAcquire(); 
 
 	sql = "SELECT id, username, coursename, style, season FROM LocalRun ORDER BY end_time ASC";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
     while (1) {
         s = sqlite3_step(stmt);
         if (s == SQLITE_ROW) {
@@ -1261,18 +2483,17 @@ void SV_RebuildRaceRanks_f(void) {
 			break;
         }
     }
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
-	CALL_SQLITE (close(db));
+	G_DBRelease(db);
 
 }
 #endif
 
 void SV_RebuildRaceRanks_f(void) {
-	char * sql;
-	sqlite3_stmt * stmt;
 	sqlite3 * db;
-	int s;//, row = 0;
+	raceCache_t *cache;
+	int i;
 	time_t	rawtime;
 
 	time(&rawtime);
@@ -1280,37 +2501,30 @@ void SV_RebuildRaceRanks_f(void) {
 
 	CleanupLocalRun();//Make sure no duplicate entries
 
-	CALL_SQLITE(open(LOCAL_DB_PATH, &db));
-	
-	//This doesn't have to be ordered at all does it?
-	sql = "SELECT LR1.id, LR1.username, LR1.coursename, LR1.style, LR1.season, LR2.season_count, LR3.global_count FROM "
-		"(SELECT id, username, coursename, style, season FROM LocalRun) AS LR1 "
-		"LEFT JOIN "
-		"(SELECT coursename, style, season, COUNT(*) AS season_count FROM LocalRun GROUP BY coursename, style, season) AS LR2 "
-		"ON LR1.style = LR2.style AND LR1.coursename = LR2.coursename AND LR1.season = LR2.season "
-		"LEFT JOIN "
-		"(SELECT coursename, style, COUNT(DISTINCT username) AS global_count FROM LocalRun GROUP BY coursename, style) AS LR3 "
-		"ON LR1.style = LR3.style AND LR1.coursename = LR3.coursename";
-	CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
-	while (1) {
-		s = sqlite3_step(stmt);
-		if (s == SQLITE_ROW) {
-			G_GetRaceScore(sqlite3_column_int(stmt, 0), (char*)sqlite3_column_text(stmt, 1), (char*)sqlite3_column_text(stmt, 2),
-				sqlite3_column_int(stmt, 3), sqlite3_column_int(stmt, 4), sqlite3_column_int(stmt, 5), sqlite3_column_int(stmt, 6), rawtime, db);
+	//Sort every course in memory once instead of scanning LocalRun for every row
+	cache = (raceCache_t *)calloc(1, sizeof(raceCache_t));
+	if (!cache) {
+		G_ErrorPrint("ERROR: Out of memory (SV_RebuildRaceRanks_f)", 0);
+		return;
+	}
 
-			//G_UpdateUnlocks((char*)sqlite3_column_text(stmt, 1), (char*)sqlite3_column_text(stmt, 2), sqlite3_column_int(stmt, 3), NULL, db);
-		}
-		else if (s == SQLITE_DONE)
-			break;
-		else {
-			G_ErrorPrint("ERROR: SQL Select Failed (SV_RebuildRaceRanks_f)", s);
-			break;
+	if (G_RaceCacheLoad(cache, NULL)) {
+		db = G_DBAcquire();
+
+		for (i = 0; i < RACECACHE_ENTRY_HASH; i++) {
+			raceEntry_t *entry;
+
+			for (entry = cache->entries[i]; entry; entry = entry->hashNext) {
+				if (entry->board->season != RACECACHE_ALLSEASONS)
+					G_GetRaceScore(cache, entry, rawtime, db);
+			}
 		}
-	}
-	CALL_SQLITE(finalize(stmt));
 
-	CALL_SQLITE(close(db));
+		G_DBRelease(db);
+	}
 
+	G_RaceCacheClear(cache);
+	free(cache);
 }
 
 static int G_GetSeason(void) {
@@ -1320,11 +2534,12 @@ static int G_GetSeason(void) {
 	return 3;
 }
 
-static void G_UpdateOurLocalRun(sqlite3 * db, int seasonOldRank_self, int seasonNewRank_self, int globalOldRank_self, int globalNewRank_self, int style_self, char *username_self, char *coursename_self, 
+static qboolean G_UpdateOurLocalRun(sqlite3 * db, int seasonOldRank_self, int seasonNewRank_self, int globalOldRank_self, int globalNewRank_self, int style_self, char *username_self, char *coursename_self, 
 	int duration_ms_self, int topspeed_self, int average_self, int end_time_self, int seasonCount, int globalCount) {
 	char * sql;
 	sqlite3_stmt * stmt;
 	int s;
+	qboolean written = qtrue;
 	const int season = G_GetSeason();
 
 	//Get count
@@ -1334,7 +2549,7 @@ static void G_UpdateOurLocalRun(sqlite3 * db, int seasonOldRank_self, int season
 	//This also needs to update lastupdatetime for the website!
 	if (globalNewRank_self && globalOldRank_self) { //And globalOldRankSelf ? - We dont want to update other rows if we dont have any other rows
 		sql = "UPDATE LocalRun SET rank = 0, last_update = ? WHERE username = ? AND coursename = ? AND style = ?";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_int (stmt, 1, end_time_self));
 		CALL_SQLITE (bind_text (stmt, 2, username_self, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_text (stmt, 3, coursename_self, -1, SQLITE_STATIC));
@@ -1343,12 +2558,12 @@ static void G_UpdateOurLocalRun(sqlite3 * db, int seasonOldRank_self, int season
 		if (s != SQLITE_DONE) {
 			G_ErrorPrint("ERROR: SQL Update Failed (G_UpdateOurLocalRun 1)", s);
 		}
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 	}
 
 	if (seasonOldRank_self == -1) { //First attempt of the season
 		sql = "INSERT INTO LocalRun (username, coursename, duration_ms, topspeed, average, style, season, end_time, rank, entries, season_rank, season_entries, last_update) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_text (stmt, 1, username_self, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_text (stmt, 2, coursename_self, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_int (stmt, 3, duration_ms_self));
@@ -1364,18 +2579,14 @@ static void G_UpdateOurLocalRun(sqlite3 * db, int seasonOldRank_self, int season
 		CALL_SQLITE (bind_int (stmt, 13, end_time_self));
 		s = sqlite3_step(stmt);
 		if (s != SQLITE_DONE) {
-			char string[1024] = {0};
-
-			Com_sprintf(string, sizeof(string), "%s;%s;%i;%i;%i;%i;%i;%i\n", username_self, coursename_self, duration_ms_self, topspeed_self, average_self, style_self, season, end_time_self);
-			trap->FS_Write( string, strlen( string ), level.failRaceLog );
-
+			written = qfalse; //Caller writes this run to failRaceLog
 			G_ErrorPrint("ERROR: SQL Insert Failed (G_UpdateOurLocalRun 2)", s);
 		}
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 	}
 	else {
 		sql = "UPDATE LocalRun SET duration_ms = ?, topspeed = ?, average = ?, end_time = ?, rank = ?, season_rank = ?, last_update = ? WHERE username = ? AND coursename = ? AND style = ? AND season = ?";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_int (stmt, 1, duration_ms_self));
 		CALL_SQLITE (bind_int (stmt, 2, topspeed_self));
 		CALL_SQLITE (bind_int (stmt, 3, average_self));
@@ -1389,16 +2600,13 @@ static void G_UpdateOurLocalRun(sqlite3 * db, int seasonOldRank_self, int season
 		CALL_SQLITE (bind_int (stmt, 11, season));
 		s = sqlite3_step(stmt);
 		if (s != SQLITE_DONE) {
-			char string[1024] = {0};
-
-			Com_sprintf(string, sizeof(string), "%s;%s;%i;%i;%i;%i;%i;%i\n", username_self, coursename_self, duration_ms_self, topspeed_self, average_self, style_self, season, end_time_self);
-			trap->FS_Write( string, strlen( string ), level.failRaceLog );
-
+			written = qfalse;
 			G_ErrorPrint("ERROR: SQL Update Failed (G_UpdateOurLocalRun 3)", s);
 		}
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 	}
 
+	return written;
 }
 
 static void G_UpdateOtherLocalRun(sqlite3 * db, int seasonNewRank_self, int seasonOldRank_self, int globalNewRank_self, int globalOldRank_self, int style_self, char *coursename_self, int time) {
@@ -1414,7 +2622,7 @@ static void G_UpdateOtherLocalRun(sqlite3 * db, int seasonNewRank_self, int seas
 	else
 		sql = "UPDATE LocalRun SET season_rank = season_rank + 1, last_update = ? WHERE coursename = ? and style = ? AND season = ? AND season_rank >= ? AND season_rank < ?";
 
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_int (stmt, 1, time));
 	CALL_SQLITE (bind_text (stmt, 2, coursename_self, -1, SQLITE_STATIC));
 	CALL_SQLITE (bind_int (stmt, 3, style_self));
@@ -1428,7 +2636,7 @@ static void G_UpdateOtherLocalRun(sqlite3 * db, int seasonNewRank_self, int seas
 	if (s != SQLITE_DONE) {
 		G_ErrorPrint("ERROR: SQL Update Failed (G_UpdateOtherLocalRun)", s);
 	}
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
 	//Should not care about what season we update if its a global pb ?
 	if (globalNewRank_self) { //Dont update other peoples global ranks if our run was not a global personal best...
@@ -1437,7 +2645,7 @@ static void G_UpdateOtherLocalRun(sqlite3 * db, int seasonNewRank_self, int seas
 		else
 			sql = "UPDATE LocalRun SET rank = rank + 1, last_update = ? WHERE coursename = ? and style = ? AND rank >= ? AND rank < ?";
 
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_int (stmt, 1, time));
 		CALL_SQLITE (bind_text (stmt, 2, coursename_self, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_int (stmt, 3, style_self));
@@ -1450,14 +2658,14 @@ static void G_UpdateOtherLocalRun(sqlite3 * db, int seasonNewRank_self, int seas
 		if (s != SQLITE_DONE) {
 			G_ErrorPrint("ERROR: SQL Update Failed (G_UpdateOtherLocalRun 2)", s);
 		}
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 	}
 
 	//loda this can be combined with above query probably
 	if (seasonOldRank_self == -1) { //First attempt  
 		sql = "UPDATE LocalRun SET season_entries = season_entries + 1, last_update = ? WHERE coursename = ? AND style = ? AND season = ?";
 	//+1 count for all, +1 rank only if affected
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_int (stmt, 1, time));
 		CALL_SQLITE (bind_text (stmt, 2, coursename_self, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_int (stmt, 3, style_self));
@@ -1467,14 +2675,14 @@ static void G_UpdateOtherLocalRun(sqlite3 * db, int seasonNewRank_self, int seas
 		if (s != SQLITE_DONE) {
 			G_ErrorPrint("ERROR: SQL Update Failed (G_UpdateOtherLocalRun 3)", s);
 		}
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 	}
 
 
 	if (globalOldRank_self == -1) { //First attempt  
 		sql = "UPDATE LocalRun SET entries = entries + 1, last_update = ? WHERE coursename = ? AND style = ?";
 	//+1 count for all, +1 rank only if affected
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_int (stmt, 1, time));
 		CALL_SQLITE (bind_text (stmt, 2, coursename_self, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_int (stmt, 3, style_self));
@@ -1483,7 +2691,7 @@ static void G_UpdateOtherLocalRun(sqlite3 * db, int seasonNewRank_self, int seas
 		if (s != SQLITE_DONE) {
 			G_ErrorPrint("ERROR: SQL Update Failed (G_UpdateOtherLocalRun 4)", s);
 		}
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 	}
 
 }
@@ -1607,12 +2815,12 @@ void G_UpdatePlaytime(sqlite3 *db, char *username, int seconds ) {
 	qboolean newDB = qfalse;
 
 	if (!db) {
-		CALL_SQLITE (open (LOCAL_DB_PATH, & db)); 
+		db = G_DBAcquire(); 
 		newDB = qtrue;
 	}
 	
 	sql = "UPDATE LocalAccount SET racetime = racetime + ? WHERE username = ?";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_int (stmt, 1, seconds));
 	CALL_SQLITE (bind_text (stmt, 2, username, -1, SQLITE_STATIC));
 
@@ -1621,50 +2829,54 @@ void G_UpdatePlaytime(sqlite3 *db, char *username, int seconds ) {
 		G_ErrorPrint("ERROR: SQL Update Failed (G_UpdatePlaytime)", s);
 	}
 
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 	if (newDB) {
-		CALL_SQLITE (close(db));
+		G_DBRelease(db);
 	}
 }
 
-void G_UpdateUnlocks(char *username, char *coursename, int style, int duration_ms, gclient_t *client, sqlite3 *db) { //Combine with update playtime i think, to reduce queries.  Update playtime is done after course completion..?
-	//If its a cumulative award or something, we can check if current race is any of the conditions, then sql check inside to see if all the other conditions are met
-	//Or, just make it cumulative when we check ValidateCosmetics, i guess thats better?
-	unsigned int unlock = 0;
-	unsigned int unlocks = 0;
+//Game thread only, SV_RebuildUnlocks_f refills cosmeticUnlocks without a lock.  The race job gets the result when it's queued
+static unsigned int G_FindUnlock(const char *coursename, int style, int duration_ms, unsigned int unlocks) {
 	int i;
 
-	if (client)
-		unlocks = client->pers.unlocks;  	//Unlocks is existing unlocks from client. no need to update if they already have it.
-
 	for (i=0; i<MAX_COSMETIC_UNLOCKS; i++) {
 		if (!(unlocks & 1 << cosmeticUnlocks[i].bitvalue) && cosmeticUnlocks[i].style == style && !Q_stricmp(coursename, cosmeticUnlocks[i].mapname) && (!cosmeticUnlocks[i].duration || (duration_ms < cosmeticUnlocks[i].duration))) {
-			unlock = (1 << cosmeticUnlocks[i].bitvalue);
 			//Com_Printf("Unlock found %i (%i %s)\n", cosmeticUnlocks[i].bitvalue, style, coursename);
-			break;
+			return (1 << cosmeticUnlocks[i].bitvalue);
 		}
 	}
+	return 0;
+}
 
-	if (unlock) {
-		char * sql;
-		sqlite3_stmt * stmt;
-		int s;
+static void G_WriteUnlock(const char *username, unsigned int unlock, sqlite3 *db) {
+	char * sql;
+	sqlite3_stmt * stmt;
+	int s;
 
-		sql = "UPDATE LocalAccount SET unlocks = unlocks | ? WHERE username = ?";
-		CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
-		CALL_SQLITE(bind_int(stmt, 1, unlock));
-		CALL_SQLITE(bind_text(stmt, 2, username, -1, SQLITE_STATIC));
+	sql = "UPDATE LocalAccount SET unlocks = unlocks | ? WHERE username = ?";
+	G_DBPrepare(db, sql, &stmt);
+	CALL_SQLITE(bind_int(stmt, 1, unlock));
+	CALL_SQLITE(bind_text(stmt, 2, username, -1, SQLITE_STATIC));
 
-		s = sqlite3_step(stmt);
-		if (s != SQLITE_DONE) {
-			G_ErrorPrint("ERROR: SQL Update Failed (G_UpdateUnlocks)", s);
-		}
+	s = sqlite3_step(stmt);
+	if (s != SQLITE_DONE) {
+		G_ErrorPrint("ERROR: SQL Update Failed (G_UpdateUnlocks)", s);
+	}
 
-		CALL_SQLITE(finalize(stmt));
+	G_DBFinalize(stmt);
+}
+
+unsigned int G_UpdateUnlocks(char *username, char *coursename, int style, int duration_ms, unsigned int unlocks, sqlite3 *db) { //Combine with update playtime i think, to reduce queries.  Update playtime is done after course completion..?
+	//If its a cumulative award or something, we can check if current race is any of the conditions, then sql check inside to see if all the other conditions are met
+	//Or, just make it cumulative when we check ValidateCosmetics, i guess thats better?
+	//Unlocks is existing unlocks from client. no need to update if they already have it.  Returns the new unlock so the caller can give it to the client.
+	const unsigned int unlock = G_FindUnlock(coursename, style, duration_ms, unlocks);
 
-		if (client)//Also update in realtime if possible.
-			client->pers.unlocks |= unlock;
+	if (unlock) {
+		G_WriteUnlock(username, unlock, db);
 	}
+
+	return unlock;
 }
 
 void G_SpawnCosmeticUnlocks(void) {
@@ -1723,22 +2935,22 @@ void SV_RebuildUnlocks_f(void) {
 	memset(cosmeticUnlocks, 0, sizeof(cosmeticUnlocks));
 	G_SpawnCosmeticUnlocks();//Re Spawn from CFG
 
-	CALL_SQLITE(open(LOCAL_DB_PATH, &db));
+	db = G_DBAcquire();
 
 	//Set all unlocks to 0 ?
 	sql = "UPDATE LocalAccount SET unlocks = 0"; //Only get username for cumulative checks if needed
-	CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	s = sqlite3_step(stmt);
 	if (s != SQLITE_DONE)
 		G_ErrorPrint("ERROR: SQL Update Failed (SV_RebuildUnlocks_f 1)", s);
-	CALL_SQLITE(finalize(stmt));
+	G_DBFinalize(stmt);
 
 	sql = "SELECT username, coursename, style, duration_ms FROM LocalRun"; //Only get username for cumulative checks if needed
-	CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	while (1) {
 		s = sqlite3_step(stmt);
 		if (s == SQLITE_ROW) {
-			G_UpdateUnlocks((char*)sqlite3_column_text(stmt, 0), (char*)sqlite3_column_text(stmt, 1), sqlite3_column_int(stmt, 2), sqlite3_column_int(stmt, 3), NULL, db);
+			G_UpdateUnlocks((char*)sqlite3_column_text(stmt, 0), (char*)sqlite3_column_text(stmt, 1), sqlite3_column_int(stmt, 2), sqlite3_column_int(stmt, 3), 0, db);
 		}
 		else if (s == SQLITE_DONE)
 			break;
@@ -1747,24 +2959,17 @@ void SV_RebuildUnlocks_f(void) {
 			break;
 		}
 	}
-	CALL_SQLITE(finalize(stmt));
+	G_DBFinalize(stmt);
 
-	CALL_SQLITE(close(db));
+	G_DBRelease(db);
 }
 
 void StripWhitespace(char *s);
 void G_AddRaceTime(char *username, char *message, int duration_ms, int style, int topspeed, int average, int clientNum, int awesomenoise) {//should be short.. but have to change elsewhere? is it worth it?
 	time_t	rawtime;
-	char	string[1024] = {0}, info[1024] = {0}, coursename[40], timeStr[32] = {0}, styleString[32] = {0};
-	qboolean seasonPB = qfalse, globalPB = qfalse;//, WR = qfalse;
-	sqlite3 * db;
-	char * sql;
-	sqlite3_stmt * stmt;
-	int s;
-	int season_oldBest, season_oldRank = 0, season_newRank = -1, global_oldBest, global_oldRank = 0, global_newRank = -1; //Changed newrank to be -1 ??
-	float addedScore;
+	char	string[1024] = {0}, info[1024] = {0}, coursename[40];
 	gclient_t	*cl;
-	const int season = G_GetSeason();
+	dbJob_t		*job;
 
 	cl = &level.clients[clientNum];
 
@@ -1787,18 +2992,66 @@ void G_AddRaceTime(char *username, char *message, int duration_ms, int style, in
 	Q_strlwr(coursename);
 	Q_CleanStr(coursename);
 
-	IntegerToRaceName(style, styleString, sizeof(styleString));
-
 	Com_sprintf(string, sizeof(string), "%s;%s;%i;%i;%i;%i;%i\n", username, coursename, duration_ms, topspeed, average, style, rawtime);
 
 	if (level.raceLog)
 		trap->FS_Write(string, strlen(string), level.raceLog); //Always write to text file races.log
 
-	CALL_SQLITE(open(LOCAL_DB_PATH, &db));
+#if _USE_CURL
+	G_AddRunToWebServer(username, coursename, duration_ms, topspeed, average, style, rawtime);
+#endif
+
+	job = (dbJob_t *)calloc(1, sizeof(dbJob_t));
+	if (!job) {
+		G_ErrorPrint("ERROR: Out of memory (G_AddRaceTime)", 0);
+		return;
+	}
+
+	job->type = DBJOB_RACE;
+	Q_strncpyz(job->username, username, sizeof(job->username));
+	Q_strncpyz(job->playername, cl->pers.netname, sizeof(job->playername));
+	if (message) {
+		Q_strncpyz(job->message, message, sizeof(job->message));
+		job->hasMessage = qtrue;
+	}
+	Q_strncpyz(job->coursename, coursename, sizeof(job->coursename));
+	IntegerToRaceName(style, job->styleString, sizeof(job->styleString));
+	job->clientNum = clientNum;
+	job->duration_ms = duration_ms;
+	job->style = style;
+	job->topspeed = topspeed;
+	job->average = average;
+	job->awesomenoise = awesomenoise;
+	job->end_time = rawtime;
+	job->unlock = G_FindUnlock(coursename, style, duration_ms, cl->pers.unlocks); //What a global PB earns, the worker only writes it
+
+	cl->pers.stats.racetime += (duration_ms*0.001f) - cl->afkDuration*0.001f;
+	cl->afkDuration = 0;
+	if (cl->pers.stats.racetime > 120.0f) { //Avoid spamming the db
+		job->playtime = (int)(cl->pers.stats.racetime + 0.5f);
+		cl->pers.stats.racetime = 0.0f;
+	}
+
+	job->ranksKnown = G_RaceCacheAddRun(job, G_GetSeason());
+
+	G_DBQueueJob(job); //Written out on the database thread, G_FinishRaceJob prints the result
+}
+
+//Database thread fallback for G_RaceCacheAddRun, when the leaderboard cache could not be loaded
+static void G_GetRaceRanksFromDB(dbJob_t *job, sqlite3 *db) {
+	char * sql;
+	sqlite3_stmt * stmt;
+	int s;
+	int season_oldBest, season_oldRank = 0, season_newRank = -1, global_oldBest, global_oldRank = 0, global_newRank = -1; //Changed newrank to be -1 ??
+	int season_oldCount = 0, season_newCount = 0, global_oldCount = 0, global_newCount = 0;
+	qboolean seasonPB = qfalse, globalPB = qfalse;//, WR = qfalse;
+	const int season = G_GetSeason();
+	char *username = job->username, *coursename = job->coursename;
+	const int duration_ms = job->duration_ms, style = job->style;
 
 	sql = "SELECT MIN(duration_ms), season_rank FROM LocalRun WHERE username = ? AND coursename = ? AND style = ? AND season = ? "
 		"UNION ALL SELECT MIN(duration_ms), rank FROM LocalRun WHERE username = ? AND coursename = ? AND style = ?";
-	CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE(bind_text(stmt, 1, username, -1, SQLITE_STATIC));
 	CALL_SQLITE(bind_text(stmt, 2, coursename, -1, SQLITE_STATIC));
 	CALL_SQLITE(bind_int(stmt, 3, style));
@@ -1850,16 +3103,13 @@ void G_AddRaceTime(char *username, char *message, int duration_ms, int style, in
 	else if (s != SQLITE_DONE) {
 		G_ErrorPrint("ERROR: SQL Select Failed (G_AddRaceTime 2)", s);
 	}
-	CALL_SQLITE(finalize(stmt));
-
-
+	G_DBFinalize(stmt);
 	if (seasonPB) {
-		int season_oldCount = 0, season_newCount, global_oldCount = 0, global_newCount;
 		int i = 1; //1st place is rank 1
 
 		sql = "SELECT COUNT(*) FROM LocalRun WHERE coursename = ? AND style = ? AND season = ? "
 			"UNION ALL SELECT COUNT(DISTINCT username) FROM LocalRun WHERE coursename = ? AND style = ?"; //entries ?
-		CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE(bind_text(stmt, 1, coursename, -1, SQLITE_STATIC));
 		CALL_SQLITE(bind_int(stmt, 2, style));
 		CALL_SQLITE(bind_int(stmt, 3, season));
@@ -1881,11 +3131,11 @@ void G_AddRaceTime(char *username, char *message, int duration_ms, int style, in
 			G_ErrorPrint("ERROR: SQL Select Failed (G_AddRaceTime 4)", s);
 		}
 
-		CALL_SQLITE(finalize(stmt));
+		G_DBFinalize(stmt);
 
 		//Get season rank
 		sql = "SELECT duration_ms FROM LocalRun WHERE coursename = ? AND style = ? AND season = ? ORDER BY duration_ms ASC, end_time ASC"; //assume just one per person to speed this up..
-		CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE(bind_text(stmt, 1, coursename, -1, SQLITE_STATIC));
 		CALL_SQLITE(bind_int(stmt, 2, style));
 		CALL_SQLITE(bind_int(stmt, 3, season));
@@ -1906,13 +3156,13 @@ void G_AddRaceTime(char *username, char *message, int duration_ms, int style, in
 				break;
 			}
 		}
-		CALL_SQLITE(finalize(stmt));
+		G_DBFinalize(stmt);
 
 		i = 1; //oh no no
 
 		//Get global rank, could union this with previous query maybe
 		sql = "SELECT MIN(duration_ms) FROM LocalRun WHERE coursename = ? AND style = ? GROUP BY username ORDER BY duration_ms ASC, end_time ASC";
-		CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE(bind_text(stmt, 1, coursename, -1, SQLITE_STATIC));
 		CALL_SQLITE(bind_int(stmt, 2, style));
 		while (1) {
@@ -1932,7 +3182,7 @@ void G_AddRaceTime(char *username, char *message, int duration_ms, int style, in
 				break;
 			}
 		}
-		CALL_SQLITE(finalize(stmt));
+		G_DBFinalize(stmt);
 
 		if (season_newRank == 0) { //We wern't faster than any times, so set our rank to count (+ 1) ? -- loda checkme
 			season_newRank = season_oldCount + 1;
@@ -1966,26 +3216,40 @@ void G_AddRaceTime(char *username, char *message, int duration_ms, int style, in
 		if (!globalPB) {
 			global_newRank = 0;
 		}
+	}
+	//else.. set ranks to 0 for print, nothing to update
 
-		if ((season_newRank != season_oldRank || global_newRank != global_oldRank)) { //Do this before messing with out race list rank - does this affect count?
-			G_UpdateOtherLocalRun(db, season_newRank, season_oldRank, global_newRank, global_oldRank, style, coursename, rawtime); //Update other spots in race list
-		}
-		G_UpdateOurLocalRun(db, season_oldRank, season_newRank, global_oldRank, global_newRank, style, username, coursename, duration_ms, topspeed, average, rawtime, season_newCount, global_newCount);//Update our race list
+	job->seasonPB = seasonPB;
+	job->globalPB = globalPB;
+	job->season_oldRank = season_oldRank;
+	job->season_newRank = season_newRank;
+	job->global_oldRank = global_oldRank;
+	job->global_newRank = global_newRank;
+	job->season_oldCount = season_oldCount;
+	job->season_newCount = season_newCount;
+	job->global_oldCount = global_oldCount;
+	job->global_newCount = global_newCount;
+}
 
-		if (cl->pers.recordingDemo && globalPB) {
-			char mapCourse[MAX_QPATH] = { 0 };
+//Database thread part of G_AddRaceTime
+static void G_RunRaceJob(dbJob_t *job, sqlite3 *db) {
+	const unsigned int unlock = job->unlock;
 
-			Q_strncpyz(mapCourse, coursename, sizeof(mapCourse));
-			StripWhitespace(mapCourse);
-			Q_strstrip(mapCourse, "\n\r;:.?*<>|\\/\"", NULL);
+	job->unlock = 0;
 
-			if (cl) {
-				cl->pers.stopRecordingTime = level.time + 2000;
-				cl->pers.keepDemo = qtrue;
-				Com_sprintf(cl->pers.oldDemoName, sizeof(cl->pers.oldDemoName), "%s", cl->pers.userName);
-				Com_sprintf(cl->pers.demoName, sizeof(cl->pers.demoName), "%s/%s-%s-%s", cl->pers.userName, cl->pers.userName, mapCourse, styleString); //TODO, change this to %s/%s-%s-%s so its puts in individual players folder
-			}
+	if (!job->ranksKnown)
+		G_GetRaceRanksFromDB(job, db);
+
+	if (job->seasonPB) {
+		const int season_oldRank = job->season_oldRank, season_newRank = job->season_newRank, global_oldRank = job->global_oldRank, global_newRank = job->global_newRank;
+		const int season_oldCount = job->season_oldCount, season_newCount = job->season_newCount, global_oldCount = job->global_oldCount, global_newCount = job->global_newCount;
+		float addedScore = 0.0f;
+
+		if ((season_newRank != season_oldRank || global_newRank != global_oldRank)) { //Do this before messing with out race list rank - does this affect count?
+			G_UpdateOtherLocalRun(db, season_newRank, season_oldRank, global_newRank, global_oldRank, job->style, job->coursename, job->end_time); //Update other spots in race list
 		}
+		if (!G_UpdateOurLocalRun(db, season_oldRank, season_newRank, global_oldRank, global_newRank, job->style, job->username, job->coursename, job->duration_ms, job->topspeed, job->average, job->end_time, season_newCount, global_newCount))//Update our race list
+			job->failedWrite = qtrue;
 
 		//For print
 		if (global_newRank > 0) {
@@ -1998,24 +3262,52 @@ void G_AddRaceTime(char *username, char *message, int duration_ms, int style, in
 			if (season_oldRank > 0)
 				addedScore -= ((season_oldCount / (float)season_oldRank) + (season_oldCount - season_oldRank)) * 0.5f;
 		}
+		job->addedScore = addedScore;
+
+		if (job->globalPB) {
+			if (unlock) {
+				G_WriteUnlock(job->username, unlock, db);
+				job->unlock = unlock;
+			}
+		}
+	}
+
+	if (job->playtime) {
+		G_UpdatePlaytime(db, job->username, job->playtime);
+	}
+}
+
+//Game thread part of G_AddRaceTime, once the database thread has worked out the ranks
+static void G_FinishRaceJob(dbJob_t *job) {
+	char timeStr[32] = {0};
+	gclient_t *cl = &level.clients[job->clientNum];
+	const qboolean sameClient = (qboolean)(cl->pers.connected == CON_CONNECTED && !Q_stricmp(cl->pers.userName, job->username));
 
-		if (globalPB) {
-			G_UpdateUnlocks(username, coursename, style, duration_ms, cl, db);
-		}
+	if (job->failedWrite && level.failRaceLog) {
+		char string[1024] = {0};
+
+		Com_sprintf(string, sizeof(string), "%s;%s;%i;%i;%i;%i;%i;%i\n", job->username, job->coursename, job->duration_ms, job->topspeed, job->average, job->style, G_GetSeason(), job->end_time);
+		trap->FS_Write( string, strlen( string ), level.failRaceLog );
 	}
-	//else.. set ranks to 0 for print, nothing to update
 
-	cl->pers.stats.racetime += (duration_ms*0.001f) - cl->afkDuration*0.001f;
-	cl->afkDuration = 0;
-	if (cl->pers.stats.racetime > 120.0f) { //Avoid spamming the db
-		G_UpdatePlaytime(db, username, (int)(cl->pers.stats.racetime + 0.5f));
-		cl->pers.stats.racetime = 0.0f;
+	if (sameClient && job->seasonPB && job->globalPB && cl->pers.recordingDemo) {
+		char mapCourse[MAX_QPATH] = { 0 };
+
+		Q_strncpyz(mapCourse, job->coursename, sizeof(mapCourse));
+		StripWhitespace(mapCourse);
+		Q_strstrip(mapCourse, "\n\r;:.?*<>|\\/\"", NULL);
+
+		cl->pers.stopRecordingTime = level.time + 2000;
+		cl->pers.keepDemo = qtrue;
+		Com_sprintf(cl->pers.oldDemoName, sizeof(cl->pers.oldDemoName), "%s", cl->pers.userName);
+		Com_sprintf(cl->pers.demoName, sizeof(cl->pers.demoName), "%s/%s-%s-%s", cl->pers.userName, cl->pers.userName, mapCourse, job->styleString); //TODO, change this to %s/%s-%s-%s so its puts in individual players folder
 	}
-	
-	CALL_SQLITE(close(db));
 
-	TimeToString((int)(duration_ms), timeStr, sizeof(timeStr), qfalse);
-	PrintRaceTime(username, cl->pers.netname, message, styleString, topspeed, average, timeStr, clientNum, season_newRank, seasonPB, global_newRank, qtrue, qtrue, season_oldRank, global_oldRank, addedScore, awesomenoise);
+	if (sameClient && job->unlock)//Also update in realtime if possible.
+		cl->pers.unlocks |= job->unlock;
+
+	TimeToString(job->duration_ms, timeStr, sizeof(timeStr), qfalse);
+	PrintRaceTime(job->username, job->playername, job->hasMessage ? job->message : NULL, job->styleString, job->topspeed, job->average, timeStr, job->clientNum, job->season_newRank, job->seasonPB, job->global_newRank, qtrue, qtrue, job->season_oldRank, job->global_oldRank, job->addedScore, job->awesomenoise);
 	//DebugWriteToDB("G_AddRaceTime");
 }
 
@@ -2126,11 +3418,11 @@ void Cmd_ACLogin_f( gentity_t *ent ) { //loda fixme show lastip ? or use lastip
 		gclient_t	*cl;
 		unsigned int lastip = 0, unlocks = 0, flags = 0;
 
-		CALL_SQLITE(open(LOCAL_DB_PATH, &db));
+		db = G_DBAcquire();
 
 		if (ip) {
 			sql = "SELECT COUNT(*) FROM LocalAccount WHERE lastip = ?";
-			CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE(bind_int64(stmt, 1, ip));
 
 			s = sqlite3_step(stmt);
@@ -2139,16 +3431,16 @@ void Cmd_ACLogin_f( gentity_t *ent ) { //loda fixme show lastip ? or use lastip
 				count = sqlite3_column_int(stmt, 0);
 			else if (s != SQLITE_DONE) {
 				G_ErrorPrint("ERROR: SQL Select Failed (Cmd_ACLogin_f 1)", s);
-				CALL_SQLITE(finalize(stmt));
-				CALL_SQLITE(close(db));
+				G_DBFinalize(stmt);
+				G_DBRelease(db);
 				return;
 			}
 
-			CALL_SQLITE(finalize(stmt));
+			G_DBFinalize(stmt);
 		}
 
 		sql = "SELECT password, lastip, flags, unlocks FROM LocalAccount WHERE username = ?";
-		CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE(bind_text(stmt, 1, username, -1, SQLITE_STATIC));
 
 		while (1) {
@@ -2168,22 +3460,22 @@ void Cmd_ACLogin_f( gentity_t *ent ) { //loda fixme show lastip ? or use lastip
 			}
 		}
 
-		CALL_SQLITE(finalize(stmt));
+		G_DBFinalize(stmt);
 
 		if (row == 0) { // No accounts found
 			trap->SendServerCommand(ent - g_entities, "print \"Account not found! To make a new account, use the /register command.\n\"");
-			CALL_SQLITE(close(db));
+			G_DBRelease(db);
 			return;
 		}
 		else if (row > 1) { // More than 1 account found
 			trap->Print("WARNING: Multiple accounts with same name!\n");
-			CALL_SQLITE(close(db));
+			G_DBRelease(db);
 			return;
 		}
 
 		if (!(flags & JAPRO_ACCOUNTFLAG_TRUSTED) && (count > 0) && lastip && ip && (lastip != ip)) { //IF lastip already tied to account, and lastIP (of attempted login username) does not match current IP, deny.?
 			trap->SendServerCommand(ent - g_entities, "print \"Your IP address already belongs to an account. You are only allowed one account.\n\"");
-			CALL_SQLITE(close(db));
+			G_DBRelease(db);
 			return;
 		}
 
@@ -2193,7 +3485,7 @@ void Cmd_ACLogin_f( gentity_t *ent ) { //loda fixme show lastip ? or use lastip
 			cl = &level.clients[i];
 			if (!Q_stricmp(username, cl->pers.userName)) {
 				trap->SendServerCommand(ent - g_entities, "print \"This account is already logged in!\n\"");
-				CALL_SQLITE(close(db));
+				G_DBRelease(db);
 				return;
 			}
 		}
@@ -2206,7 +3498,7 @@ void Cmd_ACLogin_f( gentity_t *ent ) { //loda fixme show lastip ? or use lastip
 
 			if ((flags & JAPRO_ACCOUNTFLAG_IPLOCK) && lastip && lastip != ip) {
 				trap->SendServerCommand(ent - g_entities, "print \"This account is locked to a different IP address.\n\"");
-				CALL_SQLITE(close(db));
+				G_DBRelease(db);
 				return;
 			}
 
@@ -2222,7 +3514,7 @@ void Cmd_ACLogin_f( gentity_t *ent ) { //loda fixme show lastip ? or use lastip
 				ip = lastip;
 
 			sql = "UPDATE LocalAccount SET lastip = ?, lastlogin = ? WHERE username = ?";
-			CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE(bind_int64(stmt, 1, ip));
 			CALL_SQLITE(bind_int(stmt, 2, rawtime));
 			CALL_SQLITE(bind_text(stmt, 3, username, -1, SQLITE_STATIC));
@@ -2232,7 +3524,7 @@ void Cmd_ACLogin_f( gentity_t *ent ) { //loda fixme show lastip ? or use lastip
 			if (s != SQLITE_DONE)
 				G_ErrorPrint("ERROR: SQL Update Failed (Cmd_ACLogin_f 3)", s);
 
-			CALL_SQLITE(finalize(stmt));
+			G_DBFinalize(stmt);
 
 			ent->client->pers.unlocks = unlocks;
 
@@ -2249,7 +3541,7 @@ void Cmd_ACLogin_f( gentity_t *ent ) { //loda fixme show lastip ? or use lastip
 		else {
 			trap->SendServerCommand(ent - g_entities, "print \"Incorrect password!\n\"");
 		}
-		CALL_SQLITE(close(db));
+		G_DBRelease(db);
 	}
 
 	//DebugWriteToDB("Cmd_ACLogin_f");
@@ -2287,9 +3579,9 @@ void Cmd_ChangePassword_f( gentity_t *ent ) {
 	Q_CleanStr(enteredPassword);
 	Q_CleanStr(newPassword);
 
-	CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+	db = G_DBAcquire();
 	sql = "SELECT password FROM LocalAccount WHERE username = ?";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_text (stmt, 1, ent->client->pers.userName, -1, SQLITE_STATIC));
 	
     while (1) {
@@ -2306,13 +3598,13 @@ void Cmd_ChangePassword_f( gentity_t *ent ) {
         }
     }
 
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
 	if (enteredPassword[0] && password[0] && !Q_stricmp(enteredPassword, password)) {
 		int s;
 
 		sql = "UPDATE LocalAccount SET password = ? WHERE username = ?";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_text (stmt, 1, newPassword, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_text (stmt, 2, ent->client->pers.userName, -1, SQLITE_STATIC));
 		s = sqlite3_step(stmt);
@@ -2321,12 +3613,12 @@ void Cmd_ChangePassword_f( gentity_t *ent ) {
 		else
 			G_ErrorPrint("ERROR: SQL Update Failed (Cmd_ChangePassword_f 2)", s);
 
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 	}
 	else {
 		trap->SendServerCommand(ent-g_entities, "print \"Incorrect password!\n\"");
 	}	
-	CALL_SQLITE (close(db));
+	G_DBRelease(db);
 
 	//DebugWriteToDB("Cmd_ChangePassword_f");
 }
@@ -2357,9 +3649,9 @@ void Svcmd_ChangePass_f(void)
 		return;
 	}
 
-	CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+	db = G_DBAcquire();
 	sql = "UPDATE LocalAccount SET password = ? WHERE username = ?";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_text (stmt, 1, newPassword, -1, SQLITE_STATIC));
 	CALL_SQLITE (bind_text (stmt, 2, username, -1, SQLITE_STATIC));
 	s = sqlite3_step(stmt);
@@ -2368,8 +3660,8 @@ void Svcmd_ChangePass_f(void)
 	else
 		G_ErrorPrint("ERROR: SQL Update Failed (Svcmd_ChangePass_f)", s);
 
-	CALL_SQLITE (finalize(stmt));
-	CALL_SQLITE (close(db));
+	G_DBFinalize(stmt);
+	G_DBRelease(db);
 }
 
 void Svcmd_ClearIP_f(void)
@@ -2395,9 +3687,9 @@ void Svcmd_ClearIP_f(void)
 		return;
 	}
 
-	CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+	db = G_DBAcquire();
 	sql = "UPDATE LocalAccount SET lastip = 0 WHERE username = ?";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_text (stmt, 1, username, -1, SQLITE_STATIC));
 	s = sqlite3_step(stmt);
 
@@ -2406,8 +3698,8 @@ void Svcmd_ClearIP_f(void)
 	else
 		G_ErrorPrint("ERROR: SQL Update Failed (Svcmd_ClearIP_f)", s);
 
-	CALL_SQLITE (finalize(stmt));
-	CALL_SQLITE (close(db));
+	G_DBFinalize(stmt);
+	G_DBRelease(db);
 }
 
 void Svcmd_Register_f(void)
@@ -2451,9 +3743,9 @@ void Svcmd_Register_f(void)
 	time( &rawtime );
 	localtime( &rawtime );
 
-	CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+	db = G_DBAcquire();
     sql = "INSERT INTO LocalAccount (username, password, kills, deaths, suicides, captures, returns, racetime, created, lastlogin, lastip) VALUES (?, ?, 0, 0, 0, 0, 0, 0, ?, ?, 0)";
-    CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+    G_DBPrepare(db, sql, &stmt);
     CALL_SQLITE (bind_text (stmt, 1, username, -1, SQLITE_STATIC));
 	CALL_SQLITE (bind_text (stmt, 2, password, -1, SQLITE_STATIC));
 	CALL_SQLITE (bind_int (stmt, 3, rawtime));
@@ -2462,11 +3754,13 @@ void Svcmd_Register_f(void)
 
 	if (s == SQLITE_DONE)
 		trap->Print( "Account created.\n");
+	else if (s == G_DB_DEFERRED)
+		trap->Print( "Database busy, the account will be created shortly.\n");
 	else
 		G_ErrorPrint("ERROR: SQL Insert Failed (Svcmd_Register_f)", s);
 
-	CALL_SQLITE (finalize(stmt));
-	CALL_SQLITE (close(db));
+	G_DBFinalize(stmt);
+	G_DBRelease(db);
 }
 
 void Svcmd_DeleteAccount_f(void)
@@ -2495,34 +3789,39 @@ void Svcmd_DeleteAccount_f(void)
 		sqlite3_stmt * stmt;
 		int s;
 
-		CALL_SQLITE(open(LOCAL_DB_PATH, &db));
+		db = G_DBAcquire();
 
 		if (CheckUserExists(username)) {
 			sql = "DELETE FROM LocalAccount WHERE username = ?";
-			CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE(bind_text(stmt, 1, username, -1, SQLITE_STATIC));
 			s = sqlite3_step(stmt);
 			if (s == SQLITE_DONE)
 				trap->Print("Account deleted.\n");
 			else
 				G_ErrorPrint("ERROR: SQL Delete Failed (Svcmd_DeleteAccount_f 1)", s);
-			CALL_SQLITE(finalize(stmt));
+			G_DBFinalize(stmt);
 		}
 		else
 			trap->Print("User does not exist, deleting highscores for username anyway.\n");
 
 		sql = "DELETE FROM LocalRun WHERE username = ?";
-		CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE(bind_text(stmt, 1, username, -1, SQLITE_STATIC));
 
 		//Delete from localduel?
 
 		s = sqlite3_step(stmt);
-		if (s != SQLITE_DONE)
+		if (s == SQLITE_DONE)
+			G_RaceCacheRenameUser(username, NULL);
+		else {
+			if (s == G_DB_DEFERRED) //Can't tell when it lands, let the database work out ranks until the next map
+				G_RaceCacheClear(&raceCache);
 			G_ErrorPrint("ERROR: SQL Delete Failed (Svcmd_DeleteAccount_f 2)", s);
-		CALL_SQLITE(finalize(stmt));
+		}
+		G_DBFinalize(stmt);
 
-		CALL_SQLITE(close(db));
+		G_DBRelease(db);
 	}
 }
 
@@ -2566,11 +3865,11 @@ void Svcmd_RenameAccount_f(void)
 		sqlite3_stmt * stmt;
 		int s;
 
-		CALL_SQLITE(open(LOCAL_DB_PATH, &db));
+		db = G_DBAcquire();
 
 		if (CheckUserExists(username)) {
 			sql = "UPDATE LocalAccount SET username = ? WHERE username = ?";
-			CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE(bind_text(stmt, 1, newUsername, -1, SQLITE_STATIC));
 			CALL_SQLITE(bind_text(stmt, 2, username, -1, SQLITE_STATIC));
 			s = sqlite3_step(stmt);
@@ -2578,24 +3877,29 @@ void Svcmd_RenameAccount_f(void)
 				trap->Print("Account renamed.\n");
 			else
 				G_ErrorPrint("ERROR: SQL Update Failed (Svcmd_RenameAccount_f 1)", s);
-			CALL_SQLITE(finalize(stmt));
+			G_DBFinalize(stmt);
 		}
 		else
 			trap->Print("User does not exist, renaming in races and duels anyway.\n");
 
 		sql = "UPDATE LocalRun SET username = ? WHERE username = ?";
-		CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE(bind_text(stmt, 1, newUsername, -1, SQLITE_STATIC));
 		CALL_SQLITE(bind_text(stmt, 2, username, -1, SQLITE_STATIC));
 
 		s = sqlite3_step(stmt);
-		if (s != SQLITE_DONE)
+		if (s == SQLITE_DONE)
+			G_RaceCacheRenameUser(username, newUsername);
+		else {
+			if (s == G_DB_DEFERRED)
+				G_RaceCacheClear(&raceCache);
 			G_ErrorPrint("ERROR: SQL Update Failed (Svcmd_RenameAccount_f 2)", s);
+		}
 
-		CALL_SQLITE(finalize(stmt));
+		G_DBFinalize(stmt);
 
 		sql = "UPDATE LocalDuel SET winner = ? WHERE winner = ?";
-		CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE(bind_text(stmt, 1, newUsername, -1, SQLITE_STATIC));
 		CALL_SQLITE(bind_text(stmt, 2, username, -1, SQLITE_STATIC));
 
@@ -2603,10 +3907,10 @@ void Svcmd_RenameAccount_f(void)
 		if (s != SQLITE_DONE)
 			G_ErrorPrint("ERROR: SQL Update Failed (Svcmd_RenameAccount_f 3)", s);
 
-		CALL_SQLITE(finalize(stmt));
+		G_DBFinalize(stmt);
 
 		sql = "UPDATE LocalDuel SET loser = ? WHERE loser = ?";
-		CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE(bind_text(stmt, 1, newUsername, -1, SQLITE_STATIC));
 		CALL_SQLITE(bind_text(stmt, 2, username, -1, SQLITE_STATIC));
 
@@ -2614,8 +3918,8 @@ void Svcmd_RenameAccount_f(void)
 		if (s != SQLITE_DONE)
 			G_ErrorPrint("ERROR: SQL Update Failed (Svcmd_RenameAccount_f 4)", s);
 
-		CALL_SQLITE(finalize(stmt));
-		CALL_SQLITE(close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 
 	}
 }
@@ -2648,9 +3952,9 @@ void Svcmd_AccountInfo_f(void)
 		int s;
 		char timeStr[64] = { 0 }, buf[MAX_STRING_CHARS - 64] = { 0 };
 
-		CALL_SQLITE(open(LOCAL_DB_PATH, &db));
+		db = G_DBAcquire();
 		sql = "SELECT created, lastlogin, lastip, racetime FROM LocalAccount WHERE username = ?";
-		CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE(bind_text(stmt, 1, username, -1, SQLITE_STATIC));
 
 		s = sqlite3_step(stmt);
@@ -2662,13 +3966,13 @@ void Svcmd_AccountInfo_f(void)
 		}
 		else if (s != SQLITE_DONE) {
 			G_ErrorPrint("ERROR: SQL Select Failed (Svcmd_AccountInfo_f)", s);
-			CALL_SQLITE(finalize(stmt));
-			CALL_SQLITE(close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 			return;
 		}
 
-		CALL_SQLITE(finalize(stmt));
-		CALL_SQLITE(close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 
 		Q_strncpyz(buf, va("Stats for %s:\n", username), sizeof(buf));
 		getDateTime(created, timeStr, sizeof(timeStr));
@@ -2744,9 +4048,9 @@ void Svcmd_FlagAccount_f( void ) {
 		int s;
 		int flags;
 
-		CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+		db = G_DBAcquire();
 		sql = "SELECT flags FROM LocalAccount WHERE username = ?";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_text (stmt, 1, username, -1, SQLITE_STATIC));
 	
 		s = sqlite3_step(stmt);
@@ -2755,11 +4059,11 @@ void Svcmd_FlagAccount_f( void ) {
 		}
 		else if (s != SQLITE_DONE){
 			G_ErrorPrint("ERROR: SQL Select Failed (Svcmd_FlagAccount_f 1)", s);
-			CALL_SQLITE(finalize(stmt));
-			CALL_SQLITE(close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 			return;
 		}
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 
 		if ( args == 2 ) {
 			int i = 0;
@@ -2771,7 +4075,7 @@ void Svcmd_FlagAccount_f( void ) {
 					trap->Print( "%2d [ ] %s\n", i, accountFlags[i].string );
 				}
 			}
-			CALL_SQLITE (close(db));
+			G_DBRelease(db);
 			return;
 		}
 		else if (args == 3) {
@@ -2786,7 +4090,7 @@ void Svcmd_FlagAccount_f( void ) {
 			//DM Start: New -1 toggle all options.
 			if (index < -1 || index >= MAX_ACCOUNT_FLAGS) {  //Whereas we need to allow -1 now, we must change the limit for this value.
 				trap->Print("flagAccount: Invalid range: %i [0-%i, or -1 for toggle all]\n", index, MAX_ACCOUNT_FLAGS - 1);
-				CALL_SQLITE (close(db));
+				G_DBRelease(db);
 				return;
 			}
 
@@ -2795,7 +4099,7 @@ void Svcmd_FlagAccount_f( void ) {
 			else 
 				sql = "UPDATE LocalAccount SET flags = flags | ? WHERE username = ?";
 
-			CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE (bind_int (stmt, 1, (1 << index)));
 			CALL_SQLITE (bind_text (stmt, 2, username, -1, SQLITE_STATIC));
 			s = sqlite3_step(stmt);
@@ -2807,8 +4111,8 @@ void Svcmd_FlagAccount_f( void ) {
 				G_ErrorPrint("ERROR: SQL Update Failed (Svcmd_FlagAccount_f 2)", s);
 			}
 
-			CALL_SQLITE (finalize(stmt));
-			CALL_SQLITE (close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 
 			for (i=0;  i<level.numPlayingClients; i++) {
 				cl = &level.clients[level.sortedClients[i]];
@@ -2842,7 +4146,7 @@ void Svcmd_FlagAccount_f( void ) {
 				bitmask = g_fullAdminLevel.integer;
 
 			sql = "UPDATE LocalAccount SET flags = ? WHERE username = ?";
-			CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE (bind_int (stmt, 1, bitmask));
 			CALL_SQLITE (bind_text (stmt, 2, username, -1, SQLITE_STATIC));
 			s = sqlite3_step(stmt);
@@ -2854,8 +4158,8 @@ void Svcmd_FlagAccount_f( void ) {
 				G_ErrorPrint("ERROR: SQL Update Failed (Svcmd_FlagAccount_f 2)", s);
 			}
 
-			CALL_SQLITE (finalize(stmt));
-			CALL_SQLITE (close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 
 			for (i=0;  i<level.numPlayingClients; i++) {
 				cl = &level.clients[level.sortedClients[i]];
@@ -2884,10 +4188,10 @@ void Svcmd_ListAdmins_f(void)
 		char adminString[16];
 		int row = 1;
 
-		CALL_SQLITE(open(LOCAL_DB_PATH, &db));
+		db = G_DBAcquire();
 
 		sql = "SELECT username, flags FROM localAccount WHERE flags & 4194304 ORDER BY flags DESC"; //ehh
-		CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 
 		Com_Printf("    ^5Username           Admin\n");
 
@@ -2907,8 +4211,8 @@ void Svcmd_ListAdmins_f(void)
 				break;
 			}
 		}
-		CALL_SQLITE(finalize(stmt));
-		CALL_SQLITE(close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 	}
 }
 
@@ -2919,48 +4223,48 @@ void Svcmd_DBInfo_f(void)
     sqlite3_stmt * stmt;
 	int s, numAccounts = 0, numRaces = 0, numDuels = 0;
 
-	CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+	db = G_DBAcquire();
 	sql = "SELECT COUNT(*) FROM LocalAccount";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
     s = sqlite3_step(stmt);
     if (s == SQLITE_ROW)
 		numAccounts = sqlite3_column_int(stmt, 0);
 	else if (s != SQLITE_DONE) {
 		G_ErrorPrint("ERROR: SQL Select Failed (Svcmd_DBInfo_f 1)", s);
-		CALL_SQLITE (finalize(stmt));
-		CALL_SQLITE (close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 		return;
 	}
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
-	CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+	db = G_DBAcquire();
 	sql = "SELECT COUNT(*) FROM LocalRun";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
     s = sqlite3_step(stmt);
     if (s == SQLITE_ROW)
 		numRaces = sqlite3_column_int(stmt, 0);
 	else if (s != SQLITE_DONE) {
 		G_ErrorPrint("ERROR: SQL Select Failed (Svcmd_DBInfo_f 2)", s);
-		CALL_SQLITE (finalize(stmt));
-		CALL_SQLITE (close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 		return;
 	}
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
 	sql = "SELECT COUNT(*) FROM LocalDuel";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
     s = sqlite3_step(stmt);
     if (s == SQLITE_ROW)
 		numDuels = sqlite3_column_int(stmt, 0);
 	else if (s != SQLITE_DONE) {
 		G_ErrorPrint("ERROR: SQL Select Failed (Svcmd_DBInfo_f 3)", s);
-		CALL_SQLITE (finalize(stmt));
-		CALL_SQLITE (close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 		return;
 	}
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
-	CALL_SQLITE (close(db));
+	G_DBRelease(db);
 
 	trap->Print( "There are %i accounts, %i race records, and %i duels in the database.\n", numAccounts, numRaces, numDuels);
 }
@@ -2984,10 +4288,10 @@ void Svcmd_ClanDelete_f(void) {
 	Q_strlwr(teamname);
 	Q_CleanStr(teamname);
 	
-	CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+	db = G_DBAcquire();
 
 	sql = "SELECT COUNT(*) FROM LocalTeam WHERE name = ?";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 	
 	s = sqlite3_step(stmt);
@@ -2995,21 +4299,21 @@ void Svcmd_ClanDelete_f(void) {
 		count = sqlite3_column_int(stmt, 0);
 		if (count == 0) {
 			trap->Print( "Clan does not exist!\n");
-			CALL_SQLITE (finalize(stmt));
-			CALL_SQLITE (close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 			return;
 		}
 	}
 	else if (s != SQLITE_DONE) {
 		G_ErrorPrint("ERROR: SQL Select Failed (Svcmd_ClanDelete_f 1)", s);
-		CALL_SQLITE (finalize(stmt));
-		CALL_SQLITE (close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 		return;
 	}
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
 	sql = "DELETE FROM LocalTeam WHERE name = ?";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 	s = sqlite3_step(stmt);
 
@@ -3019,9 +4323,9 @@ void Svcmd_ClanDelete_f(void) {
 	else
 		G_ErrorPrint("ERROR: SQL Delete Failed (Svcmd_ClanDelete_f 2)", s);
 
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
-	CALL_SQLITE (close(db));
+	G_DBRelease(db);
 }
 
 void Svcmd_ClanCreate_f(void) {
@@ -3043,10 +4347,10 @@ void Svcmd_ClanCreate_f(void) {
 	Q_strlwr(teamname);
 	Q_CleanStr(teamname);
 	
-	CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+	db = G_DBAcquire();
 
 	sql = "SELECT COUNT(*) FROM LocalTeam WHERE name = ?";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 	
 	s = sqlite3_step(stmt);
@@ -3054,21 +4358,21 @@ void Svcmd_ClanCreate_f(void) {
 		count = sqlite3_column_int(stmt, 0);
 		if (count > 0) {
 			trap->Print( "Clan already exists!\n");
-			CALL_SQLITE (finalize(stmt));
-			CALL_SQLITE (close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 			return;
 		}
 	}
 	else if (s != SQLITE_DONE) {
 		G_ErrorPrint("ERROR: SQL Select Failed (Svcmd_ClanCreate_f 1)", s);
-		CALL_SQLITE (finalize(stmt));
-		CALL_SQLITE (close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 		return;
 	}
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
 	sql = "INSERT INTO LocalTeam (name, flags) VALUES (?, 1)";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 	s = sqlite3_step(stmt);
 
@@ -3078,9 +4382,9 @@ void Svcmd_ClanCreate_f(void) {
 	else
 		G_ErrorPrint("ERROR: SQL Insert Failed (Svcmd_ClanCreate_f 2)", s);
 
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
-	CALL_SQLITE (close(db));
+	G_DBRelease(db);
 }
 
 void Svcmd_ClanKick_f(void) {
@@ -3106,7 +4410,7 @@ void Svcmd_ClanKick_f(void) {
 	Q_strlwr(teamname);
 	Q_CleanStr(teamname);
 	
-	CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+	db = G_DBAcquire();
 
 	if (!CheckUserExists(username)) {
 		trap->Print( "This user does not exist!\n");
@@ -3114,7 +4418,7 @@ void Svcmd_ClanKick_f(void) {
 	}
 
 	sql = "SELECT COUNT(*) FROM LocalTeam WHERE name = ?";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 	
 	s = sqlite3_step(stmt);
@@ -3122,21 +4426,21 @@ void Svcmd_ClanKick_f(void) {
 		count = sqlite3_column_int(stmt, 0);
 		if (count == 0) {
 			trap->Print( "Clan does not exist!\n");
-			CALL_SQLITE (finalize(stmt));
-			CALL_SQLITE (close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 			return;
 		}
 	}
 	else if (s != SQLITE_DONE) {
 		G_ErrorPrint("ERROR: SQL Select Failed (Svcmd_ClanKick_f 1)", s);
-		CALL_SQLITE (finalize(stmt));
-		CALL_SQLITE (close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 		return;
 	}
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
 	sql = "SELECT COUNT(*) FROM LocalTeamAccount WHERE team = ? AND account = ?";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 	CALL_SQLITE (bind_text (stmt, 2, username, -1, SQLITE_STATIC));
 	
@@ -3145,22 +4449,22 @@ void Svcmd_ClanKick_f(void) {
 		count = sqlite3_column_int(stmt, 0);
 		if (count == 0) {
 			trap->Print( "User is not in this clan!\n");
-			CALL_SQLITE (finalize(stmt));
-			CALL_SQLITE (close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 			return;
 		}
 	}
 	else if (s != SQLITE_DONE) {
 		G_ErrorPrint("ERROR: SQL Select Failed (Svcmd_ClanKick_f 2)", s);
-		CALL_SQLITE (finalize(stmt));
-		CALL_SQLITE (close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 		return;
 	}
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 	
 
 	sql = "DELETE FROM LocalTeamAccount WHERE team = ? AND account = ?";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 	CALL_SQLITE (bind_text (stmt, 2, username, -1, SQLITE_STATIC));
 	s = sqlite3_step(stmt);
@@ -3171,9 +4475,9 @@ void Svcmd_ClanKick_f(void) {
 	else
 		G_ErrorPrint("ERROR: SQL Delete Failed (Svcmd_ClanKick_f 3)", s);
 
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
-	CALL_SQLITE (close(db));
+	G_DBRelease(db);
 }
 
 void Svcmd_ClanJoin_f(void) {
@@ -3199,7 +4503,7 @@ void Svcmd_ClanJoin_f(void) {
 	Q_strlwr(teamname);
 	Q_CleanStr(teamname);
 	
-	CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+	db = G_DBAcquire();
 
 	if (!CheckUserExists(username)) {
 		trap->Print( "This user does not exist!\n");
@@ -3207,7 +4511,7 @@ void Svcmd_ClanJoin_f(void) {
 	}
 
 	sql = "SELECT COUNT(*) FROM LocalTeam WHERE name = ?";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 	
 	s = sqlite3_step(stmt);
@@ -3215,21 +4519,21 @@ void Svcmd_ClanJoin_f(void) {
 		count = sqlite3_column_int(stmt, 0);
 		if (count == 0) {
 			trap->Print( "Clan does not exist.\n");
-			CALL_SQLITE (finalize(stmt));
-			CALL_SQLITE (close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 			return;
 		}
 	}
 	else if (s != SQLITE_DONE) {
 		G_ErrorPrint("ERROR: SQL Select Failed (Svcmd_ClanJoin_f 1)", s);
-		CALL_SQLITE (finalize(stmt));
-		CALL_SQLITE (close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 		return;
 	}
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
 	sql = "SELECT COUNT(*) FROM LocalTeamAccount WHERE team = ? AND account = ?";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 	CALL_SQLITE (bind_text (stmt, 2, username, -1, SQLITE_STATIC));
 	
@@ -3238,22 +4542,22 @@ void Svcmd_ClanJoin_f(void) {
 		count = sqlite3_column_int(stmt, 0);
 		if (count > 0) {
 			trap->Print( "User is already in this clan!\n");
-			CALL_SQLITE (finalize(stmt));
-			CALL_SQLITE (close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 			return;
 		}
 	}
 	else if (s != SQLITE_DONE) {
 		G_ErrorPrint("ERROR: SQL Select Failed (Svcmd_ClanJoin_f 2)", s);
-		CALL_SQLITE (finalize(stmt));
-		CALL_SQLITE (close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 		return;
 	}
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 	
 
 	sql = "INSERT INTO LocalTeamAccount (team, account, flags) VALUES (?, ?, 0)";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 	CALL_SQLITE (bind_text (stmt, 2, username, -1, SQLITE_STATIC));
 	s = sqlite3_step(stmt);
@@ -3264,9 +4568,9 @@ void Svcmd_ClanJoin_f(void) {
 	else
 		G_ErrorPrint("ERROR: SQL Insert Failed (Svcmd_ClanJoin_f 3)", s);
 
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
-	CALL_SQLITE (close(db));
+	G_DBRelease(db);
 }
 
 void Cmd_ACRegister_f( gentity_t *ent ) { //Temporary, until global shit is done
@@ -3327,11 +4631,11 @@ void Cmd_ACRegister_f( gentity_t *ent ) { //Temporary, until global shit is done
 		*p = 0;
 	ip = ip_to_int(strIP);
 
-	CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+	db = G_DBAcquire();
 
 	if (ip) {
 		sql = "SELECT COUNT(*) FROM LocalAccount WHERE lastip = ?";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_int64 (stmt, 1, ip));
 
 		s = sqlite3_step(stmt);
@@ -3341,22 +4645,22 @@ void Cmd_ACRegister_f( gentity_t *ent ) { //Temporary, until global shit is done
 			count = sqlite3_column_int(stmt, 0);
 			if (count > 0) {
 				trap->SendServerCommand(ent-g_entities, "print \"Your IP address already belongs to an account. You are only allowed one account.\n\"");
-				CALL_SQLITE (finalize(stmt));
-				CALL_SQLITE (close(db));
+				G_DBFinalize(stmt);
+				G_DBRelease(db);
 				return;
 			}
 		}
 		else if (s != SQLITE_DONE) {
 			G_ErrorPrint("ERROR: SQL Select Failed (Cmd_ACRegister_f 1)", s);
-			CALL_SQLITE (finalize(stmt));
-			CALL_SQLITE (close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 			return;
 		}
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 	}
 
     sql = "INSERT INTO LocalAccount (username, password, kills, deaths, suicides, captures, returns, racetime, created, lastlogin, lastip, flags, unlocks) VALUES (?, ?, 0, 0, 0, 0, 0, 0, ?, ?, ?, 0, 0)";
-    CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+    G_DBPrepare(db, sql, &stmt);
     CALL_SQLITE (bind_text (stmt, 1, username, -1, SQLITE_STATIC));
 	CALL_SQLITE (bind_text (stmt, 2, password, -1, SQLITE_STATIC));
 	CALL_SQLITE (bind_int (stmt, 3, rawtime));
@@ -3368,12 +4672,14 @@ void Cmd_ACRegister_f( gentity_t *ent ) { //Temporary, until global shit is done
 		trap->SendServerCommand(ent-g_entities, "print \"Account created.\n\"");
 		Q_strncpyz(ent->client->pers.userName, username, sizeof(ent->client->pers.userName));
 	}
+	else if (s == G_DB_DEFERRED) //not logged in until the account really exists
+		trap->SendServerCommand(ent-g_entities, "print \"Database busy, your account will be created shortly. Login once it is.\n\"");
 	else
 		G_ErrorPrint("ERROR: SQL Insert Failed (Cmd_ACRegister_f 2)", s);
 
 
-	CALL_SQLITE (finalize(stmt));
-	CALL_SQLITE (close(db));
+	G_DBFinalize(stmt);
+	G_DBRelease(db);
 
 	//DebugWriteToDB("Cmd_ACRegister_f");
 }
@@ -3437,10 +4743,10 @@ void Cmd_JoinTeam_f( gentity_t *ent ) {
 		qboolean inviteOnly = qfalse;
 		int count;
 
-		CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+		db = G_DBAcquire();
 
 		sql = "SELECT flags FROM LocalTeam WHERE name = ?";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 	
 		s = sqlite3_step(stmt);
@@ -3452,18 +4758,18 @@ void Cmd_JoinTeam_f( gentity_t *ent ) {
 		}
 		else if (s == SQLITE_DONE) {
 			trap->SendServerCommand(ent-g_entities, "print \"Clan does not exist!\n\""); //You already own a team
-			CALL_SQLITE (finalize(stmt));
-			CALL_SQLITE (close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 			return;
 		}
 		else {
 			G_ErrorPrint("ERROR: SQL Select Failed (Cmd_JoinTeam_f 1)", s);
 		}
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 
 		if (inviteOnly) {
 			sql = "SELECT flags FROM LocalTeamAccount WHERE team = ? AND account = ?";
-			CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 			CALL_SQLITE (bind_text (stmt, 2, username, -1, SQLITE_STATIC));
 	
@@ -3472,8 +4778,8 @@ void Cmd_JoinTeam_f( gentity_t *ent ) {
 				int flags = sqlite3_column_int(stmt, 0);
 				if (!(flags & JAPRO_ACCOUNTTEAMFLAG_PENDING)) {
 					trap->SendServerCommand(ent-g_entities, "print \"You are already in this clan!\n\"");//Already in this clan?
-					CALL_SQLITE (finalize(stmt));
-					CALL_SQLITE (close(db));
+					G_DBFinalize(stmt);
+					G_DBRelease(db);
 					return;
 				}
 				else {
@@ -3482,18 +4788,18 @@ void Cmd_JoinTeam_f( gentity_t *ent ) {
 			}
 			else if (s == SQLITE_DONE) {
 				trap->SendServerCommand(ent-g_entities, "print \"This clan is invite-only!\n\"");//Not yet invited
-				CALL_SQLITE (finalize(stmt));
-				CALL_SQLITE (close(db));
+				G_DBFinalize(stmt);
+				G_DBRelease(db);
 				return;
 			}
 			else {
 				G_ErrorPrint("ERROR: SQL Select Failed (Cmd_JoinTeam_f 1)", s);
 			}
-			CALL_SQLITE (finalize(stmt));
+			G_DBFinalize(stmt);
 		}
 		else {
 			sql = "SELECT COUNT(*) FROM LocalTeamAccount WHERE team = ? AND account = ?";
-			CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 			CALL_SQLITE (bind_text (stmt, 2, username, -1, SQLITE_STATIC));
 	
@@ -3502,25 +4808,25 @@ void Cmd_JoinTeam_f( gentity_t *ent ) {
 				count = sqlite3_column_int(stmt, 0);
 				if (count > 0) {
 					trap->SendServerCommand(ent-g_entities, "print \"You are already in this clan!\n\""); //You already own a team - optional?
-					CALL_SQLITE (finalize(stmt));
-					CALL_SQLITE (close(db));
+					G_DBFinalize(stmt);
+					G_DBRelease(db);
 					return;
 				}
 			}
 			else if (s != SQLITE_DONE) {
 				G_ErrorPrint("ERROR: SQL Select Failed (Cmd_JoinTeam_f 2)", s);
-				CALL_SQLITE (finalize(stmt));
-				CALL_SQLITE (close(db));
+				G_DBFinalize(stmt);
+				G_DBRelease(db);
 				return;
 			}
-			CALL_SQLITE (finalize(stmt));
+			G_DBFinalize(stmt);
 		}
 
 		if (count > 0)
 			sql = "UPDATE LocalTeamAccount SET flags = 0 WHERE team = ? AND account = ?";
 		else 
 			sql = "INSERT INTO LocalTeamAccount (team, account, flags) VALUES (?, ?, 0)"; //Replace
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_text (stmt, 2, username, -1, SQLITE_STATIC));
 		s = sqlite3_step(stmt);
@@ -3531,9 +4837,9 @@ void Cmd_JoinTeam_f( gentity_t *ent ) {
 		else
 			G_ErrorPrint("ERROR: SQL Insert Failed (Cmd_JoinTeam_f 3)", s);
 
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 
-		CALL_SQLITE (close(db));
+		G_DBRelease(db);
 	}
 
 }
@@ -3565,10 +4871,10 @@ void Cmd_LeaveTeam_f( gentity_t *ent ) {
 		int s;//, row = 0;
 		int count;
 
-		CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+		db = G_DBAcquire();
 
 		sql = "SELECT flags FROM LocalTeam WHERE name = ?";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 	
 		s = sqlite3_step(stmt);
@@ -3576,17 +4882,17 @@ void Cmd_LeaveTeam_f( gentity_t *ent ) {
 		}
 		else if (s == SQLITE_DONE) {
 			trap->SendServerCommand(ent-g_entities, "print \"Clan does not exist!\n\""); //You already own a team
-			CALL_SQLITE (finalize(stmt));
-			CALL_SQLITE (close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 			return;
 		}
 		else {
 			G_ErrorPrint("ERROR: SQL Select Failed (Cmd_JoinTeam_f 1)", s);
 		}
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 
 		sql = "SELECT COUNT(*) FROM LocalTeamAccount WHERE team = ? AND account = ?";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_text (stmt, 2, username, -1, SQLITE_STATIC));
 	
@@ -3595,21 +4901,21 @@ void Cmd_LeaveTeam_f( gentity_t *ent ) {
 			count = sqlite3_column_int(stmt, 0);
 			if (count == 0) {
 				trap->SendServerCommand(ent-g_entities, "print \"You are not in this clan!\n\""); //You already own a team - optional?
-				CALL_SQLITE (finalize(stmt));
-				CALL_SQLITE (close(db));
+				G_DBFinalize(stmt);
+				G_DBRelease(db);
 				return;
 			}
 		}
 		else if (s != SQLITE_DONE) {
 			G_ErrorPrint("ERROR: SQL Select Failed (Cmd_JoinTeam_f 2)", s);
-			CALL_SQLITE (finalize(stmt));
-			CALL_SQLITE (close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 			return;
 		}
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 
 		sql = "DELETE FROM LocalTeamAccount WHERE team = ? AND account = ?";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_text (stmt, 2, username, -1, SQLITE_STATIC));
 		s = sqlite3_step(stmt);
@@ -3620,9 +4926,9 @@ void Cmd_LeaveTeam_f( gentity_t *ent ) {
 		else
 			G_ErrorPrint("ERROR: SQL Delete Failed (Cmd_JoinTeam_f 3)", s);
 
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 
-		CALL_SQLITE (close(db));
+		G_DBRelease(db);
 	}
 
 }
@@ -3658,10 +4964,10 @@ void Cmd_CreateTeam_f( gentity_t *ent ) {
 		sqlite3_stmt * stmt;
 		int s;//, row = 0;
 
-		CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+		db = G_DBAcquire();
 
 		sql = "SELECT COUNT(*) FROM LocalTeam WHERE name = ?";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 		s = sqlite3_step(stmt);
 
@@ -3669,21 +4975,21 @@ void Cmd_CreateTeam_f( gentity_t *ent ) {
 			int count = sqlite3_column_int(stmt, 0);
 			if (count > 0) {
 				trap->SendServerCommand(ent-g_entities, "print \"This clan already exists.\n\"");
-				CALL_SQLITE (finalize(stmt));
-				CALL_SQLITE (close(db));
+				G_DBFinalize(stmt);
+				G_DBRelease(db);
 				return;
 			}
 		}
 		else if (s != SQLITE_DONE) {
 			G_ErrorPrint("ERROR: SQL Select Failed (Cmd_CreateTeam_f 1)", s);
-			CALL_SQLITE (finalize(stmt));
-			CALL_SQLITE (close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 			return;
 		}
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 
 		sql = "SELECT COUNT(*) FROM LocalTeamAccount WHERE account = ?"; //AND FLAGS = OWNER, fixme
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_text (stmt, 1, username, -1, SQLITE_STATIC));
 		s = sqlite3_step(stmt);
 
@@ -3692,21 +4998,21 @@ void Cmd_CreateTeam_f( gentity_t *ent ) {
 			count = sqlite3_column_int(stmt, 0);
 			if (count > 0) {
 				trap->SendServerCommand(ent-g_entities, "print \"You are already in a clan.\n\""); //You already own a team
-				CALL_SQLITE (finalize(stmt));
-				CALL_SQLITE (close(db));
+				G_DBFinalize(stmt);
+				G_DBRelease(db);
 				return;
 			}
 		}
 		else if (s != SQLITE_DONE) {
 			G_ErrorPrint("ERROR: SQL Select Failed (Cmd_CreateTeam_f 2)", s);
-			CALL_SQLITE (finalize(stmt));
-			CALL_SQLITE (close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 			return;
 		}
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 
 		sql = "INSERT INTO LocalTeam (name, flags) VALUES (?, 0)";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 		s = sqlite3_step(stmt);
 
@@ -3715,10 +5021,10 @@ void Cmd_CreateTeam_f( gentity_t *ent ) {
 		else
 			G_ErrorPrint("ERROR: SQL Insert Failed (Cmd_CreateTeam_f 4)", s);
 
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 
 		sql = "INSERT INTO LocalTeamAccount (team, account, flags) VALUES (?, ?, ?)";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_text (stmt, 2, username, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_int (stmt, 3, JAPRO_ACCOUNTTEAMFLAG_OWNER)); //1, JAPRO_ACCOUNTTEAMFLAG_OWNER
@@ -3731,9 +5037,9 @@ void Cmd_CreateTeam_f( gentity_t *ent ) {
 		else
 			G_ErrorPrint("ERROR: SQL Insert Failed (Cmd_CreateTeam_f 6)", s);
 
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 
-		CALL_SQLITE (close(db));
+		G_DBRelease(db);
 	}
 }
 
@@ -3772,10 +5078,10 @@ void Cmd_InfoTeam_f( gentity_t *ent ) {
 		int s, row = 1;
 		char msg[1024-128] = {0}, playername[16] = {0};
 
-		CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+		db = G_DBAcquire();
 
 		sql = "SELECT username, ROUND(SUM((entries/CAST(rank AS FLOAT) + entries-rank))/2,0) AS score FROM LocalRun WHERE rank != 0 AND username IN (SELECT account FROM LocalTeamAccount WHERE team = ? AND (flags & 2 != 2)) GROUP BY username ORDER BY score DESC LIMIT ?, 10";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_int (stmt, 2, start));
 
@@ -3806,8 +5112,8 @@ void Cmd_InfoTeam_f( gentity_t *ent ) {
 			}
 		}
 
-		CALL_SQLITE (finalize(stmt));
-		CALL_SQLITE (close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 	}
 }
 
@@ -3852,36 +5158,36 @@ void Cmd_AddMaster_f(gentity_t *ent) {
 		sqlite3_stmt * stmt;
 		int s;
 
-		CALL_SQLITE(open(LOCAL_DB_PATH, &db));
+		db = G_DBAcquire();
 
 		if (!Q_stricmp(mastername, "none")) {
 			sql = "UPDATE LocalAccount SET master = NULL WHERE username = ?";
-			CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE(bind_text(stmt, 1, username, -1, SQLITE_STATIC));
 		}
 		else {
 #if 0
 			//Make sure we are not their master
 			sql = "SELECT id FROM LocalAccount WHERE master = ? AND username = ?";
-			CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE(bind_text(stmt, 1, username, -1, SQLITE_STATIC));
 			CALL_SQLITE(bind_text(stmt, 2, mastername, -1, SQLITE_STATIC));
 
 			s = sqlite3_step(stmt);
 			if (s == SQLITE_ROW) {
 				trap->SendServerCommand(ent - g_entities, "print \"You can not be your own master.\n\"");
-				CALL_SQLITE(finalize(stmt));
-				CALL_SQLITE(close(db));
+				G_DBFinalize(stmt);
+				G_DBRelease(db);
 				return;
 			}
 			else if (s != SQLITE_DONE) {
 				G_ErrorPrint("ERROR: SQL Update Failed (Cmd_AddMaster_f 1)", s);
 			}
-			CALL_SQLITE(finalize(stmt));
+			G_DBFinalize(stmt);
 #endif
 
 			sql = "UPDATE LocalAccount SET master = ? WHERE username = ?";
-			CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE(bind_text(stmt, 1, mastername, -1, SQLITE_STATIC));
 			CALL_SQLITE(bind_text(stmt, 2, username, -1, SQLITE_STATIC));
 		}
@@ -3893,9 +5199,9 @@ void Cmd_AddMaster_f(gentity_t *ent) {
 		else {
 			trap->SendServerCommand(ent - g_entities, "print \"Master added.\n\"");
 		}
-		CALL_SQLITE(finalize(stmt));
+		G_DBFinalize(stmt);
 
-		CALL_SQLITE(close(db));
+		G_DBRelease(db);
 	}
 
 }
@@ -3929,13 +5235,13 @@ void Cmd_ListMasters_f(gentity_t *ent) {
 		char msg[1024 - 128] = { 0 }, mastername[16] = { 0 };
 		qboolean printed = qfalse;
 
-		CALL_SQLITE(open(LOCAL_DB_PATH, &db));
+		db = G_DBAcquire();
 
 		sql = "SELECT T1.master, T1.username FROM "
 			"(SELECT master, username FROM LocalAccount WHERE master IS NOT NULL) AS T1 "
 			"INNER JOIN(SELECT master, COUNT(*) AS count FROM LocalAccount WHERE master IS NOT NULL GROUP BY master) AS T2 "
 			"ON T1.master = T2.master ORDER BY T2.count DESC LIMIT ?, 10"; //Order by score - OH BOY! Or by member count?
-		CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE(bind_int(stmt, 1, start));
 
 		trap->SendServerCommand(ent - g_entities, "print \"Masterlist:\n    ^5Name               Padawans\"");
@@ -3977,8 +5283,8 @@ void Cmd_ListMasters_f(gentity_t *ent) {
 			trap->SendServerCommand(ent - g_entities, va("print \"%s\n\"", msg));
 		}
 
-		CALL_SQLITE(finalize(stmt));
-		CALL_SQLITE(close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 	}
 }
 
@@ -4011,14 +5317,14 @@ void Cmd_ListTeam_f( gentity_t *ent ) { //Should i bother to cache player stats
 		int s, row = 1;
 		char msg[1024-128] = {0}, teamname[16] = {0};
 
-		CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+		db = G_DBAcquire();
 
 		sql = "SELECT T.name AS name, TA.count AS count, T.flags AS flags FROM "
 				"(SELECT name, flags From LocalTeam) AS T "
 				"INNER JOIN "
 				"(SELECT team, COUNT(*) AS count From LocalTeamAccount WHERE (flags & 2 != 2) GROUP BY team) AS TA "
 				"ON T.name = TA.team ORDER BY count DESC LIMIT ?, 10"; //Order by score - OH BOY! Or by member count?
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_int (stmt, 1, start));
 
 		trap->SendServerCommand(ent-g_entities, "print \"Clanlist:\n    ^5Name               Members\n\"");
@@ -4048,8 +5354,8 @@ void Cmd_ListTeam_f( gentity_t *ent ) { //Should i bother to cache player stats
 			}
 		}
 
-		CALL_SQLITE (finalize(stmt));
-		CALL_SQLITE (close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 	}
 }
 
@@ -4096,10 +5402,10 @@ void Cmd_InviteTeam_f( gentity_t *ent ) {
 		int s;//, row = 0;
 		//qboolean inviteOnly = qfalse;
 
-		CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+		db = G_DBAcquire();
 
 		sql = "SELECT flags FROM LocalTeam WHERE name = ?";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 	
 		s = sqlite3_step(stmt);
@@ -4107,24 +5413,24 @@ void Cmd_InviteTeam_f( gentity_t *ent ) {
 			int flags = sqlite3_column_int(stmt, 0);
 			if (!(flags & JAPRO_TEAMFLAG_PRIVATE)) {
 				trap->SendServerCommand(ent-g_entities, "print \"This clan is public!\n\""); //You already own a team
-				CALL_SQLITE (finalize(stmt));
-				CALL_SQLITE (close(db));
+				G_DBFinalize(stmt);
+				G_DBRelease(db);
 				return;
 			}
 		}
 		else if (s == SQLITE_DONE) {
 			trap->SendServerCommand(ent-g_entities, "print \"This clan does not exist!\n\""); //You already own a team
-			CALL_SQLITE (finalize(stmt));
-			CALL_SQLITE (close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 			return;
 		}
 		else {
 			G_ErrorPrint("ERROR: SQL Select Failed (Cmd_JoinTeam_f 1)", s);
 		}
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 
 		sql = "SELECT flags FROM LocalTeamAccount WHERE team = ? AND account = ?";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_text (stmt, 2, username, -1, SQLITE_STATIC));
 
@@ -4133,25 +5439,25 @@ void Cmd_InviteTeam_f( gentity_t *ent ) {
 			int flags = sqlite3_column_int(stmt, 0);
 			if (!(flags & JAPRO_ACCOUNTTEAMFLAG_OWNER)) {
 				trap->SendServerCommand(ent-g_entities, "print \"You are not the clan leader!\n\"");//no permission
-				CALL_SQLITE (finalize(stmt));
-				CALL_SQLITE (close(db));
+				G_DBFinalize(stmt);
+				G_DBRelease(db);
 				return;
 			}
 		}
 		else if (s == SQLITE_DONE) {
 			trap->SendServerCommand(ent-g_entities, "print \"You are not the clan leader!\n\"");//not even in the clan - lmao
-			CALL_SQLITE (finalize(stmt));
-			CALL_SQLITE (close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 			return;
 		}
 		else {
 			G_ErrorPrint("ERROR: SQL Select Failed (Cmd_InviteTeam_f 2)", s);
 		}
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 
 
 		sql = "SELECT COUNT(*) FROM LocalTeamAccount WHERE team = ? AND account = ?";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_text (stmt, 2, invitee, -1, SQLITE_STATIC));
 
@@ -4160,21 +5466,21 @@ void Cmd_InviteTeam_f( gentity_t *ent ) {
 			int count = sqlite3_column_int(stmt, 0);
 			if (count > 0) {
 				trap->SendServerCommand(ent-g_entities, "print \"Recepient is already in the clan!\n\"");
-				CALL_SQLITE (finalize(stmt));
-				CALL_SQLITE (close(db));
+				G_DBFinalize(stmt);
+				G_DBRelease(db);
 				return;
 			}
 		}
 		else if (s != SQLITE_DONE) {
 			G_ErrorPrint("ERROR: SQL Select Failed (Cmd_InviteTeam_f 3)", s);
-			CALL_SQLITE (finalize(stmt));
-			CALL_SQLITE (close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 			return;
 		}
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 
 		sql = "INSERT INTO LocalTeamAccount (team, account, flags) VALUES (?, ?, ?)";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_text (stmt, 2, invitee, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_int (stmt, 3, JAPRO_ACCOUNTTEAMFLAG_PENDING));
@@ -4186,9 +5492,9 @@ void Cmd_InviteTeam_f( gentity_t *ent ) {
 		else
 			G_ErrorPrint("ERROR: SQL Insert Failed (Cmd_InviteTeam_f 4)", s);
 
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 
-		CALL_SQLITE (close(db));
+		G_DBRelease(db);
 	}
 
 }
@@ -4229,10 +5535,10 @@ void Cmd_AdminTeam_f( gentity_t *ent ) {
 		sqlite3_stmt * stmt;
 		int s;
 
-		CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+		db = G_DBAcquire();
 
 		sql = "SELECT flags FROM LocalTeamAccount WHERE team = ? AND account = ?";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_text (stmt, 2, username, -1, SQLITE_STATIC));
 
@@ -4241,31 +5547,31 @@ void Cmd_AdminTeam_f( gentity_t *ent ) {
 			int flags = sqlite3_column_int(stmt, 0);
 			if (!(flags & JAPRO_ACCOUNTTEAMFLAG_OWNER)) {
 				trap->SendServerCommand(ent-g_entities, "print \"You are not the clan leader!\n\"");//no permission
-				CALL_SQLITE (finalize(stmt));
-				CALL_SQLITE (close(db));
+				G_DBFinalize(stmt);
+				G_DBRelease(db);
 				return;
 			}
 		}
 		else if (s == SQLITE_DONE) {
 			trap->SendServerCommand(ent-g_entities, "print \"You are not the clan leader!\n\"");//not even in the clan - lmao
-			CALL_SQLITE (finalize(stmt));
-			CALL_SQLITE (close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 			return;
 		}
 		else {
 			G_ErrorPrint("ERROR: SQL Select Failed (Cmd_AdminTeam_f 1)", s);
-			CALL_SQLITE (finalize(stmt));
-			CALL_SQLITE (close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 			return;
 		}
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 
 		if (!Q_stricmp(command, "kick")) {
 			char player[16];
 
 			if (args < 4) {
 				trap->SendServerCommand(ent-g_entities, "print \"Usage: /clanAdmin <clan> <kick/private/public/longname/tag> <text (optional)>\n\"");
-				CALL_SQLITE (close(db));
+				G_DBRelease(db);
 				return;
 			}
 
@@ -4275,7 +5581,7 @@ void Cmd_AdminTeam_f( gentity_t *ent ) {
 			Q_strstrip(player, "\n\r", NULL);
 
 			sql = "DELETE FROM LocalTeamAccount WHERE team = ? AND account = ?";
-			CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 			CALL_SQLITE (bind_text (stmt, 2, player, -1, SQLITE_STATIC));
 			s = sqlite3_step(stmt);
@@ -4283,12 +5589,12 @@ void Cmd_AdminTeam_f( gentity_t *ent ) {
 				trap->SendServerCommand(ent-g_entities, "print \"Player removed.\n\"");//eh, maybe check if they were even in the team b4 printing this
 			else 
 				G_ErrorPrint("ERROR: SQL Delete Failed (Cmd_AdminTeam_f 2)", s);
-			CALL_SQLITE (finalize(stmt));
+			G_DBFinalize(stmt);
 
 		}
 		else if (!Q_stricmp(command, "private")) {
 			sql = "UPDATE LocalTeam SET flags = ? WHERE name = ?";
-			CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE (bind_int (stmt, 1, JAPRO_TEAMFLAG_PRIVATE));
 			CALL_SQLITE (bind_text (stmt, 2, teamname, -1, SQLITE_STATIC));
 			s = sqlite3_step(stmt);
@@ -4296,25 +5602,25 @@ void Cmd_AdminTeam_f( gentity_t *ent ) {
 				trap->SendServerCommand(ent-g_entities, "print \"Clan made private.\n\"");//eh, maybe check if they were even in the team b4 printing this
 			else 
 				G_ErrorPrint("ERROR: SQL Delete Failed (Cmd_AdminTeam_f 3)", s);
-			CALL_SQLITE (finalize(stmt));
+			G_DBFinalize(stmt);
 		}
 		else if (!Q_stricmp(command, "public")) {
 			sql = "UPDATE LocalTeam SET flags = 0 WHERE name = ?";
-			CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE (bind_text (stmt, 1, teamname, -1, SQLITE_STATIC));
 			s = sqlite3_step(stmt);
 			if (s == SQLITE_DONE)
 				trap->SendServerCommand(ent-g_entities, "print \"Clan made public.\n\"");//eh, maybe check if they were even in the team b4 printing this
 			else 
 				G_ErrorPrint("ERROR: SQL Delete Failed (Cmd_AdminTeam_f 4)", s);
-			CALL_SQLITE (finalize(stmt));
+			G_DBFinalize(stmt);
 		}
 		else if (!Q_stricmp(command, "longname")) {
 			char longname[24];
 
 			if (args < 4) {
 				trap->SendServerCommand(ent-g_entities, "print \"Usage: /clanAdmin <clan> <kick/private/public/longname/tag> <text (optional)>\n\"");
-				CALL_SQLITE (close(db));
+				G_DBRelease(db);
 				return;
 			}
 
@@ -4325,7 +5631,7 @@ void Cmd_AdminTeam_f( gentity_t *ent ) {
 			Q_strstrip(longname, "\n\r", NULL);
 
 			sql = "UPDATE LocalTeam SET longname = ? WHERE name = ?";
-			CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE (bind_text (stmt, 1, longname, -1, SQLITE_STATIC));
 			CALL_SQLITE (bind_text (stmt, 2, teamname, -1, SQLITE_STATIC));
 			s = sqlite3_step(stmt);
@@ -4333,14 +5639,14 @@ void Cmd_AdminTeam_f( gentity_t *ent ) {
 				trap->SendServerCommand(ent-g_entities, "print \"Longname set.\n\"");//eh, maybe check if they were even in the team b4 printing this
 			else 
 				G_ErrorPrint("ERROR: SQL Delete Failed (Cmd_AdminTeam_f 5)", s);
-			CALL_SQLITE (finalize(stmt));
+			G_DBFinalize(stmt);
 		}
 		else if (!Q_stricmp(command, "tag")) {
 			char tags[16];
 
 			if (args < 4) {
 				trap->SendServerCommand(ent-g_entities, "print \"Usage: /clanAdmin <clan> <kick/private/public/longname/tag> <text (optional)>\n\"");
-				CALL_SQLITE (close(db));
+				G_DBRelease(db);
 				return;
 			}
 
@@ -4350,7 +5656,7 @@ void Cmd_AdminTeam_f( gentity_t *ent ) {
 			Q_strstrip(tags, "\n\r", NULL);
 
 			sql = "UPDATE LocalTeam SET tag = ? WHERE name = ?";
-			CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE (bind_text (stmt, 1, tags, -1, SQLITE_STATIC));
 			CALL_SQLITE (bind_text (stmt, 2, teamname, -1, SQLITE_STATIC));
 			s = sqlite3_step(stmt);
@@ -4358,13 +5664,13 @@ void Cmd_AdminTeam_f( gentity_t *ent ) {
 				trap->SendServerCommand(ent-g_entities, "print \"Tag set.\n\"");//eh, maybe check if they were even in the team b4 printing this
 			else 
 				G_ErrorPrint("ERROR: SQL Delete Failed (Cmd_AdminTeam_f 6)", s);
-			CALL_SQLITE (finalize(stmt));
+			G_DBFinalize(stmt);
 		}
 		else {
 			trap->SendServerCommand(ent-g_entities, "print \"Usage: /clanAdmin <clan> <kick/private/public/longname/tag> <text (optional)>\n\"");
 		}
 
-		CALL_SQLITE (close(db));
+		G_DBRelease(db);
 
 	}
 }
@@ -4435,11 +5741,11 @@ void Cmd_AccountStats_f(gentity_t *ent) { //Should i bother to cache player stat
 		int s, created = 0;
 		qboolean printInfo = qfalse;
 
-		CALL_SQLITE(open(LOCAL_DB_PATH, &db));
+		db = G_DBAcquire();
 
 		sql = "SELECT created, master FROM LocalAccount WHERE username = ? "
 			"UNION ALL SELECT username, NULL  from LocalAccount WHERE master = ? LIMIT 32";
-		CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE(bind_text(stmt, 1, username, -1, SQLITE_STATIC));
 		CALL_SQLITE(bind_text(stmt, 2, username, -1, SQLITE_STATIC));
 
@@ -4451,14 +5757,14 @@ void Cmd_AccountStats_f(gentity_t *ent) { //Should i bother to cache player stat
 		}
 		else if (s == SQLITE_DONE) {
 			trap->SendServerCommand(ent - g_entities, "print \"Account not found!\n\"");
-			CALL_SQLITE(finalize(stmt));
-			CALL_SQLITE(close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 			return;
 		}
 		else if (s == SQLITE_ERROR) {
 			G_ErrorPrint("ERROR: SQL Select Failed (Cmd_Stats_f 1)", s);
-			CALL_SQLITE(finalize(stmt));
-			CALL_SQLITE(close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 			return;
 		}
 
@@ -4474,7 +5780,7 @@ void Cmd_AccountStats_f(gentity_t *ent) { //Should i bother to cache player stat
 				break;
 			}
 		}
-		CALL_SQLITE(finalize(stmt));
+		G_DBFinalize(stmt);
 
 		{
 			char msg[1024-128] = { 0 };
@@ -4512,7 +5818,7 @@ void Cmd_AccountStats_f(gentity_t *ent) { //Should i bother to cache player stat
 			//Race stats
 			sql = "SELECT SUM(entries-rank) AS newscore, CAST(SUM(entries/CAST(rank AS FLOAT)) AS INT) AS oldscore, AVG(rank) as rank, AVG((entries - CAST(rank-1 AS float))/entries) AS percentile, SUM(CASE WHEN rank == 1 THEN 1 ELSE 0 END) AS golds, SUM(CASE WHEN rank == 2 THEN 1 ELSE 0 END) AS silvers, SUM(CASE WHEN rank == 3 THEN 1 ELSE 0 END) AS bronzes, COUNT(*) as count FROM LocalRun "
 				"WHERE rank != 0 AND style != 14 AND username = ?";
-			CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE(bind_text(stmt, 1, username, -1, SQLITE_STATIC));
 
 			s = sqlite3_step(stmt);
@@ -4530,11 +5836,11 @@ void Cmd_AccountStats_f(gentity_t *ent) { //Should i bother to cache player stat
 			else if (s != SQLITE_DONE) {
 				G_ErrorPrint("ERROR: SQL Select Failed (Cmd_Stats_f 2)", s);
 			}
-			CALL_SQLITE(finalize(stmt));
+			G_DBFinalize(stmt);
 
 			//Recent races
 			sql = "SELECT coursename, style, rank, season_rank, duration_ms, end_time FROM LocalRun WHERE username = ? ORDER BY end_time DESC LIMIT ?, 10";
-			CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE(bind_text(stmt, 1, username, -1, SQLITE_STATIC));
 			CALL_SQLITE(bind_int(stmt, 2, start));
 
@@ -4570,7 +5876,7 @@ void Cmd_AccountStats_f(gentity_t *ent) { //Should i bother to cache player stat
 			}
 			trap->SendServerCommand(ent - g_entities, va("print \"%s\"", msg));
 
-			CALL_SQLITE(finalize(stmt));
+			G_DBFinalize(stmt);
 
 		}
 		else if (type == 2)//All Combat..? break down per style? gametype?
@@ -4589,7 +5895,7 @@ void Cmd_AccountStats_f(gentity_t *ent) { //Should i bother to cache player stat
 				"ON D1.username = D2.username2) "
 				"INNER JOIN (SELECT loser AS username3, COUNT(*) AS loss_count, SUM(1-odds) AS loss_ts FROM LocalDuel WHERE type = ? GROUP BY username3) AS D3 "
 				"ON D1.username = D3.username3 ORDER BY elo desc LIMIT ?, 10";
-			CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE(bind_text(stmt, 1, username, -1, SQLITE_STATIC));
 
 			s = sqlite3_step(stmt);
@@ -4607,12 +5913,12 @@ void Cmd_AccountStats_f(gentity_t *ent) { //Should i bother to cache player stat
 			else if (s != SQLITE_DONE) {
 				G_ErrorPrint("ERROR: SQL Select Failed (Cmd_Stats_f 2)", s);
 			}
-			CALL_SQLITE(finalize(stmt));
+			G_DBFinalize(stmt);
 #endif
 
 			//Recent duels
 			sql = "SELECT winner, loser, type, end_time FROM LocalDuel WHERE winner = ? OR loser = ? ORDER BY end_time DESC LIMIT ?, 10";
-			CALL_SQLITE(prepare_v2(db, sql, strlen(sql) + 1, &stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE(bind_text(stmt, 1, username, -1, SQLITE_STATIC));
 			CALL_SQLITE(bind_text(stmt, 2, username, -1, SQLITE_STATIC));
 			CALL_SQLITE(bind_int(stmt, 3, start));
@@ -4651,10 +5957,10 @@ void Cmd_AccountStats_f(gentity_t *ent) { //Should i bother to cache player stat
 			}
 			trap->SendServerCommand(ent - g_entities, va("print \"%s\"", msg));
 
-			CALL_SQLITE(finalize(stmt));
+			G_DBFinalize(stmt);
 		}
 
-		CALL_SQLITE(close(db));
+		G_DBRelease(db);
 	}
 	//DebugWriteToDB("Cmd_AccountStats_f");
 }
@@ -4751,14 +6057,10 @@ void G_AddSimpleStatsToDB() {
 //Useless feature
 #if _STATLOG
 	fileHandle_t f;	
-	int		fLen = 0, args = 1, s; //MAX_FILESIZE = 4096
-	char	buf[8 * 1024] = {0}, empty[8] = {0};//eh
+	int		fLen = 0, args = 1; //MAX_FILESIZE = 4096
+	char	buf[8 * 1024] = {0};//eh
 	char*	pch;
-	sqlite3 * db;
-	char * sql;
-	sqlite3_stmt * stmt;
-	UserStats_t	TempUserStats;
-	qboolean good = qfalse;
+	dbJob_t	*job;
 
 	fLen = trap->FS_Open(TEMP_STAT_LOG, &f, FS_READ);
 
@@ -4775,51 +6077,82 @@ void G_AddSimpleStatsToDB() {
 	trap->FS_Read(buf, fLen, f);
 	buf[fLen] = 0;
 	trap->FS_Close(f);
-	
-	CALL_SQLITE (open (LOCAL_DB_PATH, & db));
-	sql = "UPDATE LocalAccount SET "
-		"kills = kills + ?, deaths = deaths + ?, suicides = suicides + ?, captures = captures + ?, returns = returns + ? "
-		"WHERE username = ?";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
 
-	//Todo: make TempRaceRecord an array of structs instead, maybe like 32 long idk, and build a query to insert 32 at a time or something.. instead of 1 by 1
+	job = (dbJob_t *)calloc(1, sizeof(dbJob_t));
+	if (job)
+		job->stats = (dbJobStats_t *)calloc(256, sizeof(dbJobStats_t));
+	if (!job || !job->stats) {
+		free(job);
+		trap->Print("ERROR: Unable to insert previous map stats into database.\n");
+		return;
+	}
+	job->type = DBJOB_SIMPLESTATS;
+
+	//Parse here, strtok is not safe to use on the database thread
 	pch = strtok (buf,";\n");
-	while (pch != NULL)
+	while (pch != NULL && job->numStats < 256)
 	{
+		dbJobStats_t *stats = &job->stats[job->numStats];
+
 		if ((args % 6) == 1)
-			Q_strncpyz(TempUserStats.username, pch, sizeof(TempUserStats.username));
+			Q_strncpyz(stats->username, pch, sizeof(stats->username));
 		else if ((args % 6) == 2)
-			TempUserStats.kills = atoi(pch);
+			stats->kills = atoi(pch);
 		else if ((args % 6) == 3)
-			TempUserStats.deaths = atoi(pch);
+			stats->deaths = atoi(pch);
 		else if ((args % 6) == 4)
-			TempUserStats.suicides = atoi(pch);
+			stats->suicides = atoi(pch);
 		else if ((args % 6) == 5)
-			TempUserStats.captures = atoi(pch);
+			stats->captures = atoi(pch);
 		else if ((args % 6) == 0) {
-			TempUserStats.returns = atoi(pch);
-			//trap->Print("Inserting stat into db: %s, %i, %i, %i, %i, %i\n", TempUserStats.username, TempUserStats.kills, TempUserStats.deaths, TempUserStats.suicides, TempUserStats.captures, TempUserStats.returns);
-			CALL_SQLITE (bind_int (stmt, 1, TempUserStats.kills));
-			CALL_SQLITE (bind_int (stmt, 2, TempUserStats.deaths));
-			CALL_SQLITE (bind_int (stmt, 3, TempUserStats.suicides));
-			CALL_SQLITE (bind_int (stmt, 4, TempUserStats.captures));
-			CALL_SQLITE (bind_int (stmt, 5, TempUserStats.returns));
-			CALL_SQLITE (bind_text (stmt, 6, TempUserStats.username, -1, SQLITE_STATIC));
-			CALL_SQLITE_EXPECT (step (stmt), DONE);
-			CALL_SQLITE (reset (stmt));
-			CALL_SQLITE (clear_bindings (stmt));
+			stats->returns = atoi(pch);
+			job->numStats++;
 		}
     	pch = strtok (NULL, ";\n");
 		args++;
 	}
 
-	s = sqlite3_step(stmt); //this duplicates last one..?
-	if (s == SQLITE_DONE)
-		good = qtrue;
-	CALL_SQLITE (finalize(stmt));
-	CALL_SQLITE (close(db));	
+	G_DBQueueJob(job);
+#endif
+}
 
-	if (good) { //dont delete tmp file if mysql database is not responding 
+#if _STATLOG
+//Database thread part of G_AddSimpleStatsToDB
+static void G_RunSimpleStatsJob(dbJob_t *job, sqlite3 *db) {
+	char * sql;
+	sqlite3_stmt * stmt;
+	int i, s;
+
+	sql = "UPDATE LocalAccount SET "
+		"kills = kills + ?, deaths = deaths + ?, suicides = suicides + ?, captures = captures + ?, returns = returns + ? "
+		"WHERE username = ?";
+	G_DBPrepare(db, sql, &stmt);
+
+	job->statsWritten = qtrue;
+	for (i = 0; i < job->numStats; i++) {
+		//trap->Print("Inserting stat into db: %s, %i, %i, %i, %i, %i\n", TempUserStats.username, TempUserStats.kills, TempUserStats.deaths, TempUserStats.suicides, TempUserStats.captures, TempUserStats.returns);
+		CALL_SQLITE (bind_int (stmt, 1, job->stats[i].kills));
+		CALL_SQLITE (bind_int (stmt, 2, job->stats[i].deaths));
+		CALL_SQLITE (bind_int (stmt, 3, job->stats[i].suicides));
+		CALL_SQLITE (bind_int (stmt, 4, job->stats[i].captures));
+		CALL_SQLITE (bind_int (stmt, 5, job->stats[i].returns));
+		CALL_SQLITE (bind_text (stmt, 6, job->stats[i].username, -1, SQLITE_STATIC));
+		s = sqlite3_step(stmt);
+		if (s != SQLITE_DONE)
+			job->statsWritten = qfalse;
+		CALL_SQLITE (reset (stmt));
+		CALL_SQLITE (clear_bindings (stmt));
+	}
+
+	G_DBFinalize(stmt);
+}
+
+//Game thread part of G_AddSimpleStatsToDB
+static void G_FinishSimpleStatsJob(dbJob_t *job) {
+	fileHandle_t f;
+	char empty[8] = {0};
+
+	if (job->statsWritten) { //dont delete tmp file if mysql database is not responding 
 		trap->FS_Open(TEMP_STAT_LOG, &f, FS_WRITE); 
 		trap->FS_Write( empty, strlen( empty ), level.tempStatLog );
 		trap->FS_Close(f);
@@ -4829,7 +6162,43 @@ void G_AddSimpleStatsToDB() {
 		trap->Print("ERROR: Unable to insert previous map stats into database.\n");
 
 	//DebugWriteToDB("G_AddSimpleStatToDB");
+}
+#endif
+
+static void G_DBRunJob(dbJob_t *job, sqlite3 *db) {
+	switch (job->type) {
+	case DBJOB_RACE:
+		G_RunRaceJob(job, db);
+		break;
+#if _ELORANKING
+	case DBJOB_DUEL:
+		G_AddDuelElo(job->username, job->otherName, job->style, job->duration_ms, job->topspeed, job->average, 0, job->end_time, db);
+		break;
+#endif
+#if _STATLOG
+	case DBJOB_SIMPLESTATS:
+		G_RunSimpleStatsJob(job, db);
+		break;
+#endif
+	default:
+		break;
+	}
+}
+
+static void G_DBFinishJob(dbJob_t *job) {
+	switch (job->type) {
+	case DBJOB_RACE:
+		G_FinishRaceJob(job);
+		break;
+#if _STATLOG
+	case DBJOB_SIMPLESTATS:
+		G_FinishSimpleStatsJob(job);
+		break;
 #endif
+	default:
+		break;
+	}
+	free(job->stats);
 }
 
 #if 0
@@ -4839,11 +6208,11 @@ void G_AddSimpleStatsToDB2() { //For each item in array.. do an update query?  C
     sqlite3_stmt * stmt;
 	int row = 0;
 
-	CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+	db = G_DBAcquire();
 	sql = "UPDATE LocalAccount SET "
 		"kills = kills + ?, deaths = deaths + ?, suicides = suicides + ?, captures = captures + ?, returns = returns + ? "
 		"WHERE username = ?";
-	CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+	G_DBPrepare(db, sql, &stmt);
 
 	for (row = 0; row < 256; row++) { //size of UserStats ?
 		if (!UserStats[row].username || !UserStats[row].username[0])
@@ -4860,8 +6229,8 @@ void G_AddSimpleStatsToDB2() { //For each item in array.. do an update query?  C
 		CALL_SQLITE (clear_bindings (stmt));
 	}
 
-	CALL_SQLITE (finalize(stmt));
-	CALL_SQLITE (close(db));
+	G_DBFinalize(stmt);
+	G_DBRelease(db);
 }
 #endif
 
@@ -4878,7 +6247,7 @@ void BuildMapHighscores() { //loda fixme, take prepare,query out of loop
 	Q_strlwr(mapName);
 	Q_CleanStr(mapName);
 
-	CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+	db = G_DBAcquire();
 
 	for (i = 0; i < level.numCourses; i++) { //32 max
 		Q_strncpyz(courseName, mapName, sizeof(courseName));
@@ -4894,7 +6263,7 @@ void BuildMapHighscores() { //loda fixme, take prepare,query out of loop
 				   "GROUP by username) " 
 				"AS X INNER JOIN LocalRun AS LR ON LR.id = X.id ORDER BY duration_ms, end_time LIMIT 10"; //end_time so in case of tie, first one shows up first?
 
-			CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE (bind_text (stmt, 1, courseName, -1, SQLITE_STATIC));
 			CALL_SQLITE (bind_int (stmt, 2, mstyle));
 
@@ -4937,10 +6306,10 @@ void BuildMapHighscores() { //loda fixme, take prepare,query out of loop
 					break;
 				}
 			}
-			CALL_SQLITE (finalize(stmt));
+			G_DBFinalize(stmt);
 		}
 	}
-	CALL_SQLITE (close(db));
+	G_DBRelease(db);
 
 	if (level.numCourses)
 		trap->Print("Highscores built for %s\n", mapName);
@@ -5110,9 +6479,9 @@ void Cmd_PersonalBest_f(gentity_t *ent) { //loda fixme bugged, always finds in c
 	}
 
 	if (!duration_ms) { //Not found in cache, so check db
-		CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+		db = G_DBAcquire();
 		sql = "SELECT MIN(duration_ms), topspeed, average FROM LocalRun WHERE username = ? AND coursename = ? AND style = ?";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_text (stmt, 1, username, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_text (stmt, 2, courseNameFull, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_int (stmt, 3, style));
@@ -5126,13 +6495,13 @@ void Cmd_PersonalBest_f(gentity_t *ent) { //loda fixme bugged, always finds in c
 		}
 		else if (s != SQLITE_DONE) {
 			fprintf (stderr, "ERROR: SQL Select Failed.\n");//trap print?
-			CALL_SQLITE (finalize(stmt));
-			CALL_SQLITE (close(db));
+			G_DBFinalize(stmt);
+			G_DBRelease(db);
 			return;
 		}
 
-		CALL_SQLITE (finalize(stmt));
-		CALL_SQLITE (close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 	}
 
 	if (duration_ms >= 60000) { //FIXME, make this use the inttostring function if it tests bugfree
@@ -5334,8 +6703,9 @@ void Cmd_DFFind_f(gentity_t *ent) {
 		int s;
 		char dateStr[64] = {0}, dateStrColored[64] = {0}, timeStr[32], msg[1024-128] = {0};
 		time_t	rawtime;
+		raceBoard_t *board;
 
-		CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+		db = G_DBAcquire();
 
 		if (enteredCourseName) { //Course e
 			//Com_Printf("doing sql query %s %i\n", courseName, style);
@@ -5344,7 +6714,7 @@ void Cmd_DFFind_f(gentity_t *ent) {
 			//sql = "SELECT coursename, MAX(entries) FROM LocalRun WHERE instr(coursename, ?) > 0 LIMIT 1";
 			//sql = "SELECT DISTINCT(coursename) FROM LocalRun WHERE instr(coursename, ?) > 0 ORDER BY LENGTH(coursename) ASC, entries DESC LIMIT 1";
 			sql = "SELECT DISTINCT(coursename) FROM LocalRun WHERE instr(replace(coursename, ' ', ''), ?) > 0 ORDER BY entries DESC LIMIT 1";
-			CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE (bind_text (stmt, 1, partialCourseName, -1, SQLITE_STATIC));
 			s = sqlite3_step(stmt);
 			if (s == SQLITE_ROW) {
@@ -5354,16 +6724,44 @@ void Cmd_DFFind_f(gentity_t *ent) {
 			else if (s == SQLITE_DONE) {
 				//Com_Printf("fail 4\n");
 				trap->SendServerCommand(ent-g_entities, "print \"Usage: /rFind <username> <mapname (optional)> <season (optional - example: s1)> <style (optional)>.  This displays the players best time.\n\"");
-				CALL_SQLITE (finalize(stmt));
-				CALL_SQLITE (close(db));
+				G_DBFinalize(stmt);
+				G_DBRelease(db);
 				return;
 			}
 			else {
 				G_ErrorPrint("ERROR: SQL Select Failed (Cmd_DFFind_f)", s);
 				return;
 			}
-			CALL_SQLITE (finalize(stmt));
+			G_DBFinalize(stmt);
+
+		}
+
+		time( &rawtime );
+		localtime( &rawtime );
+
+		if (season == -1)
+			trap->SendServerCommand(ent-g_entities, va("print \"Best time for %s on %s using %s:\n    ^5Rank     Time         Topspeed    Average      Date\n\"", username, fullCourseName, inputStyleString));
+		else
+			trap->SendServerCommand(ent-g_entities, va("print \"Best time for %s on %s using %s season %i:\n    ^5Rank     Time         Topspeed    Average      Date\n\"", username, fullCourseName, inputStyleString, season));
+
+		board = G_RaceCacheBoard(fullCourseName, style, (season == -1) ? RACECACHE_ALLSEASONS : season);
+		if (board) { //Course on this map, rank comes from the leaderboard cache
+			raceEntry_t *entry = G_RaceFindEntry(&raceCache, board, username);
 
+			if (entry) {
+				TimeToString(entry->duration_ms, timeStr, sizeof(timeStr), qfalse);
+				getDateTime(entry->end_time, dateStr, sizeof(dateStr));
+				if (rawtime - entry->end_time < 60*60*24) { //Today
+					Com_sprintf(dateStrColored, sizeof(dateStrColored), "^2%s^7", dateStr);
+				}
+				else {
+					Q_strncpyz(dateStrColored, dateStr, sizeof(dateStrColored));
+				}
+				Com_sprintf(msg, sizeof(msg), "    ^3%-8i %-12s %-11i %-12i %s\n", G_RaceRank(entry), timeStr, entry->topspeed, entry->average, dateStrColored);
+			}
+			trap->SendServerCommand(ent-g_entities, va("print \"%s\"", msg));
+			G_DBRelease(db);
+			return;
 		}
 
 		//Problem - crossmap query can return multiple records for same person since the cleanup cmd is only done on mapchange, 
@@ -5373,7 +6771,7 @@ void Cmd_DFFind_f(gentity_t *ent) {
 			sql = "SELECT rank, MIN(duration_ms) AS duration, topspeed, average, end_time FROM LocalRun WHERE username = ? AND coursename = ? AND style = ? GROUP BY username ORDER BY duration ASC, end_time ASC LIMIT 1";
 		else 
 			sql = "SELECT season_rank, MIN(duration_ms) AS duration, topspeed, average, end_time FROM LocalRun WHERE username = ? AND coursename = ? AND style = ? AND season = ? GROUP BY username ORDER BY duration ASC, end_time ASC LIMIT 1";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_text (stmt, 1, username, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_text (stmt, 2, fullCourseName, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_int (stmt, 3, style));
@@ -5382,13 +6780,6 @@ void Cmd_DFFind_f(gentity_t *ent) {
 			CALL_SQLITE (bind_int (stmt, 4, season));
 		}
 
-		time( &rawtime );
-		localtime( &rawtime );
-
-		if (season == -1)
-			trap->SendServerCommand(ent-g_entities, va("print \"Best time for %s on %s using %s:\n    ^5Rank     Time         Topspeed    Average      Date\n\"", username, fullCourseName, inputStyleString));
-		else
-			trap->SendServerCommand(ent-g_entities, va("print \"Best time for %s on %s using %s season %i:\n    ^5Rank     Time         Topspeed    Average      Date\n\"", username, fullCourseName, inputStyleString, season));
 		while (1) {
 			s = sqlite3_step(stmt);
 			if (s == SQLITE_ROW) {
@@ -5417,8 +6808,8 @@ void Cmd_DFFind_f(gentity_t *ent) {
 		}
 		trap->SendServerCommand(ent-g_entities, va("print \"%s\"", msg));
 
-		CALL_SQLITE (finalize(stmt));
-		CALL_SQLITE (close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 	}
 }
 
@@ -5482,14 +6873,14 @@ void Cmd_DFTopRank_f(gentity_t *ent) { //Add season support?
 		float rank, percentile;
 		char msg[1024-128] = {0}, username[40];
 
-		CALL_SQLITE (open (LOCAL_DB_PATH, & db)); //Needs to select only top entry from each person not all seasons
+		db = G_DBAcquire(); //Needs to select only top entry from each person not all seasons
 		if (style == -1) {
 			if (season == -1) {
 				sql = "SELECT username, SUM(entries-rank) AS newscore, CAST(SUM(entries/CAST(rank AS FLOAT)) AS INT) AS oldscore, AVG(rank) as rank, AVG((entries - CAST(rank-1 AS float))/entries) AS percentile, SUM(CASE WHEN rank == 1 THEN 1 ELSE 0 END) AS golds, SUM(CASE WHEN rank == 2 THEN 1 ELSE 0 END) AS silvers, SUM(CASE WHEN rank == 3 THEN 1 ELSE 0 END) AS bronzes, COUNT(*) as count FROM LocalRun "
 					"WHERE rank != 0 "
 					"GROUP BY username "
 					"ORDER BY oldscore+newscore DESC, rank DESC LIMIT ?, 10";
-				CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+				G_DBPrepare(db, sql, &stmt);
 				CALL_SQLITE (bind_int (stmt, 1, start));
 			}
 			else {
@@ -5497,7 +6888,7 @@ void Cmd_DFTopRank_f(gentity_t *ent) { //Add season support?
 					"WHERE season = ? "
 					"GROUP BY username "
 					"ORDER BY oldscore+newscore DESC, rank DESC LIMIT ?, 10";
-				CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+				G_DBPrepare(db, sql, &stmt);
 				CALL_SQLITE (bind_int (stmt, 1, season));
 				CALL_SQLITE (bind_int (stmt, 2, start));
 			}
@@ -5508,7 +6899,7 @@ void Cmd_DFTopRank_f(gentity_t *ent) { //Add season support?
 					"WHERE rank != 0 AND style = ? "
 					"GROUP BY username "
 					"ORDER BY oldscore+newscore DESC, rank DESC LIMIT ?, 10";
-				CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+				G_DBPrepare(db, sql, &stmt);
 				CALL_SQLITE (bind_int (stmt, 1, style));
 				CALL_SQLITE (bind_int (stmt, 2, start));
 			}
@@ -5517,7 +6908,7 @@ void Cmd_DFTopRank_f(gentity_t *ent) { //Add season support?
 					"WHERE season = ? AND style = ? "
 					"GROUP BY username "
 					"ORDER BY oldscore+newscore DESC, rank DESC LIMIT ?, 10";
-				CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+				G_DBPrepare(db, sql, &stmt);
 				CALL_SQLITE (bind_int (stmt, 1, season));
 				CALL_SQLITE (bind_int (stmt, 2, style));
 				CALL_SQLITE (bind_int (stmt, 3, start));
@@ -5560,8 +6951,8 @@ void Cmd_DFTopRank_f(gentity_t *ent) { //Add season support?
 		}
 		trap->SendServerCommand(ent-g_entities, va("print \"%s\"", msg));
 
-		CALL_SQLITE (finalize(stmt));
-		CALL_SQLITE (close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 
 	}
 }
@@ -5648,14 +7039,14 @@ void Cmd_DFHardest_f(gentity_t *ent) {
 		char styleStr[16] = {0}, msg[128] = {0};
 		int s;
 
-		CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+		db = G_DBAcquire();
 
 		if (style == -1) {
 			if (currentSeason)
 				sql = "SELECT username, coursename, style, season_entries FROM LocalRun WHERE season = (SELECT MAX(season) FROM LocalRun) ORDER BY season_entries ASC, entries ASC LIMIT ?,10";
 			else
 				sql = "SELECT username, coursename, style, entries FROM LocalRun ORDER BY entries ASC LIMIT ?,10";
-			CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE (bind_int (stmt, 1, start));
 		}
 		else {
@@ -5663,7 +7054,7 @@ void Cmd_DFHardest_f(gentity_t *ent) {
 				sql = "SELECT username, coursename, style, season_entries FROM LocalRun WHERE season = (SELECT MAX(season) FROM LocalRun) AND style = ? ORDER BY season_entries ASC, entries ASC LIMIT ?,10";
 			else
 				sql = "SELECT username, coursename, style, entries FROM LocalRun WHERE style = ? ORDER BY entries ASC LIMIT ?,10";
-			CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE (bind_int (stmt, 1, style));
 			CALL_SQLITE (bind_int (stmt, 2, start));
 		}
@@ -5696,8 +7087,8 @@ void Cmd_DFHardest_f(gentity_t *ent) {
 		}
 		trap->SendServerCommand(ent-g_entities, va("print \"%s\"", msg));
 
-		CALL_SQLITE (finalize(stmt));
-		CALL_SQLITE (close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 	}
 
 
@@ -5762,14 +7153,14 @@ void Cmd_DFRecent_f(gentity_t *ent) {
 		char dateStr[64] = {0}, timeStr[32] = {0}, styleStr[16] = {0}, rankStr[16] = {0}, msg[1024 - 128] = { 0 };
 		int s;
 
-		CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+		db = G_DBAcquire();
 
 		if (style == -1) {
 			if (showSeasons)
 				sql = "SELECT username, coursename, style, rank, duration_ms, end_time, season_rank FROM LocalRun ORDER BY end_time DESC LIMIT ?,10";
 			else
 				sql = "SELECT username, coursename, style, rank, duration_ms, end_time FROM LocalRun WHERE rank != 0 ORDER BY end_time DESC LIMIT ?,10";
-			CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE (bind_int (stmt, 1, start));
 		}
 		else {
@@ -5777,7 +7168,7 @@ void Cmd_DFRecent_f(gentity_t *ent) {
 				sql = "SELECT username, coursename, style, rank, duration_ms, end_time, season_rank FROM LocalRun WHERE style = ? ORDER BY end_time DESC LIMIT ?,10";
 			else
 				sql = "SELECT username, coursename, style, rank, duration_ms, end_time FROM LocalRun WHERE rank != 0 AND style = ? ORDER BY end_time DESC LIMIT ?,10";
-			CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE (bind_int (stmt, 1, style));
 			CALL_SQLITE (bind_int (stmt, 2, start));
 		}
@@ -5821,8 +7212,8 @@ void Cmd_DFRecent_f(gentity_t *ent) {
 		}
 		trap->SendServerCommand(ent-g_entities, va("print \"%s\"", msg));
 
-		CALL_SQLITE (finalize(stmt));
-		CALL_SQLITE (close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 	}
 
 
@@ -5838,6 +7229,25 @@ qboolean atoi_real(const char* string) {
 	return qtrue;
 }
 
+static void G_AppendTop10Row(gentity_t *ent, char *msg, size_t msgSize, int position, const char *username, int duration_ms, int topspeed, int average, int end_time, time_t rawtime) {
+	char dateStr[64] = {0}, dateStrColored[64] = {0}, timeStr[32], *tmpMsg;
+
+	TimeToString(duration_ms, timeStr, sizeof(timeStr), qfalse);
+	getDateTime(end_time, dateStr, sizeof(dateStr));
+	if (rawtime - end_time < 60*60*24) { //Today
+		Com_sprintf(dateStrColored, sizeof(dateStrColored), "^2%s^7", dateStr);
+	}
+	else {
+		Q_strncpyz(dateStrColored, dateStr, sizeof(dateStrColored));
+	}
+	tmpMsg = va("^5%2i^3: ^3%-18s ^3%-12s ^3%-11i ^3%-12i %s\n", position, username, timeStr, topspeed, average, dateStrColored);
+	if (strlen(msg) + strlen(tmpMsg) >= msgSize) {
+		trap->SendServerCommand( ent-g_entities, va("print \"%s\"", msg));
+		msg[0] = '\0';
+	}
+	Q_strcat(msg, msgSize, tmpMsg);
+}
+
 void Cmd_DFTop10_f(gentity_t *ent) {
 	int style = -1, page = -1, season = -1, start = 0, input, i;
 	char inputString[40], inputStyleString[16];
@@ -5944,10 +7354,11 @@ void Cmd_DFTop10_f(gentity_t *ent) {
 		sqlite3_stmt * stmt;
 		int row = 1;
 		int s;
-		char dateStr[64] = {0}, dateStrColored[64] = {0}, timeStr[32], msg[1024-128] = {0};
+		char msg[1024-128] = {0};
 		time_t	rawtime;
+		raceBoard_t *board;
 
-		CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+		db = G_DBAcquire();
 
 		if (enteredCourseName) { //Course e
 			//Com_Printf("doing sql query %s %i\n", courseName, style);
@@ -5956,7 +7367,7 @@ void Cmd_DFTop10_f(gentity_t *ent) {
 			//sql = "SELECT coursename, MAX(entries) FROM LocalRun WHERE instr(coursename, ?) > 0 LIMIT 1";
 			//sql = "SELECT DISTINCT(coursename) FROM LocalRun WHERE instr(coursename, ?) > 0 ORDER BY LENGTH(coursename) ASC, entries DESC LIMIT 1";
 			sql = "SELECT DISTINCT(coursename) FROM LocalRun WHERE instr(replace(coursename, ' ', ''), ?) > 0 ORDER BY entries DESC LIMIT 1";
-			CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE (bind_text (stmt, 1, partialCourseName, -1, SQLITE_STATIC));
 			s = sqlite3_step(stmt);
 			if (s == SQLITE_ROW) {
@@ -5966,16 +7377,39 @@ void Cmd_DFTop10_f(gentity_t *ent) {
 			else if (s == SQLITE_DONE) {
 				//Com_Printf("fail 4\n");
 				trap->SendServerCommand(ent-g_entities, "print \"Usage: /rTop <course (if needed)> <style (optional)> <season (optional - example: s1)> <page (optional)>.  This displays highscores for the specified course.\n\"");
-				CALL_SQLITE (finalize(stmt));
-				CALL_SQLITE (close(db));
+				G_DBFinalize(stmt);
+				G_DBRelease(db);
 				return;
 			}
 			else {
 				G_ErrorPrint("ERROR: SQL Select Failed (Cmd_DFTop10_f)", s);
 				return;
 			}
-			CALL_SQLITE (finalize(stmt));
+			G_DBFinalize(stmt);
+
+		}
+
+		time( &rawtime );
+		localtime( &rawtime );
+
+		if (season == -1)
+			trap->SendServerCommand(ent-g_entities, va("print \"Highscore results for %s using %s:\n    ^5Username           Time         Topspeed    Average      Date\n\"", fullCourseName, inputStyleString));
+		else
+			trap->SendServerCommand(ent-g_entities, va("print \"Highscore results for %s using %s season %i:\n    ^5Username           Time         Topspeed    Average      Date\n\"", fullCourseName, inputStyleString, season));
 
+		board = G_RaceCacheBoard(fullCourseName, style, (season == -1) ? RACECACHE_ALLSEASONS : season);
+		if (board) { //Course on this map, page through the leaderboard cache
+			for (i = 0; i < 10; i++) {
+				raceEntry_t *entry = G_RaceSelect(board, start + i);
+
+				if (!entry)
+					break;
+				G_AppendTop10Row(ent, msg, sizeof(msg), row+start, entry->username, entry->duration_ms, entry->topspeed, entry->average, entry->end_time, rawtime);
+				row++;
+			}
+			trap->SendServerCommand(ent-g_entities, va("print \"%s\"", msg));
+			G_DBRelease(db);
+			return;
 		}
 
 		//Problem - crossmap query can return multiple records for same person since the cleanup cmd is only done on mapchange, 
@@ -5985,7 +7419,7 @@ void Cmd_DFTop10_f(gentity_t *ent) {
 			sql = "SELECT username, MIN(duration_ms) AS duration, topspeed, average, end_time FROM LocalRun WHERE coursename = ? AND style = ? GROUP BY username ORDER BY duration ASC, end_time ASC LIMIT ?, 10";
 		else 
 			sql = "SELECT username, MIN(duration_ms) AS duration, topspeed, average, end_time FROM LocalRun WHERE coursename = ? AND style = ? AND season = ? GROUP BY username ORDER BY duration ASC, end_time ASC LIMIT ?, 10";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_text (stmt, 1, fullCourseName, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_int (stmt, 2, style));
 
@@ -5997,31 +7431,10 @@ void Cmd_DFTop10_f(gentity_t *ent) {
 			CALL_SQLITE (bind_int (stmt, 4, start));
 		}
 
-		time( &rawtime );
-		localtime( &rawtime );
-
-		if (season == -1)
-			trap->SendServerCommand(ent-g_entities, va("print \"Highscore results for %s using %s:\n    ^5Username           Time         Topspeed    Average      Date\n\"", fullCourseName, inputStyleString));
-		else
-			trap->SendServerCommand(ent-g_entities, va("print \"Highscore results for %s using %s season %i:\n    ^5Username           Time         Topspeed    Average      Date\n\"", fullCourseName, inputStyleString, season));
 		while (1) {
 			s = sqlite3_step(stmt);
 			if (s == SQLITE_ROW) {
-				char *tmpMsg = NULL;
-				TimeToString(sqlite3_column_int(stmt, 1), timeStr, sizeof(timeStr), qfalse);
-				getDateTime(sqlite3_column_int(stmt, 4), dateStr, sizeof(dateStr));
-				if (rawtime - sqlite3_column_int(stmt, 4) < 60*60*24) { //Today
-					Com_sprintf(dateStrColored, sizeof(dateStrColored), "^2%s^7", dateStr);
-				}
-				else {
-					Q_strncpyz(dateStrColored, dateStr, sizeof(dateStrColored));
-				}
-				tmpMsg = va("^5%2i^3: ^3%-18s ^3%-12s ^3%-11i ^3%-12i %s\n", row+start, sqlite3_column_text(stmt, 0), timeStr, sqlite3_column_int(stmt, 2), sqlite3_column_int(stmt, 3), dateStrColored);
-				if (strlen(msg) + strlen(tmpMsg) >= sizeof( msg)) {
-					trap->SendServerCommand( ent-g_entities, va("print \"%s\"", msg));
-					msg[0] = '\0';
-				}
-				Q_strcat(msg, sizeof(msg), tmpMsg);
+				G_AppendTop10Row(ent, msg, sizeof(msg), row+start, (const char *)sqlite3_column_text(stmt, 0), sqlite3_column_int(stmt, 1), sqlite3_column_int(stmt, 2), sqlite3_column_int(stmt, 3), sqlite3_column_int(stmt, 4), rawtime);
 				row++;
 			}
 			else if (s == SQLITE_DONE)
@@ -6033,8 +7446,8 @@ void Cmd_DFTop10_f(gentity_t *ent) {
 		}
 		trap->SendServerCommand(ent-g_entities, va("print \"%s\"", msg));
 
-		CALL_SQLITE (finalize(stmt));
-		CALL_SQLITE (close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 	}
 }
 
@@ -6155,7 +7568,7 @@ void Cmd_DFTop10_f(gentity_t *ent) {
 		char dateStr[64] = {0}, dateStrColored[64] = {0};
 		time_t	rawtime;
 
-		CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+		db = G_DBAcquire();
 
 		if (partialCourseName) { //Course e
 			//Com_Printf("doing sql query %s %i\n", courseName, style);
@@ -6164,7 +7577,7 @@ void Cmd_DFTop10_f(gentity_t *ent) {
 			//sql = "SELECT coursename, MAX(entries) FROM LocalRun WHERE instr(coursename, ?) > 0 LIMIT 1";
 			//sql = "SELECT DISTINCT(coursename) FROM LocalRun WHERE instr(coursename, ?) > 0 ORDER BY LENGTH(coursename) ASC, entries DESC LIMIT 1";
 			sql = "SELECT DISTINCT(coursename) FROM LocalRun WHERE instr(coursename, ?) > 0 ORDER BY entries DESC LIMIT 1";
-			CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+			G_DBPrepare(db, sql, &stmt);
 			CALL_SQLITE (bind_text (stmt, 1, courseName, -1, SQLITE_STATIC));
 			s = sqlite3_step(stmt);
 			if (s == SQLITE_ROW) {
@@ -6174,11 +7587,11 @@ void Cmd_DFTop10_f(gentity_t *ent) {
 			else {
 				//Com_Printf("fail 4\n");
 				trap->SendServerCommand(ent-g_entities, "print \"Usage: /rTop <course (if needed)> <style (optional)> <page (optional)>.  This displays the top10 for the specified course.\n\"");
-				CALL_SQLITE (finalize(stmt));
-				CALL_SQLITE (close(db));
+				G_DBFinalize(stmt);
+				G_DBRelease(db);
 				return;
 			}
-			CALL_SQLITE (finalize(stmt));
+			G_DBFinalize(stmt);
 
 		}
 
@@ -6186,7 +7599,7 @@ void Cmd_DFTop10_f(gentity_t *ent) {
 		//fix by grouping by username here? and using min() so it shows right one? who knows if that will work
 		//could be cheaper by using where rank != 0 instead of min(duration_ms) but w/e
 		sql = "SELECT username, MIN(duration_ms) AS duration, topspeed, average, end_time FROM LocalRun WHERE coursename = ? AND style = ? GROUP BY username ORDER BY duration ASC, end_time ASC LIMIT ?, 10";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 		CALL_SQLITE (bind_text (stmt, 1, courseNameFull, -1, SQLITE_STATIC));
 		CALL_SQLITE (bind_int (stmt, 2, style));
 		CALL_SQLITE (bind_int (stmt, 3, start));
@@ -6224,8 +7637,8 @@ void Cmd_DFTop10_f(gentity_t *ent) {
 		}
 		trap->SendServerCommand(ent-g_entities, va("print \"%s\"", msg));
 
-		CALL_SQLITE (finalize(stmt));
-		CALL_SQLITE (close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 	}
 }
 #endif
@@ -6297,7 +7710,7 @@ void Cmd_DFTodo_f(gentity_t *ent) {
 		char msg[1024-128] = {0}, timeStr[64], dateStr[64], styleStr[16], rankStr[16];
 		int s, row = 1;
 
-		CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+		db = G_DBAcquire();
 		if (style == -1) {
 			if (enteredCoursename) {
 				//sql = "SELECT coursename, style, rank, entries, duration_ms, end_time FROM LocalRun WHERE rank != 0 AND username = ? AND instr(coursename, ?) > 0 ORDER BY (entries - entries / rank) DESC LIMIT ?, 10";
@@ -6312,7 +7725,7 @@ void Cmd_DFTodo_f(gentity_t *ent) {
 								"ON T1.coursename = T2.coursename AND T1.style = T2.style "
 							"WHERE T2.coursename IS NULL OR T2.style IS NULL) "	
 					"ORDER BY (entries-((entries/cast(rank as float))+(entries-rank)/2.0)) DESC LIMIT ?, 10";
-					CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+					G_DBPrepare(db, sql, &stmt);
 					CALL_SQLITE (bind_text (stmt, 1, username, -1, SQLITE_STATIC));
 					CALL_SQLITE (bind_text (stmt, 2, partialCourseName, -1, SQLITE_STATIC));
 					CALL_SQLITE (bind_text (stmt, 3, partialCourseName, -1, SQLITE_STATIC));
@@ -6333,7 +7746,7 @@ void Cmd_DFTodo_f(gentity_t *ent) {
 								"ON T1.coursename = T2.coursename AND T1.style = T2.style "
 							"WHERE T2.coursename IS NULL OR T2.style IS NULL) "	
 					"ORDER BY (entries-((entries/cast(rank as float))+(entries-rank)/2.0)) DESC LIMIT ?, 10";
-					CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+					G_DBPrepare(db, sql, &stmt);
 					CALL_SQLITE (bind_text (stmt, 1, username, -1, SQLITE_STATIC));
 					CALL_SQLITE (bind_text (stmt, 2, username, -1, SQLITE_STATIC));
 					CALL_SQLITE (bind_int (stmt, 3, start));
@@ -6353,7 +7766,7 @@ void Cmd_DFTodo_f(gentity_t *ent) {
 								"ON T1.coursename = T2.coursename AND T1.style = T2.style "
 							"WHERE T2.coursename IS NULL OR T2.style IS NULL) "	
 					"ORDER BY (entries-((entries/cast(rank as float))+(entries-rank)/2.0)) DESC LIMIT ?, 10";
-					CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+					G_DBPrepare(db, sql, &stmt);
 					CALL_SQLITE (bind_text (stmt, 1, username, -1, SQLITE_STATIC));
 					CALL_SQLITE (bind_int (stmt, 2, style));
 					CALL_SQLITE (bind_text (stmt, 3, partialCourseName, -1, SQLITE_STATIC));
@@ -6377,7 +7790,7 @@ void Cmd_DFTodo_f(gentity_t *ent) {
 								"ON T1.coursename = T2.coursename AND T1.style = T2.style "
 							"WHERE T2.coursename IS NULL OR T2.style IS NULL) "	
 					"ORDER BY (entries-((entries/cast(rank as float))+(entries-rank)/2.0)) DESC LIMIT ?, 10";
-					CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+					G_DBPrepare(db, sql, &stmt);
 					CALL_SQLITE (bind_text (stmt, 1, username, -1, SQLITE_STATIC));
 					CALL_SQLITE (bind_int (stmt, 2, style));
 					CALL_SQLITE (bind_int (stmt, 3, style));
@@ -6420,9 +7833,9 @@ void Cmd_DFTodo_f(gentity_t *ent) {
 			}
 		}
 		trap->SendServerCommand(ent-g_entities, va("print \"%s\"", msg));
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 
-		CALL_SQLITE (close(db));
+		G_DBRelease(db);
 	}
 
 }
@@ -6498,7 +7911,7 @@ void Cmd_DFPopular_f(gentity_t *ent) {
 		char msg[1024-128] = {0}, styleStr[16], entriesStr[16];
 		int s, row = 1;
 
-		CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+		db = G_DBAcquire();
 		if (style == -1) {
 			if (enteredUsername) {
 				if (season == -1) { //User
@@ -6508,7 +7921,7 @@ void Cmd_DFPopular_f(gentity_t *ent) {
 									"ON T1.coursename = T2.coursename AND T1.style = T2.style "
 								"WHERE T2.coursename IS NULL OR T2.style IS NULL "
 					"ORDER BY entries DESC LIMIT ?, 10";
-					CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+					G_DBPrepare(db, sql, &stmt);
 					CALL_SQLITE (bind_text (stmt, 1, username, -1, SQLITE_STATIC));
 					CALL_SQLITE (bind_int (stmt, 2, start));
 				}
@@ -6519,7 +7932,7 @@ void Cmd_DFPopular_f(gentity_t *ent) {
 									"ON T1.coursename = T2.coursename AND T1.style = T2.style "
 								"WHERE T2.coursename IS NULL OR T2.style IS NULL "
 					"ORDER BY season_entries DESC LIMIT ?, 10";
-					CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+					G_DBPrepare(db, sql, &stmt);
 					CALL_SQLITE (bind_int (stmt, 1, season));
 					CALL_SQLITE (bind_int (stmt, 2, season));
 					CALL_SQLITE (bind_text (stmt, 3, username, -1, SQLITE_STATIC));
@@ -6529,12 +7942,12 @@ void Cmd_DFPopular_f(gentity_t *ent) {
 			else {
 				if (season == -1) {
 					sql = "SELECT coursename, style, entries, username FROM LocalRun WHERE rank = 1 GROUP BY coursename, style ORDER BY entries DESC LIMIT ?, 10";
-					CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+					G_DBPrepare(db, sql, &stmt);
 					CALL_SQLITE (bind_int (stmt, 1, start));
 				}
 				else { //Season
 					sql = "SELECT coursename, style, season_entries, username FROM LocalRun WHERE season_rank = 1 AND season = ? GROUP BY coursename, style ORDER BY season_entries DESC LIMIT ?, 10";
-					CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+					G_DBPrepare(db, sql, &stmt);
 					CALL_SQLITE (bind_int (stmt, 1, season));
 					CALL_SQLITE (bind_int (stmt, 2, start));
 				}
@@ -6549,7 +7962,7 @@ void Cmd_DFPopular_f(gentity_t *ent) {
 									"ON T1.coursename = T2.coursename AND T1.style = T2.style "
 								"WHERE T2.coursename IS NULL OR T2.style IS NULL "
 					"ORDER BY entries DESC LIMIT ?, 10";
-					CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+					G_DBPrepare(db, sql, &stmt);
 					CALL_SQLITE (bind_int (stmt, 1, style));
 					CALL_SQLITE (bind_int (stmt, 2, style));
 					CALL_SQLITE (bind_text (stmt, 3, username, -1, SQLITE_STATIC));
@@ -6562,7 +7975,7 @@ void Cmd_DFPopular_f(gentity_t *ent) {
 									"ON T1.coursename = T2.coursename AND T1.style = T2.style "
 								"WHERE T2.coursename IS NULL OR T2.style IS NULL "
 					"ORDER BY season_entries DESC LIMIT ?, 10";
-					CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+					G_DBPrepare(db, sql, &stmt);
 					CALL_SQLITE (bind_int (stmt, 1, style));
 					CALL_SQLITE (bind_int (stmt, 2, season));
 					CALL_SQLITE (bind_int (stmt, 3, style));
@@ -6574,13 +7987,13 @@ void Cmd_DFPopular_f(gentity_t *ent) {
 			else {
 				if (season == -1) { //Style
 					sql = "SELECT coursename, style, entries, username FROM LocalRun WHERE rank = 1 AND style = ? GROUP BY coursename, style ORDER BY entries DESC LIMIT ?, 10";
-					CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+					G_DBPrepare(db, sql, &stmt);
 					CALL_SQLITE (bind_int (stmt, 1, style));
 					CALL_SQLITE (bind_int (stmt, 2, start));
 				}
 				else { //Style, season
 					sql = "SELECT coursename, style, season_entries, username FROM LocalRun WHERE season_rank = 1 AND style = ? AND season = ? GROUP BY coursename, style ORDER BY season_entries DESC LIMIT ?, 10";
-					CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+					G_DBPrepare(db, sql, &stmt);
 					CALL_SQLITE (bind_int (stmt, 1, style));
 					CALL_SQLITE (bind_int (stmt, 2, season));
 					CALL_SQLITE (bind_int (stmt, 3, start));
@@ -6616,9 +8029,9 @@ void Cmd_DFPopular_f(gentity_t *ent) {
 			}
 		}
 		trap->SendServerCommand(ent-g_entities, va("print \"%s\"", msg));
-		CALL_SQLITE (finalize(stmt));
+		G_DBFinalize(stmt);
 
-		CALL_SQLITE (close(db));
+		G_DBRelease(db);
 	}
 
 }
@@ -6683,9 +8096,9 @@ void Cmd_ACWhois_f( gentity_t *ent ) { //why does this crash sometimes..? condit
 		seeip = qtrue;
 	
 	if (whois) {
-		CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+		db = G_DBAcquire();
 		sql = "SELECT username FROM LocalAccount WHERE lastip = ?";
-		CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+		G_DBPrepare(db, sql, &stmt);
 	}
 
 	if (whois && seeip) {
@@ -6791,8 +8204,8 @@ void Cmd_ACWhois_f( gentity_t *ent ) { //why does this crash sometimes..? condit
 					}
 					else if (s != SQLITE_DONE) {
 						G_ErrorPrint("ERROR: SQL Select Failed (Cmd_ACWhois_f)", s);
-						CALL_SQLITE (finalize(stmt));
-						CALL_SQLITE (close(db));
+						G_DBFinalize(stmt);
+						G_DBRelease(db);
 						return;
 					}
 
@@ -6831,8 +8244,8 @@ void Cmd_ACWhois_f( gentity_t *ent ) { //why does this crash sometimes..? condit
 	}
 
 	if (whois) {
-		CALL_SQLITE (finalize(stmt));
-		CALL_SQLITE (close(db));
+		G_DBFinalize(stmt);
+		G_DBRelease(db);
 	}
 
 	trap->SendServerCommand(ent-g_entities, va("print \"%s\"", msg));
@@ -6846,7 +8259,7 @@ void InitGameAccountStuff( void ) { //Called every mapload , move the create tab
     sqlite3_stmt * stmt;
 	int s;
 
-	CALL_SQLITE (open (LOCAL_DB_PATH, & db));
+	db = G_DBAcquire();
 
 	//sqlite_exec(db, "VACUUM;", 0, 0);
 	//index LocalRun on RANK
@@ -6857,11 +8270,11 @@ void InitGameAccountStuff( void ) { //Called every mapload , move the create tab
 
 	sql = "CREATE TABLE IF NOT EXISTS LocalAccount(id INTEGER PRIMARY KEY, username VARCHAR(16), password VARCHAR(16), kills UNSIGNED SMALLINT, deaths UNSIGNED SMALLINT, "
 		"suicides UNSIGNED SMALLINT, captures UNSIGNED SMALLINT, returns UNSIGNED SMALLINT, racetime UNSIGNED INTEGER, lastlogin UNSIGNED INTEGER, created UNSIGNED INTEGER, lastip UNSIGNED INTEGER, flags UNSIGNED TINYINT, unlocks UNSIGNED INTEGER, master VARCHAR(16))";
-    CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+    G_DBPrepare(db, sql, &stmt);
 	s = sqlite3_step(stmt);
 	if (s != SQLITE_DONE)
 		G_ErrorPrint("ERROR: SQL Create Failed (InitGameAccountStuff 1)", s);
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
 #if 1//NEWRACERANKING
 	sql = "CREATE TABLE IF NOT EXISTS LocalRun(id INTEGER PRIMARY KEY, username VARCHAR(16), coursename VARCHAR(40), duration_ms UNSIGNED INTEGER, topspeed UNSIGNED SMALLINT, "
@@ -6870,53 +8283,54 @@ void InitGameAccountStuff( void ) { //Called every mapload , move the create tab
 	sql = "CREATE TABLE IF NOT EXISTS LocalRun(id INTEGER PRIMARY KEY, username VARCHAR(16), coursename VARCHAR(40), duration_ms UNSIGNED INTEGER, topspeed UNSIGNED SMALLINT, "
 		"average UNSIGNED SMALLINT, style UNSIGNED TINYINT, end_time UNSIGNED INTEGER)";
 #endif
-    CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+    G_DBPrepare(db, sql, &stmt);
 	s = sqlite3_step(stmt);
 	if (s != SQLITE_DONE)
 		G_ErrorPrint("ERROR: SQL Create Failed (InitGameAccountStuff 2)", s);
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
 	sql = "CREATE TABLE IF NOT EXISTS LocalDuel(id INTEGER PRIMARY KEY, winner VARCHAR(16), loser VARCHAR(16), duration UNSIGNED SMALLINT, "
 		"type UNSIGNED TINYINT, winner_hp UNSIGNED TINYINT, winner_shield UNSIGNED TINYINT, end_time UNSIGNED INTEGER, winner_elo DECIMAL(6,2), loser_elo DECIMAL(6,2), odds DECIMAL(9,2))";
-    CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+    G_DBPrepare(db, sql, &stmt);
 	s = sqlite3_step(stmt);
 	if (s != SQLITE_DONE)
 		G_ErrorPrint("ERROR: SQL Create Failed (InitGameAccountStuff 3)", s);
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
 	sql = "CREATE TABLE IF NOT EXISTS LocalTeam(id INTEGER PRIMARY KEY, name VARCHAR(16), tag VARCHAR(16), longname VARCHAR(24), flags UNSIGNED TINYINT)";
-    CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+    G_DBPrepare(db, sql, &stmt);
 	s = sqlite3_step(stmt);
 	if (s != SQLITE_DONE)
 		G_ErrorPrint("ERROR: SQL Create Failed (InitGameAccountStuff 4)", s);
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
 	sql = "CREATE TABLE IF NOT EXISTS LocalTeamAccount(id INTEGER PRIMARY KEY, team VARCHAR(16), account VARCHAR(16), flags UNSIGNED TINYINT)";
-    CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+    G_DBPrepare(db, sql, &stmt);
 	s = sqlite3_step(stmt);
 	if (s != SQLITE_DONE)
 		G_ErrorPrint("ERROR: SQL Create Failed (InitGameAccountStuff 5)", s);
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 
 #if _ELORANKING
 	/*
 	sql = "CREATE TABLE IF NOT EXISTS DuelRanks(id INTEGER PRIMARY KEY, username VARCHAR(16), type UNSIGNED SMALLINT, rank DECIMAL(6,2), TSSUM DECIMAL(9,2), count UNSIGNED INTEGER)"; //We only need like 2 decimal precision here so how do that in sqlite C? --todo
-    CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+    G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE_EXPECT (step (stmt), DONE);
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 	*/
 #endif
 
 #if 0//NEWRACERANKING
 	sql = "CREATE TABLE IF NOT EXISTS RaceRanks(id INTEGER PRIMARY KEY, username VARCHAR(16), style UNSIGNED SMALLINT, score DECIMAL(6,2), percentilesum DECIMAL(6,2), ranksum DECIMAL(6,2), golds UNSIGNED SMALLINT, silvers UNSIGNED SMALLINT, bronzes UNSIGNED SMALLINT, count UNSIGNED SMALLINT)"; //We only need like 2 decimal precision here so how do that in sqlite C? --todo
-    CALL_SQLITE (prepare_v2 (db, sql, strlen (sql) + 1, & stmt, NULL));
+    G_DBPrepare(db, sql, &stmt);
 	CALL_SQLITE_EXPECT (step (stmt), DONE);
-	CALL_SQLITE (finalize(stmt));
+	G_DBFinalize(stmt);
 #endif
 
-	CALL_SQLITE (close(db));
+	G_DBRelease(db);
 
 	CleanupLocalRun(); //Deletes useless shit from LocalRun database table
+	G_RaceCacheInit(); //Ranks and highscores of this maps courses
 #if !_NEWRACERANKING
 	G_AddToDBFromFile(); //Add last maps highscores
 #endif
@@ -6981,54 +8395,320 @@ void G_SpawnWarpLocationsFromCfg(void) //loda fixme
 	Com_Printf ("Loaded warp locations from %s\n", filename);
 }
 
-#if 0
-void AddRunToWebServer(RaceRecord_t record) 
-{ 
+#if _USE_CURL
+/*
+=============================================================================
 
-	//fetch_response();
+WEB SERVER SUBMISSION
 
-	CURL *curl;
-	char address[128], data[256], password[64];
-	CURLcode res;
+Runs are POSTed to sv_webServerPath through a curl multi handle that is
+polled once per frame from G_RunFrame, so a slow or unreachable web server
+never blocks the game.  At most MAX_HTTP_INFLIGHT transfers run at once, the
+rest wait in the queue.  Failed transfers are retried with an exponential
+backoff and dropped after MAX_HTTP_ATTEMPTS.  On map change or shutdown the
+queue is drained for up to sv_webServerShutdownWait ms, by default not at all
+so the game thread never waits on the web server, and whatever is left is
+dropped with a line in the security log.
 
+Note that curl_multi_perform only stays non-blocking during DNS lookups if
+libcurl was built with the threaded or c-ares resolver (the default on all
+our platforms), so prefer an IP address in sv_webServerPath otherwise.
 
-	Q_strncpyz(address, sv_webServerPath.string, sizeof(address));
-	Q_strncpyz(password, sv_webServerPassword.string, sizeof(password));
+=============================================================================
+*/
 
-	//Case, special chars matter? clean??  Encode coursename / username for html ?
+#define MAX_HTTP_REQUESTS		64	//queued + in flight
+#define MAX_HTTP_INFLIGHT		4
+#define MAX_HTTP_ATTEMPTS		5
+#define HTTP_RETRY_DELAY		2000	//ms, doubled for every failed attempt
+#define HTTP_CONNECT_TIMEOUT	5		//seconds
+#define HTTP_TIMEOUT			10		//seconds
+#define HTTP_SHUTDOWN_WAIT_MAX	1000	//ms, cap for sv_webServerShutdownWait
+
+typedef struct httpRequest_s {
+	qboolean	active;
+	CURL		*easy;			//non NULL while in flight
+	char		url[128];
+	char		data[512];		//CURLOPT_POSTFIELDS does not copy, so this has to live until the transfer is done
+	int			attempts;
+	int			nextAttempt;	//level.time
+} httpRequest_t;
+
+static CURLM			*httpMulti = NULL;
+static httpRequest_t	httpRequests[MAX_HTTP_REQUESTS];
+static int				httpInFlight = 0;
+static qboolean			httpDraining = qfalse;	//no more retries, G_HTTPShutdown is flushing the queue
+
+static size_t G_HTTPDiscardResponse( void *ptr, size_t size, size_t nmemb, void *userdata ) {
+	return size * nmemb;
+}
 
+static qboolean G_HTTPStart( httpRequest_t *req ) {
+	CURL *easy = curl_easy_init();
 
-	Q_strncpyz(record.username, "testuser", sizeof(record.username));
-	Q_strncpyz(record.coursename, "testcourse", sizeof(record.coursename));
-	record.duration_ms = 123456;
-	record.topspeed = 835;
-	record.average = 652;
-	record.style = 3;
-	record.end_timeInt = 26246234;
+	if ( !easy ) {
+		return qfalse;
+	}
 
+	curl_easy_setopt( easy, CURLOPT_URL, req->url );
+	curl_easy_setopt( easy, CURLOPT_POST, 1L );
+	curl_easy_setopt( easy, CURLOPT_POSTFIELDS, req->data );
+	curl_easy_setopt( easy, CURLOPT_NOSIGNAL, 1L ); //timeouts must not use SIGALRM in a game module
+	curl_easy_setopt( easy, CURLOPT_CONNECTTIMEOUT, (long)HTTP_CONNECT_TIMEOUT );
+	curl_easy_setopt( easy, CURLOPT_TIMEOUT, (long)HTTP_TIMEOUT );
+	curl_easy_setopt( easy, CURLOPT_WRITEFUNCTION, G_HTTPDiscardResponse );
+	curl_easy_setopt( easy, CURLOPT_PRIVATE, (char *)req );
 
-	Com_sprintf(data, sizeof(data), "username=%s&coursename=%s&duration_ms=%i&topspeed=%i&average=%i&style=%i&end_time=%i", 
-		record.username, record.coursename, record.duration_ms, record.topspeed, record.average, record.style, record.end_time);
+	if ( curl_multi_add_handle( httpMulti, easy ) != CURLM_OK ) {
+		curl_easy_cleanup( easy );
+		return qfalse;
+	}
 
-	curl_global_init(CURL_GLOBAL_ALL);
-	curl = curl_easy_init();
-	if (curl) {
-		curl_easy_setopt(curl, CURLOPT_VERBOSE, 1);
-		curl_easy_setopt(curl, CURLOPT_URL, address);
-		curl_easy_setopt(curl, CURLOPT_POST, 1);
-		curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data);
-		res = curl_easy_perform(curl); 
-	
-		if(res != CURLE_OK) 
-			fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res)); 
-		else 
-			trap->Print("cURL Worked?\n"); //de fuck izzat
+	req->easy = easy;
+	req->attempts++;
+	httpInFlight++;
+	return qtrue;
+}
+
+static void G_HTTPFinish( httpRequest_t *req, qboolean success, const char *error ) {
+	curl_multi_remove_handle( httpMulti, req->easy );
+	curl_easy_cleanup( req->easy );
+	req->easy = NULL;
+	httpInFlight--;
 
-		curl_easy_cleanup(curl);
+	if ( success ) {
+		req->active = qfalse;
 	}
-	else 
-		trap->Print("ERROR: Libcurl failed\n"); //de fuck izzat
+	else if ( req->attempts >= MAX_HTTP_ATTEMPTS || httpDraining ) {
+		G_SecurityLogPrintf( "ERROR: Giving up on web server request to %s after %i attempts (%s)\n", req->url, req->attempts, error );
+		req->active = qfalse;
+	}
+	else {
+		req->nextAttempt = level.time + (HTTP_RETRY_DELAY << (req->attempts - 1));
+	}
+}
+
+/*
+==================
+G_HTTPQueuePost
+
+Queues a POST request, returns qfalse if the queue is full.
+==================
+*/
+qboolean G_HTTPQueuePost( const char *url, const char *data ) {
+	int i;
+
+	if ( !httpMulti ) {
+		curl_global_init( CURL_GLOBAL_ALL );
+		httpMulti = curl_multi_init();
+		if ( !httpMulti ) {
+			trap->Print( "ERROR: Libcurl failed\n" );
+			return qfalse;
+		}
+	}
+
+	for ( i = 0; i < MAX_HTTP_REQUESTS; i++ ) {
+		httpRequest_t *req = &httpRequests[i];
+
+		if ( req->active ) {
+			continue;
+		}
+
+		memset( req, 0, sizeof( *req ) );
+		Q_strncpyz( req->url, url, sizeof( req->url ) );
+		Q_strncpyz( req->data, data, sizeof( req->data ) );
+		req->nextAttempt = level.time;
+		req->active = qtrue;
+		return qtrue;
+	}
+
+	G_SecurityLogPrintf( "ERROR: Web server request queue full, dropping request to %s\n", url );
+	return qfalse;
+}
+
+/*
+==================
+G_HTTPRunFrame
+
+Starts queued requests that are due, advances transfers without blocking and
+handles the ones that finished.  Called every frame from G_RunFrame.
+==================
+*/
+void G_HTTPRunFrame( void ) {
+	CURLMsg *msg;
+	int i, running, msgsLeft;
+
+	if ( !httpMulti ) {
+		return;
+	}
+
+	for ( i = 0; i < MAX_HTTP_REQUESTS && httpInFlight < MAX_HTTP_INFLIGHT; i++ ) {
+		httpRequest_t *req = &httpRequests[i];
+
+		if ( req->active && !req->easy && req->nextAttempt <= level.time ) {
+			if ( !G_HTTPStart( req ) ) {
+				break; //try again next frame
+			}
+		}
+	}
+
+	if ( !httpInFlight ) {
+		return;
+	}
+
+	while ( curl_multi_perform( httpMulti, &running ) == CURLM_CALL_MULTI_PERFORM )
+		;
 
+	while ( (msg = curl_multi_info_read( httpMulti, &msgsLeft )) != NULL ) {
+		httpRequest_t *req = NULL;
+		long code = 0;
 
-} 
-#endif
\ No newline at end of file
+		if ( msg->msg != CURLMSG_DONE ) {
+			continue;
+		}
+
+		curl_easy_getinfo( msg->easy_handle, CURLINFO_PRIVATE, (char **)&req );
+		if ( !req ) {
+			continue;
+		}
+
+		if ( msg->data.result != CURLE_OK ) {
+			G_HTTPFinish( req, qfalse, curl_easy_strerror( msg->data.result ) );
+			continue;
+		}
+
+		curl_easy_getinfo( msg->easy_handle, CURLINFO_RESPONSE_CODE, &code );
+		if ( code >= 500 ) { //server side trouble, worth retrying.  4xx means the request itself is bad
+			G_HTTPFinish( req, qfalse, "server error" );
+		}
+		else {
+			if ( code >= 400 )
+				G_SecurityLogPrintf( "ERROR: Web server rejected request to %s with HTTP %i\n", req->url, (int)code );
+			G_HTTPFinish( req, qtrue, NULL );
+		}
+	}
+}
+
+//Waits at most msec for activity on the transfers in flight.  curl_multi_wait is newer than our curl headers
+static void G_HTTPWait( int msec ) {
+	fd_set readfds, writefds, errfds;
+	struct timeval timeout;
+	int maxfd = -1;
+
+	FD_ZERO( &readfds );
+	FD_ZERO( &writefds );
+	FD_ZERO( &errfds );
+	if ( curl_multi_fdset( httpMulti, &readfds, &writefds, &errfds, &maxfd ) != CURLM_OK ) {
+		return;
+	}
+
+	timeout.tv_sec = 0;
+	timeout.tv_usec = msec * 1000;
+	select( maxfd + 1, &readfds, &writefds, &errfds, &timeout ); //no sockets yet while resolving, then this just sleeps
+}
+
+static int G_HTTPPending( void ) {
+	int i, pending = 0;
+
+	for ( i = 0; i < MAX_HTTP_REQUESTS; i++ ) {
+		if ( httpRequests[i].active ) {
+			pending++;
+		}
+	}
+	return pending;
+}
+
+/*
+==================
+G_HTTPShutdown
+
+Gives everything still queued or in flight one last attempt, waiting at most
+sv_webServerShutdownWait ms, then cancels whatever is left.  Called from
+G_ShutdownGame.
+==================
+*/
+void G_HTTPShutdown( void ) {
+	int i, dropped = 0;
+	const int deadline = trap->Milliseconds() + Com_Clampi( 0, HTTP_SHUTDOWN_WAIT_MAX, sv_webServerShutdownWait.integer );
+
+	if ( !httpMulti ) {
+		return;
+	}
+
+	httpDraining = qtrue;
+	for ( i = 0; i < MAX_HTTP_REQUESTS; i++ ) {
+		httpRequests[i].nextAttempt = level.time; //skip the backoff, level.time stands still from here on
+	}
+
+	while ( trap->Milliseconds() < deadline ) {
+		G_HTTPRunFrame();
+		if ( !httpInFlight ) {
+			if ( !G_HTTPPending() ) {
+				break;
+			}
+			G_HTTPRunFrame(); //the last batch just finished, start the next one
+			if ( !httpInFlight ) {
+				break; //curl won't take any more
+			}
+		}
+		G_HTTPWait( 50 );
+	}
+	httpDraining = qfalse;
+
+	for ( i = 0; i < MAX_HTTP_REQUESTS; i++ ) {
+		httpRequest_t *req = &httpRequests[i];
+
+		if ( req->easy ) {
+			curl_multi_remove_handle( httpMulti, req->easy );
+			curl_easy_cleanup( req->easy );
+		}
+		if ( req->active ) {
+			char *password = strstr( req->data, "&password=" );
+
+			if ( password ) {
+				*password = '\0'; //keep the secret out of the log
+			}
+			G_SecurityLogPrintf( "Dropped unsent web server request to %s: %s\n", req->url, req->data );
+			dropped++;
+		}
+	}
+	memset( httpRequests, 0, sizeof( httpRequests ) );
+	httpInFlight = 0;
+
+	if ( dropped ) {
+		G_SecurityLogPrintf( "Cancelled %i unsent web server requests on shutdown\n", dropped );
+	}
+
+	curl_multi_cleanup( httpMulti );
+	httpMulti = NULL;
+	curl_global_cleanup();
+}
+
+void G_AddRunToWebServer( const char *username, const char *coursename, int duration_ms, int topspeed, int average, int style, int end_time ) {
+	char data[512], *user, *course;
+	CURL *escaper;
+
+	if ( !sv_webServerPath.string[0] ) {
+		return;
+	}
+
+	escaper = curl_easy_init();
+	if ( !escaper ) {
+		trap->Print( "ERROR: Libcurl failed\n" );
+		return;
+	}
+
+	user = curl_easy_escape( escaper, username, 0 );
+	course = curl_easy_escape( escaper, coursename, 0 );
+
+	if ( user && course ) {
+		Com_sprintf( data, sizeof( data ), "username=%s&coursename=%s&duration_ms=%i&topspeed=%i&average=%i&style=%i&end_time=%i&password=%s",
+			user, course, duration_ms, topspeed, average, style, end_time, sv_webServerPassword.string );
+		G_HTTPQueuePost( sv_webServerPath.string, data );
+	}
+
+	curl_free( user );
+	curl_free( course );
+	curl_easy_cleanup( escaper );
+}
+#endif
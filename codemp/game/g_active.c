@@ -47,6 +47,65 @@ void P_SetTwitchInfo(gclient_t	*client)
 	client->ps.painDirection ^= 1;
 }
 
+/*
+Origin trails of every client, kept out of gclient_t in one block with an
+array per field (struct of arrays).  A client's timestamps are contiguous so
+G_TrailSearch can binary search them, and G_TimeShiftClients gathers the
+bounds it needs into per component rows to lerp every client in one pass.
+Slots are a ring per client, clientHistory.head is the newest one.
+*/
+#define TRAIL_BOUNDS	9 //origin, mins, maxs
+
+typedef struct {
+	int				head[MAX_CLIENTS];
+	int				time[MAX_CLIENTS][NUM_CLIENT_TRAILS];
+	int				leveltime[MAX_CLIENTS][NUM_CLIENT_TRAILS];
+	float			bounds[MAX_CLIENTS][NUM_CLIENT_TRAILS][TRAIL_BOUNDS];
+	int				torsoAnim[MAX_CLIENTS][NUM_CLIENT_TRAILS];
+	int				torsoTimer[MAX_CLIENTS][NUM_CLIENT_TRAILS];
+	int				legsAnim[MAX_CLIENTS][NUM_CLIENT_TRAILS];
+	int				legsTimer[MAX_CLIENTS][NUM_CLIENT_TRAILS];
+	float			realAngle[MAX_CLIENTS][NUM_CLIENT_TRAILS];
+	clientTrail_t	saved[MAX_CLIENTS]; // used to restore after time shift
+} clientHistory_t;
+
+static clientHistory_t clientHistory;
+
+/*
+With UNLAGGED_LAZY a shot doesn't move anyone, the lerped bounds of the
+clients along it are handed to the engine with the trace (G_UnlaggedTrace)
+and only a client that actually gets hit is shifted for the damage code.
+*/
+typedef struct {
+	qboolean		active;
+	qboolean		anims;
+	int				numRewind;
+	traceRewind_t	rewind[MAX_CLIENTS];
+	int				from[MAX_CLIENTS], to[MAX_CLIENTS];
+	float			frac[MAX_CLIENTS];
+} lazyShift_t;
+
+static lazyShift_t lazyShift;
+
+static void G_FillTrail( gentity_t *ent, int slot, int time ) {
+	const int	clientNum = ent->s.number;
+	float		*bounds = clientHistory.bounds[clientNum][slot];
+
+	VectorCopy( ent->r.currentOrigin, bounds );
+	VectorCopy( ent->r.mins, bounds + 3 );
+	VectorCopy( ent->r.maxs, bounds + 6 );
+	//VectorCopy( ent->r.currentAngles, ... ); //Well r.currentAngles are never actually used by clients in this game?
+
+	clientHistory.torsoAnim[clientNum][slot] = ent->client->ps.torsoAnim;
+	clientHistory.torsoTimer[clientNum][slot] = ent->client->ps.torsoTimer;
+	clientHistory.legsAnim[clientNum][slot] = ent->client->ps.legsAnim;
+	clientHistory.legsTimer[clientNum][slot] = ent->client->ps.legsTimer;
+	clientHistory.realAngle[clientNum][slot] = ent->s.apos.trBase[YAW];
+
+	clientHistory.leveltime[clientNum][slot] = level.time;
+	clientHistory.time[clientNum][slot] = time;
+}
+
 /*
 ============
 G_ResetTrail
@@ -58,22 +117,16 @@ the teleport bit is toggled)
 void G_ResetTrail( gentity_t *ent ) {
 	int		i, time;
 
+	if ( ent->s.number >= MAX_CLIENTS ) //NPCs are never time shifted
+		return;
+
+	clientHistory.saved[ent->s.number].leveltime = 0;
+
 	// fill up the origin trails with data (assume the current position for the last 1/2 second or so)
-	ent->client->unlagged.trailHead = numTrails - 1;
-	for ( i = ent->client->unlagged.trailHead, time = level.time; i >= 0; i--, time -= frametime ) {
-		VectorCopy( ent->r.mins, ent->client->unlagged.trail[i].mins );
-		VectorCopy( ent->r.maxs, ent->client->unlagged.trail[i].maxs );
-		VectorCopy( ent->r.currentOrigin, ent->client->unlagged.trail[i].currentOrigin );
-		//VectorCopy( ent->r.currentAngles, ent->client->unlagged.trail[i].currentAngles );
-
-		ent->client->unlagged.trail[i].torsoAnim = ent->client->ps.torsoAnim;
-		ent->client->unlagged.trail[i].torsoTimer = ent->client->ps.torsoTimer;
-		ent->client->unlagged.trail[i].legsAnim = ent->client->ps.legsAnim;
-		ent->client->unlagged.trail[i].legsTimer = ent->client->ps.legsTimer;
-		ent->client->unlagged.trail[i].realAngle = ent->s.apos.trBase[YAW];
-
-		ent->client->unlagged.trail[i].leveltime = time;
-		ent->client->unlagged.trail[i].time = time;
+	clientHistory.head[ent->s.number] = numTrails - 1;
+	for ( i = numTrails - 1, time = level.time; i >= 0; i--, time -= frametime ) {
+		G_FillTrail( ent, i, time );
+		clientHistory.leveltime[ent->s.number][i] = time;
 	}
 }
 
@@ -87,20 +140,24 @@ Keep track of where the client's been (usually called every ClientThink)
 */
 void G_StoreTrail( gentity_t *ent ) {
 	int		head, newtime;
+	const int clientNum = ent->s.number;
 
-	head = ent->client->unlagged.trailHead;
+	if ( clientNum >= MAX_CLIENTS )
+		return;
+
+	head = clientHistory.head[clientNum];
 
 	// if we're on a new frame
-	if ( ent->client->unlagged.trail[head].leveltime < level.time ) {
+	if ( clientHistory.leveltime[clientNum][head] < level.time ) {
 		// snap the last head up to the end of frame time
-		ent->client->unlagged.trail[head].time = level.previousTime;
+		clientHistory.time[clientNum][head] = level.previousTime;
 
 		// increment the head
-		ent->client->unlagged.trailHead++;
-		if ( ent->client->unlagged.trailHead >= numTrails ) {
-			ent->client->unlagged.trailHead = 0;
+		head++;
+		if ( head >= numTrails ) {
+			head = 0;
 		}
-		head = ent->client->unlagged.trailHead;
+		clientHistory.head[clientNum] = head;
 	}
 
 	if ( ent->r.svFlags & SVF_BOT ) {
@@ -118,22 +175,7 @@ void G_StoreTrail( gentity_t *ent ) {
 	}
 
 	// store all the collision-detection info and the time
-	VectorCopy( ent->r.mins, ent->client->unlagged.trail[head].mins );
-	VectorCopy( ent->r.maxs, ent->client->unlagged.trail[head].maxs );
-	VectorCopy( ent->r.currentOrigin, ent->client->unlagged.trail[head].currentOrigin );
-	//VectorCopy( ent->r.currentAngles, ent->client->unlagged.trail[head].currentAngles );
-
-	ent->client->unlagged.trail[head].torsoAnim = ent->client->ps.torsoAnim;
-	ent->client->unlagged.trail[head].torsoTimer = ent->client->ps.torsoTimer;
-	ent->client->unlagged.trail[head].legsAnim = ent->client->ps.legsAnim;
-	ent->client->unlagged.trail[head].legsTimer = ent->client->ps.legsTimer;
-	ent->client->unlagged.trail[head].realAngle = ent->s.apos.trBase[YAW];
-
-	//if (ent->client->unlagged.trail[head].currentAngles[0] || ent->client->unlagged.trail[head].currentAngles[1] || ent->client->unlagged.trail[head].currentAngles[2])
-		//Com_Printf("Current angles are %.2f %.2f %.2f\n", ent->client->unlagged.trail[head].currentAngles[0], ent->client->unlagged.trail[head].currentAngles[1], ent->client->unlagged.trail[head].currentAngles[2]);
-
-	ent->client->unlagged.trail[head].leveltime = level.time;
-	ent->client->unlagged.trail[head].time = newtime;
+	G_FillTrail( ent, head, newtime );
 
 	//Also store their anim info? Since with ghoul2 collision that matters..
 
@@ -252,149 +294,209 @@ static void G_DrawPlayerStick(gentity_t *ent, int color, int duration, int time)
 
 /*
 =================
-G_TimeShiftClient
+G_TrailSearch
 
-Move a client back to where he was at the specified "time"
+Binary search of a client's trail for the newest slot stored at or before
+"time", counted from the oldest slot.  -1 if every slot is newer.
 =================
 */
-void G_TimeShiftClient( gentity_t *ent, int time, qboolean timeshiftAnims ) {
-	int		j, k;
+static int G_TrailSearch( int clientNum, int time ) {
+	const int	*times = clientHistory.time[clientNum];
+	const int	oldest = clientHistory.head[clientNum] + 1;
+	int			low = 0, high = numTrails - 1, found = -1;
 
-	if ( time > level.time ) {
-		time = level.time;
+	while ( low <= high ) {
+		const int mid = (low + high) >> 1;
+
+		if ( times[(oldest + mid) % numTrails] <= time ) {
+			found = mid;
+			low = mid + 1;
+		}
+		else {
+			high = mid - 1;
+		}
+	}
+	return found;
+}
+
+/*
+=================
+G_TrailSandwich
+
+Finds the two trail slots whose times sandwich "time" and how far between them
+it is.  Returns qfalse if the client is already where it was at "time".  If the
+trail is too short both slots are the earliest one, with a frac of 1.
+=================
+*/
+static qboolean G_TrailSandwich( int clientNum, int time, int *j, int *k, float *frac ) {
+	const int	found = G_TrailSearch( clientNum, time );
+	const int	oldest = clientHistory.head[clientNum] + 1;
+
+	if ( found == numTrails - 1 ) //newest slot is old enough
+		return qfalse;
+
+	if ( found < 0 ) { // we wrapped, so grab the earliest
+		*j = *k = oldest % numTrails;
+		*frac = 1.0f;
+		return qtrue;
 	}
 
-	// find two entries in the origin trail whose times sandwich "time"
 	// assumes no two adjacent trail records have the same timestamp
-	j = k = ent->client->unlagged.trailHead;
-	do {
-		if ( ent->client->unlagged.trail[j].time <= time )
-			break;
+	*j = (oldest + found) % numTrails;
+	*k = (oldest + found + 1) % numTrails;
+	*frac = (float)(clientHistory.time[clientNum][*k] - time) / (float)(clientHistory.time[clientNum][*k] - clientHistory.time[clientNum][*j]);
+	return qtrue;
+}
 
-		k = j;
-		j--;
-		if ( j < 0 ) {
-			j = numTrails - 1;
+/*
+=================
+G_ApplyTimeShift
+
+Saves the client's current position once per frame, then moves it to the lerped trail position
+=================
+*/
+static void G_ApplyTimeShift( gentity_t *ent, const vec3_t origin, const vec3_t mins, const vec3_t maxs, int j, int k, float frac, qboolean timeshiftAnims ) {
+	const int		clientNum = ent->s.number;
+	clientTrail_t	*saved = &clientHistory.saved[clientNum];
+
+	// make sure it doesn't get re-saved
+	if ( saved->leveltime != level.time ) {
+		// save the current origin and bounding box
+		VectorCopy( ent->r.mins, saved->mins );
+		VectorCopy( ent->r.maxs, saved->maxs );
+		VectorCopy( ent->r.currentOrigin, saved->currentOrigin );
+		//VectorCopy( ent->r.currentAngles, saved->currentAngles );
+
+		if (timeshiftAnims) {
+			saved->torsoAnim = ent->client->ps.torsoAnim;
+			saved->torsoTimer = ent->client->ps.torsoTimer;
+			saved->legsAnim = ent->client->ps.legsAnim;
+			saved->legsTimer = ent->client->ps.legsTimer;
+			saved->realAngle = ent->s.apos.trBase[YAW];
 		}
+
+		saved->leveltime = level.time;
+	}
+
+#if 1
+	if (g_unlagged.integer & (1<<3)) {
+		G_DrawPlayerStick(ent, 0x0000ff, 5000, level.time);
+		//Com_Printf("pre angle is %.2f\n", ent->s.apos.trBase[YAW]);
 	}
-	while ( j != ent->client->unlagged.trailHead );
+#endif
 
-	// if we got past the first iteration above, we've sandwiched (or wrapped)
-	if ( j != k ) {
-		// make sure it doesn't get re-saved
-		if ( ent->client->unlagged.saved.leveltime != level.time ) {
-			// save the current origin and bounding box
-			VectorCopy( ent->r.mins, ent->client->unlagged.saved.mins );
-			VectorCopy( ent->r.maxs, ent->client->unlagged.saved.maxs );
-			VectorCopy( ent->r.currentOrigin, ent->client->unlagged.saved.currentOrigin );
-			//VectorCopy( ent->r.currentAngles, ent->client->unlagged.saved.currentAngles );
+	// shift the client's position back to where he was at "time"
+	VectorCopy( origin, ent->r.currentOrigin );
+	VectorCopy( mins, ent->r.mins );
+	VectorCopy( maxs, ent->r.maxs );
 
-			if (timeshiftAnims) {
-				ent->client->unlagged.saved.torsoAnim = ent->client->ps.torsoAnim;
-				ent->client->unlagged.saved.torsoTimer = ent->client->ps.torsoTimer;
-				ent->client->unlagged.saved.legsAnim = ent->client->ps.legsAnim;
-				ent->client->unlagged.saved.legsTimer = ent->client->ps.legsTimer;
-				ent->client->unlagged.saved.realAngle = ent->s.apos.trBase[YAW];
-			}
+	//Lerp this somehow?
+	if (timeshiftAnims) {
+		ent->client->ps.torsoAnim = clientHistory.torsoAnim[clientNum][k];
+		ent->client->ps.legsAnim = clientHistory.legsAnim[clientNum][k];
+		TimeShiftAnimLerp(frac, clientHistory.torsoAnim[clientNum][j], clientHistory.torsoAnim[clientNum][k], clientHistory.torsoTimer[clientNum][j], clientHistory.torsoTimer[clientNum][k], &ent->client->ps.torsoTimer);
+		TimeShiftAnimLerp(frac, clientHistory.legsAnim[clientNum][j], clientHistory.legsAnim[clientNum][k], clientHistory.legsTimer[clientNum][j], clientHistory.legsTimer[clientNum][k], &ent->client->ps.legsTimer);
+		ent->s.apos.trBase[YAW] = LerpAngle( clientHistory.realAngle[clientNum][k], clientHistory.realAngle[clientNum][j], frac );
+	}
 
-			ent->client->unlagged.saved.leveltime = level.time;
-		}
+	// this will recalculate absmin and absmax
+	trap->LinkEntity( (sharedEntity_t *)ent );
 
 #if 1
-		if (g_unlagged.integer & (1<<3)) {
-			G_DrawPlayerStick(ent, 0x0000ff, 5000, level.time);
-			//Com_Printf("pre angle is %.2f\n", ent->s.apos.trBase[YAW]);
-		}
+	if (g_unlagged.integer & (1<<3)) {
+		G_DrawPlayerStick(ent, 0x00ff00, 5000, level.time);
+		//Com_Printf("post angle is %.2f\n", ent->s.apos.trBase[YAW]);
+	}
 #endif
+}
 
-		// if we haven't wrapped back to the head, we've sandwiched, so
-		// we shift the client's position back to where he was at "time"
-		if ( j != ent->client->unlagged.trailHead )
-		{
-			float	frac = (float)(ent->client->unlagged.trail[k].time - time) / (float)(ent->client->unlagged.trail[k].time - ent->client->unlagged.trail[j].time);
+/*
+=================
+G_TimeShiftClient
 
-			// FOR TESTING ONLY
-			//Com_Printf( "level time: %d, fire time: %d, j time: %d, k time: %d\n", level.time, time, ent->client->unlagged.trail[j].time, ent->client->unlagged.trail[k].time );
+Move a client back to where he was at the specified "time"
+=================
+*/
+void G_TimeShiftClient( gentity_t *ent, int time, qboolean timeshiftAnims ) {
+	const int	clientNum = ent->s.number;
+	vec3_t		origin, mins, maxs;
+	float		frac;
+	int			j, k;
 
-			// interpolate between the two origins to give position at time index "time"
-			TimeShiftLerp( frac, ent->client->unlagged.trail[k].currentOrigin, ent->client->unlagged.trail[j].currentOrigin, ent->r.currentOrigin );
-			//ent->r.currentAngles[YAW] = LerpAngle( ent->client->unlagged.trail[k].currentAngles[YAW], ent->r.currentAngles[YAW], frac );
+	if ( clientNum >= MAX_CLIENTS )
+		return;
 
-			// lerp these too, just for fun (and ducking)
-			TimeShiftLerp( frac, ent->client->unlagged.trail[k].mins, ent->client->unlagged.trail[j].mins, ent->r.mins );
-			TimeShiftLerp( frac, ent->client->unlagged.trail[k].maxs, ent->client->unlagged.trail[j].maxs, ent->r.maxs );
-			
-			//Lerp this somehow?
-			if (timeshiftAnims) {
-				/*
-				Com_Printf("Lerp timeshifting client %s. Old anim = %i %i (times %i %i).  New Anim = %i %i (times %i %i).\n", 
-					ent->client->pers.netname,
-					ent->client->ps.torsoAnim, ent->client->ps.legsAnim, ent->client->ps.torsoTimer, ent->client->ps.legsTimer, 
-					ent->client->unlagged.trail[k].torsoAnim, ent->client->unlagged.trail[k].legsAnim, ent->client->unlagged.trail[k].torsoTimer, ent->client->unlagged.trail[k].legsTimer);
-				*/
+	if ( time > level.time ) {
+		time = level.time;
+	}
 
-				ent->client->ps.torsoAnim = ent->client->unlagged.trail[k].torsoAnim;
-				ent->client->ps.legsAnim = ent->client->unlagged.trail[k].legsAnim;
-				TimeShiftAnimLerp(frac, ent->client->unlagged.trail[j].torsoAnim, ent->client->unlagged.trail[k].torsoAnim, ent->client->unlagged.trail[j].torsoTimer, ent->client->unlagged.trail[k].torsoTimer,  &ent->client->ps.torsoTimer);
-				TimeShiftAnimLerp(frac, ent->client->unlagged.trail[j].legsAnim, ent->client->unlagged.trail[k].legsAnim, ent->client->unlagged.trail[j].legsTimer, ent->client->unlagged.trail[k].legsTimer, &ent->client->ps.legsTimer);
-				//ent->s.apos.trBase[YAW] = LerpAngle( ent->client->unlagged.trail[k].realAngle, ent->s.apos.trBase[YAW], frac ); //Shouldnt this be lerping between k and j instead of k and trbase ?
-				ent->s.apos.trBase[YAW] = LerpAngle( ent->client->unlagged.trail[k].realAngle, ent->client->unlagged.trail[j].realAngle, frac ); //Shouldnt this be lerping between k and j instead of k and trbase ?
+	if ( !G_TrailSandwich( clientNum, time, &j, &k, &frac ) )
+		return;
 
-				//Com_Printf("j angle is %.2f k angle is %.2f frac is %.2f\n", ent->client->unlagged.trail[j].realAngle, ent->client->unlagged.trail[k].realAngle, frac);
-				//Com_Printf("interp angle is %.2f\n", LerpAngle( ent->client->unlagged.trail[j].realAngle, ent->client->unlagged.trail[k].realAngle, frac ));
-			}
+	// interpolate between the two origins to give position at time index "time"
+	TimeShiftLerp( frac, clientHistory.bounds[clientNum][k], clientHistory.bounds[clientNum][j], origin );
+	// lerp these too, just for fun (and ducking)
+	TimeShiftLerp( frac, clientHistory.bounds[clientNum][k] + 3, clientHistory.bounds[clientNum][j] + 3, mins );
+	TimeShiftLerp( frac, clientHistory.bounds[clientNum][k] + 6, clientHistory.bounds[clientNum][j] + 6, maxs );
 
-			// this will recalculate absmin and absmax
-			trap->LinkEntity( (sharedEntity_t *)ent );
-		} else {
-			// we wrapped, so grab the earliest
-			//VectorCopy( ent->client->unlagged.trail[k].currentAngles, ent->r.currentAngles );
-			VectorCopy( ent->client->unlagged.trail[k].currentOrigin, ent->r.currentOrigin );
-			VectorCopy( ent->client->unlagged.trail[k].mins, ent->r.mins );
-			VectorCopy( ent->client->unlagged.trail[k].maxs, ent->r.maxs );
+	G_ApplyTimeShift( ent, origin, mins, maxs, j, k, frac, timeshiftAnims );
+}
 
-			if (timeshiftAnims) {
-				/*
-				Com_Printf("Timeshifting client %s. Old anim = %i %i (times %i %i).  New Anim = %i %i (times %i %i).\n", 
-					ent->client->pers.netname,
-					ent->client->ps.torsoAnim, ent->client->ps.legsAnim, ent->client->ps.torsoTimer, ent->client->ps.legsTimer, 
-					ent->client->unlagged.trail[k].torsoAnim, ent->client->unlagged.trail[k].legsAnim, ent->client->unlagged.trail[k].torsoTimer, ent->client->unlagged.trail[k].legsTimer);
-				*/
+//Slab test of the segment against a box grown by radius
+static qboolean G_SegmentTouchesBox( const vec3_t start, const vec3_t end, const vec3_t mins, const vec3_t maxs, float radius ) {
+	float	enter = 0.0f, leave = 1.0f;
+	int		i;
 
-				ent->client->ps.torsoAnim = ent->client->unlagged.trail[k].torsoAnim;
-				ent->client->ps.torsoTimer = ent->client->unlagged.trail[k].torsoTimer;
-				ent->client->ps.legsAnim = ent->client->unlagged.trail[k].legsAnim;
-				ent->client->ps.legsTimer = ent->client->unlagged.trail[k].legsTimer;
-				ent->s.apos.trBase[YAW] = ent->client->unlagged.trail[k].realAngle;
-			}
+	for ( i = 0; i < 3; i++ ) {
+		const float delta = end[i] - start[i];
+		const float low = mins[i] - radius, high = maxs[i] + radius;
+		float t1, t2;
 
-			// this will recalculate absmin and absmax
-			trap->LinkEntity( (sharedEntity_t *)ent );
+		if ( fabs( delta ) < 0.0001f ) {
+			if ( start[i] < low || start[i] > high )
+				return qfalse;
+			continue;
 		}
 
-#if 1
-		if (g_unlagged.integer & (1<<3)) {
-			G_DrawPlayerStick(ent, 0x00ff00, 5000, level.time);
-			//Com_Printf("post angle is %.2f\n", ent->s.apos.trBase[YAW]);
+		t1 = (low - start[i]) / delta;
+		t2 = (high - start[i]) / delta;
+		if ( t1 > t2 ) {
+			const float swap = t1;
+			t1 = t2;
+			t2 = swap;
 		}
-#endif
-
-
+		if ( t1 > enter )
+			enter = t1;
+		if ( t2 < leave )
+			leave = t2;
+		if ( enter > leave )
+			return qfalse;
 	}
+	return qtrue;
 }
 
 /*
 =====================
-G_TimeShiftAllClients
+G_TimeShiftClients
 
-Move ALL clients back to where they were at the specified "time",
-except for "skip"
+Shared by G_TimeShiftAllClients and G_TimeShiftClientsAlongRay.  Every client
+that needs it is searched and its two trail samples are gathered, then the
+bounds of all of them are lerped together in flat per component rows the
+compiler can vectorize.  With a segment, only clients whose current or shifted
+box can touch it are moved and relinked, the trace can't hit the others either way.
 =====================
 */
-void G_TimeShiftAllClients( int time, gentity_t *skip, qboolean timeshiftAnims ) {
-	int			i;
+static void G_TimeShiftClients( int time, gentity_t *skip, qboolean timeshiftAnims, const vec3_t start, const vec3_t end, float radius ) {
+	int			i, c, numShifted = 0;
+	int			clientNums[MAX_CLIENTS], from[MAX_CLIENTS], to[MAX_CLIENTS];
+	float		frac[MAX_CLIENTS];
+	float		older[TRAIL_BOUNDS][MAX_CLIENTS], newer[TRAIL_BOUNDS][MAX_CLIENTS], shifted[TRAIL_BOUNDS][MAX_CLIENTS];
 	gentity_t	*ent;
 
+	lazyShift.active = (qboolean)(start && (g_unlagged.integer & UNLAGGED_LAZY) && trap->TraceRewound);
+	lazyShift.anims = timeshiftAnims;
+	lazyShift.numRewind = 0;
+
 	if (!skip->client)
 		return;
 	if (skip->r.svFlags & SVF_BOT)
@@ -413,12 +515,127 @@ void G_TimeShiftAllClients( int time, gentity_t *skip, qboolean timeshiftAnims )
 	// for every client
 	ent = &g_entities[0];
 	for ( i = 0; i < MAX_CLIENTS; i++, ent++ ) {
-		if ( ent->client && ent->inuse && ent->client->sess.sessionTeam < TEAM_SPECTATOR && ent != skip ) {
-			G_TimeShiftClient( ent, time, timeshiftAnims );
+		const float *sampleJ, *sampleK;
+
+		if ( !ent->client || !ent->inuse || ent->client->sess.sessionTeam >= TEAM_SPECTATOR || ent == skip )
+			continue;
+		if ( !G_TrailSandwich( i, time, &from[numShifted], &to[numShifted], &frac[numShifted] ) )
+			continue;
+
+		sampleJ = clientHistory.bounds[i][from[numShifted]];
+		sampleK = clientHistory.bounds[i][to[numShifted]];
+		for ( c = 0; c < TRAIL_BOUNDS; c++ ) {
+			newer[c][numShifted] = sampleK[c];
+			older[c][numShifted] = sampleJ[c];
 		}
+		clientNums[numShifted++] = i;
+	}
+
+	// same as TimeShiftLerp, for every component of every client at once
+	for ( c = 0; c < TRAIL_BOUNDS; c++ ) {
+		const float *k = newer[c], *j = older[c];
+		float *out = shifted[c];
+
+		for ( i = 0; i < numShifted; i++ ) {
+			out[i] = frac[i] * k[i] + (1.0f - frac[i]) * j[i];
+		}
+	}
+
+	for ( i = 0; i < numShifted; i++ ) {
+		vec3_t origin, mins, maxs;
+
+		ent = &g_entities[clientNums[i]];
+		VectorSet( origin, shifted[0][i], shifted[1][i], shifted[2][i] );
+		VectorSet( mins, shifted[3][i], shifted[4][i], shifted[5][i] );
+		VectorSet( maxs, shifted[6][i], shifted[7][i], shifted[8][i] );
+
+		if ( start ) {
+			vec3_t absmin, absmax;
+
+			VectorAdd( origin, mins, absmin );
+			VectorAdd( origin, maxs, absmax );
+			// LinkEntity grows absmin/absmax by 1
+			if ( !G_SegmentTouchesBox( start, end, ent->r.absmin, ent->r.absmax, radius ) && !G_SegmentTouchesBox( start, end, absmin, absmax, radius + 1.0f ) )
+				continue;
+		}
+
+		if ( lazyShift.active ) {
+			const int n = lazyShift.numRewind++;
+			traceRewind_t *rewind = &lazyShift.rewind[n];
+
+			rewind->entityNum = clientNums[i];
+			VectorCopy( origin, rewind->origin );
+			VectorCopy( mins, rewind->mins );
+			VectorCopy( maxs, rewind->maxs );
+			if ( timeshiftAnims )
+				rewind->yaw = LerpAngle( clientHistory.realAngle[clientNums[i]][to[i]], clientHistory.realAngle[clientNums[i]][from[i]], frac[i] );
+			else
+				rewind->yaw = ent->s.apos.trBase[YAW];
+			lazyShift.from[n] = from[i];
+			lazyShift.to[n] = to[i];
+			lazyShift.frac[n] = frac[i];
+			continue;
+		}
+
+		G_ApplyTimeShift( ent, origin, mins, maxs, from[i], to[i], frac[i], timeshiftAnims );
 	}
 }
 
+/*
+=====================
+G_TimeShiftAllClients
+
+Move ALL clients back to where they were at the specified "time",
+except for "skip"
+=====================
+*/
+void G_TimeShiftAllClients( int time, gentity_t *skip, qboolean timeshiftAnims ) {
+	G_TimeShiftClients( time, skip, timeshiftAnims, NULL, NULL, 0.0f );
+}
+
+/*
+=====================
+G_TimeShiftClientsAlongRay
+
+G_TimeShiftAllClients for a shot, only clients that can be hit by a trace from
+start to end with a box of "radius" are moved.  Undo with G_UnTimeShiftAllClients.
+=====================
+*/
+void G_TimeShiftClientsAlongRay( int time, gentity_t *skip, qboolean timeshiftAnims, const vec3_t start, const vec3_t end, float radius ) {
+	G_TimeShiftClients( time, skip, timeshiftAnims, start, end, radius );
+}
+
+
+/*
+=====================
+G_UnlaggedTrace
+
+Used by JP_Trace between G_TimeShiftClientsAlongRay and G_UnTimeShiftAllClients
+when the shift was deferred.  The engine clips the rewound clients where they
+were without relinking them, then the client that was hit (if any) is really
+shifted so hit locations, dodges and knockback see the same position.
+Returns qfalse if there is nothing deferred and the caller should trace normally.
+=====================
+*/
+qboolean G_UnlaggedTrace( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule, int traceFlags, int useLod ) {
+	int i;
+
+	if ( !lazyShift.active )
+		return qfalse;
+
+	trap->TraceRewound( results, start, mins, maxs, end, passEntityNum, contentmask, capsule, traceFlags, useLod, lazyShift.rewind, lazyShift.numRewind );
+
+	for ( i = 0; i < lazyShift.numRewind; i++ ) {
+		const traceRewind_t *rewind = &lazyShift.rewind[i];
+
+		if ( rewind->entityNum == results->entityNum ) {
+			G_ApplyTimeShift( &g_entities[rewind->entityNum], rewind->origin, rewind->mins, rewind->maxs, lazyShift.from[i], lazyShift.to[i], lazyShift.frac[i], lazyShift.anims );
+			break;
+		}
+	}
+
+	return qtrue;
+}
 
 /*
 ===================
@@ -428,23 +645,30 @@ Move a client back to where he was before the time shift
 ===================
 */
 void G_UnTimeShiftClient( gentity_t *ent, qboolean timeshiftAnims ) {
+	clientTrail_t *saved;
+
+	if ( ent->s.number >= MAX_CLIENTS )
+		return;
+
+	saved = &clientHistory.saved[ent->s.number];
+
 	// if it was saved
-	if ( ent->client->unlagged.saved.leveltime == level.time ) {
+	if ( saved->leveltime == level.time ) {
 		// move it back
-		VectorCopy( ent->client->unlagged.saved.mins, ent->r.mins );
-		VectorCopy( ent->client->unlagged.saved.maxs, ent->r.maxs );
-		VectorCopy( ent->client->unlagged.saved.currentOrigin, ent->r.currentOrigin );
-		//VectorCopy( ent->client->unlagged.saved.currentAngles, ent->r.currentAngles );
+		VectorCopy( saved->mins, ent->r.mins );
+		VectorCopy( saved->maxs, ent->r.maxs );
+		VectorCopy( saved->currentOrigin, ent->r.currentOrigin );
+		//VectorCopy( saved->currentAngles, ent->r.currentAngles );
 
 		if (timeshiftAnims) {
-			ent->client->ps.torsoAnim = ent->client->unlagged.saved.torsoAnim;
-			ent->client->ps.torsoTimer = ent->client->unlagged.saved.torsoTimer;
-			ent->client->ps.legsAnim = ent->client->unlagged.saved.legsAnim;
-			ent->client->ps.legsTimer = ent->client->unlagged.saved.legsTimer;
-			ent->s.apos.trBase[YAW] = ent->client->unlagged.saved.realAngle;
+			ent->client->ps.torsoAnim = saved->torsoAnim;
+			ent->client->ps.torsoTimer = saved->torsoTimer;
+			ent->client->ps.legsAnim = saved->legsAnim;
+			ent->client->ps.legsTimer = saved->legsTimer;
+			ent->s.apos.trBase[YAW] = saved->realAngle;
 		}
 
-		ent->client->unlagged.saved.leveltime = 0;
+		saved->leveltime = 0;
 
 		// this will recalculate absmin and absmax
 		trap->LinkEntity( (sharedEntity_t *)ent );
@@ -463,6 +687,8 @@ void G_UnTimeShiftAllClients( gentity_t *skip, qboolean timeshiftAnims ) {
 	int			i;
 	gentity_t	*ent;
 
+	lazyShift.active = qfalse;
+
 	if (!skip->client)
 		return;
 	if (skip->r.svFlags & SVF_BOT)
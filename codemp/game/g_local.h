@@ -305,6 +305,7 @@ extern int dueltypes[MAX_CLIENTS];//JAPRO - Serverside - Fullforce Duels y is th
 #define UNLAGGED_PROJ_NUDGE	(1<<0)
 #define UNLAGGED_HITSCAN	(1<<1)
 #define UNLAGGED_PUSHPULL	(1<<2)
+#define UNLAGGED_LAZY		(1<<4) //hitscan rewinds only inside the trace, see G_UnlaggedTrace
 
 //JAPRO - Serverside - Voting bits
 #define VOTE_GAMETYPE		(1<<0)
@@ -371,6 +372,8 @@ void G_StoreTrail( gentity_t *ent );
 void G_ResetTrail( gentity_t *ent );
 void G_TimeShiftClient( gentity_t *ent, int time, qboolean timeshiftAnims );
 void G_TimeShiftAllClients( int time, gentity_t *skip, qboolean timeshiftAnims );
+void G_TimeShiftClientsAlongRay( int time, gentity_t *skip, qboolean timeshiftAnims, const vec3_t start, const vec3_t end, float radius );
+qboolean G_UnlaggedTrace( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule, int traceFlags, int useLod );
 void G_UnTimeShiftClient( gentity_t *ent, qboolean timeshiftAnims );
 void G_UnTimeShiftAllClients( gentity_t *skip, qboolean timeshiftAnims );
 void G_PredictPlayerStepSlideMove( gentity_t *ent, float frametime );
@@ -1197,13 +1200,6 @@ struct gclient_s {
 
 	vec3_t		lastVelocity;
 
-	//Testunlagged
-	struct {
-		int				trailHead;
-		clientTrail_t	trail[NUM_CLIENT_TRAILS];
-		clientTrail_t	saved; // used to restore after time shift
-	} unlagged;
-
 	struct force {
 		int		regenDebounce;
 		int		drainDebounce;
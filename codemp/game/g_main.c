@@ -546,6 +546,14 @@ void G_InitGame( int levelTime, int randomSeed, int restart ) {
 
 void G_AddSimpleStatsToFile();
 void G_AddSimpleStatsToDB();
+void G_DBShutdown(void);
+void G_RaceCacheShutdown(void);
+void G_DBEndFrame(void);
+void G_DBRunCompletions(void);
+#if _USE_CURL
+void G_HTTPRunFrame(void);
+void G_HTTPShutdown(void);
+#endif
 /*
 =================
 G_ShutdownGame
@@ -558,6 +566,11 @@ void G_ShutdownGame( int restart ) {
 	//This is for the previous map, so do this here, not in initgame so cl->pers stuff does not get cleared.
 	G_AddSimpleStatsToFile();//Add previous maps stats from memory to file.
 	G_AddSimpleStatsToDB();//Add previous maps stats from file to database.  (use file incase database cant be written to, so the stats wont be lost.. we can just add them later).
+	G_DBShutdown();//Commit and close the persistent database connection
+	G_RaceCacheShutdown();
+#if _USE_CURL
+	G_HTTPShutdown();
+#endif
 
 //	trap->Print ("==== ShutdownGame ====\n");
 
@@ -4136,6 +4149,15 @@ void G_RunFrame( int levelTime ) {
 		iTimer_Queues);
 #endif
 
+	//Print race results etc. the database thread has finished, then commit this frame's database writes in one transaction
+	G_DBRunCompletions();
+	G_DBEndFrame();
+
+#if _USE_CURL
+	//Advance web server submissions, never blocks
+	G_HTTPRunFrame();
+#endif
+
 //unlagged - backward reconciliation #4
 	// record the time at the end of this frame - it should be about
 	// the time the next frame begins - when the server starts
@@ -4269,6 +4291,7 @@ gameImport_t *trap = NULL;
 Q_EXPORT gameExport_t* QDECL GetModuleAPI( int apiVersion, gameImport_t *import )
 {
 	static gameExport_t ge = {0};
+	static gameImport_t oldImport;
 
 	assert( import );
 	trap = import;
@@ -4277,7 +4300,13 @@ Q_EXPORT gameExport_t* QDECL GetModuleAPI( int apiVersion, gameImport_t *import
 
 	memset( &ge, 0, sizeof( ge ) );
 
-	if ( apiVersion != GAME_API_VERSION ) {
+	if ( apiVersion == 1 ) {
+		// an older engine's table ends before TraceRewound, leave the newer imports NULL
+		memset( &oldImport, 0, sizeof( oldImport ) );
+		memcpy( &oldImport, import, offsetof( gameImport_t, TraceRewound ) );
+		trap = &oldImport;
+	}
+	else if ( apiVersion != GAME_API_VERSION ) {
 		trap->Print( "Mismatched GAME_API_VERSION: expected %i, got %i\n", GAME_API_VERSION, apiVersion );
 		return NULL;
 	}
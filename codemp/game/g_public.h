@@ -29,7 +29,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 
 #define Q3_INFINITE			16777216
 
-#define	GAME_API_VERSION	1
+#define	GAME_API_VERSION	2 // 2: TraceRewound, TraceBatch
 
 // entity->svFlags
 // the server does not know how to interpret most of the values
@@ -762,6 +762,26 @@ typedef enum gameExportLegacy_e {
 	GAME_GETITEMINDEXBYTAG
 } gameExportLegacy_t;
 
+// where an entity was at some earlier time, TraceRewound clips against this
+// instead of the entity's linked position
+typedef struct traceRewind_s {
+	int			entityNum;
+	vec3_t		origin;
+	vec3_t		mins, maxs;
+	float		yaw; // ghoul2 collision angle
+} traceRewind_t;
+
+// one trace of a TraceBatch, mins/maxs of zero are a point trace
+typedef struct traceRequest_s {
+	vec3_t		start, end;
+	vec3_t		mins, maxs;
+	int			passEntityNum;
+	int			contentmask;
+	int			capsule;
+	int			traceFlags;
+	int			useLod;
+} traceRequest_t;
+
 typedef struct gameImport_s {
 	// misc
 	void		(*Print)								( const char *msg, ... );
@@ -1098,6 +1118,13 @@ typedef struct gameImport_s {
 	void		(*G2API_CleanEntAttachments)			( void );
 	qboolean	(*G2API_OverrideServer)					( void *serverInstance );
 	void		(*G2API_GetSurfaceName)					( void *ghoul2, int surfNumber, int modelIndex, char *fillBuf );
+
+	// GAME_API_VERSION 2, NULL when an older engine loaded the module
+
+	// trace with some entities moved to a historical position, nothing is relinked
+	void		(*TraceRewound)							( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule, int traceFlags, int useLod, const traceRewind_t *rewind, int numRewind );
+	// same results as a Trace per request, nearby traces share the entity lookup
+	void		(*TraceBatch)							( const traceRequest_t *requests, trace_t *results, int numRequests );
 } gameImport_t;
 
 typedef struct gameExport_s {
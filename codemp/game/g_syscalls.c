@@ -249,7 +249,8 @@ static QINLINE void EndHack(int entityNum) { //Should be inline?
 
 void JP_Trace( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule, int traceFlags, int useLod ) {
 	BeginHack(passEntityNum);
-	trap->Trace( results, start, mins, maxs, end, passEntityNum, contentmask, capsule, traceFlags, useLod );
+	if ( !G_UnlaggedTrace( results, start, mins, maxs, end, passEntityNum, contentmask, capsule, traceFlags, useLod ) )
+		trap->Trace( results, start, mins, maxs, end, passEntityNum, contentmask, capsule, traceFlags, useLod );
 	EndHack(passEntityNum);
 }
 
@@ -1136,6 +1137,12 @@ void SVSyscall_Trace( trace_t *results, const vec3_t start, const vec3_t mins, c
 		trap_Trace( results, start, mins, maxs, end, passEntityNum, contentmask );
 }
 
+void SVSyscall_TraceBatch( const traceRequest_t *requests, trace_t *results, int numRequests ) {
+	int i;
+	for ( i = 0; i < numRequests; i++ )
+		SVSyscall_Trace( &results[i], requests[i].start, requests[i].mins, requests[i].maxs, requests[i].end, requests[i].passEntityNum, requests[i].contentmask, requests[i].capsule, requests[i].traceFlags, requests[i].useLod );
+}
+
 NORETURN void QDECL G_Error( int errorLevel, const char *error, ... ) {
 	va_list argptr;
 	char text[1024];
@@ -1480,4 +1487,5 @@ static void TranslateSyscalls( void ) {
 	trap->G2API_CleanEntAttachments			= trap_G2API_CleanEntAttachments;
 	trap->G2API_OverrideServer				= trap_G2API_OverrideServer;
 	trap->G2API_GetSurfaceName				= trap_G2API_GetSurfaceName;
+	trap->TraceBatch						= SVSyscall_TraceBatch;
 }
@@ -617,7 +617,7 @@ static void WP_DisruptorMainFire( gentity_t *ent )
 	VectorMA( start, shotRange, forward, end );
 
 	if ( g_unlagged.integer & UNLAGGED_HITSCAN )
-		G_TimeShiftAllClients( ent->client->pers.cmd.serverTime, ent, ghoul2 );
+		G_TimeShiftClientsAlongRay( ent->client->pers.cmd.serverTime, ent, ghoul2, start, end, 0.0f );
 
 	ignore = ent->s.number;
 	traces = 0;
@@ -865,7 +865,10 @@ void WP_DisruptorAltFire( gentity_t *ent )
 	skip = ent->s.number;
 
 	if ( g_unlagged.integer & UNLAGGED_HITSCAN )
-		G_TimeShiftAllClients( ent->client->pers.cmd.serverTime, ent, ghoul2 );
+	{
+		VectorMA( start, shotRange * traces, forward, end ); //Each trace through people starts where the last one stopped
+		G_TimeShiftClientsAlongRay( ent->client->pers.cmd.serverTime, ent, ghoul2, start, end, 0.0f );
+	}
 
 	for (i = 0; i < traces; i++ )
 	{
@@ -4023,7 +4026,10 @@ static void WP_FireConcussionAlt( gentity_t *ent )
 	VectorSet( shot_maxs, 1, 1, 1 );
 
 	if ( g_unlagged.integer & UNLAGGED_HITSCAN )
-		G_TimeShiftAllClients( ent->client->pers.cmd.serverTime, ent, ghoul2 );
+	{
+		VectorMA( start, shotRange * traces, forward, end ); //Each trace through people starts where the last one stopped
+		G_TimeShiftClientsAlongRay( ent->client->pers.cmd.serverTime, ent, ghoul2, start, end, 1.0f ); //shot_maxs
+	}
 
 	for ( i = 0; i < traces; i++ )
 	{
@@ -4502,7 +4508,7 @@ static void WP_FireLightningGun( gentity_t *ent )
 	VectorMA( start, 1, vright, start );
 
 	if ( g_unlagged.integer & UNLAGGED_HITSCAN )
-		G_TimeShiftAllClients( ent->client->pers.cmd.serverTime, ent, ghoul2 );
+		G_TimeShiftClientsAlongRay( ent->client->pers.cmd.serverTime, ent, ghoul2, start, end, 0.0f );
 
 	ignore = ent->s.number;
 
@@ -4608,7 +4614,7 @@ static void WP_FireShockLance( gentity_t *ent )
 	VectorMA( start, 1, vright, start );
 
 	if ( g_unlagged.integer & UNLAGGED_HITSCAN )
-		G_TimeShiftAllClients( ent->client->pers.cmd.serverTime, ent, qfalse );
+		G_TimeShiftClientsAlongRay( ent->client->pers.cmd.serverTime, ent, qfalse, start, end, 0.0f );
 
 	ignore = ent->s.number;
 
@@ -0,0 +1,413 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+#include "G2_skin.h"
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#define G2SKIN_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define G2SKIN_TARGET(x)
+#else
+#define G2SKIN_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+static_assert( sizeof( mdxaBone_t ) == 12 * sizeof( float ), "the kernels index bones as 12 packed floats" );
+
+static inline int G2_SkinAlign( int size )
+{
+	return ( size + 31 ) & ~31;
+}
+
+// verts per weight count, false if a weight's bone index is past the bone references
+static bool G2_SkinCountVerts( const mdxmSurface_t *surface, int *counts )
+{
+	const mdxmVertex_t *v = (mdxmVertex_t *) ( (byte *)surface + surface->ofsVerts );
+
+	for ( int k = 0 ; k <= iMAX_G2_BONEWEIGHTS_PER_VERT ; k++ )
+	{
+		counts[k] = 0;
+	}
+	for ( int j = 0 ; j < surface->numVerts ; j++, v++ )
+	{
+		const int iNumWeights = G2_GetVertWeights( v );
+
+		for ( int k = 0 ; k < iNumWeights ; k++ )
+		{
+			if ( G2_GetVertBoneIndex( v, k ) >= surface->numBoneReferences )
+			{
+				return false;	// the scalar loop would read past the bone references
+			}
+		}
+		counts[iNumWeights]++;
+	}
+	return true;
+}
+
+static inline int G2_SkinBlocks( int numVerts )
+{
+	return ( numVerts + G2_SKIN_BLOCK - 1 ) / G2_SKIN_BLOCK;
+}
+
+int G2_SkinVertsSize( const mdxmSurface_t *surface )
+{
+	int counts[iMAX_G2_BONEWEIGHTS_PER_VERT + 1];
+	int numBlocks = 0, numRows = 0;
+
+	if ( surface->numVerts <= 0 || !G2_SkinCountVerts( surface, counts ) )
+	{
+		return 0;
+	}
+	for ( int k = 1 ; k <= iMAX_G2_BONEWEIGHTS_PER_VERT ; k++ )
+	{
+		numBlocks += G2_SkinBlocks( counts[k] );
+		numRows += G2_SkinBlocks( counts[k] ) * k;
+	}
+
+	return G2_SkinAlign( sizeof( g2SkinVerts_t ) )
+		+ G2_SkinAlign( numBlocks * sizeof( int ) )
+		+ G2_SkinAlign( numBlocks * G2_SKIN_BLOCK * sizeof( int ) )
+		+ G2_SkinAlign( numBlocks * 3 * G2_SKIN_BLOCK * sizeof( float ) )
+		+ G2_SkinAlign( numRows * G2_SKIN_BLOCK * sizeof( int ) )
+		+ G2_SkinAlign( numRows * G2_SKIN_BLOCK * sizeof( float ) );
+}
+
+g2SkinVerts_t *G2_BuildSkinVerts( const mdxmSurface_t *surface, void *mem )
+{
+	const mdxmVertex_t	*v = (mdxmVertex_t *) ( (byte *)surface + surface->ofsVerts );
+	g2SkinVerts_t		*skin = (g2SkinVerts_t *)mem;
+	int					counts[iMAX_G2_BONEWEIGHTS_PER_VERT + 1];
+	int					firstBlock[iMAX_G2_BONEWEIGHTS_PER_VERT + 1];
+	int					firstRow[iMAX_G2_BONEWEIGHTS_PER_VERT + 1];
+	int					placed[iMAX_G2_BONEWEIGHTS_PER_VERT + 1];
+	int					numRows = 0;
+	int					j, k;
+
+	G2_SkinCountVerts( surface, counts );
+
+	// verts with the same weight count share blocks, fewest weights first
+	skin->numVerts = surface->numVerts;
+	skin->numBlocks = 0;
+	skin->usedBoneRefs = 0;
+	for ( k = 1 ; k <= iMAX_G2_BONEWEIGHTS_PER_VERT ; k++ )
+	{
+		firstBlock[k] = skin->numBlocks;
+		firstRow[k] = numRows;
+		placed[k] = 0;
+		skin->numBlocks += G2_SkinBlocks( counts[k] );
+		numRows += G2_SkinBlocks( counts[k] ) * k;
+	}
+
+	byte *data = (byte *)mem + G2_SkinAlign( sizeof( g2SkinVerts_t ) );
+	skin->blockWeights = (int *)data;
+	data += G2_SkinAlign( skin->numBlocks * sizeof( int ) );
+	skin->vertIndex = (int *)data;
+	data += G2_SkinAlign( skin->numBlocks * G2_SKIN_BLOCK * sizeof( int ) );
+	skin->xyz = (float *)data;
+	data += G2_SkinAlign( skin->numBlocks * 3 * G2_SKIN_BLOCK * sizeof( float ) );
+	skin->boneRefs = (int *)data;
+	data += G2_SkinAlign( numRows * G2_SKIN_BLOCK * sizeof( int ) );
+	skin->weights = (float *)data;
+
+	for ( k = 1 ; k <= iMAX_G2_BONEWEIGHTS_PER_VERT ; k++ )
+	{
+		for ( j = 0 ; j < G2_SkinBlocks( counts[k] ) ; j++ )
+		{
+			skin->blockWeights[firstBlock[k] + j] = k;
+		}
+	}
+
+	// padding lanes skin the origin by a bone some vert uses, and are never written out
+	const int padRef = G2_GetVertBoneIndex( v, 0 );
+	for ( j = 0 ; j < skin->numBlocks * G2_SKIN_BLOCK ; j++ )
+	{
+		skin->vertIndex[j] = -1;
+	}
+	for ( j = 0 ; j < skin->numBlocks * 3 * G2_SKIN_BLOCK ; j++ )
+	{
+		skin->xyz[j] = 0.0f;
+	}
+	for ( j = 0 ; j < numRows * G2_SKIN_BLOCK ; j++ )
+	{
+		skin->boneRefs[j] = padRef;
+		skin->weights[j] = 0.0f;
+	}
+
+	for ( j = 0 ; j < surface->numVerts ; j++, v++ )
+	{
+		const int iNumWeights = G2_GetVertWeights( v );
+		const int blockInGroup = placed[iNumWeights] / G2_SKIN_BLOCK;
+		const int block = firstBlock[iNumWeights] + blockInGroup;
+		const int row = firstRow[iNumWeights] + blockInGroup * iNumWeights;
+		const int lane = placed[iNumWeights]++ % G2_SKIN_BLOCK;
+		float *xyz = skin->xyz + block * 3 * G2_SKIN_BLOCK + lane;
+
+		skin->vertIndex[block * G2_SKIN_BLOCK + lane] = j;
+		xyz[0] = v->vertCoords[0];
+		xyz[G2_SKIN_BLOCK] = v->vertCoords[1];
+		xyz[2 * G2_SKIN_BLOCK] = v->vertCoords[2];
+
+		float fTotalWeight = 0.0f;
+		for ( k = 0 ; k < iNumWeights ; k++ )
+		{
+			const int slot = ( row + k ) * G2_SKIN_BLOCK + lane;
+
+			skin->boneRefs[slot] = G2_GetVertBoneIndex( v, k );
+			skin->weights[slot] = G2_GetVertBoneWeight( v, k, fTotalWeight, iNumWeights );
+			skin->usedBoneRefs |= 1u << skin->boneRefs[slot];
+		}
+	}
+
+	return skin;
+}
+
+static void G2_SkinVertsScalar( const g2SkinVerts_t *skin, const mdxaBone_t *bones, const vec3_t scale, float *out )
+{
+	int row = 0;
+
+	for ( int block = 0 ; block < skin->numBlocks ; row += skin->blockWeights[block++] )
+	{
+		const int numWeights = skin->blockWeights[block];
+
+		for ( int lane = 0 ; lane < G2_SKIN_BLOCK ; lane++ )
+		{
+			const int	vert = skin->vertIndex[block * G2_SKIN_BLOCK + lane];
+			const float	*xyz = skin->xyz + block * 3 * G2_SKIN_BLOCK + lane;
+			const float	x = xyz[0], y = xyz[G2_SKIN_BLOCK], z = xyz[2 * G2_SKIN_BLOCK];
+			vec3_t		tempVert = { 0.0f, 0.0f, 0.0f };
+
+			if ( vert < 0 )
+			{
+				break;
+			}
+
+			for ( int k = 0 ; k < numWeights ; k++ )
+			{
+				const int slot = ( row + k ) * G2_SKIN_BLOCK + lane;
+				const float fBoneWeight = skin->weights[slot];
+				const mdxaBone_t &bone = bones[skin->boneRefs[slot]];
+
+				for ( int r = 0 ; r < 3 ; r++ )
+				{
+					tempVert[r] += fBoneWeight * ( bone.matrix[r][0] * x + bone.matrix[r][1] * y + bone.matrix[r][2] * z + bone.matrix[r][3] );
+				}
+			}
+
+			out[vert * 5 + 0] = tempVert[0] * scale[0];
+			out[vert * 5 + 1] = tempVert[1] * scale[1];
+			out[vert * 5 + 2] = tempVert[2] * scale[2];
+		}
+	}
+}
+
+#ifdef G2SKIN_X86
+
+G2SKIN_TARGET("sse2")
+static void G2_SkinVertsSSE2( const g2SkinVerts_t *skin, const mdxaBone_t *bones, const vec3_t scale, float *out )
+{
+	const __m128 scaleX = _mm_set1_ps( scale[0] );
+	const __m128 scaleY = _mm_set1_ps( scale[1] );
+	const __m128 scaleZ = _mm_set1_ps( scale[2] );
+	int row = 0;
+
+	for ( int block = 0 ; block < skin->numBlocks ; row += skin->blockWeights[block++] )
+	{
+		const int numWeights = skin->blockWeights[block];
+
+		for ( int lane = 0 ; lane < G2_SKIN_BLOCK ; lane += 4 )
+		{
+			const int *vertIndex = skin->vertIndex + block * G2_SKIN_BLOCK + lane;
+			if ( vertIndex[0] < 0 )
+			{
+				break;
+			}
+
+			const float	*xyz = skin->xyz + block * 3 * G2_SKIN_BLOCK + lane;
+			const __m128 x = _mm_loadu_ps( xyz );
+			const __m128 y = _mm_loadu_ps( xyz + G2_SKIN_BLOCK );
+			const __m128 z = _mm_loadu_ps( xyz + 2 * G2_SKIN_BLOCK );
+			__m128 acc[3] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+
+			for ( int k = 0 ; k < numWeights ; k++ )
+			{
+				const int slot = ( row + k ) * G2_SKIN_BLOCK + lane;
+				const int *refs = skin->boneRefs + slot;
+				const __m128 w = _mm_loadu_ps( skin->weights + slot );
+
+				for ( int r = 0 ; r < 3 ; r++ )
+				{
+					// the row of each lane's bone, turned into a column per lane
+					__m128 m0 = _mm_loadu_ps( bones[refs[0]].matrix[r] );
+					__m128 m1 = _mm_loadu_ps( bones[refs[1]].matrix[r] );
+					__m128 m2 = _mm_loadu_ps( bones[refs[2]].matrix[r] );
+					__m128 m3 = _mm_loadu_ps( bones[refs[3]].matrix[r] );
+					_MM_TRANSPOSE4_PS( m0, m1, m2, m3 );
+
+					__m128 p = _mm_add_ps( _mm_mul_ps( m0, x ), _mm_mul_ps( m1, y ) );
+					p = _mm_add_ps( p, _mm_mul_ps( m2, z ) );
+					p = _mm_add_ps( p, m3 );
+					acc[r] = _mm_add_ps( acc[r], _mm_mul_ps( w, p ) );
+				}
+			}
+
+			float o[3][4];
+			_mm_storeu_ps( o[0], _mm_mul_ps( acc[0], scaleX ) );
+			_mm_storeu_ps( o[1], _mm_mul_ps( acc[1], scaleY ) );
+			_mm_storeu_ps( o[2], _mm_mul_ps( acc[2], scaleZ ) );
+			for ( int l = 0 ; l < 4 && vertIndex[l] >= 0 ; l++ )
+			{
+				float *v = out + vertIndex[l] * 5;
+				v[0] = o[0][l];
+				v[1] = o[1][l];
+				v[2] = o[2][l];
+			}
+		}
+	}
+}
+
+// no fma here, it would round differently to the scalar loop
+G2SKIN_TARGET("avx")
+static void G2_SkinVertsAVX( const g2SkinVerts_t *skin, const mdxaBone_t *bones, const vec3_t scale, float *out )
+{
+	const __m256 scaleX = _mm256_set1_ps( scale[0] );
+	const __m256 scaleY = _mm256_set1_ps( scale[1] );
+	const __m256 scaleZ = _mm256_set1_ps( scale[2] );
+	int row = 0;
+
+	for ( int block = 0 ; block < skin->numBlocks ; row += skin->blockWeights[block++] )
+	{
+		const int numWeights = skin->blockWeights[block];
+		const float	*xyz = skin->xyz + block * 3 * G2_SKIN_BLOCK;
+		const __m256 x = _mm256_loadu_ps( xyz );
+		const __m256 y = _mm256_loadu_ps( xyz + G2_SKIN_BLOCK );
+		const __m256 z = _mm256_loadu_ps( xyz + 2 * G2_SKIN_BLOCK );
+		__m256 acc[3] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+
+		for ( int k = 0 ; k < numWeights ; k++ )
+		{
+			const int slot = ( row + k ) * G2_SKIN_BLOCK;
+			const int *refs = skin->boneRefs + slot;
+			const __m256 w = _mm256_loadu_ps( skin->weights + slot );
+
+			for ( int r = 0 ; r < 3 ; r++ )
+			{
+				// lanes l and l+4 share a register, then each 128 bit half is
+				// transposed like in the sse2 kernel (faster than gathers)
+				__m256 m[4];
+				for ( int l = 0 ; l < 4 ; l++ )
+				{
+					m[l] = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( bones[refs[l]].matrix[r] ) ),
+						_mm_loadu_ps( bones[refs[l + 4]].matrix[r] ), 1 );
+				}
+				const __m256 t0 = _mm256_unpacklo_ps( m[0], m[1] );
+				const __m256 t1 = _mm256_unpackhi_ps( m[0], m[1] );
+				const __m256 t2 = _mm256_unpacklo_ps( m[2], m[3] );
+				const __m256 t3 = _mm256_unpackhi_ps( m[2], m[3] );
+				const __m256 c0 = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+				const __m256 c1 = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+				const __m256 c2 = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+				const __m256 c3 = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+
+				__m256 p = _mm256_add_ps( _mm256_mul_ps( c0, x ), _mm256_mul_ps( c1, y ) );
+				p = _mm256_add_ps( p, _mm256_mul_ps( c2, z ) );
+				p = _mm256_add_ps( p, c3 );
+				acc[r] = _mm256_add_ps( acc[r], _mm256_mul_ps( w, p ) );
+			}
+		}
+
+		// padding lanes have no vert to write to
+		const int *vertIndex = skin->vertIndex + block * G2_SKIN_BLOCK;
+		float o[3][G2_SKIN_BLOCK];
+		_mm256_storeu_ps( o[0], _mm256_mul_ps( acc[0], scaleX ) );
+		_mm256_storeu_ps( o[1], _mm256_mul_ps( acc[1], scaleY ) );
+		_mm256_storeu_ps( o[2], _mm256_mul_ps( acc[2], scaleZ ) );
+		for ( int l = 0 ; l < G2_SKIN_BLOCK && vertIndex[l] >= 0 ; l++ )
+		{
+			float *v = out + vertIndex[l] * 5;
+			v[0] = o[0][l];
+			v[1] = o[1][l];
+			v[2] = o[2][l];
+		}
+	}
+	_mm256_zeroupper();
+}
+
+static bool G2_CpuHasSSE2( void )
+{
+#if defined(_M_X64) || defined(__x86_64__)
+	return true;
+#elif defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid( info, 1 );
+	return ( info[3] & ( 1 << 26 ) ) != 0;
+#else
+	return __builtin_cpu_supports( "sse2" ) != 0;
+#endif
+}
+
+static bool G2_CpuHasAVX( void )
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid( info, 1 );
+	const bool osxsave = ( info[2] & ( 1 << 27 ) ) != 0;
+	const bool avx = ( info[2] & ( 1 << 28 ) ) != 0;
+	// the os has to save the ymm registers too
+	return osxsave && avx && ( _xgetbv( 0 ) & 6 ) == 6;
+#else
+	return __builtin_cpu_supports( "avx" ) != 0;
+#endif
+}
+
+#endif // G2SKIN_X86
+
+g2SkinFunc_t G2_GetSkinKernel( g2SkinKernel_t kernel )
+{
+	switch ( kernel )
+	{
+	case G2SKIN_SCALAR:
+		return G2_SkinVertsScalar;
+#ifdef G2SKIN_X86
+	case G2SKIN_SSE2:
+		return G2_CpuHasSSE2() ? G2_SkinVertsSSE2 : NULL;
+	case G2SKIN_AVX:
+		return G2_CpuHasAVX() ? G2_SkinVertsAVX : NULL;
+#endif
+	default:
+		return NULL;
+	}
+}
+
+void G2_SkinVerts( const g2SkinVerts_t *skin, const mdxaBone_t *bones, const vec3_t scale, float *out )
+{
+	static g2SkinFunc_t skinFunc = NULL;
+
+	if ( !skinFunc )
+	{
+		for ( int kernel = G2SKIN_NUM_KERNELS - 1 ; !skinFunc ; kernel-- )
+		{
+			skinFunc = G2_GetSkinKernel( (g2SkinKernel_t)kernel );
+		}
+	}
+
+	skinFunc( skin, bones, scale, out );
+}
@@ -0,0 +1,69 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+#pragma once
+
+#define MDXABONEDEF
+#include "rd-common/mdx_format.h"
+
+// Skinning of ghoul2 surface verts for collision traces, several verts at a time.
+//
+// The packed weights of a surface are decoded once at load into blocks of
+// G2_SKIN_BLOCK verts with the same weight count, laid out one array per
+// coordinate and weight slot, so the SSE2 and AVX kernels can skin a block with
+// plain vector loads. All the kernels do the same float operations in the same
+// order as the scalar loop in R_TransformEachSurface, so they give bit identical
+// verts.
+
+#define G2_SKIN_BLOCK (8)
+
+typedef struct g2SkinVerts_s {
+	int				numVerts;
+	int				numBlocks;
+	unsigned int	usedBoneRefs;	// bit per surface bone reference some vert is weighted to
+	int				*blockWeights;	// [block] weights of each vert in the block
+	int				*vertIndex;		// [block][G2_SKIN_BLOCK] vert skinned by each lane, -1 for padding
+	float			*xyz;			// [block][3][G2_SKIN_BLOCK] bind pose coords
+	int				*boneRefs;		// [block][weight][G2_SKIN_BLOCK] index into the surface bone references
+	float			*weights;		// [block][weight][G2_SKIN_BLOCK]
+} g2SkinVerts_t;
+
+typedef enum {
+	G2SKIN_SCALAR,
+	G2SKIN_SSE2,
+	G2SKIN_AVX,
+	G2SKIN_NUM_KERNELS
+} g2SkinKernel_t;
+
+// bones holds the matrix of each surface bone reference (only the used ones
+// need to be valid), scale is applied after the weights are summed. Writes the
+// xyz of each vert to out, with a stride of 5 floats as in the transformed vert
+// array.
+typedef void (*g2SkinFunc_t)( const g2SkinVerts_t *skin, const mdxaBone_t *bones, const vec3_t scale, float *out );
+
+// bytes G2_BuildSkinVerts needs for the surface, 0 if it can't be decoded
+int				G2_SkinVertsSize( const mdxmSurface_t *surface );
+g2SkinVerts_t	*G2_BuildSkinVerts( const mdxmSurface_t *surface, void *mem );
+
+// best kernel the cpu supports, picked on first use
+void			G2_SkinVerts( const g2SkinVerts_t *skin, const mdxaBone_t *bones, const vec3_t scale, float *out );
+
+// NULL if the kernel isn't built in or the cpu can't run it
+g2SkinFunc_t	G2_GetSkinKernel( g2SkinKernel_t kernel );
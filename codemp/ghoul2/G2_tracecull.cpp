@@ -0,0 +1,294 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+#include "G2_tracecull.h"
+
+#include <math.h>
+
+void G2_RadiusTraceAxes(const vec3_t rayStart, const vec3_t rayEnd, const float fRadius, vec3_t saxis, vec3_t taxis, vec3_t v3RayDir)
+{
+	vec3_t basis1;
+	vec3_t basis2;
+
+	basis2[0]=0.0f;
+	basis2[1]=0.0f;
+	basis2[2]=1.0f;
+
+	VectorSubtract(rayEnd, rayStart, v3RayDir);
+
+	CrossProduct(v3RayDir,basis2,basis1);
+
+	if (DotProduct(basis1,basis1)<.1f)
+	{
+		basis2[0]=0.0f;
+		basis2[1]=1.0f;
+		basis2[2]=0.0f;
+		CrossProduct(v3RayDir,basis2,basis1);
+	}
+
+	CrossProduct(v3RayDir,basis1,basis2);
+	// Give me a shot direction not a bunch of zeros :) -Gil
+//	assert(DotProduct(basis1,basis1)>.0001f);
+//	assert(DotProduct(basis2,basis2)>.0001f);
+
+	VectorNormalize(basis1);
+	VectorNormalize(basis2);
+
+	const float c=cos(0.0f);//theta
+	const float s=sin(0.0f);//theta
+
+	VectorScale(basis1, 0.5f * c / fRadius,taxis);
+	VectorMA(taxis,     0.5f * s / fRadius,basis2,taxis);
+
+	VectorScale(basis1,-0.5f * s /fRadius,saxis);
+	VectorMA(    saxis, 0.5f * c /fRadius,basis2,saxis);
+
+	//rayDir/=lengthSquared(raydir);
+	const float f = VectorLengthSquared(v3RayDir);
+	v3RayDir[0]/=f;
+	v3RayDir[1]/=f;
+	v3RayDir[2]/=f;
+}
+
+int G2_RadiusTraceFlags(const float *point, const vec3_t rayStart, const vec3_t saxis, const vec3_t taxis, const vec3_t rayDir)
+{
+	vec3_t delta;
+	delta[0]=point[0]-rayStart[0];
+	delta[1]=point[1]-rayStart[1];
+	delta[2]=point[2]-rayStart[2];
+	const float s=DotProduct(delta,saxis)+0.5f;
+	const float t=DotProduct(delta,taxis)+0.5f;
+	const float u=DotProduct(delta,rayDir);
+	int vflags=0;
+
+	if (s>0)
+	{
+		vflags|=1;
+	}
+	if (s<1)
+	{
+		vflags|=2;
+	}
+	if (t>0)
+	{
+		vflags|=4;
+	}
+	if (t<1)
+	{
+		vflags|=8;
+	}
+	if (u>0)
+	{
+		vflags|=16;
+	}
+	if (u<1)
+	{
+		vflags|=32;
+	}
+	return vflags;
+}
+
+qboolean G2_SegmentTriangleTest( const vec3_t start, const vec3_t end,
+	const vec3_t A, const vec3_t B, const vec3_t C,
+	qboolean backFaces,qboolean frontFaces,vec3_t returnedPoint,vec3_t returnedNormal, float *denom)
+{
+	static const float tiny=1E-10f;
+	vec3_t returnedNormalT;
+	vec3_t edgeAC;
+
+	VectorSubtract(C, A, edgeAC);
+	VectorSubtract(B, A, returnedNormalT);
+
+	CrossProduct(returnedNormalT, edgeAC, returnedNormal);
+
+	vec3_t ray;
+	VectorSubtract(end, start, ray);
+
+	*denom=DotProduct(ray, returnedNormal);
+
+	if (fabs(*denom)<tiny||        // triangle parallel to ray
+		(!backFaces && *denom>0)||		// not accepting back faces
+		(!frontFaces && *denom<0))		//not accepting front faces
+	{
+		return qfalse;
+	}
+
+	vec3_t toPlane;
+	VectorSubtract(A, start, toPlane);
+
+	float t=DotProduct(toPlane, returnedNormal)/ *denom;
+
+	if (t<0.0f||t>1.0f)
+	{
+		return qfalse; // off segment
+	}
+
+	VectorScale(ray, t, ray);
+
+	VectorAdd(ray, start, returnedPoint);
+
+	vec3_t edgePA;
+	VectorSubtract(A, returnedPoint, edgePA);
+
+	vec3_t edgePB;
+	VectorSubtract(B, returnedPoint, edgePB);
+
+	vec3_t edgePC;
+	VectorSubtract(C, returnedPoint, edgePC);
+
+	vec3_t temp;
+
+	CrossProduct(edgePA, edgePB, temp);
+	if (DotProduct(temp, returnedNormal)<0.0f)
+	{
+		return qfalse; // off triangle
+	}
+
+	CrossProduct(edgePC, edgePA, temp);
+	if (DotProduct(temp,returnedNormal)<0.0f)
+	{
+		return qfalse; // off triangle
+	}
+
+	CrossProduct(edgePB, edgePC, temp);
+	if (DotProduct(temp, returnedNormal)<0.0f)
+	{
+		return qfalse; // off triangle
+	}
+	return qtrue;
+}
+
+qboolean G2_TraceCullInit(g2TraceCull_t *cull, const vec3_t rayStart, const vec3_t rayEnd, float fRadius)
+{
+	VectorCopy(rayStart, cull->rayStart);
+	VectorCopy(rayEnd, cull->rayEnd);
+	cull->radiusTrace = (qboolean)!(fabs(fRadius) < 0.1);	// same test as G2_TraceSurfaces
+	if (cull->radiusTrace)
+	{
+		if (VectorCompare(rayStart, rayEnd))
+		{ //no frame to cull against
+			return qfalse;
+		}
+		G2_RadiusTraceAxes(rayStart, rayEnd, fRadius, cull->saxis, cull->taxis, cull->rayDir);
+	}
+	return qtrue;
+}
+
+qboolean G2_TraceCullBounds(const g2TraceCull_t *cull, const g2BoneBounds_t *boneBounds, int numBoneRefs, const mdxaBone_t *bones, const vec3_t scale)
+{
+	int			i, j;
+	vec3_t		mins, maxs;
+
+	// move each bone box by its bone and gather them into one model space box
+	ClearBounds(mins, maxs);
+	for (i = 0; i < numBoneRefs; i++)
+	{
+		const g2BoneBounds_t &b = boneBounds[i];
+		if (b.mins[0] > b.maxs[0])
+		{
+			continue;
+		}
+
+		const mdxaBone_t &bone = bones[i];
+		vec3_t center, extent;
+		VectorAdd(b.mins, b.maxs, center);
+		VectorScale(center, 0.5f, center);
+		VectorSubtract(b.maxs, center, extent);
+
+		for (j = 0; j < 3; j++)
+		{
+			const float c = DotProduct(bone.matrix[j], center) + bone.matrix[j][3];
+			const float e = fabs(bone.matrix[j][0]) * extent[0] + fabs(bone.matrix[j][1]) * extent[1] + fabs(bone.matrix[j][2]) * extent[2];
+			if (c - e < mins[j])
+			{
+				mins[j] = c - e;
+			}
+			if (c + e > maxs[j])
+			{
+				maxs[j] = c + e;
+			}
+		}
+	}
+	if (mins[0] > maxs[0])
+	{
+		return qfalse; // no verts to hit
+	}
+
+	for (j = 0; j < 3; j++)
+	{
+		const float a = mins[j] * scale[j];
+		const float b = maxs[j] * scale[j];
+		mins[j] = (a < b ? a : b) - G2_TRACECULL_EPSILON;
+		maxs[j] = (a < b ? b : a) + G2_TRACECULL_EPSILON;
+	}
+
+	if (cull->radiusTrace)
+	{
+		// G2_RadiusTracePolys drops a poly when all its verts are outside the same side of the
+		// swept square, so drop the surface when all the box corners are
+		int flags = 63;
+		for (i = 0; i < 8 && flags; i++)
+		{
+			vec3_t corner;
+			corner[0] = (i & 1) ? maxs[0] : mins[0];
+			corner[1] = (i & 2) ? maxs[1] : mins[1];
+			corner[2] = (i & 4) ? maxs[2] : mins[2];
+			flags &= ~G2_RadiusTraceFlags(corner, cull->rayStart, cull->saxis, cull->taxis, cull->rayDir);
+		}
+		return (qboolean)!flags;
+	}
+
+	// segment against box
+	float tMin = 0.0f, tMax = 1.0f;
+	for (j = 0; j < 3; j++)
+	{
+		const float d = cull->rayEnd[j] - cull->rayStart[j];
+		if (fabs(d) < 1e-6f)
+		{
+			if (cull->rayStart[j] < mins[j] || cull->rayStart[j] > maxs[j])
+			{
+				return qfalse;
+			}
+			continue;
+		}
+
+		float t0 = (mins[j] - cull->rayStart[j]) / d;
+		float t1 = (maxs[j] - cull->rayStart[j]) / d;
+		if (t0 > t1)
+		{
+			const float tmp = t0;
+			t0 = t1;
+			t1 = tmp;
+		}
+		if (t0 > tMin)
+		{
+			tMin = t0;
+		}
+		if (t1 < tMax)
+		{
+			tMax = t1;
+		}
+		if (tMin > tMax)
+		{
+			return qfalse;
+		}
+	}
+	return qtrue;
+}
@@ -0,0 +1,69 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+#pragma once
+
+#define MDXABONEDEF
+#include "rd-common/mdx_format.h"
+
+// Culling of ghoul2 surfaces before a collision trace skins them.
+//
+// Each surface keeps the bind pose box of the verts weighted to each of its
+// bone references. Moving those boxes by the bones gives a box around the
+// skinned surface, and a surface whose box the trace ray can't reach is left
+// untransformed, so the poly tests skip it. The poly tests live here as well,
+// so the cull can be checked against them.
+
+typedef struct g2BoneBounds_s {
+	vec3_t		mins, maxs;			// mins > maxs if no vert uses the bone reference
+} g2BoneBounds_t;
+
+// the model space ray a collision trace is about to test
+typedef struct g2TraceCull_s {
+	vec3_t		rayStart;
+	vec3_t		rayEnd;
+	qboolean	radiusTrace;
+	// radius trace frame, as built by G2_RadiusTraceAxes
+	vec3_t		saxis;
+	vec3_t		taxis;
+	vec3_t		rayDir;
+} g2TraceCull_t;
+
+// pad the bone bounds well past the rounding of the skinning and the poly tests
+#define G2_TRACECULL_EPSILON (1.0f)
+
+// the swept square of a radius trace, rayDir is scaled so the ray spans 0..1
+void		G2_RadiusTraceAxes( const vec3_t rayStart, const vec3_t rayEnd, const float fRadius, vec3_t saxis, vec3_t taxis, vec3_t rayDir );
+
+// bit per side of the swept square a point is inside of, 63 when it's inside all of them
+int			G2_RadiusTraceFlags( const float *point, const vec3_t rayStart, const vec3_t saxis, const vec3_t taxis, const vec3_t rayDir );
+
+// routine that works out given a ray whether or not it hits a poly
+qboolean	G2_SegmentTriangleTest( const vec3_t start, const vec3_t end,
+	const vec3_t A, const vec3_t B, const vec3_t C,
+	qboolean backFaces, qboolean frontFaces, vec3_t returnedPoint, vec3_t returnedNormal, float *denom );
+
+// qfalse if the trace can't be culled (a radius trace without a direction)
+qboolean	G2_TraceCullInit( g2TraceCull_t *cull, const vec3_t rayStart, const vec3_t rayEnd, float fRadius );
+
+// can the trace touch any poly of the surface once it's skinned? bones holds the
+// matrix of each surface bone reference with a non empty box. The bounds are
+// conservative, so this only ever rejects surfaces the poly tests would miss anyway.
+qboolean	G2_TraceCullBounds( const g2TraceCull_t *cull, const g2BoneBounds_t *boneBounds, int numBoneRefs, const mdxaBone_t *bones, const vec3_t scale );
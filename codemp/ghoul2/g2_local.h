@@ -237,6 +237,7 @@ void		G2_TransformModel(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale,
 #else
 void		G2_TransformModel(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale, IHeapAllocator *G2VertSpace, int useLod);
 #endif
+void		G2_TransformModelForTrace(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale, IHeapAllocator *G2VertSpace, int useLod, const vec3_t rayStart, const vec3_t rayEnd, float fRadius);
 void		G2_GenerateWorldMatrix(const vec3_t angles, const vec3_t origin);
 void		TransformPoint (const vec3_t in, vec3_t out, mdxaBone_t *mat);
 void		Inverse_Matrix(mdxaBone_t *src, mdxaBone_t *dest);
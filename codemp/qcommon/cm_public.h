@@ -54,6 +54,9 @@ int			CM_BoxLeafnums( const vec3_t mins, const vec3_t maxs, int *boxList,
 		 					int listsize, int *lastLeaf );
 //rwwRMG - changed to boxList to not conflict with list type
 
+// qfalse if no world brush or patch of brushmask reaches into the box
+qboolean	CM_BoxMayTouch( const vec3_t mins, const vec3_t maxs, int brushmask );
+
 int			CM_LeafCluster (int leafnum);
 int			CM_LeafArea (int leafnum);
 
@@ -22,6 +22,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "cm_local.h"
+#include "cm_patch.h"
 
 /*
 ==================
@@ -192,6 +193,80 @@ int	CM_BoxLeafnums( const vec3_t mins, const vec3_t maxs, int *boxList, int list
 	return ll.count;
 }
 
+/*
+==================
+CM_BoxMayTouch
+
+Returns qfalse only if no world brush or patch with contents in brushmask
+reaches into the box, going by their bounds. Lets a caller skip a bunch of
+traces that all stay inside the box with a single leaf walk.
+==================
+*/
+#define	MAX_TOUCH_LEAFS	256
+static qboolean CM_BoundsIntersect( const vec3_t mins, const vec3_t maxs, const vec3_t mins2, const vec3_t maxs2 ) {
+	return (qboolean)( mins[0] <= maxs2[0] && mins[1] <= maxs2[1] && mins[2] <= maxs2[2] &&
+		maxs[0] >= mins2[0] && maxs[1] >= mins2[1] && maxs[2] >= mins2[2] );
+}
+
+qboolean CM_BoxMayTouch( const vec3_t mins, const vec3_t maxs, int brushmask ) {
+	int			leafs[MAX_TOUCH_LEAFS];
+	int			i, k, lastLeaf;
+	int			count;
+	cLeaf_t		*leaf;
+	cbrush_t	*b;
+	cPatch_t	*patch;
+
+	count = CM_BoxLeafnums( mins, maxs, leafs, MAX_TOUCH_LEAFS, &lastLeaf );
+	if ( count >= MAX_TOUCH_LEAFS ) {
+		return qtrue;	// too big to bother
+	}
+
+	cmg.checkcount++;
+
+	for ( i = 0 ; i < count ; i++ ) {
+		leaf = &cmg.leafs[leafs[i]];
+
+		for ( k = 0 ; k < leaf->numLeafBrushes ; k++ ) {
+			b = &cmg.brushes[cmg.leafbrushes[leaf->firstLeafBrush+k]];
+			if ( b->checkcount == cmg.checkcount ) {
+				continue;	// already checked this brush in another leaf
+			}
+			b->checkcount = cmg.checkcount;
+
+			if ( !(b->contents & brushmask) ) {
+				continue;
+			}
+			if ( CM_BoundsIntersect( b->bounds[0], b->bounds[1], mins, maxs ) ) {
+				return qtrue;
+			}
+		}
+
+		if ( cm_noCurves->integer ) {
+			continue;
+		}
+
+		for ( k = 0 ; k < leaf->numLeafSurfaces ; k++ ) {
+			patch = cmg.surfaces[ cmg.leafsurfaces[ leaf->firstLeafSurface + k ] ];
+			if ( !patch ) {
+				continue;
+			}
+			if ( patch->checkcount == cmg.checkcount ) {
+				continue;	// already checked this patch in another leaf
+			}
+			patch->checkcount = cmg.checkcount;
+
+			if ( !(patch->contents & brushmask) ) {
+				continue;
+			}
+			if ( CM_BoundsIntersect( patch->pc->bounds[0], patch->pc->bounds[1], mins, maxs ) ) {
+				return qtrue;
+			}
+		}
+	}
+
+	return qfalse;
+}
+
 
 //====================================================================
 
@@ -131,10 +131,10 @@ to the appropriate place.
 A raw string should NEVER be passed as fmt, because of "%f" type crashers.
 =============
 */
+static thread_local comDeferredOutput_t *com_deferredOutput;
+
 std::recursive_mutex printfLock;
 void QDECL Com_Printf( const char *fmt, ... ) {
-	std::lock_guard<std::recursive_mutex> l( printfLock );
-
 	static qboolean opening_qconsole = qfalse;
 	va_list		argptr;
 	char		msg[MAXPRINTMSG];
@@ -143,6 +143,13 @@ void QDECL Com_Printf( const char *fmt, ... ) {
 	Q_vsnprintf (msg, sizeof(msg), fmt, argptr);
 	va_end (argptr);
 
+	if ( com_deferredOutput ) {
+		Q_strcat( com_deferredOutput->print, sizeof( com_deferredOutput->print ), msg );
+		return;
+	}
+
+	std::lock_guard<std::recursive_mutex> l( printfLock );
+
 	if ( rd_buffer ) {
 		if ((strlen (msg) + strlen(rd_buffer)) > (size_t)(rd_buffersize - 1)) {
 			rd_flush(rd_buffer);
@@ -258,6 +265,18 @@ void NORETURN QDECL Com_Error( int code, const char *fmt, ... ) {
 	static int	errorCount;
 	int			currentTime;
 
+	if ( com_deferredOutput ) {
+		// nothing is shut down from a worker thread, the main thread raises it again
+		if ( !com_deferredOutput->error ) {
+			com_deferredOutput->error = qtrue;
+			com_deferredOutput->errorCode = code;
+			va_start (argptr,fmt);
+			Q_vsnprintf (com_deferredOutput->errorMessage, sizeof(com_deferredOutput->errorMessage), fmt, argptr);
+			va_end (argptr);
+		}
+		throw code;
+	}
+
 	if ( com_errorEntered ) {
 		Sys_Error( "recursive error after: %s", com_errorMessage );
 	}
@@ -308,6 +327,38 @@ void NORETURN QDECL Com_Error( int code, const char *fmt, ... ) {
 	Sys_Error ("%s", com_errorMessage);
 }
 
+/*
+=============
+Com_BeginDeferredOutput
+
+Until Com_EndDeferredOutput, Com_Printf on this thread only appends to
+output, and Com_Error records the error there and throws its code to the
+caller's catch ( int ) without shutting anything down.  For engine code run
+on worker threads, the main thread gives it all to Com_RaiseDeferredOutput
+once the workers are done.
+=============
+*/
+void Com_BeginDeferredOutput( comDeferredOutput_t *output ) {
+	output->print[0] = '\0';
+	output->error = qfalse;
+	output->errorCode = 0;
+	output->errorMessage[0] = '\0';
+	com_deferredOutput = output;
+}
+
+void Com_EndDeferredOutput( void ) {
+	com_deferredOutput = NULL;
+}
+
+void Com_RaiseDeferredOutput( const comDeferredOutput_t *output ) {
+	if ( output->print[0] ) {
+		Com_Printf( "%s", output->print );
+	}
+	if ( output->error ) {
+		Com_Error( output->errorCode, "%s", output->errorMessage );
+	}
+}
+
 
 /*
 =============
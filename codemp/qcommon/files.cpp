@@ -219,6 +219,8 @@ typedef struct pack_s {
 	int				hashSize;					// hash table size (power of 2)
 	fileInPack_t*	*hashTable;					// hash table
 	fileInPack_t*	buildBuffer;				// buffer with the filenames etc.
+	struct pakMapping_s	*mapping;				// whole pk3 mapped into memory, see FS_MapPak
+	qboolean		mapFailed;					// don't retry mapping a pk3 that couldn't be mapped
 } pack_t;
 
 typedef struct directory_s {
@@ -252,6 +254,7 @@ static cvar_t		*fs_copyfiles;
 static cvar_t		*fs_gamedirvar;
 static cvar_t		*fs_dirbeforepak; //rww - when building search path, keep directories at top and insert pk3's under them
 static cvar_t		*fs_loadpakdlls;
+static cvar_t		*fs_mmapPaks;
 #ifndef DEDICATED
 static cvar_t		*fs_globalcfg;
 #endif
@@ -283,7 +286,10 @@ typedef struct fileHandleData_s {
 			fileSize(0),
 			zipFilePos(0),
 			zipFileLen(0),
-			zipFile(qfalse) {
+			zipFile(qfalse),
+			zipData(nullptr),
+			zipDataPos(0),
+			zipMapping(nullptr) {
 		ospath[0] = '\0';
 		name[0] = '\0';
 	}
@@ -300,6 +306,9 @@ typedef struct fileHandleData_s {
 	int			zipFilePos;
 	int			zipFileLen;
 	qboolean	zipFile;
+	const byte	*zipData;		// stored entry inside a mapped pk3, read without minizip
+	int			zipDataPos;
+	struct pakMapping_s	*zipMapping;
 	char		name[MAX_ZPATH];
 } fileHandleData_t;
 
@@ -357,6 +366,9 @@ static void FS_ResetFileHandleData( fileHandleData_t *f ) {
 	f->zipFilePos = 0;
 	f->zipFileLen = 0;
 	f->zipFile = qfalse;
+	f->zipData = nullptr;
+	f->zipDataPos = 0;
+	f->zipMapping = nullptr;
 	f->name[0] = '\0';
 }
 
@@ -425,6 +437,248 @@ static long FS_HashFileName( const char *fname, int hashSize ) {
 	return hash;
 }
 
+/*
+=================
+File index
+
+One hash table over the files of every pure pk3 in the search path, mapping
+each name to the first pk3 that has it.  FS_FOpenFileRead and FS_FileIsInPAK
+only look into that pk3 instead of probing every pk3's own table.  Directories
+aren't indexed, they are still checked in search path order.  It's built on the
+first lookup after the search path or the pure pak list changes.
+=================
+*/
+typedef struct fileIndexEntry_s {
+	fileInPack_t	*file;
+	searchpath_t	*search;
+} fileIndexEntry_t;
+
+static fileIndexEntry_t	*fs_fileIndex;
+static int				fs_fileIndexSize;	// power of 2
+static qboolean			fs_fileIndexValid;
+
+// hash of the whole name, case and separator insensitive like FS_FilenameCompare
+static unsigned int FS_HashIndexName( const char *fname ) {
+	unsigned int	hash = 5381;
+	int				c;
+
+	while ( (c = *fname++) != '\0' ) {
+		if ( c >= 'A' && c <= 'Z' ) {
+			c += 'a' - 'A';
+		}
+		if ( c == '\\' || c == ':' ) {
+			c = '/';
+		}
+		hash = hash * 33 + c;
+	}
+	return hash ^ (hash >> 16);
+}
+
+static void FS_InvalidateFileIndex( void ) {
+	if ( fs_fileIndex ) {
+		Z_Free( fs_fileIndex );
+	}
+	fs_fileIndex = NULL;
+	fs_fileIndexSize = 0;
+	fs_fileIndexValid = qfalse;
+}
+
+static void FS_BuildFileIndex( void ) {
+	searchpath_t	*search;
+	fileInPack_t	*file;
+	int				i, count = 0;
+	unsigned int	h;
+
+	FS_InvalidateFileIndex();
+
+	for ( search = fs_searchpaths ; search ; search = search->next ) {
+		if ( search->pack && FS_PakIsPure( search->pack ) ) {
+			count += search->pack->numfiles;
+		}
+	}
+
+	// keep it at most half full
+	for ( fs_fileIndexSize = 16 ; fs_fileIndexSize < count * 2 ; fs_fileIndexSize <<= 1 ) {
+	}
+	fs_fileIndex = (fileIndexEntry_t *)Z_Malloc( fs_fileIndexSize * sizeof( *fs_fileIndex ), TAG_FILESYS, qtrue );
+
+	for ( search = fs_searchpaths ; search ; search = search->next ) {
+		if ( !search->pack || !FS_PakIsPure( search->pack ) ) {
+			continue;
+		}
+
+		for ( i = 0 ; i < search->pack->numfiles ; i++ ) {
+			file = &search->pack->buildBuffer[i];
+			if ( !file->name ) {
+				continue;	// the zip directory was cut short
+			}
+
+			// the first pak in the search path wins
+			h = FS_HashIndexName( file->name ) & (fs_fileIndexSize - 1);
+			while ( fs_fileIndex[h].file && FS_FilenameCompare( fs_fileIndex[h].file->name, file->name ) ) {
+				h = (h + 1) & (fs_fileIndexSize - 1);
+			}
+			if ( !fs_fileIndex[h].file ) {
+				fs_fileIndex[h].file = file;
+				fs_fileIndex[h].search = search;
+			}
+		}
+	}
+
+	fs_fileIndexValid = qtrue;
+}
+
+/*
+=================
+FS_FileIndexLookup
+
+The search path of the first pure pk3 that has the file, NULL if none has it
+=================
+*/
+static searchpath_t *FS_FileIndexLookup( const char *filename ) {
+	unsigned int h;
+
+	if ( !fs_fileIndexValid ) {
+		FS_BuildFileIndex();
+	}
+
+	h = FS_HashIndexName( filename ) & (fs_fileIndexSize - 1);
+	while ( fs_fileIndex[h].file ) {
+		if ( !FS_FilenameCompare( fs_fileIndex[h].file->name, filename ) ) {
+			return fs_fileIndex[h].search;
+		}
+		h = (h + 1) & (fs_fileIndexSize - 1);
+	}
+	return NULL;
+}
+
+/*
+=================
+Pak mappings
+
+A pk3 is mapped into memory the first time a stored (uncompressed) entry is
+opened from it.  Stored entries are then read with a plain copy out of the
+mapping instead of going through minizip, and FS_ReadFile hands out pointers
+straight into the mapping for the binary formats in fs_zeroCopyExtensions.
+Those buffers hold a reference, so a mapping outlives its pak until the last
+one is given back to FS_FreeFile.  The views are copy-on-write, callers that
+patch their buffer in place (the bsp loaders do) never write to the pk3.
+
+A pk3 that's been rewritten since it was mapped would raise SIGBUS on the
+pages past its new end, so its size is checked again every time an entry is
+opened and a pk3 that changed goes back to minizip.  Entries that aren't
+aligned like a Z_Malloc'd buffer are copied even for the zero-copy formats.
+=================
+*/
+typedef struct pakMapping_s {
+	byte					*data;
+	size_t					size;
+	int						refs;		// FS_ReadFile buffers pointing into data
+	qboolean				closed;		// the pak has been freed
+	struct pakMapping_s		*next;
+} pakMapping_t;
+
+static pakMapping_t	*fs_pakMappings;
+
+// FS_ReadFile returns these without a copy. Text formats need the trailing 0
+// and models are retagged with Z_MorphMallocTag, so they always get a copy.
+static const char *fs_zeroCopyExtensions[] = { "bsp", "tga", "jpg", "jpeg", "png" };
+#define FS_ZEROCOPY_ALIGN	16	// as Z_Malloc aligns its buffers
+
+static pakMapping_t *FS_MapPak( pack_t *pak ) {
+	pakMapping_t	*m;
+	void			*data;
+	size_t			size;
+
+	if ( pak->mapFailed ) {
+		return NULL;
+	}
+	if ( pak->mapping ) {
+		return pak->mapping;
+	}
+
+	data = Sys_MapFile( pak->pakFilename, &size );
+	if ( !data ) {
+		Com_DPrintf( "FS_MapPak: couldn't map %s\n", pak->pakFilename );
+		pak->mapFailed = qtrue;
+		return NULL;
+	}
+
+	m = (pakMapping_t *)Z_Malloc( sizeof( *m ), TAG_FILESYS, qtrue );
+	m->data = (byte *)data;
+	m->size = size;
+	m->next = fs_pakMappings;
+	fs_pakMappings = m;
+	pak->mapping = m;
+	return m;
+}
+
+static void FS_ReleasePakMapping( pakMapping_t *m ) {
+	pakMapping_t	**prev;
+
+	for ( prev = &fs_pakMappings ; *prev ; prev = &(*prev)->next ) {
+		if ( *prev == m ) {
+			*prev = m->next;
+			break;
+		}
+	}
+	Sys_UnmapFile( m->data, m->size );
+	Z_Free( m );
+}
+
+/*
+=================
+FS_StoredFileData
+
+The data of the current file of z if it's stored uncompressed and its pk3
+can be mapped, NULL if it has to be read through minizip
+=================
+*/
+static const byte *FS_StoredFileData( pack_t *pak, unzFile z, int len, pakMapping_t **mapping ) {
+	unz_file_info	info;
+	pakMapping_t	*m;
+	ZPOS64_T		pos;
+
+	if ( !fs_mmapPaks || !fs_mmapPaks->integer ) {
+		return NULL;
+	}
+	if ( unzGetCurrentFileInfo( z, &info, NULL, 0, NULL, 0, NULL, 0 ) != UNZ_OK ) {
+		return NULL;
+	}
+	// method 0 is stored, bit 0 of the flags is encryption
+	if ( info.compression_method != 0 || (info.flag & 1) || info.compressed_size != (unsigned long)len ) {
+		return NULL;
+	}
+	m = FS_MapPak( pak );
+	if ( !m ) {
+		return NULL;
+	}
+	if ( Sys_FileSize( pak->pakFilename ) != (int64_t)m->size ) {
+		// keep the stale mapping for the buffers already out, it's unmapped with the pak
+		Com_DPrintf( "FS_StoredFileData: %s changed on disk since it was mapped\n", pak->pakFilename );
+		pak->mapFailed = qtrue;
+		return NULL;
+	}
+	pos = unzGetCurrentFileZStreamPos64( z );
+	if ( !pos || pos + len > m->size ) {
+		return NULL;
+	}
+	*mapping = m;
+	return m->data + pos;
+}
+
+static qboolean FS_ZeroCopyExtension( const char *filename ) {
+	const char	*ext = COM_GetExtension( filename );
+	size_t		i;
+
+	for ( i = 0 ; i < ARRAY_LEN( fs_zeroCopyExtensions ) ; i++ ) {
+		if ( !Q_stricmp( ext, fs_zeroCopyExtensions[i] ) ) {
+			return qtrue;
+		}
+	}
+	return qfalse;
+}
+
 static fileHandle_t FS_HandleForFile(void) {
 	int		i;
 
@@ -1437,6 +1691,7 @@ long FS_FOpenFileRead( const char *filename, fileHandle_t *file, qboolean unique
 	//void			*temp;
 	int				l;
 	bool			isUserConfig = false;
+	searchpath_t	*indexed;
 
 	hash = 0;
 
@@ -1472,6 +1727,9 @@ long FS_FOpenFileRead( const char *filename, fileHandle_t *file, qboolean unique
 
 	isUserConfig = !Q_stricmp( filename, "autoexec.cfg" ) || !Q_stricmp( filename, Q3CONFIG_CFG );
 
+	// the only pak worth looking into, directories before it can still override it
+	indexed = FS_FileIndexLookup( filename );
+
 	//
 	// search through the path, one element at a time
 	//
@@ -1493,6 +1751,9 @@ long FS_FOpenFileRead( const char *filename, fileHandle_t *file, qboolean unique
 		for ( search = fs_searchpaths ; search ; search = search->next ) {
 			//
 			if ( search->pack ) {
+				if ( search != indexed ) {
+					continue;
+				}
 				hash = FS_HashFileName(filename, search->pack->hashSize);
 			}
 			// is the element a pak file?
@@ -1593,6 +1854,7 @@ long FS_FOpenFileRead( const char *filename, fileHandle_t *file, qboolean unique
 #endif
 						fsh[*file].zipFilePos = pakFile->pos;
 						fsh[*file].zipFileLen = pakFile->len;
+						fsh[*file].zipData = FS_StoredFileData( pak, fsh[*file].handleFiles.file.z, pakFile->len, &fsh[*file].zipMapping );
 
 						if ( fs_debug->integer ) {
 							Com_Printf( "FS_FOpenFileRead: %s (found in '%s')\n",
@@ -1820,6 +2082,17 @@ int FS_Read( void *buffer, int len, fileHandle_t f ) {
 			buf += read;
 		}
 		return len;
+	} else if (fsh[f].zipData) {
+		remaining = fsh[f].zipFileLen - fsh[f].zipDataPos;
+		if (len > remaining) {
+			len = remaining;
+		}
+		if (len <= 0) {
+			return 0;
+		}
+		Com_Memcpy (buf, fsh[f].zipData + fsh[f].zipDataPos, len);
+		fsh[f].zipDataPos += len;
+		return len;
 	} else {
 		return unzReadCurrentFile(fsh[f].handleFiles.file.z, buffer, len);
 	}
@@ -1909,6 +2182,28 @@ int FS_Seek( fileHandle_t f, long offset, int origin ) {
 
 	FS_AssertInitialised();
 
+	if (fsh[f].zipData) {
+		// mapped stored entry, just move the read position
+		int pos;
+
+		switch( origin ) {
+			case FS_SEEK_CUR:
+				pos = fsh[f].zipDataPos + offset;
+				break;
+			case FS_SEEK_END:
+				pos = fsh[f].zipFileLen + offset;
+				break;
+			case FS_SEEK_SET:
+				pos = offset;
+				break;
+			default:
+				Com_Error( ERR_FATAL, "Bad origin in FS_Seek" );
+				return -1;
+		}
+		fsh[f].zipDataPos = Com_Clampi( 0, fsh[f].zipFileLen, pos );
+		return offset;
+	}
+
 	if (fsh[f].zipFile == qtrue) {
 		//FIXME: this is really, really crappy
 		//(but better than what was here before)
@@ -2001,9 +2296,6 @@ CONVENIENCE FUNCTIONS FOR ENTIRE FILES
 
 int	FS_FileIsInPAK(const char *filename, int *pChecksum ) {
 	searchpath_t	*search;
-	pack_t			*pak;
-	fileInPack_t	*pakFile;
-	long			hash = 0;
 
 	FS_AssertInitialised();
 
@@ -2023,38 +2315,15 @@ int	FS_FileIsInPAK(const char *filename, int *pChecksum ) {
 		return -1;
 	}
 
-	//
-	// search through the path, one element at a time
-	//
-
-	for ( search = fs_searchpaths ; search ; search = search->next ) {
-		//
-		if (search->pack) {
-			hash = FS_HashFileName(filename, search->pack->hashSize);
-		}
-		// is the element a pak file?
-		if ( search->pack && search->pack->hashTable[hash] ) {
-			// disregard if it doesn't match one of the allowed pure pak files
-			if ( !FS_PakIsPure(search->pack) ) {
-				continue;
-			}
+	search = FS_FileIndexLookup( filename );
+	if ( !search ) {
+		return -1;
+	}
 
-			// look through all the pak file elements
-			pak = search->pack;
-			pakFile = pak->hashTable[hash];
-			do {
-				// case and separator insensitive comparisons
-				if ( !FS_FilenameCompare( pakFile->name, filename ) ) {
-					if (pChecksum) {
-						*pChecksum = pak->pure_checksum;
-					}
-					return 1;
-				}
-				pakFile = pakFile->next;
-			} while(pakFile != NULL);
-		}
+	if ( pChecksum ) {
+		*pChecksum = search->pack->pure_checksum;
 	}
-	return -1;
+	return 1;
 }
 
 long FS_ReadDLLInPAK(const char *filename, void **buffer) {
@@ -2257,6 +2526,15 @@ long FS_ReadFile( const char *qpath, void **buffer ) {
 
 	fs_loadCount++;
 
+	if ( fsh[h].zipData && !isConfig && FS_ZeroCopyExtension( qpath ) && !((uintptr_t)fsh[h].zipData & (FS_ZEROCOPY_ALIGN - 1)) ) {
+		// point into the mapping instead of copying, FS_FreeFile drops the reference
+		fsh[h].zipMapping->refs++;
+		fs_readCount += len;
+		*buffer = (void *)fsh[h].zipData;
+		FS_FCloseFile( h );
+		return len;
+	}
+
 	buf = (byte*)Z_Malloc( len+1, TAG_FILESYS, qfalse);
 	buf[len]='\0';	// because we're not calling Z_Malloc with optional trailing 'bZeroIt' bool
 	*buffer = buf;
@@ -2290,6 +2568,15 @@ void FS_FreeFile( void *buffer ) {
 		Com_Error( ERR_FATAL, "FS_FreeFile( NULL )" );
 	}
 
+	for ( pakMapping_t *m = fs_pakMappings ; m ; m = m->next ) {
+		if ( (byte *)buffer >= m->data && (byte *)buffer < m->data + m->size ) {
+			if ( !--m->refs && m->closed ) {
+				FS_ReleasePakMapping( m );
+			}
+			return;
+		}
+	}
+
 	Z_Free( buffer );
 }
 
@@ -2447,6 +2734,13 @@ Frees a pak structure and releases all associated resources
 
 void FS_FreePak(pack_t *thepak)
 {
+	if (thepak->mapping) {
+		// buffers from FS_ReadFile may still point into it
+		thepak->mapping->closed = qtrue;
+		if (!thepak->mapping->refs) {
+			FS_ReleasePakMapping(thepak->mapping);
+		}
+	}
 	unzClose(thepak->handle);
 	Z_Free(thepak->buildBuffer);
 	Z_Free(thepak);
@@ -3265,6 +3559,7 @@ static void FS_AddGameDirectory( const char *path, const char *dir ) {
 	}
 
 	Q_strncpyz( fs_gamedir, dir, sizeof( fs_gamedir ) );
+	FS_InvalidateFileIndex();
 
 	// find all pak files in this directory
 	Q_strncpyz(curpath, FS_BuildOSPath(path, dir, ""), sizeof(curpath));
@@ -3539,6 +3834,7 @@ void FS_Shutdown( qboolean closemfp ) {
 
 	// any FS_ calls will now be an error until reinitialized
 	fs_searchpaths = NULL;
+	FS_InvalidateFileIndex();
 
 	Cmd_RemoveCommand( "path" );
 	Cmd_RemoveCommand( "dir" );
@@ -3596,6 +3892,7 @@ static void FS_ReorderPurePaks()
 		return;
 
 	fs_reordered = qfalse;
+	FS_InvalidateFileIndex();
 
 	p_insert_index = &fs_searchpaths; // we insert in order at the beginning of the list
 	for ( i = 0 ; i < fs_numServerPaks ; i++ ) {
@@ -3668,6 +3965,12 @@ void FS_Startup( const char *gameName ) {
 	fs_dirbeforepak = Cvar_Get("fs_dirbeforepak", "0", CVAR_INIT|CVAR_PROTECTED, "Prioritize directories before paks if not pure" );
 
 	fs_loadpakdlls = Cvar_Get("fs_loadpakdlls", "1", CVAR_NORESTART|CVAR_PROTECTED, "Toggle loading DLLs from pk3 files");
+#ifdef idx64
+	fs_mmapPaks = Cvar_Get("fs_mmapPaks", "1", CVAR_INIT|CVAR_PROTECTED, "Map pk3 files into memory and read stored entries without copying");
+#else
+	// 32-bit builds can't afford to map the big asset pk3s into their address space
+	fs_mmapPaks = Cvar_Get("fs_mmapPaks", "0", CVAR_INIT|CVAR_PROTECTED, "Map pk3 files into memory and read stored entries without copying");
+#endif
 
 	// add search path elements in reverse priority order (lowest priority first)
 	if (fs_cdpath->string[0]) {
@@ -4026,6 +4329,9 @@ void FS_PureServerSetLoadedPaks( const char *pakSums, const char *pakNames ) {
 		fs_serverPaks[i] = atoi( Cmd_Argv( i ) );
 	}
 
+	// FS_PakIsPure answers differently now
+	FS_InvalidateFileIndex();
+
 	if (fs_numServerPaks) {
 		Com_DPrintf( "Connected to a pure server.\n" );
 	}
@@ -4310,7 +4616,9 @@ int		FS_FOpenFileByMode( const char *qpath, fileHandle_t *f, fsMode_t mode ) {
 
 int		FS_FTell( fileHandle_t f ) {
 	int pos;
-	if (fsh[f].zipFile == qtrue) {
+	if (fsh[f].zipData) {
+		pos = fsh[f].zipDataPos;
+	} else if (fsh[f].zipFile == qtrue) {
 		pos = unztell(fsh[f].handleFiles.file.z);
 	} else {
 		pos = ftell(fsh[f].handleFiles.file.o);
@@ -29,23 +29,21 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 
 static int			bloc = 0;
 
+// the offset versions don't touch bloc, messages are written from the
+// snapshot worker threads at the same time
 void	Huff_putBit( int bit, byte *fout, int *offset) {
-	bloc = *offset;
-	if ((bloc&7) == 0) {
-		fout[(bloc>>3)] = 0;
+	int pos = *offset;
+	if ((pos&7) == 0) {
+		fout[(pos>>3)] = 0;
 	}
-	fout[(bloc>>3)] |= bit << (bloc&7);
-	bloc++;
-	*offset = bloc;
+	fout[(pos>>3)] |= bit << (pos&7);
+	*offset = pos + 1;
 }
 
 int		Huff_getBit( byte *fin, int *offset) {
-	int t;
-	bloc = *offset;
-	t = (fin[(bloc>>3)] >> (bloc&7)) & 0x1;
-	bloc++;
-	*offset = bloc;
-	return t;
+	int pos = *offset;
+	*offset = pos + 1;
+	return (fin[(pos>>3)] >> (pos&7)) & 0x1;
 }
 
 /* Add a bit to the output file (buffered) */
@@ -315,10 +313,152 @@ void Huff_transmit (huff_t *huff, int ch, byte *fout) {
 	}
 }
 
+/* Send the prefix code for this node at *offset */
+static void offset_send(node_t *node, node_t *child, byte *fout, int *offset) {
+	if (node->parent) {
+		offset_send(node->parent, node, fout, offset);
+	}
+	if (child) {
+		Huff_putBit(node->right == child, fout, offset);
+	}
+}
+
 void Huff_offsetTransmit (huff_t *huff, int ch, byte *fout, int *offset) {
-	bloc = *offset;
-	send(huff->loc[ch], NULL, fout);
-	*offset = bloc;
+	offset_send(huff->loc[ch], NULL, fout, offset);
+}
+
+/*
+==============================================================================
+
+Table driven coding
+
+Once a tree stops changing, like the static msgHuff tree, every symbol can be
+sent with a single write of its precomputed code, and HUFF_LOOKUP_BITS bits
+of input resolve a symbol with one table lookup.  Both produce exactly the
+bits of Huff_offsetTransmit and Huff_offsetReceive.  Codes that don't fit the
+tables fall back to walking the tree.
+
+==============================================================================
+*/
+
+/* Write numBits bits of value at *offset, lowest bit first like Huff_putBit */
+void Huff_putBits( unsigned int value, int numBits, byte *fout, int *offset ) {
+	int pos = *offset;
+	int shift, n;
+
+	while ( numBits > 0 ) {
+		shift = pos & 7;
+		n = 8 - shift;
+		if ( n > numBits ) {
+			n = numBits;
+		}
+		if ( !shift ) {
+			fout[pos >> 3] = value & ((1 << n) - 1);
+		} else {
+			fout[pos >> 3] |= (value & ((1 << n) - 1)) << shift;
+		}
+		value >>= n;
+		numBits -= n;
+		pos += n;
+	}
+	*offset = pos;
+}
+
+/* Read numBits (at most 24) bits at *offset, lowest bit first like Huff_getBit */
+int Huff_getBits( const byte *fin, int numBits, int *offset ) {
+	int pos = *offset;
+	int value = 0;
+	int got = 0;
+	int shift, n;
+
+	while ( got < numBits ) {
+		shift = pos & 7;
+		n = 8 - shift;
+		if ( n > numBits - got ) {
+			n = numBits - got;
+		}
+		value |= ((fin[pos >> 3] >> shift) & ((1 << n) - 1)) << got;
+		got += n;
+		pos += n;
+	}
+	*offset = pos;
+	return value;
+}
+
+static void Huff_BuildCodes_r( const node_t *node, unsigned int code, int depth, huffCodes_t *codes ) {
+	if ( !node ) {
+		return;
+	}
+	if ( node->symbol != INTERNAL_NODE ) {
+		if ( depth > 32 ) {
+			return;		// left at length 0, sent by walking the tree
+		}
+		codes->code[node->symbol] = code;
+		codes->length[node->symbol] = depth;
+		return;
+	}
+	Huff_BuildCodes_r( node->left, code, depth + 1, codes );
+	Huff_BuildCodes_r( node->right, depth < 32 ? code | (1u << depth) : code, depth + 1, codes );
+}
+
+void Huff_BuildCodes( const huff_t *huff, huffCodes_t *codes ) {
+	int sym, len, i;
+
+	Com_Memset( codes, 0, sizeof( *codes ) );
+	codes->tree = huff->tree;
+	Huff_BuildCodes_r( huff->tree, 0, 0, codes );
+
+	for ( sym = 0 ; sym <= HMAX ; sym++ ) {
+		len = codes->length[sym];
+		if ( !len || len > HUFF_LOOKUP_BITS ) {
+			continue;
+		}
+		// every index whose low len bits are the code decodes to this symbol
+		for ( i = codes->code[sym] ; i < (1 << HUFF_LOOKUP_BITS) ; i += 1 << len ) {
+			codes->lookup[i] = sym | (len << 9);
+		}
+	}
+}
+
+/* Huff_offsetTransmit with the code table built from huff */
+void Huff_offsetTransmitCodes( const huffCodes_t *codes, huff_t *huff, int ch, byte *fout, int *offset ) {
+	if ( !codes->length[ch] ) {
+		Huff_offsetTransmit( huff, ch, fout, offset );
+		return;
+	}
+	Huff_putBits( codes->code[ch], codes->length[ch], fout, offset );
+}
+
+/* Huff_offsetReceive with the lookup table, fin is valid up to maxOffset bits */
+int Huff_offsetReceiveCodes( const huffCodes_t *codes, const byte *fin, int *offset, int maxOffset ) {
+	const node_t	*node;
+	int				pos = *offset;
+	int				entry, bits;
+
+	// the lookup reads three bytes from the current one
+	if ( pos + 24 <= maxOffset ) {
+		bits = fin[pos >> 3] | (fin[(pos >> 3) + 1] << 8) | (fin[(pos >> 3) + 2] << 16);
+		entry = codes->lookup[(bits >> (pos & 7)) & ((1 << HUFF_LOOKUP_BITS) - 1)];
+		if ( entry ) {
+			*offset = pos + (entry >> 9);
+			return entry & 511;
+		}
+	}
+
+	node = codes->tree;
+	while ( node && node->symbol == INTERNAL_NODE ) {
+		if ( (fin[pos >> 3] >> (pos & 7)) & 1 ) {
+			node = node->right;
+		} else {
+			node = node->left;
+		}
+		pos++;
+	}
+	if ( !node ) {
+		return 0;
+	}
+	*offset = pos;
+	return node->symbol;
 }
 
 void Huff_Decompress(msg_t *mbuf, int offset) {
@@ -373,7 +513,7 @@ void Huff_Decompress(msg_t *mbuf, int offset) {
 	Com_Memcpy(mbuf->data + offset, seq, cch);
 }
 
-extern 	int oldsize;
+extern thread_local int oldsize;
 
 void Huff_Compress(msg_t *mbuf, int offset) {
 	int			i, ch, size;
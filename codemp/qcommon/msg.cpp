@@ -22,6 +22,8 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 ===========================================================================
 */
 
+#include <atomic>
+
 #include "qcommon/q_shared.h"
 #include "qcommon/qcommon.h"
 #include "server/server.h"
@@ -30,6 +32,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 //#define _USINGNEWHUFFTABLE_		// Build a new frequency table to cut and paste.
 
 static huffman_t		msgHuff;
+static huffCodes_t		msgHuffCodes[2];	// compressor, decompressor
 
 static qboolean			msgInit = qfalse;
 #ifdef _NEWHUFFTABLE_
@@ -45,11 +48,12 @@ Handles byte ordering and avoids alignment errors
 ==============================================================================
 */
 
+// debug stats, per thread since the snapshot workers write messages in parallel
 #ifndef FINAL_BUILD
-	int gLastBitIndex = 0;
+	thread_local int gLastBitIndex = 0;
 #endif
 
-int oldsize = 0;
+thread_local int oldsize = 0;
 
 bool g_nOverrideChecked = false;
 void MSG_CheckNETFPSFOverrides(qboolean psfOverrides);
@@ -131,7 +135,7 @@ bit functions
 =============================================================================
 */
 
-int	overflows;
+thread_local int	overflows;
 
 // negative bit values include signs
 void MSG_WriteBits( msg_t *msg, int value, int bits ) {
@@ -197,10 +201,8 @@ void MSG_WriteBits( msg_t *msg, int value, int bits ) {
 		if (bits&7) {
 			int nbits;
 			nbits = bits&7;
-			for(i=0;i<nbits;i++) {
-				Huff_putBit((value&1), msg->data, &msg->bit);
-				value = (value>>1);
-			}
+			Huff_putBits(value, nbits, msg->data, &msg->bit);
+			value = (value>>nbits);
 			bits = bits - nbits;
 		}
 		if (bits) {
@@ -208,7 +210,7 @@ void MSG_WriteBits( msg_t *msg, int value, int bits ) {
 #ifdef _NEWHUFFTABLE_
 				fwrite(&value, 1, 1, fp);
 #endif // _NEWHUFFTABLE_
-				Huff_offsetTransmit (&msgHuff.compressor, (value&0xff), msg->data, &msg->bit);
+				Huff_offsetTransmitCodes (&msgHuffCodes[0], &msgHuff.compressor, (value&0xff), msg->data, &msg->bit);
 				value = (value>>8);
 			}
 		}
@@ -253,14 +255,12 @@ int MSG_ReadBits( msg_t *msg, int bits ) {
 		nbits = 0;
 		if (bits&7) {
 			nbits = bits&7;
-			for(i=0;i<nbits;i++) {
-				value |= (Huff_getBit(msg->data, &msg->bit)<<i);
-			}
+			value = Huff_getBits(msg->data, nbits, &msg->bit);
 			bits = bits - nbits;
 		}
 		if (bits) {
 			for(i=0;i<bits;i+=8) {
-				Huff_offsetReceive (msgHuff.decompressor.tree, &get, msg->data, &msg->bit);
+				get = Huff_offsetReceiveCodes (&msgHuffCodes[1], msg->data, &msg->bit, msg->maxsize<<3);
 #ifdef _NEWHUFFTABLE_
 				fwrite(&get, 1, 1, fp);
 #endif // _NEWHUFFTABLE_
@@ -1114,6 +1114,157 @@ void MSG_WriteDeltaEntity( msg_t *msg, struct entityState_s *from, struct entity
 	}
 }
 
+/*
+==============================================================================
+
+			DELTA ENTITY CACHE
+
+The server writes the same (from, to) entity delta for every client that acked
+the same previous state, spectators and players on a common frame mostly.
+MSG_WriteDeltaEntityCached keeps the encoded bits of each delta it writes and
+splices them into the next message that needs the same one, instead of diffing
+the field table and running the huffman coder again.  The encoded bits don't
+depend on where in the message they start, so they can be copied as they are.
+
+Slots are keyed by the full from and to states and are only filled once per
+frame; a slot being written is treated as a miss, so the snapshot worker
+threads share the cache without a lock.  MSG_ClearDeltaEntityCache starts a
+new frame and must not run while deltas are being written.
+==============================================================================
+*/
+
+#define DELTACACHE_SLOTS		1024	// power of 2
+#define DELTACACHE_MAX_BYTES	96		// longer deltas aren't cached
+
+typedef struct deltaCacheSlot_s {
+	std::atomic<unsigned int>	stamp;		// deltaCacheFrame*2 while written, deltaCacheFrame*2+1 when ready
+	unsigned int				hash;
+	qboolean					force;
+	entityState_t				from;
+	entityState_t				to;
+	int							numBits;
+	byte						bits[DELTACACHE_MAX_BYTES];
+} deltaCacheSlot_t;
+
+static deltaCacheSlot_t	deltaCache[DELTACACHE_SLOTS];
+static unsigned int		deltaCacheFrame = 1;
+
+void MSG_ClearDeltaEntityCache( void ) {
+	deltaCacheFrame++;
+}
+
+static unsigned int MSG_HashEntityState( const entityState_t *s, unsigned int hash ) {
+	const int	*p = (const int *)s;
+	size_t		i;
+
+	for ( i = 0 ; i < sizeof( *s ) / sizeof( int ) ; i++ ) {
+		hash = (hash ^ p[i]) * 16777619;
+	}
+	return hash;
+}
+
+// copy numBits bits starting at bit offset start of data into out, byte aligned
+static void MSG_ExtractBits( const byte *data, int start, int numBits, byte *out ) {
+	int i, pos, shift;
+
+	for ( i = 0 ; i < numBits ; i += 8 ) {
+		pos = start + i;
+		shift = pos & 7;
+		out[i >> 3] = data[pos >> 3] >> shift;
+		if ( shift ) {
+			out[i >> 3] |= data[(pos >> 3) + 1] << (8 - shift);
+		}
+	}
+}
+
+// append numBits bits of bits to the message, as MSG_WriteBits would have
+static void MSG_SpliceBits( msg_t *msg, const byte *bits, int numBits ) {
+	int i, n, v, pos, shift;
+
+	if ( msg->maxsize - ((msg->bit + numBits) >> 3) < 4 ) {
+		msg->overflowed = qtrue;
+		return;
+	}
+
+	pos = msg->bit;
+	for ( i = 0 ; i < numBits ; i += 8 ) {
+		n = numBits - i;
+		v = bits[i >> 3];
+		if ( n < 8 ) {
+			v &= (1 << n) - 1;
+		} else {
+			n = 8;
+		}
+		shift = pos & 7;
+		if ( !shift ) {
+			msg->data[pos >> 3] = v;
+		} else {
+			msg->data[pos >> 3] = (msg->data[pos >> 3] & ((1 << shift) - 1)) | (v << shift);
+			if ( shift + n > 8 ) {
+				msg->data[(pos >> 3) + 1] = v >> (8 - shift);
+			}
+		}
+		pos += n;
+	}
+	msg->bit = pos;
+	msg->cursize = (msg->bit >> 3) + 1;
+}
+
+/*
+==================
+MSG_WriteDeltaEntityCached
+
+MSG_WriteDeltaEntity through the delta entity cache, returns qtrue if the
+bits came from the cache
+==================
+*/
+qboolean MSG_WriteDeltaEntityCached( msg_t *msg, entityState_t *from, entityState_t *to, qboolean force ) {
+	deltaCacheSlot_t	*slot;
+	unsigned int		hash, stamp;
+	unsigned int		writing = deltaCacheFrame * 2;
+	int					start;
+
+	if ( !from || !to || msg->oob ) {
+		MSG_WriteDeltaEntity( msg, from, to, force );
+		return qfalse;
+	}
+
+	hash = MSG_HashEntityState( to, MSG_HashEntityState( from, 2166136261u ) );
+	slot = &deltaCache[hash & (DELTACACHE_SLOTS - 1)];
+
+	stamp = slot->stamp.load( std::memory_order_acquire );
+	if ( stamp == writing + 1 ) {
+		if ( slot->hash == hash && slot->force == force
+			&& !memcmp( &slot->to, to, sizeof( *to ) ) && !memcmp( &slot->from, from, sizeof( *from ) ) ) {
+			MSG_SpliceBits( msg, slot->bits, slot->numBits );
+			return qtrue;
+		}
+		// slot taken by another delta this frame
+		slot = NULL;
+	} else if ( stamp == writing || !slot->stamp.compare_exchange_strong( stamp, writing ) ) {
+		// another thread is filling it
+		slot = NULL;
+	}
+
+	start = msg->bit;
+	MSG_WriteDeltaEntity( msg, from, to, force );
+
+	if ( slot ) {
+		if ( msg->overflowed || msg->bit - start > DELTACACHE_MAX_BYTES * 8 ) {
+			// leave it marked as written, it isn't worth retrying this frame
+			return qfalse;
+		}
+		slot->hash = hash;
+		slot->force = force;
+		slot->from = *from;
+		slot->to = *to;
+		slot->numBits = msg->bit - start;
+		MSG_ExtractBits( msg->data, start, slot->numBits, slot->bits );
+		slot->stamp.store( writing + 1, std::memory_order_release );
+	}
+	return qfalse;
+}
+
 /*
 ==================
 MSG_ReadDeltaEntity
@@ -3043,6 +3194,8 @@ void MSG_initHuffman() {
 			Huff_addRef(&msgHuff.decompressor,	(byte)i);			// Do update
 		}
 	}
+	Huff_BuildCodes(&msgHuff.compressor, &msgHuffCodes[0]);
+	Huff_BuildCodes(&msgHuff.decompressor, &msgHuffCodes[1]);
 }
 
 #else
@@ -3078,6 +3231,8 @@ void MSG_initHuffman() {
 	}
 	Com_Printf("};\n");
 	FS_FreeFile( data );
+	Huff_BuildCodes(&msgHuff.compressor, &msgHuffCodes[0]);
+	Huff_BuildCodes(&msgHuff.decompressor, &msgHuffCodes[1]);
 	Cbuf_AddText( "condump dump.txt\n" );
 }
 
@@ -78,6 +78,11 @@ typedef int SOCKET;
 #define ioctlsocket                                ioctl
 #define socketError                                errno
 
+#ifdef __linux__
+// recvmmsg/sendmmsg, several datagrams per syscall
+#define NET_MMSG
+#endif
+
 #endif
 
 static qboolean usingSocks = qfalse;
@@ -97,6 +102,10 @@ static cvar_t	*net_port;
 
 static cvar_t	*net_dropsim;
 
+#ifdef NET_MMSG
+static cvar_t	*net_mmsg;
+#endif
+
 static struct sockaddr_in	socksRelayAddr;
 
 static SOCKET	ip_socket = INVALID_SOCKET;
@@ -238,15 +247,148 @@ qboolean Sys_StringToAdr( const char *s, netadr_t *a ) {
 
 /*
 ==================
-NET_GetPacket
+NET_ReceivedPacket
 
-Receive one packet
+Fills in net_from for the ret bytes received into net_message
 ==================
 */
+static qboolean NET_ReceivedPacket( struct sockaddr_in *from, socklen_t fromlen, int ret, netadr_t *net_from, msg_t *net_message ) {
+	memset( from->sin_zero, 0, 8 );
+
+	if ( usingSocks && memcmp( from, &socksRelayAddr, fromlen ) == 0 ) {
+		if ( ret < 10 || net_message->data[0] != 0 || net_message->data[1] != 0 || net_message->data[2] != 0 || net_message->data[3] != 1 ) {
+			return qfalse;
+		}
+		net_from->type = NA_IP;
+		net_from->ip[0] = net_message->data[4];
+		net_from->ip[1] = net_message->data[5];
+		net_from->ip[2] = net_message->data[6];
+		net_from->ip[3] = net_message->data[7];
+		memcpy( &net_from->port, &net_message->data[8], 2 );
+		net_message->readcount = 10;
+	}
+	else {
+		SockadrToNetadr( from, net_from );
+		net_message->readcount = 0;
+	}
+
+	if( ret >= net_message->maxsize ) {
+		Com_Printf( "Oversize packet from %s\n", NET_AdrToString (*net_from) );
+		return qfalse;
+	}
+
+	net_message->cursize = ret;
+	return qtrue;
+}
+
 #ifdef _DEBUG
 int	recvfromCount;
 #endif
 
+#ifdef NET_MMSG
+#define	NET_MMSG_PACKETS	32
+#define	NET_MMSG_PACKETLEN	1400		// MAX_PACKETLEN in net_chan.cpp
+
+// datagrams drained by one recvmmsg, handed out by NET_GetPacket
+typedef struct netRecvRing_s {
+	struct mmsghdr		hdrs[NET_MMSG_PACKETS];
+	struct iovec		iovs[NET_MMSG_PACKETS];
+	struct sockaddr_in	from[NET_MMSG_PACKETS];
+	byte				data[NET_MMSG_PACKETS][MAX_MSGLEN + 1];
+	int					num;
+	int					next;
+} netRecvRing_t;
+
+// packets held back by Sys_SendPacket until NET_FlushPacketBatch
+typedef struct netSendQueue_s {
+	struct mmsghdr		hdrs[NET_MMSG_PACKETS];
+	struct iovec		iovs[NET_MMSG_PACKETS];
+	struct sockaddr_in	to[NET_MMSG_PACKETS];
+	netadrtype_t		type[NET_MMSG_PACKETS];
+	byte				data[NET_MMSG_PACKETS][NET_MMSG_PACKETLEN];
+	int					num;
+	qboolean			batching;
+} netSendQueue_t;
+
+static netRecvRing_t	netRecv;
+static netSendQueue_t	netSend;
+static qboolean			netMmsgUnsupported = qfalse;
+
+static qboolean NET_UseMmsg( void ) {
+	return (qboolean)( net_mmsg && net_mmsg->integer && !netMmsgUnsupported );
+}
+
+/*
+==================
+NET_FillRecvRing
+
+Returns qfalse if nothing is waiting or recvmmsg is not available
+==================
+*/
+static qboolean NET_FillRecvRing( void ) {
+	int i, ret, err;
+
+	for ( i = 0 ; i < NET_MMSG_PACKETS ; i++ ) {
+		netRecv.iovs[i].iov_base = netRecv.data[i];
+		netRecv.iovs[i].iov_len = sizeof( netRecv.data[i] );
+		memset( &netRecv.hdrs[i], 0, sizeof( netRecv.hdrs[i] ) );
+		netRecv.hdrs[i].msg_hdr.msg_name = &netRecv.from[i];
+		netRecv.hdrs[i].msg_hdr.msg_namelen = sizeof( netRecv.from[i] );
+		netRecv.hdrs[i].msg_hdr.msg_iov = &netRecv.iovs[i];
+		netRecv.hdrs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	netRecv.num = netRecv.next = 0;
+
+#ifdef _DEBUG
+	recvfromCount++;		// performance check
+#endif
+	ret = recvmmsg( ip_socket, netRecv.hdrs, NET_MMSG_PACKETS, MSG_DONTWAIT, NULL );
+
+	if ( ret == SOCKET_ERROR ) {
+		err = socketError;
+
+		if ( err == ENOSYS ) {
+			netMmsgUnsupported = qtrue;
+			return qfalse;
+		}
+
+		if( err == EAGAIN || err == ECONNRESET )
+			return qfalse;
+
+		Com_Printf( "NET_GetPacket: %s\n", NET_ErrorString() );
+		return qfalse;
+	}
+
+	netRecv.num = ret;
+	return (qboolean)( ret > 0 );
+}
+
+static qboolean NET_GetPacketBatched( netadr_t *net_from, msg_t *net_message ) {
+	int i, len;
+
+	// skip bad packets here, select won't report the ones left in the ring
+	do {
+		if ( netRecv.next == netRecv.num && !NET_FillRecvRing() ) {
+			return qfalse;
+		}
+
+		i = netRecv.next++;
+		len = netRecv.hdrs[i].msg_len;
+		memcpy( net_message->data, netRecv.data[i], Q_min( len, net_message->maxsize ) );
+	} while ( !NET_ReceivedPacket( &netRecv.from[i], netRecv.hdrs[i].msg_hdr.msg_namelen, len, net_from, net_message ) );
+
+	return qtrue;
+}
+#endif
+
+/*
+==================
+NET_GetPacket
+
+Receive one packet
+==================
+*/
 qboolean NET_GetPacket( netadr_t *net_from, msg_t *net_message, fd_set *fdr ) {
 	int ret, err;
 	socklen_t fromlen;
@@ -256,6 +398,17 @@ qboolean NET_GetPacket( netadr_t *net_from, msg_t *net_message, fd_set *fdr ) {
 		return qfalse;
 	}
 
+#ifdef NET_MMSG
+	if ( NET_UseMmsg() ) {
+		if ( NET_GetPacketBatched( net_from, net_message ) ) {
+			return qtrue;
+		}
+		if ( !netMmsgUnsupported ) {
+			return qfalse;
+		}
+	}
+#endif
+
 	fromlen = sizeof( from );
 #ifdef _DEBUG
 	recvfromCount++;		// performance check
@@ -272,37 +425,106 @@ qboolean NET_GetPacket( netadr_t *net_from, msg_t *net_message, fd_set *fdr ) {
 		return qfalse;
 	}
 
-	memset( from.sin_zero, 0, 8 );
+	return NET_ReceivedPacket( &from, fromlen, ret, net_from, net_message );
+}
 
-	if ( usingSocks && memcmp( &from, &socksRelayAddr, fromlen ) == 0 ) {
-		if ( ret < 10 || net_message->data[0] != 0 || net_message->data[1] != 0 || net_message->data[2] != 0 || net_message->data[3] != 1 ) {
-			return qfalse;
-		}
-		net_from->type = NA_IP;
-		net_from->ip[0] = net_message->data[4];
-		net_from->ip[1] = net_message->data[5];
-		net_from->ip[2] = net_message->data[6];
-		net_from->ip[3] = net_message->data[7];
-		memcpy( &net_from->port, &net_message->data[8], 2 );
-		net_message->readcount = 10;
+//=============================================================================
+
+static char socksBuf[4096];
+
+static void NET_SendError( netadrtype_t type ) {
+	int err = socketError;
+
+	// wouldblock is silent
+	if( err == EAGAIN ) {
+		return;
 	}
-	else {
-		SockadrToNetadr( &from, net_from );
-		net_message->readcount = 0;
+
+	// some PPP links do not allow broadcasts and return an error
+	if( err == EADDRNOTAVAIL && type == NA_BROADCAST ) {
+		return;
 	}
 
-	if( ret >= net_message->maxsize ) {
-		Com_Printf( "Oversize packet from %s\n", NET_AdrToString (*net_from) );
-		return qfalse;
+	Com_Printf( "NET_SendPacket: %s\n", NET_ErrorString() );
+}
+
+#ifdef NET_MMSG
+/*
+==================
+NET_BeginPacketBatch
+
+Queue up the packets sent until NET_FlushPacketBatch
+==================
+*/
+void NET_BeginPacketBatch( void ) {
+	netSend.batching = NET_UseMmsg();
+}
+
+/*
+==================
+NET_FlushPacketBatch
+==================
+*/
+void NET_FlushPacketBatch( void ) {
+	int sent = 0;
+	int ret;
+
+	while ( sent < netSend.num && ip_socket != INVALID_SOCKET ) {
+		if ( netMmsgUnsupported ) {
+			ret = sendto( ip_socket, (const char *)netSend.data[sent], netSend.iovs[sent].iov_len, 0,
+				(sockaddr *)&netSend.to[sent], sizeof(netSend.to[sent]) );
+			if ( ret == SOCKET_ERROR ) {
+				NET_SendError( netSend.type[sent] );
+			}
+			sent++;
+			continue;
+		}
+
+		ret = sendmmsg( ip_socket, netSend.hdrs + sent, netSend.num - sent, 0 );
+		if ( ret == SOCKET_ERROR ) {
+			if ( socketError == ENOSYS ) {
+				netMmsgUnsupported = qtrue;
+				continue;
+			}
+			// only the first packet failed, drop it like Sys_SendPacket would
+			NET_SendError( netSend.type[sent] );
+			sent++;
+			continue;
+		}
+		sent += ret;
 	}
 
-	net_message->cursize = ret;
-	return qtrue;
+	netSend.num = 0;
+	netSend.batching = qfalse;
 }
 
-//=============================================================================
+static void NET_QueuePacket( int length, const void *data, netadr_t *to, struct sockaddr_in *addr ) {
+	int i;
+
+	if ( netSend.num == NET_MMSG_PACKETS ) {
+		NET_FlushPacketBatch();
+		netSend.batching = qtrue;
+	}
+
+	i = netSend.num++;
+	memcpy( netSend.data[i], data, length );
+	netSend.to[i] = *addr;
+	netSend.type[i] = to->type;
+	netSend.iovs[i].iov_base = netSend.data[i];
+	netSend.iovs[i].iov_len = length;
+	memset( &netSend.hdrs[i], 0, sizeof( netSend.hdrs[i] ) );
+	netSend.hdrs[i].msg_hdr.msg_name = &netSend.to[i];
+	netSend.hdrs[i].msg_hdr.msg_namelen = sizeof( netSend.to[i] );
+	netSend.hdrs[i].msg_hdr.msg_iov = &netSend.iovs[i];
+	netSend.hdrs[i].msg_hdr.msg_iovlen = 1;
+}
+#else
+void NET_BeginPacketBatch( void ) {
+}
 
-static char socksBuf[4096];
+void NET_FlushPacketBatch( void ) {
+}
+#endif
 
 /*
 ==================
@@ -324,6 +546,18 @@ void Sys_SendPacket( int length, const void *data, netadr_t to ) {
 
 	NetadrToSockadr( &to, &addr );
 
+#ifdef NET_MMSG
+	if ( netSend.batching ) {
+		if ( !usingSocks && length <= NET_MMSG_PACKETLEN ) {
+			NET_QueuePacket( length, data, &to, &addr );
+			return;
+		}
+		// keep the packets in order
+		NET_FlushPacketBatch();
+		netSend.batching = qtrue;
+	}
+#endif
+
 	if( usingSocks && to.type == NA_IP ) {
 		socksBuf[0] = 0;	// reserved
 		socksBuf[1] = 0;
@@ -338,19 +572,7 @@ void Sys_SendPacket( int length, const void *data, netadr_t to ) {
 		ret = sendto( ip_socket, (const char *)data, length, 0, (sockaddr *)&addr, sizeof(addr) );
 	}
 	if( ret == SOCKET_ERROR ) {
-		int err = socketError;
-
-		// wouldblock is silent
-		if( err == EAGAIN ) {
-			return;
-		}
-
-		// some PPP links do not allow broadcasts and return an error
-		if( err == EADDRNOTAVAIL && to.type == NA_BROADCAST ) {
-			return;
-		}
-
-		Com_Printf( "NET_SendPacket: %s\n", NET_ErrorString() );
+		NET_SendError( to.type );
 	}
 }
 
@@ -893,6 +1115,10 @@ static qboolean NET_GetCvars( void ) {
 
 	net_dropsim = Cvar_Get( "net_dropsim", "", CVAR_TEMP);
 
+#ifdef NET_MMSG
+	net_mmsg = Cvar_Get( "net_mmsg", "1", CVAR_ARCHIVE_ND, "Receive and send several packets per system call" );
+#endif
+
 	return modified ? qtrue : qfalse;
 }
 
@@ -939,6 +1165,10 @@ void NET_Config( qboolean enableNetworking ) {
 	}
 
 	if ( stop ) {
+#ifdef NET_MMSG
+		netRecv.num = netRecv.next = 0;
+		netSend.num = 0;
+#endif
 		if ( ip_socket != INVALID_SOCKET ) {
 			closesocket( ip_socket );
 			ip_socket = INVALID_SOCKET;
@@ -90,6 +90,8 @@ void MSG_WriteDeltaEntity( msg_t *msg, struct entityState_s *from, struct entity
 						   , qboolean force );
 void MSG_ReadDeltaEntity( msg_t *msg, entityState_t *from, entityState_t *to,
 						 int number );
+qboolean MSG_WriteDeltaEntityCached( msg_t *msg, entityState_t *from, entityState_t *to, qboolean force );
+void MSG_ClearDeltaEntityCache( void );
 
 #ifdef _ONEBIT_COMBO
 void MSG_WriteDeltaPlayerstate( msg_t *msg, struct playerState_s *from, struct playerState_s *to, int *bitComboDelta, int *bitNumDelta, qboolean isVehiclePS = qfalse );
@@ -155,6 +157,8 @@ qboolean	NET_GetLoopPacket (netsrc_t sock, netadr_t *net_from, msg_t *net_messag
 void		NET_Sleep(int msec);
 
 void		Sys_SendPacket( int length, const void *data, netadr_t to );
+void		NET_BeginPacketBatch( void );
+void		NET_FlushPacketBatch( void );
 //Does NOT parse port numbers, only base addresses.
 qboolean	Sys_StringToAdr( const char *s, netadr_t *a );
 qboolean	Sys_IsLANAddress (netadr_t adr);
@@ -762,6 +766,18 @@ void 		QDECL Com_Printf( const char *fmt, ... );
 void 		QDECL Com_DPrintf( const char *fmt, ... );
 void		QDECL Com_OPrintf( const char *fmt, ...); // Outputs to the VC / Windows Debug window (only in debug compile)
 void 		NORETURN QDECL Com_Error( int code, const char *fmt, ... );
+
+// prints and errors of engine code running on a worker thread, kept for the main thread
+typedef struct comDeferredOutput_s {
+	char		print[2048];			// cut short if there's more
+	qboolean	error;
+	int			errorCode;
+	char		errorMessage[MAX_STRING_CHARS];
+} comDeferredOutput_t;
+
+void		Com_BeginDeferredOutput( comDeferredOutput_t *output );
+void		Com_EndDeferredOutput( void );
+void		Com_RaiseDeferredOutput( const comDeferredOutput_t *output );
 void 		NORETURN Com_Quit_f( void );
 int			Com_EventLoop( void );
 int			Com_Milliseconds( void );	// will be journaled properly
@@ -1040,6 +1056,16 @@ typedef struct huffman_s {
 	huff_t		decompressor;
 } huffman_t;
 
+// code tables of a huff_t that no longer changes, see Huff_BuildCodes
+#define HUFF_LOOKUP_BITS	11
+
+typedef struct huffCodes_s {
+	unsigned int	code[HMAX+1];		// first bit sent in bit 0
+	int				length[HMAX+1];		// 0 if the symbol isn't in the tree or the code is too long
+	unsigned short	lookup[1<<HUFF_LOOKUP_BITS];	// symbol | length << 9 for the next HUFF_LOOKUP_BITS bits, 0 for longer codes
+	node_t			*tree;
+} huffCodes_t;
+
 void	Huff_Compress(msg_t *buf, int offset);
 void	Huff_Decompress(msg_t *buf, int offset);
 void	Huff_Init(huffman_t *huff);
@@ -1050,6 +1076,11 @@ void	Huff_offsetReceive (node_t *node, int *ch, byte *fin, int *offset);
 void	Huff_offsetTransmit (huff_t *huff, int ch, byte *fout, int *offset);
 void	Huff_putBit( int bit, byte *fout, int *offset);
 int		Huff_getBit( byte *fout, int *offset);
+void	Huff_putBits( unsigned int value, int numBits, byte *fout, int *offset );
+int		Huff_getBits( const byte *fin, int numBits, int *offset );
+void	Huff_BuildCodes( const huff_t *huff, huffCodes_t *codes );
+void	Huff_offsetTransmitCodes( const huffCodes_t *codes, huff_t *huff, int ch, byte *fout, int *offset );
+int		Huff_offsetReceiveCodes( const huffCodes_t *codes, const byte *fin, int *offset, int maxOffset );
 
 extern huffman_t clientHuffTables;
 
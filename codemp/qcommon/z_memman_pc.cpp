@@ -43,14 +43,40 @@ void CIN_CloseAllVideos();
 
 // This handles zone memory allocation.
 // It is a wrapper around malloc with a tag id and a magic number at the start
+//
+// Blocks are kept in one list per tag, so freeing a tag doesn't have to look at
+//	every other block.  The hunk tags are bump allocated out of big arena chunks
+//	that go back a chunk at a time, and small blocks of other tags come out of
+//	per-size pools instead of their own mallocs.  A pool chunk goes back once all
+//	its blocks are freed, but each pool keeps one empty chunk so a pool that sits
+//	right at a chunk boundary doesn't malloc and free a chunk every time.
 
 #define ZONE_MAGIC			0x21436587
 
+#define ZONE_ALIGN			16
+#define ZONE_ROUNDUP(x)		(((x) + ZONE_ALIGN - 1) & ~(ZONE_ALIGN - 1))
+
+#define ZONE_ARENA_CHUNK	(1024*1024)
+#define ZONE_ARENA_MAXBLOCK	(ZONE_ARENA_CHUNK / 4)	// bigger ones get their own malloc
+
+#define ZONE_POOL_CLASSES	5						// 16, 32, 64, 128 and 256 bytes
+#define ZONE_POOL_MAXSIZE	(16 << (ZONE_POOL_CLASSES - 1))
+#define ZONE_POOL_CHUNK		(64*1024)
+
+typedef enum
+{
+	ZONE_KIND_MALLOC,		// own malloc, goes back with free()
+	ZONE_KIND_POOL,			// pool slot, goes back on its chunk's free list
+	ZONE_KIND_ARENA,		// arena memory, only reclaimed when the whole tag is freed
+} zoneKind_t;
+
 typedef struct zoneHeader_s
 {
 		int					iMagic;
 		memtag_t			eTag;
 		int					iSize;
+		short				sKind;
+		short				sSlot;		// index of a pool slot in its chunk
 struct	zoneHeader_s		*pNext;
 struct	zoneHeader_s		*pPrev;
 } zoneHeader_t;
@@ -85,52 +111,304 @@ typedef struct zoneStats_s
 
 } zoneStats_t;
 
+// a malloc'd piece of an arena or pool, the blocks follow at ZONE_ALIGN
+typedef struct zoneChunk_s
+{
+struct	zoneChunk_s			*pNext;
+struct	zoneChunk_s			*pPrev;		// pools only
+		zoneHeader_t		*pFree;		// pools only, the chunk's free slots
+		int					iSize;
+		int					iUsed;		// bytes handed out, or live slots of a pool chunk
+} zoneChunk_t;
+
+static inline byte *ZoneChunkData(zoneChunk_t *pChunk)
+{
+	return (byte *)pChunk + ZONE_ROUNDUP(sizeof(zoneChunk_t));
+}
+
+typedef struct zoneArena_s
+{
+	zoneChunk_t				*pChunks;		// the one being filled first
+	int						iChunks;
+	int						iLiveSize;		// not yet Z_Free'd, for the stats
+	int						iLiveCount;
+} zoneArena_t;
+
+typedef struct zonePool_s
+{
+	zoneChunk_t				*pChunks;		// ones with free slots, allocated from first
+	zoneChunk_t				*pFull;
+	int						iChunks;
+	int						iEmpty;			// chunks without live slots, at most one
+} zonePool_t;
+
 typedef struct zone_s
 {
 	zoneStats_t				Stats;
-	zoneHeader_t			Header;
+	zoneHeader_t			TagHeaders[TAG_COUNT];
+	zoneArena_t				Arenas[TAG_COUNT];
+	zonePool_t				Pools[ZONE_POOL_CLASSES];
 } zone_t;
 
 cvar_t	*com_validateZone;
 
 zone_t	TheZone = {};
 
+// only Hunk_Alloc uses these, and hunk memory stays until Hunk_Clear anyway
+static inline qboolean Zone_TagUsesArena(memtag_t eTag)
+{
+	return (qboolean)(eTag == TAG_HUNK_MARK1 || eTag == TAG_HUNK_MARK2);
+}
 
-// Scans through the linked list of mallocs and makes sure no data has been overwritten
+static inline int Zone_BlockSize(int iSize)
+{
+	return ZONE_ROUNDUP(sizeof(zoneHeader_t) + iSize + sizeof(zoneTail_t));
+}
 
-void Z_Validate(void)
+static zoneChunk_t *Zone_AllocChunk(int iSize)
 {
-	if(!com_validateZone || !com_validateZone->integer)
+	zoneChunk_t *pChunk = (zoneChunk_t *) malloc(ZONE_ROUNDUP(sizeof(zoneChunk_t)) + iSize);
+	if (pChunk)
 	{
-		return;
+		pChunk->pNext = pChunk->pPrev = NULL;
+		pChunk->pFree = NULL;
+		pChunk->iSize = iSize;
+		pChunk->iUsed = 0;
 	}
+	return pChunk;
+}
 
-	zoneHeader_t *pMemory = TheZone.Header.pNext;
-	while (pMemory)
+static void Zone_FreeChunks(zoneChunk_t *pChunk)
+{
+	while (pChunk)
 	{
-		#ifdef DETAILED_ZONE_DEBUG_CODE
-		// this won't happen here, but wtf?
-		int& iAllocCount = mapAllocatedZones[pMemory];
-		if (iAllocCount <= 0)
+		zoneChunk_t *pNext = pChunk->pNext;
+		free(pChunk);
+		pChunk = pNext;
+	}
+}
+
+// Bump allocates iRealSize bytes for a block of eTag, NULL if out of memory
+static zoneHeader_t *Zone_ArenaAlloc(memtag_t eTag, int iRealSize)
+{
+	zoneArena_t *pArena = &TheZone.Arenas[eTag];
+	zoneChunk_t *pChunk = pArena->pChunks;
+
+	iRealSize = ZONE_ROUNDUP(iRealSize);
+	if (!pChunk || pChunk->iUsed + iRealSize > pChunk->iSize)
+	{
+		pChunk = Zone_AllocChunk(ZONE_ARENA_CHUNK);
+		if (!pChunk)
 		{
-			Com_Error(ERR_FATAL, "Z_Validate(): Bad block allocation count!");
-			return;
+			return NULL;
 		}
-		#endif
+		pChunk->pNext = pArena->pChunks;
+		pArena->pChunks = pChunk;
+		pArena->iChunks++;
+	}
+
+	zoneHeader_t *pMemory = (zoneHeader_t *) (ZoneChunkData(pChunk) + pChunk->iUsed);
+	pChunk->iUsed += iRealSize;
+	return pMemory;
+}
+
+static inline int Zone_PoolForSize(int iSize)
+{
+	int iPool = 0;
+	while ((16 << iPool) < iSize)
+	{
+		iPool++;
+	}
+	return iPool;
+}
+
+static inline int Zone_PoolSlotSize(int iPool)
+{
+	return Zone_BlockSize(16 << iPool);
+}
+
+static void Zone_LinkChunk(zoneChunk_t **ppList, zoneChunk_t *pChunk)
+{
+	pChunk->pPrev = NULL;
+	pChunk->pNext = *ppList;
+	if (pChunk->pNext)
+	{
+		pChunk->pNext->pPrev = pChunk;
+	}
+	*ppList = pChunk;
+}
+
+static void Zone_UnlinkChunk(zoneChunk_t **ppList, zoneChunk_t *pChunk)
+{
+	if (pChunk->pPrev)
+	{
+		pChunk->pPrev->pNext = pChunk->pNext;
+	}
+	else
+	{
+		*ppList = pChunk->pNext;
+	}
+	if (pChunk->pNext)
+	{
+		pChunk->pNext->pPrev = pChunk->pPrev;
+	}
+}
 
-		if(pMemory->iMagic != ZONE_MAGIC)
+// Takes a slot off the first chunk of iPool with one free, NULL if out of memory
+static zoneHeader_t *Zone_PoolAlloc(int iPool, short *psSlot)
+{
+	zonePool_t *pPool = &TheZone.Pools[iPool];
+	zoneChunk_t *pChunk = pPool->pChunks;
+	const int iSlotSize = Zone_PoolSlotSize(iPool);
+
+	if (!pChunk)
+	{
+		pChunk = Zone_AllocChunk(ZONE_POOL_CHUNK);
+		if (!pChunk)
 		{
-			Com_Error(ERR_FATAL, "Z_Validate(): Corrupt zone header!");
-			return;
+			return NULL;
 		}
+		Zone_LinkChunk(&pPool->pChunks, pChunk);
+		pPool->iChunks++;
+		pPool->iEmpty++;
 
-		if (ZoneTailFromHeader(pMemory)->iMagic != ZONE_MAGIC)
+		for (int i = ZONE_POOL_CHUNK / iSlotSize - 1; i >= 0; i--)
 		{
-			Com_Error(ERR_FATAL, "Z_Validate(): Corrupt zone tail!");
-			return;
+			zoneHeader_t *pSlot = (zoneHeader_t *) (ZoneChunkData(pChunk) + i * iSlotSize);
+			pSlot->pNext = pChunk->pFree;
+			pChunk->pFree = pSlot;
+		}
+	}
+
+	zoneHeader_t *pMemory = pChunk->pFree;
+	pChunk->pFree = pMemory->pNext;
+	if (!pChunk->iUsed++)
+	{
+		pPool->iEmpty--;
+	}
+	if (!pChunk->pFree)
+	{
+		Zone_UnlinkChunk(&pPool->pChunks, pChunk);
+		Zone_LinkChunk(&pPool->pFull, pChunk);
+	}
+
+	*psSlot = (short)(((byte *)pMemory - ZoneChunkData(pChunk)) / iSlotSize);
+	return pMemory;
+}
+
+// Puts a slot back on its chunk, and frees the chunk once it's a second empty one
+static void Zone_PoolFree(zoneHeader_t *pMemory)
+{
+	const int iPool = Zone_PoolForSize(pMemory->iSize);
+	zonePool_t *pPool = &TheZone.Pools[iPool];
+	zoneChunk_t *pChunk = (zoneChunk_t *) ((byte *)pMemory - pMemory->sSlot * Zone_PoolSlotSize(iPool) - ZONE_ROUNDUP(sizeof(zoneChunk_t)));
+
+	if (!pChunk->pFree)
+	{
+		Zone_UnlinkChunk(&pPool->pFull, pChunk);
+		Zone_LinkChunk(&pPool->pChunks, pChunk);
+	}
+	pMemory->pNext = pChunk->pFree;
+	pChunk->pFree = pMemory;
+
+	if (!--pChunk->iUsed)
+	{
+		if (pPool->iEmpty)
+		{
+			Zone_UnlinkChunk(&pPool->pChunks, pChunk);
+			free(pChunk);
+			pPool->iChunks--;
+		}
+		else
+		{
+			pPool->iEmpty++;
+		}
+	}
+}
+
+static void Zone_LinkBlock(zoneHeader_t *pMemory)
+{
+	zoneHeader_t *pHeader = &TheZone.TagHeaders[pMemory->eTag];
+
+	pMemory->pNext = pHeader->pNext;
+	pHeader->pNext = pMemory;
+	if (pMemory->pNext)
+	{
+		pMemory->pNext->pPrev = pMemory;
+	}
+	pMemory->pPrev = pHeader;
+}
+
+static void Zone_UnlinkBlock(zoneHeader_t *pMemory)
+{
+	// Sanity checks...
+	//
+	assert(pMemory->pPrev->pNext == pMemory);
+	assert(!pMemory->pNext || (pMemory->pNext->pPrev == pMemory));
+
+	pMemory->pPrev->pNext = pMemory->pNext;
+	if(pMemory->pNext)
+	{
+		pMemory->pNext->pPrev = pMemory->pPrev;
+	}
+}
+
+static void Zone_ValidateBlock(zoneHeader_t *pMemory)
+{
+	#ifdef DETAILED_ZONE_DEBUG_CODE
+	// this won't happen here, but wtf?
+	int& iAllocCount = mapAllocatedZones[pMemory];
+	if (iAllocCount <= 0)
+	{
+		Com_Error(ERR_FATAL, "Z_Validate(): Bad block allocation count!");
+		return;
+	}
+	#endif
+
+	if(pMemory->iMagic != ZONE_MAGIC)
+	{
+		Com_Error(ERR_FATAL, "Z_Validate(): Corrupt zone header!");
+		return;
+	}
+
+	if (ZoneTailFromHeader(pMemory)->iMagic != ZONE_MAGIC)
+	{
+		Com_Error(ERR_FATAL, "Z_Validate(): Corrupt zone tail!");
+		return;
+	}
+}
+
+// Scans through the linked list of mallocs and makes sure no data has been overwritten
+
+void Z_Validate(void)
+{
+	if(!com_validateZone || !com_validateZone->integer)
+	{
+		return;
+	}
+
+	for (int i=0; i<TAG_COUNT; i++)
+	{
+		zoneHeader_t *pMemory = TheZone.TagHeaders[i].pNext;
+		while (pMemory)
+		{
+			Zone_ValidateBlock(pMemory);
+			pMemory = pMemory->pNext;
 		}
 
-		pMemory = pMemory->pNext;
+		// arena blocks aren't linked, but they sit back to back in their chunks
+		for (zoneChunk_t *pChunk = TheZone.Arenas[i].pChunks; pChunk; pChunk = pChunk->pNext)
+		{
+			for (int iOffset = 0; iOffset < pChunk->iUsed; )
+			{
+				pMemory = (zoneHeader_t *) (ZoneChunkData(pChunk) + iOffset);
+				if (pMemory->iMagic)	// zeroed by Z_Free
+				{
+					Zone_ValidateBlock(pMemory);
+				}
+				iOffset += Zone_BlockSize(pMemory->iSize);
+			}
+		}
 	}
 }
 
@@ -154,20 +432,20 @@ typedef struct StaticMem_s {
 #pragma pack(pop)
 
 StaticZeroMem_t gZeroMalloc  =
-	{ {ZONE_MAGIC, TAG_STATIC,0,NULL,NULL},{ZONE_MAGIC}};
+	{ {ZONE_MAGIC, TAG_STATIC,0,ZONE_KIND_MALLOC,0,NULL,NULL},{ZONE_MAGIC}};
 StaticMem_t gEmptyString =
-	{ {ZONE_MAGIC, TAG_STATIC,2,NULL,NULL},{'\0','\0'},{ZONE_MAGIC}};
+	{ {ZONE_MAGIC, TAG_STATIC,2,ZONE_KIND_MALLOC,0,NULL,NULL},{'\0','\0'},{ZONE_MAGIC}};
 StaticMem_t gNumberString[] = {
-	{ {ZONE_MAGIC, TAG_STATIC,2,NULL,NULL},{'0','\0'},{ZONE_MAGIC}},
-	{ {ZONE_MAGIC, TAG_STATIC,2,NULL,NULL},{'1','\0'},{ZONE_MAGIC}},
-	{ {ZONE_MAGIC, TAG_STATIC,2,NULL,NULL},{'2','\0'},{ZONE_MAGIC}},
-	{ {ZONE_MAGIC, TAG_STATIC,2,NULL,NULL},{'3','\0'},{ZONE_MAGIC}},
-	{ {ZONE_MAGIC, TAG_STATIC,2,NULL,NULL},{'4','\0'},{ZONE_MAGIC}},
-	{ {ZONE_MAGIC, TAG_STATIC,2,NULL,NULL},{'5','\0'},{ZONE_MAGIC}},
-	{ {ZONE_MAGIC, TAG_STATIC,2,NULL,NULL},{'6','\0'},{ZONE_MAGIC}},
-	{ {ZONE_MAGIC, TAG_STATIC,2,NULL,NULL},{'7','\0'},{ZONE_MAGIC}},
-	{ {ZONE_MAGIC, TAG_STATIC,2,NULL,NULL},{'8','\0'},{ZONE_MAGIC}},
-	{ {ZONE_MAGIC, TAG_STATIC,2,NULL,NULL},{'9','\0'},{ZONE_MAGIC}},
+	{ {ZONE_MAGIC, TAG_STATIC,2,ZONE_KIND_MALLOC,0,NULL,NULL},{'0','\0'},{ZONE_MAGIC}},
+	{ {ZONE_MAGIC, TAG_STATIC,2,ZONE_KIND_MALLOC,0,NULL,NULL},{'1','\0'},{ZONE_MAGIC}},
+	{ {ZONE_MAGIC, TAG_STATIC,2,ZONE_KIND_MALLOC,0,NULL,NULL},{'2','\0'},{ZONE_MAGIC}},
+	{ {ZONE_MAGIC, TAG_STATIC,2,ZONE_KIND_MALLOC,0,NULL,NULL},{'3','\0'},{ZONE_MAGIC}},
+	{ {ZONE_MAGIC, TAG_STATIC,2,ZONE_KIND_MALLOC,0,NULL,NULL},{'4','\0'},{ZONE_MAGIC}},
+	{ {ZONE_MAGIC, TAG_STATIC,2,ZONE_KIND_MALLOC,0,NULL,NULL},{'5','\0'},{ZONE_MAGIC}},
+	{ {ZONE_MAGIC, TAG_STATIC,2,ZONE_KIND_MALLOC,0,NULL,NULL},{'6','\0'},{ZONE_MAGIC}},
+	{ {ZONE_MAGIC, TAG_STATIC,2,ZONE_KIND_MALLOC,0,NULL,NULL},{'7','\0'},{ZONE_MAGIC}},
+	{ {ZONE_MAGIC, TAG_STATIC,2,ZONE_KIND_MALLOC,0,NULL,NULL},{'8','\0'},{ZONE_MAGIC}},
+	{ {ZONE_MAGIC, TAG_STATIC,2,ZONE_KIND_MALLOC,0,NULL,NULL},{'9','\0'},{ZONE_MAGIC}},
 };
 
 qboolean gbMemFreeupOccured = qfalse;
@@ -188,6 +466,29 @@ void *Z_Malloc(int iSize, memtag_t eTag, qboolean bZeroit /* = qfalse */, int iU
 	// Allocate a chunk...
 	//
 	zoneHeader_t *pMemory = NULL;
+	short sKind = ZONE_KIND_MALLOC;
+	short sSlot = 0;
+
+	if (Zone_TagUsesArena(eTag) && iRealSize <= ZONE_ARENA_MAXBLOCK)
+	{
+		pMemory = Zone_ArenaAlloc(eTag, iRealSize);
+		sKind = ZONE_KIND_ARENA;
+	}
+	else if (iSize <= ZONE_POOL_MAXSIZE)
+	{
+		pMemory = Zone_PoolAlloc(Zone_PoolForSize(iSize), &sSlot);
+		sKind = ZONE_KIND_POOL;
+	}
+
+	if (pMemory == NULL)
+	{
+		sKind = ZONE_KIND_MALLOC;	// if those failed, go through the usual recovery below
+	}
+	else if (bZeroit)
+	{
+		memset(pMemory, 0, iRealSize);
+	}
+
 	while (pMemory == NULL)
 	{
 		if (gbMemFreeupOccured)
@@ -286,13 +587,18 @@ void *Z_Malloc(int iSize, memtag_t eTag, qboolean bZeroit /* = qfalse */, int iU
 	pMemory->iMagic	= ZONE_MAGIC;
 	pMemory->eTag	= eTag;
 	pMemory->iSize	= iSize;
-	pMemory->pNext  = TheZone.Header.pNext;
-	TheZone.Header.pNext = pMemory;
-	if (pMemory->pNext)
+	pMemory->sKind	= sKind;
+	pMemory->sSlot	= sSlot;
+	if (sKind == ZONE_KIND_ARENA)
 	{
-		pMemory->pNext->pPrev = pMemory;
+		pMemory->pNext = pMemory->pPrev = NULL;
+		TheZone.Arenas[eTag].iLiveSize += iSize;
+		TheZone.Arenas[eTag].iLiveCount++;
+	}
+	else
+	{
+		Zone_LinkBlock(pMemory);
 	}
-	pMemory->pPrev = &TheZone.Header;
 	//
 	// add tail...
 	//
@@ -349,6 +655,13 @@ void Z_MorphMallocTag( void *pvAddress, memtag_t eDesiredTag )
 		return;	// won't get here
 	}
 
+	if (pMemory->sKind == ZONE_KIND_ARENA)
+	{
+		// it would go away with the arena's tag, not the new one
+		Com_Error(ERR_FATAL, "Z_MorphMallocTag(): Can't retag hunk memory!");
+		return;	// won't get here
+	}
+
 	// DEC existing tag stats...
 	//
 //	TheZone.Stats.iCurrent	- unchanged
@@ -358,7 +671,9 @@ void Z_MorphMallocTag( void *pvAddress, memtag_t eDesiredTag )
 
 	// morph...
 	//
+	Zone_UnlinkBlock(pMemory);
 	pMemory->eTag = eDesiredTag;
+	Zone_LinkBlock(pMemory);
 
 	// INC new tag stats...
 	//
@@ -379,19 +694,28 @@ static void Zone_FreeBlock(zoneHeader_t *pMemory)
 		TheZone.Stats.iSizesPerTag	[pMemory->eTag] -= pMemory->iSize;
 		TheZone.Stats.iCountsPerTag	[pMemory->eTag]--;
 
-		// Sanity checks...
-		//
-		assert(pMemory->pPrev->pNext == pMemory);
-		assert(!pMemory->pNext || (pMemory->pNext->pPrev == pMemory));
-
 		// Unlink and free...
 		//
-		pMemory->pPrev->pNext = pMemory->pNext;
-		if(pMemory->pNext)
+		switch (pMemory->sKind)
 		{
-			pMemory->pNext->pPrev = pMemory->pPrev;
+		case ZONE_KIND_ARENA:
+			// stays in the arena until the tag goes
+			TheZone.Arenas[pMemory->eTag].iLiveSize -= pMemory->iSize;
+			TheZone.Arenas[pMemory->eTag].iLiveCount--;
+			pMemory->iMagic = 0;
+			break;
+
+		case ZONE_KIND_POOL:
+			Zone_UnlinkBlock(pMemory);
+			pMemory->iMagic = 0;
+			Zone_PoolFree(pMemory);
+			break;
+
+		default:
+			Zone_UnlinkBlock(pMemory);
+			free (pMemory);
+			break;
 		}
-		free (pMemory);
 
 
 		#ifdef DETAILED_ZONE_DEBUG_CODE
@@ -485,15 +809,47 @@ void Z_TagFree(memtag_t eTag)
 //	int iZoneBlocks = TheZone.Stats.iCount;
 //#endif
 
-	zoneHeader_t *pMemory = TheZone.Header.pNext;
+	if (eTag == TAG_ALL)
+	{
+		for (int i=0; i<TAG_COUNT; i++)
+		{
+			if (i != TAG_ALL)
+			{
+				Z_TagFree((memtag_t)i);
+			}
+		}
+		return;
+	}
+
+	zoneHeader_t *pMemory = TheZone.TagHeaders[eTag].pNext;
 	while (pMemory)
 	{
 		zoneHeader_t *pNext = pMemory->pNext;
-		if ( (eTag == TAG_ALL) || (pMemory->eTag == eTag))
+		Zone_FreeBlock(pMemory);
+		pMemory = pNext;
+	}
+
+	// the arena blocks go all at once
+	zoneArena_t *pArena = &TheZone.Arenas[eTag];
+	if (pArena->pChunks)
+	{
+		TheZone.Stats.iCount -= pArena->iLiveCount;
+		TheZone.Stats.iCurrent -= pArena->iLiveSize;
+		TheZone.Stats.iSizesPerTag	[eTag] -= pArena->iLiveSize;
+		TheZone.Stats.iCountsPerTag	[eTag] -= pArena->iLiveCount;
+
+		#ifdef DETAILED_ZONE_DEBUG_CODE
+		for (map<void*,int>::iterator it = mapAllocatedZones.begin(); it != mapAllocatedZones.end(); ++it)
 		{
-			Zone_FreeBlock(pMemory);
+			if (((zoneHeader_t *)it->first)->eTag == eTag && ((zoneHeader_t *)it->first)->sKind == ZONE_KIND_ARENA)
+			{
+				it->second = 0;
+			}
 		}
-		pMemory = pNext;
+		#endif
+
+		Zone_FreeChunks(pArena->pChunks);
+		memset(pArena, 0, sizeof(*pArena));
 	}
 
 // these stupid pragmas don't work here???!?!?!
@@ -548,6 +904,21 @@ static void Z_Stats_f(void)
 									TheZone.Stats.iPeak,
 									         (float)TheZone.Stats.iPeak / 1024.0f / 1024.0f
 				);
+
+	int iArenaChunks = 0;
+	int iPoolChunks = 0;
+	for (int i=0; i<TAG_COUNT; i++)
+	{
+		iArenaChunks += TheZone.Arenas[i].iChunks;
+	}
+	for (int i=0; i<ZONE_POOL_CLASSES; i++)
+	{
+		iPoolChunks += TheZone.Pools[i].iChunks;
+	}
+	Com_Printf("%d arena chunks (%.2fMB), %d small block pool chunks (%.2fMB)\n",
+									iArenaChunks, (float)iArenaChunks * ZONE_ARENA_CHUNK / 1024.0f / 1024.0f,
+									iPoolChunks, (float)iPoolChunks * ZONE_POOL_CHUNK / 1024.0f / 1024.0f
+				);
 }
 
 // Gives a detailed breakdown of the memory blocks in the zone
@@ -599,6 +970,19 @@ void Com_ShutdownZoneMemory(void)
 		assert(!TheZone.Stats.iCount);
 		assert(!TheZone.Stats.iCurrent);
 	}
+
+	// arenas whose blocks were all Z_Free'd, and the pools
+	for (int i=0; i<TAG_COUNT; i++)
+	{
+		Zone_FreeChunks(TheZone.Arenas[i].pChunks);
+		memset(&TheZone.Arenas[i], 0, sizeof(TheZone.Arenas[i]));
+	}
+	for (int i=0; i<ZONE_POOL_CLASSES; i++)
+	{
+		Zone_FreeChunks(TheZone.Pools[i].pChunks);
+		Zone_FreeChunks(TheZone.Pools[i].pFull);
+		memset(&TheZone.Pools[i], 0, sizeof(TheZone.Pools[i]));
+	}
 }
 
 // Initialises the zone memory system
@@ -606,7 +990,10 @@ void Com_ShutdownZoneMemory(void)
 void Com_InitZoneMemory( void )
 {
 	memset(&TheZone, 0, sizeof(TheZone));
-	TheZone.Header.iMagic = ZONE_MAGIC;
+	for (int i=0; i<TAG_COUNT; i++)
+	{
+		TheZone.TagHeaders[i].iMagic = ZONE_MAGIC;
+	}
 }
 
 void Com_InitZoneMemoryVars( void ) {
@@ -673,16 +1060,28 @@ void Com_TouchMemory( void ) {
 
 	sum = 0;
 
-	zoneHeader_t *pMemory = TheZone.Header.pNext;
-	while (pMemory)
+	for (int iTag=0; iTag<TAG_COUNT; iTag++)
 	{
-		byte *pMem = (byte *) &pMemory[1];
-		j = pMemory->iSize >> 2;
-		for (i=0; i<j; i+=64){
-			sum += ((int*)pMem)[i];
+		zoneHeader_t *pMemory = TheZone.TagHeaders[iTag].pNext;
+		while (pMemory)
+		{
+			byte *pMem = (byte *) &pMemory[1];
+			j = pMemory->iSize >> 2;
+			for (i=0; i<j; i+=64){
+				sum += ((int*)pMem)[i];
+			}
+
+			pMemory = pMemory->pNext;
 		}
 
-		pMemory = pMemory->pNext;
+		for (zoneChunk_t *pChunk = TheZone.Arenas[iTag].pChunks; pChunk; pChunk = pChunk->pNext)
+		{
+			int *pMem = (int *) ZoneChunkData(pChunk);
+			j = pChunk->iUsed >> 2;
+			for (i=0; i<j; i+=64){
+				sum += pMem[i];
+			}
+		}
 	}
 
 //	end = Sys_Milliseconds();
@@ -386,7 +386,33 @@ int G2_DecideTraceLod(CGhoul2Info &ghoul2, int useLod)
 	return returnLod;
 }
 
-void R_TransformEachSurface( const mdxmSurface_t *surface, vec3_t scale, IHeapAllocator *G2VertSpace, size_t *TransformedVertsArray,CBoneCache *boneCache)
+// can the trace touch any poly of this surface once it's skinned?
+static bool G2_TraceCullSurface(const g2TraceCull_t &cull, const mdxmSurface_t *surface, const model_t *currentModel, int lod, const vec3_t scale, CBoneCache *boneCache)
+{
+	if (!currentModel->g2SurfaceBounds)
+	{
+		return true;
+	}
+	const g2BoneBounds_t *boneBounds = currentModel->g2SurfaceBounds[lod * currentModel->mdxm->numSurfaces + surface->thisSurfaceIndex];
+	if (!boneBounds)
+	{
+		return true;
+	}
+
+	mdxaBone_t bones[1<<iG2_BITS_PER_BONEREF];
+	const int *piBoneReferences = (int*) ((byte*)surface + surface->ofsBoneReferences);
+	const int numBoneRefs = surface->numBoneReferences < (int)ARRAY_LEN(bones) ? surface->numBoneReferences : (int)ARRAY_LEN(bones);
+	for (int i = 0; i < numBoneRefs; i++)
+	{
+		if (boneBounds[i].mins[0] <= boneBounds[i].maxs[0])
+		{
+			bones[i] = EvalBoneCache(piBoneReferences[i],boneCache);
+		}
+	}
+	return !!G2_TraceCullBounds(&cull, boneBounds, numBoneRefs, bones, scale);
+}
+
+void R_TransformEachSurface( const mdxmSurface_t *surface, vec3_t scale, IHeapAllocator *G2VertSpace, size_t *TransformedVertsArray,CBoneCache *boneCache, const g2SkinVerts_t *skin)
 {
 	int				 j, k;
 	mdxmVertex_t 	*v;
@@ -405,6 +431,30 @@ void R_TransformEachSurface( const mdxmSurface_t *surface, vec3_t scale, IHeapAl
 		Com_Error(ERR_DROP, "Ran out of transform space for Ghoul2 Models. Adjust MiniHeapSize in SV_SpawnServer.\n");
 	}
 
+	// several verts at a time from the weights decoded at load, with the same results as below
+	if (skin)
+	{
+		mdxaBone_t bones[1<<iG2_BITS_PER_BONEREF];
+		const int numBoneRefs = surface->numBoneReferences < (int)ARRAY_LEN(bones) ? surface->numBoneReferences : (int)ARRAY_LEN(bones);
+
+		for ( k = 0 ; k < numBoneRefs ; k++ )
+		{
+			if (skin->usedBoneRefs & (1u << k))
+			{
+				bones[k] = EvalBoneCache(piBoneReferences[k],boneCache);
+			}
+		}
+		G2_SkinVerts(skin, bones, scale, TransformedVerts);
+
+		const mdxmVertexTexCoord_t *pTexCoords = (mdxmVertexTexCoord_t *) ((byte *)surface + surface->ofsVerts + surface->numVerts * sizeof(mdxmVertex_t));
+		for ( j = 0; j < surface->numVerts; j++ )
+		{
+			TransformedVerts[j * 5 + 3] = pTexCoords[j].texCoords[0];
+			TransformedVerts[j * 5 + 4] = pTexCoords[j].texCoords[1];
+		}
+		return;
+	}
+
 	// whip through and actually transform each vertex
 	const int numVerts = surface->numVerts;
 	v = (mdxmVertex_t *) ((byte *)surface + surface->ofsVerts);
@@ -498,7 +548,7 @@ void R_TransformEachSurface( const mdxmSurface_t *surface, vec3_t scale, IHeapAl
 }
 
 void G2_TransformSurfaces(int surfaceNum, surfaceInfo_v &rootSList,
-					CBoneCache *boneCache, const model_t *currentModel, int lod, vec3_t scale, IHeapAllocator *G2VertSpace, size_t *TransformedVertArray, bool secondTimeAround)
+					CBoneCache *boneCache, const model_t *currentModel, int lod, vec3_t scale, IHeapAllocator *G2VertSpace, size_t *TransformedVertArray, bool secondTimeAround, const g2TraceCull_t *cull)
 {
 	int	i;
 	assert(currentModel);
@@ -519,10 +569,12 @@ void G2_TransformSurfaces(int surfaceNum, surfaceInfo_v &rootSList,
 		offFlags = surfOverride->offFlags;
 	}
 	// if this surface is not off, add it to the shader render list
-	if (!offFlags)
+	if (!offFlags && (!cull || G2_TraceCullSurface(*cull, surface, currentModel, lod, scale, boneCache)))
 	{
 
-		R_TransformEachSurface(surface, scale, G2VertSpace, TransformedVertArray, boneCache);
+		const g2SkinVerts_t *skin = currentModel->g2SkinVerts ? currentModel->g2SkinVerts[lod * currentModel->mdxm->numSurfaces + surface->thisSurfaceIndex] : NULL;
+
+		R_TransformEachSurface(surface, scale, G2VertSpace, TransformedVertArray, boneCache, skin);
 	}
 
 	// if we are turning off all descendants, then stop this recursion now
@@ -534,16 +586,11 @@ void G2_TransformSurfaces(int surfaceNum, surfaceInfo_v &rootSList,
 	// now recursively call for the children
 	for (i=0; i< surfInfo->numChildren; i++)
 	{
-		G2_TransformSurfaces(surfInfo->childIndexes[i], rootSList, boneCache, currentModel, lod, scale, G2VertSpace, TransformedVertArray, secondTimeAround);
+		G2_TransformSurfaces(surfInfo->childIndexes[i], rootSList, boneCache, currentModel, lod, scale, G2VertSpace, TransformedVertArray, secondTimeAround, cull);
 	}
 }
 
-// main calling point for the model transform for collision detection. At this point all of the skeleton has been transformed.
-#ifdef _G2_GORE
-void G2_TransformModel(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale, IHeapAllocator *G2VertSpace, int useLod, bool ApplyGore)
-#else
-void G2_TransformModel(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale, IHeapAllocator *G2VertSpace, int useLod)
-#endif
+static void G2_TransformModels(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale, IHeapAllocator *G2VertSpace, int useLod, bool ApplyGore, const g2TraceCull_t *cull)
 {
 	int				i, lod;
 	vec3_t			correctScale;
@@ -631,7 +678,10 @@ void G2_TransformModel(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale,
 		G2_FindOverrideSurface(-1,g.mSlist); //reset the quick surface override lookup;
 		// recursively call the model surface transform
 
-		G2_TransformSurfaces(g.mSurfaceRoot, g.mSlist, g.mBoneCache,  g.currentModel, lod, correctScale, G2VertSpace, g.mTransformedVertsArray, false);
+		// zone transform space is kept for later traces, which may go anywhere, so fill it all in
+		const g2TraceCull_t *modelCull = (g.mFlags & GHOUL2_ZONETRANSALLOC) ? NULL : cull;
+
+		G2_TransformSurfaces(g.mSurfaceRoot, g.mSlist, g.mBoneCache,  g.currentModel, lod, correctScale, G2VertSpace, g.mTransformedVertsArray, false, modelCull);
 
 #ifdef _G2_GORE
 		if (ApplyGore && firstModelOnly)
@@ -643,6 +693,34 @@ void G2_TransformModel(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale,
 	}
 }
 
+// main calling point for the model transform for collision detection. At this point all of the skeleton has been transformed.
+#ifdef _G2_GORE
+void G2_TransformModel(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale, IHeapAllocator *G2VertSpace, int useLod, bool ApplyGore)
+{
+	G2_TransformModels(ghoul2, frameNum, scale, G2VertSpace, useLod, ApplyGore, NULL);
+}
+#else
+void G2_TransformModel(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale, IHeapAllocator *G2VertSpace, int useLod)
+{
+	G2_TransformModels(ghoul2, frameNum, scale, G2VertSpace, useLod, false, NULL);
+}
+#endif
+
+// as G2_TransformModel, but only skins the surfaces whose bone bounds the model space trace
+// ray can reach. Meant to be followed by G2_TraceModels with the same ray and radius.
+void G2_TransformModelForTrace(CGhoul2Info_v &ghoul2, const int frameNum, vec3_t scale, IHeapAllocator *G2VertSpace, int useLod, const vec3_t rayStart, const vec3_t rayEnd, float fRadius)
+{
+	g2TraceCull_t cull;
+
+	if (!G2_TraceCullInit(&cull, rayStart, rayEnd, fRadius))
+	{ //no frame to cull against
+		G2_TransformModels(ghoul2, frameNum, scale, G2VertSpace, useLod, false, NULL);
+		return;
+	}
+
+	G2_TransformModels(ghoul2, frameNum, scale, G2VertSpace, useLod, false, &cull);
+}
+
 
 // work out how much space a triangle takes
 static float	G2_AreaOfTri(const vec3_t A, const vec3_t B, const vec3_t C)
@@ -688,77 +766,6 @@ static void G2_BuildHitPointST( const vec3_t A, const float SA, const float TA,
 }
 
 
-// routine that works out given a ray whether or not it hits a poly
-qboolean G2_SegmentTriangleTest( const vec3_t start, const vec3_t end,
-	const vec3_t A, const vec3_t B, const vec3_t C,
-	qboolean backFaces,qboolean frontFaces,vec3_t returnedPoint,vec3_t returnedNormal, float *denom)
-{
-	static const float tiny=1E-10f;
-	vec3_t returnedNormalT;
-	vec3_t edgeAC;
-
-	VectorSubtract(C, A, edgeAC);
-	VectorSubtract(B, A, returnedNormalT);
-
-	CrossProduct(returnedNormalT, edgeAC, returnedNormal);
-
-	vec3_t ray;
-	VectorSubtract(end, start, ray);
-
-	*denom=DotProduct(ray, returnedNormal);
-
-	if (fabs(*denom)<tiny||        // triangle parallel to ray
-		(!backFaces && *denom>0)||		// not accepting back faces
-		(!frontFaces && *denom<0))		//not accepting front faces
-	{
-		return qfalse;
-	}
-
-	vec3_t toPlane;
-	VectorSubtract(A, start, toPlane);
-
-	float t=DotProduct(toPlane, returnedNormal)/ *denom;
-
-	if (t<0.0f||t>1.0f)
-	{
-		return qfalse; // off segment
-	}
-
-	VectorScale(ray, t, ray);
-
-	VectorAdd(ray, start, returnedPoint);
-
-	vec3_t edgePA;
-	VectorSubtract(A, returnedPoint, edgePA);
-
-	vec3_t edgePB;
-	VectorSubtract(B, returnedPoint, edgePB);
-
-	vec3_t edgePC;
-	VectorSubtract(C, returnedPoint, edgePC);
-
-	vec3_t temp;
-
-	CrossProduct(edgePA, edgePB, temp);
-	if (DotProduct(temp, returnedNormal)<0.0f)
-	{
-		return qfalse; // off triangle
-	}
-
-	CrossProduct(edgePC, edgePA, temp);
-	if (DotProduct(temp,returnedNormal)<0.0f)
-	{
-		return qfalse; // off triangle
-	}
-
-	CrossProduct(edgePB, edgePC, temp);
-	if (DotProduct(temp, returnedNormal)<0.0f)
-	{
-		return qfalse; // off triangle
-	}
-	return qtrue;
-}
-
 #ifdef _G2_GORE
 struct SVertexTemp
 {
@@ -1201,91 +1208,20 @@ static bool G2_RadiusTracePolys(
 								)
 {
 	int		j;
-	vec3_t basis1;
-	vec3_t basis2;
 	vec3_t taxis;
 	vec3_t saxis;
-
-	basis2[0]=0.0f;
-	basis2[1]=0.0f;
-	basis2[2]=1.0f;
-
 	vec3_t v3RayDir;
-	VectorSubtract(TS.rayEnd, TS.rayStart, v3RayDir);
-
-	CrossProduct(v3RayDir,basis2,basis1);
-
-	if (DotProduct(basis1,basis1)<.1f)
-	{
-		basis2[0]=0.0f;
-		basis2[1]=1.0f;
-		basis2[2]=0.0f;
-		CrossProduct(v3RayDir,basis2,basis1);
-	}
-
-	CrossProduct(v3RayDir,basis1,basis2);
-	// Give me a shot direction not a bunch of zeros :) -Gil
-//	assert(DotProduct(basis1,basis1)>.0001f);
-//	assert(DotProduct(basis2,basis2)>.0001f);
-
-	VectorNormalize(basis1);
-	VectorNormalize(basis2);
-
-	const float c=cos(0.0f);//theta
-	const float s=sin(0.0f);//theta
-
-	VectorScale(basis1, 0.5f * c / TS.m_fRadius,taxis);
-	VectorMA(taxis,     0.5f * s / TS.m_fRadius,basis2,taxis);
 
-	VectorScale(basis1,-0.5f * s /TS.m_fRadius,saxis);
-	VectorMA(    saxis, 0.5f * c /TS.m_fRadius,basis2,saxis);
+	G2_RadiusTraceAxes(TS.rayStart, TS.rayEnd, TS.m_fRadius, saxis, taxis, v3RayDir);
 
 	const float * const verts = (float *)TS.TransformedVertsArray[surface->thisSurfaceIndex];
 	const int numVerts = surface->numVerts;
 
 	int flags=63;
-	//rayDir/=lengthSquared(raydir);
-	const float f = VectorLengthSquared(v3RayDir);
-	v3RayDir[0]/=f;
-	v3RayDir[1]/=f;
-	v3RayDir[2]/=f;
 
 	for ( j = 0; j < numVerts; j++ )
 	{
-		const int pos=j*5;
-		vec3_t delta;
-		delta[0]=verts[pos+0]-TS.rayStart[0];
-		delta[1]=verts[pos+1]-TS.rayStart[1];
-		delta[2]=verts[pos+2]-TS.rayStart[2];
-		const float s=DotProduct(delta,saxis)+0.5f;
-		const float t=DotProduct(delta,taxis)+0.5f;
-		const float u=DotProduct(delta,v3RayDir);
-		int vflags=0;
-
-		if (s>0)
-		{
-			vflags|=1;
-		}
-		if (s<1)
-		{
-			vflags|=2;
-		}
-		if (t>0)
-		{
-			vflags|=4;
-		}
-		if (t<1)
-		{
-			vflags|=8;
-		}
-		if (u>0)
-		{
-			vflags|=16;
-		}
-		if (u<1)
-		{
-			vflags|=32;
-		}
+		int vflags=G2_RadiusTraceFlags(&verts[j*5], TS.rayStart, saxis, taxis, v3RayDir);
 
 		vflags=(~vflags);
 		flags&=vflags;
@@ -1436,7 +1372,11 @@ static void G2_TraceSurfaces(CTraceSurface &TS)
 		if (TS.collRecMap)
 		{
 #endif
-			if (!(fabs(TS.m_fRadius) < 0.1))	// if not a point-trace
+			if (!TS.TransformedVertsArray[surface->thisSurfaceIndex])
+			{
+				// culled by G2_TransformModelForTrace, the ray can't reach it
+			}
+			else if (!(fabs(TS.m_fRadius) < 0.1))	// if not a point-trace
 			{
 				// .. then use radius check
 				//
@@ -3383,6 +3383,7 @@ qboolean R_LoadMDXM( model_t *mod, void *buffer, const char *mod_name, qboolean
 
 	if (bAlreadyFound)
 	{
+		R_BuildG2TraceData( mod );
 		return qtrue;	// All done. Stop, go no further, do not LittleLong(), do not pass Go...
 	}
 
@@ -3519,9 +3520,88 @@ qboolean R_LoadMDXM( model_t *mod, void *buffer, const char *mod_name, qboolean
 		// find the next LOD
 		lod = (mdxmLOD_t *)( (byte *)lod + lod->ofsEnd );
 	}
+
+	R_BuildG2TraceData( mod );
 	return qtrue;
 }
 
+/*
+=================
+R_BuildG2TraceData
+
+Boxes the bind pose verts of each surface per bone reference, so a collision trace can bound a
+skinned surface from its bone matrices alone. Every skinned vert is a convex blend of its verts
+moved by each of its bones, so it lies inside the union of the moved boxes. Surfaces with a
+negative weight (or a bad bone reference) aren't bounded and always get skinned.
+
+Also decodes the weights of each surface for the G2_SkinVerts kernels.
+=================
+*/
+void R_BuildG2TraceData( model_t *mod )
+{
+	const mdxmHeader_t	*mdxm = mod->mdxm;
+	g2BoneBounds_t		boneBounds[1<<iG2_BITS_PER_BONEREF];
+	int					l, i, j, k;
+
+	mod->g2SurfaceBounds = (g2BoneBounds_t **)Hunk_Alloc( mdxm->numLODs * mdxm->numSurfaces * sizeof( g2BoneBounds_t * ), h_low );
+	mod->g2SkinVerts = (g2SkinVerts_t **)Hunk_Alloc( mdxm->numLODs * mdxm->numSurfaces * sizeof( g2SkinVerts_t * ), h_low );
+
+	const mdxmLOD_t *lod = (mdxmLOD_t *) ( (byte *)mdxm + mdxm->ofsLODs );
+	for ( l = 0 ; l < mdxm->numLODs ; l++)
+	{
+		const mdxmSurface_t *surf = (mdxmSurface_t *) ( (byte *)lod + sizeof (mdxmLOD_t) + (mdxm->numSurfaces * sizeof(mdxmLODSurfOffset_t)) );
+		for ( i = 0 ; i < mdxm->numSurfaces ; i++)
+		{
+			const int numBoneRefs = surf->numBoneReferences;
+			bool bounded = ( numBoneRefs > 0 && numBoneRefs <= (int)ARRAY_LEN( boneBounds )
+				&& surf->thisSurfaceIndex >= 0 && surf->thisSurfaceIndex < mdxm->numSurfaces );
+
+			for ( j = 0 ; bounded && j < numBoneRefs ; j++ )
+			{
+				ClearBounds( boneBounds[j].mins, boneBounds[j].maxs );
+			}
+
+			const mdxmVertex_t *v = (mdxmVertex_t *) ( (byte *)surf + surf->ofsVerts );
+			for ( j = 0 ; bounded && j < surf->numVerts ; j++, v++ )
+			{
+				const int iNumWeights = G2_GetVertWeights( v );
+
+				float fTotalWeight = 0.0f;
+				for ( k = 0 ; k < iNumWeights ; k++ )
+				{
+					const int	iBoneIndex	= G2_GetVertBoneIndex( v, k );
+					const float	fBoneWeight	= G2_GetVertBoneWeight( v, k, fTotalWeight, iNumWeights );
+
+					if ( fBoneWeight < 0.0f || iBoneIndex >= numBoneRefs )
+					{
+						bounded = false;
+						break;
+					}
+					AddPointToBounds( v->vertCoords, boneBounds[iBoneIndex].mins, boneBounds[iBoneIndex].maxs );
+				}
+			}
+
+			if ( bounded )
+			{
+				g2BoneBounds_t *surfBounds = (g2BoneBounds_t *)Hunk_Alloc( numBoneRefs * sizeof( g2BoneBounds_t ), h_low );
+				memcpy( surfBounds, boneBounds, numBoneRefs * sizeof( g2BoneBounds_t ) );
+				mod->g2SurfaceBounds[l * mdxm->numSurfaces + surf->thisSurfaceIndex] = surfBounds;
+			}
+
+			const int skinSize = G2_SkinVertsSize( surf );
+			if ( skinSize && surf->thisSurfaceIndex >= 0 && surf->thisSurfaceIndex < mdxm->numSurfaces )
+			{
+				mod->g2SkinVerts[l * mdxm->numSurfaces + surf->thisSurfaceIndex] = G2_BuildSkinVerts( surf, Hunk_Alloc( skinSize, h_low ) );
+			}
+
+			// find the next surface
+			surf = (mdxmSurface_t *)( (byte *)surf + surf->ofsEnd );
+		}
+		// find the next LOD
+		lod = (mdxmLOD_t *)( (byte *)lod + lod->ofsEnd );
+	}
+}
+
 //#define CREATE_LIMB_HIERARCHY
 
 #ifdef CREATE_LIMB_HIERARCHY
@@ -29,6 +29,8 @@ typedef unsigned int GLuint;
 #include "rd-common/tr_common.h"
 #include "rd-common/tr_public.h"
 #include "ghoul2/ghoul2_shared.h" //rwwRMG - added
+#include "ghoul2/G2_skin.h"
+#include "ghoul2/G2_tracecull.h"
 
 #define GL_INDEX_TYPE		GL_UNSIGNED_INT
 typedef unsigned int glIndex_t;
@@ -863,6 +865,7 @@ Ghoul2 Insert End
 
 } modtype_t;
 
+// model space box around the bind pose verts weighted to one bone reference of a ghoul2 surface
 typedef struct model_s {
 	char		name[MAX_QPATH];
 	modtype_t	type;
@@ -876,6 +879,8 @@ Ghoul2 Insert Start
 */
 	mdxmHeader_t *mdxm;				// only if type == MOD_GL2M which is a GHOUL II Mesh file NOT a GHOUL II animation file
 	mdxaHeader_t *mdxa;				// only if type == MOD_GL2A which is a GHOUL II Animation file
+	g2BoneBounds_t **g2SurfaceBounds;	// [lod * numSurfaces + surface], each numBoneReferences long, NULL if unbounded
+	g2SkinVerts_t	**g2SkinVerts;		// [lod * numSurfaces + surface], NULL to skin with the scalar loop
 /*
 Ghoul2 Insert End
 */
@@ -1875,6 +1880,7 @@ Ghoul2 Insert Start
 void		Multiply_3x4Matrix(mdxaBone_t *out, mdxaBone_t *in2, mdxaBone_t *in);
 extern qboolean R_LoadMDXM (model_t *mod, void *buffer, const char *name, qboolean &bAlreadyCached );
 extern qboolean R_LoadMDXA (model_t *mod, void *buffer, const char *name, qboolean &bAlreadyCached );
+extern void R_BuildG2TraceData( model_t *mod );
 void		RE_InsertModelIntoHash(const char *name, model_t *mod);
 /*
 Ghoul2 Insert End
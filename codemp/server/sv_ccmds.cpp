@@ -2030,6 +2030,8 @@ void SV_AddOperatorCommands( void ) {
 	Cmd_AddCommand ("dumpuser", SV_DumpUser_f, "Prints the userinfo for a given userid" );
 	Cmd_AddCommand ("map_restart", SV_MapRestart_f, "Restart the current map" );
 	Cmd_AddCommand ("sectorlist", SV_SectorList_f);
+	Cmd_AddCommand ("worldbench", SV_WorldBench_f, "Compares entity lookup times of the sector tree and the grid on the current map" );
+	Cmd_AddCommand ("deltacache", SV_DeltaCache_f, "Prints how many entity deltas were reused from the delta cache since the last call" );
 	Cmd_AddCommand ("map", SV_Map_f, "Load a new map with cheats disabled" );
 	Cmd_SetCommandCompletionFunc( "map", SV_CompleteMapName );
 	Cmd_AddCommand ("devmap", SV_Map_f, "Load a new map with cheats enabled" );
@@ -2076,6 +2078,8 @@ void SV_RemoveOperatorCommands( void ) {
 	Cmd_RemoveCommand ("dumpuser");
 	Cmd_RemoveCommand ("map_restart");
 	Cmd_RemoveCommand ("sectorlist");
+	Cmd_RemoveCommand ("worldbench");
+	Cmd_RemoveCommand ("deltacache");
 	Cmd_RemoveCommand ("svsay");
 #endif
 }
@@ -3157,9 +3157,15 @@ void SV_BindGame( void ) {
 		gi.G2API_CleanEntAttachments			= SV_G2API_CleanEntAttachments;
 		gi.G2API_OverrideServer					= SV_G2API_OverrideServer;
 		gi.G2API_GetSurfaceName					= SV_G2API_GetSurfaceName;
+		gi.TraceRewound							= SV_TraceRewound;
+		gi.TraceBatch							= SV_TraceBatch;
 
 		GetGameAPI = (GetGameAPI_t)gvm->GetModuleAPI;
 		ret = GetGameAPI( GAME_API_VERSION, &gi );
+		if ( !ret ) {
+			// modules built before TraceRewound only know version 1, they never look past the imports it had
+			ret = GetGameAPI( 1, &gi );
+		}
 		if ( !ret ) {
 			//free VM?
 			svs.gameStarted = qfalse;
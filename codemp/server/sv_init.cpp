@@ -463,6 +463,7 @@ void SV_SpawnServer( char *server, qboolean killBots, ForceReload_e eForceReload
 
 	// shut down the existing game if it is running
 	SV_ShutdownGameProgs();
+	SV_ShutdownSnapshotThreads();
 	svs.gameStarted = qfalse;
 
 	Com_Printf ("------ Server Initialization ------\n");
@@ -995,6 +996,9 @@ void SV_Init (void) {
 		sv_master[index] = Cvar_Get(va("sv_master%d", index + 1), "", CVAR_ARCHIVE_ND|CVAR_PROTECTED);
 	sv_reconnectlimit = Cvar_Get ("sv_reconnectlimit", "3", 0);
 	sv_showghoultraces = Cvar_Get ("sv_showghoultraces", "0", 0);
+	sv_worldIndex = Cvar_Get ("sv_worldIndex", "0", CVAR_ARCHIVE_ND, "Entity lookup for traces, 0 = sector tree, 1 = grid for large maps with many entities. Applied on map load" );
+	sv_snapshotThreads = Cvar_Get ("sv_snapshotThreads", "0", CVAR_ARCHIVE_ND, "Worker threads used to build and encode client snapshots, 0 = build them on the main thread" );
+	sv_deltaCache = Cvar_Get ("sv_deltaCache", "1", CVAR_ARCHIVE_ND, "Encode identical entity deltas once per frame and reuse them for every client that needs them" );
 	sv_showloss = Cvar_Get ("sv_showloss", "0", 0);
 	sv_padPackets = Cvar_Get ("sv_padPackets", "0", 0);
 	sv_killserver = Cvar_Get ("sv_killserver", "0", 0);
@@ -45,6 +45,9 @@ cvar_t	*sv_allowDownload;
 cvar_t	*sv_master[MAX_MASTER_SERVERS];		// master server ip address
 cvar_t	*sv_reconnectlimit;		// minimum seconds between connect messages
 cvar_t	*sv_showghoultraces;	// report ghoul2 traces
+cvar_t	*sv_worldIndex;			// 0 = sector tree, 1 = loose grid
+cvar_t	*sv_snapshotThreads;	// worker threads building snapshots, 0 = main thread only
+cvar_t	*sv_deltaCache;			// reuse encoded entity deltas across clients
 cvar_t	*sv_showloss;			// report when usercmds are lost
 cvar_t	*sv_padPackets;			// add nop bytes to messages
 cvar_t	*sv_killserver;			// menu system can set to 1 to shut server down
@@ -21,6 +21,11 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 ===========================================================================
 */
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include "server.h"
 #include "qcommon/cm_public.h"
 
@@ -46,6 +51,10 @@ A normal server packet will look like:
 =============================================================================
 */
 
+// entity deltas written through MSG_WriteDeltaEntityCached, see SV_DeltaCache_f
+static std::atomic<int>	svDeltaCacheLookups;
+static std::atomic<int>	svDeltaCacheHits;
+
 /*
 =============
 SV_EmitPacketEntities
@@ -58,6 +67,8 @@ static void SV_EmitPacketEntities( clientSnapshot_t *from, clientSnapshot_t *to,
 	int		oldindex, newindex;
 	int		oldnum, newnum;
 	int		from_num_entities;
+	qboolean	useCache = (qboolean)( sv_deltaCache->integer != 0 );
+	int		lookups = 0, hits = 0;
 
 	// generate the delta update
 	if ( !from ) {
@@ -89,7 +100,12 @@ static void SV_EmitPacketEntities( clientSnapshot_t *from, clientSnapshot_t *to,
 			// delta update from old position
 			// because the force parm is qfalse, this will not result
 			// in any bytes being emited if the entity has not changed at all
-			MSG_WriteDeltaEntity (msg, oldent, newent, qfalse );
+			if ( useCache ) {
+				lookups++;
+				hits += MSG_WriteDeltaEntityCached (msg, oldent, newent, qfalse );
+			} else {
+				MSG_WriteDeltaEntity (msg, oldent, newent, qfalse );
+			}
 			oldindex++;
 			newindex++;
 			continue;
@@ -97,7 +113,12 @@ static void SV_EmitPacketEntities( clientSnapshot_t *from, clientSnapshot_t *to,
 
 		if ( newnum < oldnum ) {
 			// this is a new entity, send it from the baseline
-			MSG_WriteDeltaEntity (msg, &sv.svEntities[newnum].baseline, newent, qtrue );
+			if ( useCache ) {
+				lookups++;
+				hits += MSG_WriteDeltaEntityCached (msg, &sv.svEntities[newnum].baseline, newent, qtrue );
+			} else {
+				MSG_WriteDeltaEntity (msg, &sv.svEntities[newnum].baseline, newent, qtrue );
+			}
 			newindex++;
 			continue;
 		}
@@ -111,25 +132,44 @@ static void SV_EmitPacketEntities( clientSnapshot_t *from, clientSnapshot_t *to,
 	}
 
 	MSG_WriteBits( msg, (MAX_GENTITIES-1), GENTITYNUM_BITS );	// end of packetentities
+
+	if ( lookups ) {
+		svDeltaCacheLookups += lookups;
+		svDeltaCacheHits += hits;
+	}
+}
+
+/*
+=============
+SV_DeltaCache_f
+
+Prints the delta cache hit rate since the last call
+=============
+*/
+void SV_DeltaCache_f( void ) {
+	int lookups = svDeltaCacheLookups.exchange( 0 );
+	int hits = svDeltaCacheHits.exchange( 0 );
+
+	if ( !sv_deltaCache->integer ) {
+		Com_Printf( "Delta cache is disabled (sv_deltaCache 0)\n" );
+	}
+	Com_Printf( "%i of %i entity deltas reused (%.1f%%)\n", hits, lookups, lookups ? 100.0f * hits / lookups : 0.0f );
 }
 
 
 
 /*
 ==================
-SV_WriteSnapshotToClient
+SV_SnapshotDeltaFrame
+
+Picks the frame the new snapshot is delta compressed against, NULL for a full
+snapshot
 ==================
 */
-static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg ) {
-	clientSnapshot_t	*frame, *oldframe;
-	int					lastframe;
-	int					i;
-	int					snapFlags;
+static clientSnapshot_t *SV_SnapshotDeltaFrame( client_t *client, int *lastframe ) {
+	clientSnapshot_t	*oldframe;
 	int					deltaMessage;
 
-	// this is the snapshot we are creating
-	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
-
 	// bots never acknowledge, but it doesn't matter since the only use case is for serverside demos
 	// in which case we can delta against the very last message every time
 	deltaMessage = client->deltaMessage;
@@ -141,33 +181,33 @@ static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg ) {
 	if ( deltaMessage <= 0 || client->state != CS_ACTIVE ) {
 		// client is asking for a retransmit
 		oldframe = NULL;
-		lastframe = 0;
+		*lastframe = 0;
 	} else if ( client->netchan.outgoingSequence - deltaMessage
 		>= (PACKET_BACKUP - 3) ) {
 		// client hasn't gotten a good message through in a long time
 		Com_DPrintf ("%s: Delta request from out of date packet.\n", client->name);
 		oldframe = NULL;
-		lastframe = 0;
+		*lastframe = 0;
 	} else if ( client->demo.demorecording && client->demo.demowaiting ) {
 		// demo is waiting for a non-delta-compressed frame for this client, so don't delta compress
 		oldframe = NULL;
-		lastframe = 0;
+		*lastframe = 0;
 	} else if ( client->demo.minDeltaFrame > deltaMessage ) {
 		// we saved a non-delta frame to the demo and sent it to the client, but the client didn't ack it
 		// we can't delta against an old frame that's not in the demo without breaking the demo.  so send
 		// non-delta frames until the client acks.
 		oldframe = NULL;
-		lastframe = 0;
+		*lastframe = 0;
 	} else {
 		// we have a valid snapshot to delta from
 		oldframe = &client->frames[ deltaMessage & PACKET_MASK ];
-		lastframe = client->netchan.outgoingSequence - deltaMessage;
+		*lastframe = client->netchan.outgoingSequence - deltaMessage;
 
 		// the snapshot's entities may still have rolled off the buffer, though
 		if ( oldframe->first_entity <= svs.nextSnapshotEntities - svs.numSnapshotEntities ) {
 			Com_DPrintf ("%s: Delta request from out of date entities.\n", client->name);
 			oldframe = NULL;
-			lastframe = 0;
+			*lastframe = 0;
 		}
 	}
 
@@ -179,6 +219,22 @@ static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg ) {
 		client->demo.demowaiting = qfalse;
 	}
 
+	return oldframe;
+}
+
+/*
+==================
+SV_WriteSnapshotToClient
+==================
+*/
+static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg, clientSnapshot_t *oldframe, int lastframe ) {
+	clientSnapshot_t	*frame;
+	int					i;
+	int					snapFlags;
+
+	// this is the snapshot we are creating
+	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
+
 	MSG_WriteByte (msg, svc_snapshot);
 
 	// NOTE, MRE: now sent at the start of every message from server to client
@@ -309,8 +365,11 @@ Build a client snapshot structure
 typedef struct snapshotEntityNumbers_s {
 	int		numSnapshotEntities;
 	int		snapshotEntities[MAX_SNAPSHOT_ENTITIES];
+	byte	added[MAX_GENTITIES/8];	// prevents double adding from portal views
 } snapshotEntityNumbers_t;
 
+#define SNAPSHOT_ADDED( eNums, num )	( (eNums)->added[(num) >> 3] & (1 << ((num) & 7)) )
+
 /*
 =======================
 SV_QsortEntityNumbers
@@ -339,12 +398,14 @@ static int QDECL SV_QsortEntityNumbers( const void *a, const void *b ) {
 SV_AddEntToSnapshot
 ===============
 */
-static void SV_AddEntToSnapshot( svEntity_t *svEnt, sharedEntity_t *gEnt, snapshotEntityNumbers_t *eNums ) {
+static void SV_AddEntToSnapshot( sharedEntity_t *gEnt, snapshotEntityNumbers_t *eNums ) {
+	int num = gEnt->s.number;
+
 	// if we have already added this entity to this snapshot, don't add again
-	if ( svEnt->snapshotCounter == sv.snapshotCounter ) {
+	if ( SNAPSHOT_ADDED( eNums, num ) ) {
 		return;
 	}
-	svEnt->snapshotCounter = sv.snapshotCounter;
+	eNums->added[num >> 3] |= 1 << (num & 7);
 
 	// if we are full, silently discard entities
 	if ( eNums->numSnapshotEntities == MAX_SNAPSHOT_ENTITIES ) {
@@ -355,6 +416,163 @@ static void SV_AddEntToSnapshot( svEntity_t *svEnt, sharedEntity_t *gEnt, snapsh
 	eNums->numSnapshotEntities++;
 }
 
+/*
+===============
+SV_EntityInPVS
+
+Area and cluster test of an entity against a viewpoint
+===============
+*/
+static qboolean SV_EntityInPVS( svEntity_t *svEnt, int clientarea, const byte *clientpvs ) {
+	const byte	*bitvector;
+	int			i, l;
+
+	// ignore if not touching a PV leaf
+	// check area
+	if ( !CM_AreasConnected( clientarea, svEnt->areanum ) ) {
+		// doors can legally straddle two areas, so
+		// we may need to check another one
+		if ( !CM_AreasConnected( clientarea, svEnt->areanum2 ) ) {
+			return qfalse;		// blocked by a door
+		}
+	}
+
+	bitvector = clientpvs;
+
+	// check individual leafs
+	if ( !svEnt->numClusters ) {
+		return qfalse;
+	}
+	l = 0;
+	for ( i=0 ; i < svEnt->numClusters ; i++ ) {
+		l = svEnt->clusternums[i];
+		if ( bitvector[l >> 3] & (1 << (l&7) ) ) {
+			break;
+		}
+	}
+
+	// if we haven't found it to be visible,
+	// check overflow clusters that coudln't be stored
+	if ( i == svEnt->numClusters ) {
+		if ( svEnt->lastCluster ) {
+			for ( ; l <= svEnt->lastCluster ; l++ ) {
+				if ( bitvector[l >> 3] & (1 << (l&7) ) ) {
+					break;
+				}
+			}
+			if ( l == svEnt->lastCluster ) {
+				return qfalse;	// not visible
+			}
+		} else {
+			return qfalse;
+		}
+	}
+
+	return qtrue;
+}
+
+/*
+=============================================================================
+
+Visibility cache
+
+Clients standing in the same cluster and area see the same entities through
+the PVS, so during SV_SendClientMessages the area and cluster test is done
+once per (cluster, area) viewpoint.  Each cache entry lists, in entity
+order, the entities that pass the client independent filters and are either
+visible from the viewpoint or need a look for every client regardless:
+broadcast and portal entities, entities sent to specific clients and events,
+which the landing effect limit counts whether visible or not.  Clients then
+only run their own filters over that list.  Entries are built on first use
+under svVisCacheLock, the snapshot workers share them.
+
+=============================================================================
+*/
+
+#define MAX_VISCACHE_ENTRIES	64
+#define VISCACHE_VISIBLE		0x40000000		// or'd into the entity number if it passed SV_EntityInPVS
+
+typedef struct visCacheEntry_s {
+	int		cluster;
+	int		area;
+	int		numEntities;
+	int		entities[MAX_GENTITIES];
+} visCacheEntry_t;
+
+static visCacheEntry_t	svVisCache[MAX_VISCACHE_ENTRIES];
+static int				svVisCacheNumEntries;
+static qboolean			svVisCacheActive;	// only valid while SV_SendClientMessages runs, the game may move entities in between
+static std::mutex		svVisCacheLock;
+
+static void SV_BuildVisCacheEntry( visCacheEntry_t *entry, const byte *clientpvs ) {
+	sharedEntity_t	*ent;
+	svEntity_t		*svEnt;
+	qboolean		visible;
+	int				e, i;
+
+	entry->numEntities = 0;
+	for ( e = 0 ; e < sv.num_entities ; e++ ) {
+		ent = SV_GentityNum(e);
+
+		if ( !ent->r.linked || (ent->s.eFlags & EF_PERMANENT) || (ent->r.svFlags & SVF_NOCLIENT) ) {
+			continue;
+		}
+
+		svEnt = SV_SvEntityForGentity( ent );
+		visible = SV_EntityInPVS( svEnt, entry->area, clientpvs );
+
+		if ( !visible ) {
+			if ( !(ent->r.svFlags & SVF_BROADCAST) && !ent->s.isPortalEnt && ent->s.eType < ET_EVENTS ) {
+				for ( i = 0 ; i < (int)ARRAY_LEN( ent->r.broadcastClients ) ; i++ ) {
+					if ( ent->r.broadcastClients[i] ) {
+						break;
+					}
+				}
+				if ( i == (int)ARRAY_LEN( ent->r.broadcastClients ) ) {
+					continue;
+				}
+			}
+		}
+
+		entry->entities[entry->numEntities++] = visible ? (e | VISCACHE_VISIBLE) : e;
+	}
+}
+
+/*
+===============
+SV_VisCacheForViewpoint
+
+NULL if the cache isn't in use or is full
+===============
+*/
+static const visCacheEntry_t *SV_VisCacheForViewpoint( int cluster, int area, const byte *clientpvs ) {
+	visCacheEntry_t	*entry;
+	int				i;
+
+	if ( !svVisCacheActive ) {
+		return NULL;
+	}
+
+	std::lock_guard<std::mutex> l( svVisCacheLock );
+
+	for ( i = 0, entry = svVisCache ; i < svVisCacheNumEntries ; i++, entry++ ) {
+		if ( entry->cluster == cluster && entry->area == area ) {
+			return entry;
+		}
+	}
+
+	if ( svVisCacheNumEntries == MAX_VISCACHE_ENTRIES ) {
+		return NULL;
+	}
+
+	entry = &svVisCache[svVisCacheNumEntries];
+	entry->cluster = cluster;
+	entry->area = area;
+	SV_BuildVisCacheEntry( entry, clientpvs );
+	svVisCacheNumEntries++;
+	return entry;
+}
+
 /*
 ===============
 SV_AddEntitiesVisibleFromPoint
@@ -369,17 +587,17 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 									snapshotEntityNumbers_t *eNums, qboolean portal, qboolean skipDuelCull )
 #endif
 {
-	int		e, i;
+	int		e, c, numCandidates;
 	sharedEntity_t *ent;
 	svEntity_t	*svEnt;
-	int		l;
 	int		clientarea, clientcluster;
 	int		leafnum;
 	byte	*clientpvs;
-	byte	*bitvector;
 	vec3_t	difference;
 	float	length, radius;
 	int		effectCount = 0;
+	const visCacheEntry_t *cache;
+	sharedEntity_t *viewer;
 
 	// during an error shutdown message we may need to transmit
 	// the shutdown message after the server has shutdown, so
@@ -397,7 +615,17 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 
 	clientpvs = CM_ClusterPVS (clientcluster);
 
-	for ( e = 0 ; e < sv.num_entities ; e++ ) {
+	// the recorder bot is sent everything, it has to look at every entity
+	viewer = SV_GentityNum(frame->ps.clientNum);
+	if ( sv_autoDemo->integer == 2 && (viewer->r.svFlags & SVF_BOT) && viewer->playerState->pm_type == PM_SPECTATOR ) {
+		cache = NULL;
+	} else {
+		cache = SV_VisCacheForViewpoint( clientcluster, clientarea, clientpvs );
+	}
+	numCandidates = cache ? cache->numEntities : sv.num_entities;
+
+	for ( c = 0 ; c < numCandidates ; c++ ) {
+		e = cache ? (cache->entities[c] & ~VISCACHE_VISIBLE) : c;
 		ent = SV_GentityNum(e);
 
 		// never send entities that aren't linked in
@@ -461,7 +689,7 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 		svEnt = SV_SvEntityForGentity( ent );
 
 		// don't double add an entity through portals
-		if ( svEnt->snapshotCounter == sv.snapshotCounter ) {
+		if ( SNAPSHOT_ADDED( eNums, e ) ) {
 			continue;
 		}
 
@@ -475,65 +703,30 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 		if ( (ent->r.svFlags & SVF_BROADCAST) || e == frame->ps.clientNum
 			|| (ent->r.broadcastClients[frame->ps.clientNum/32] & (1 << (frame->ps.clientNum % 32))) )
 		{
-			SV_AddEntToSnapshot( svEnt, ent, eNums );
+			SV_AddEntToSnapshot( ent, eNums );
 			continue;
 		}
 
 		if (ent->s.isPortalEnt)
 		{ //rww - portal entities are always sent as well
-			SV_AddEntToSnapshot( svEnt, ent, eNums );
+			SV_AddEntToSnapshot( ent, eNums );
 			continue;
 		}
 
 		if (sv_autoDemo->integer == 2) //How find out how to only add all entities for the bot named RECORDER, not all bots? what entities can we still exclude?
 		{
-			sharedEntity_t *ent2;
-			ent2 = SV_GentityNum(frame->ps.clientNum);
-			if (ent2->r.svFlags & SVF_BOT && ent2->playerState->pm_type == PM_SPECTATOR) {
-				SV_AddEntToSnapshot( svEnt, ent, eNums );
+			if (viewer->r.svFlags & SVF_BOT && viewer->playerState->pm_type == PM_SPECTATOR) {
+				SV_AddEntToSnapshot( ent, eNums );
 				continue;
 			}
 		}
 
-		// ignore if not touching a PV leaf
-		// check area
-		if ( !CM_AreasConnected( clientarea, svEnt->areanum ) ) {
-			// doors can legally straddle two areas, so
-			// we may need to check another one
-			if ( !CM_AreasConnected( clientarea, svEnt->areanum2 ) ) {
-				continue;		// blocked by a door
-			}
-		}
-
-		bitvector = clientpvs;
-
-		// check individual leafs
-		if ( !svEnt->numClusters ) {
-			continue;
-		}
-		l = 0;
-		for ( i=0 ; i < svEnt->numClusters ; i++ ) {
-			l = svEnt->clusternums[i];
-			if ( bitvector[l >> 3] & (1 << (l&7) ) ) {
-				break;
-			}
-		}
-
-		// if we haven't found it to be visible,
-		// check overflow clusters that coudln't be stored
-		if ( i == svEnt->numClusters ) {
-			if ( svEnt->lastCluster ) {
-				for ( ; l <= svEnt->lastCluster ; l++ ) {
-					if ( bitvector[l >> 3] & (1 << (l&7) ) ) {
-						break;
-					}
-				}
-				if ( l == svEnt->lastCluster ) {
-					continue;	// not visible
-				}
-			} else {
+		if ( cache ) {
+			if ( !(cache->entities[c] & VISCACHE_VISIBLE) ) {
 				continue;
 			}
+		} else if ( !SV_EntityInPVS( svEnt, clientarea, clientpvs ) ) {
+			continue;
 		}
 
 		if (g_svCullDist != -1.0f)
@@ -553,7 +746,7 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 		}
 
 		// add it
-		SV_AddEntToSnapshot( svEnt, ent, eNums );
+		SV_AddEntToSnapshot( ent, eNums );
 
 		// if its a portal entity, add everything visible from its camera position
 		if ( ent->r.svFlags & SVF_PORTAL ) {
@@ -575,7 +768,7 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 
 /*
 =============
-SV_BuildClientSnapshot
+SV_GatherClientSnapshot
 
 Decides which entities are going to be visible to the client, and
 copies off the playerstate and areabits.
@@ -584,34 +777,31 @@ This properly handles multiple recursive portals, but the render
 currently doesn't.
 
 For viewing through other player's eyes, client can be something other than client->gentity
+
+Only touches the client's own frame and entityNumbers, so it can run on a
+snapshot worker thread.  Returns qfalse if the client gets an empty snapshot.
 =============
 */
-static void SV_BuildClientSnapshot( client_t *client ) {
+static qboolean SV_GatherClientSnapshot( client_t *client, snapshotEntityNumbers_t *entityNumbers ) {
 	vec3_t						org;
 	clientSnapshot_t			*frame;
-	snapshotEntityNumbers_t		entityNumbers;
 	int							i;
-	sharedEntity_t				*ent;
-	entityState_t				*state;
-	svEntity_t					*svEnt;
 	sharedEntity_t				*clent;
 	playerState_t				*ps;
 
-	// bump the counter used to prevent double adding
-	sv.snapshotCounter++;
-
 	// this is the frame we are creating
 	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
 
 	// clear everything in this snapshot
-	entityNumbers.numSnapshotEntities = 0;
+	entityNumbers->numSnapshotEntities = 0;
+	Com_Memset( entityNumbers->added, 0, sizeof( entityNumbers->added ) );
 	Com_Memset( frame->areabits, 0, sizeof( frame->areabits ) );
 
 	frame->num_entities = 0;
 
 	clent = client->gentity;
 	if ( !clent || client->state == CS_ZOMBIE ) {
-		return;
+		return qfalse;
 	}
 
 	// grab the current playerState_t
@@ -645,8 +835,7 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 	if ( clientNum < 0 || clientNum >= MAX_GENTITIES ) {
 		Com_Error( ERR_DROP, "SV_SvEntityForGentity: bad gEnt" );
 	}
-	svEnt = &sv.svEntities[ clientNum ];
-	svEnt->snapshotCounter = sv.snapshotCounter;
+	entityNumbers->added[clientNum >> 3] |= 1 << (clientNum & 7);
 
 
 	// find the client's viewpoint
@@ -656,17 +845,17 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 	// add all the entities directly visible to the eye, which
 	// may include portal entities that merge other viewpoints
 #ifndef DEDICATED
-	SV_AddEntitiesVisibleFromPoint( org, frame, &entityNumbers, qfalse );
+	SV_AddEntitiesVisibleFromPoint( org, frame, entityNumbers, qfalse );
 #else
-	SV_AddEntitiesVisibleFromPoint( org, frame, &entityNumbers, qfalse, client->disableDuelCull );
+	SV_AddEntitiesVisibleFromPoint( org, frame, entityNumbers, qfalse, client->disableDuelCull );
 #endif
 
 	// if there were portals visible, there may be out of order entities
 	// in the list which will need to be resorted for the delta compression
 	// to work correctly.  This also catches the error condition
 	// of an entity being included twice.
-	qsort( entityNumbers.snapshotEntities, entityNumbers.numSnapshotEntities,
-		sizeof( entityNumbers.snapshotEntities[0] ), SV_QsortEntityNumbers );
+	qsort( entityNumbers->snapshotEntities, entityNumbers->numSnapshotEntities,
+		sizeof( entityNumbers->snapshotEntities[0] ), SV_QsortEntityNumbers );
 
 	// now that all viewpoint's areabits have been OR'd together, invert
 	// all of them to make it a mask vector, which is what the renderer wants
@@ -674,27 +863,68 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 		((int *)frame->areabits)[i] = ((int *)frame->areabits)[i] ^ -1;
 	}
 
-	// copy the entity states out
-	frame->num_entities = 0;
+	return qtrue;
+}
+
+/*
+=============
+SV_ReserveSnapshotEntities
+
+Claims the client's slots in the svs.snapshotEntities ring
+=============
+*/
+static void SV_ReserveSnapshotEntities( client_t *client, int numEntities ) {
+	clientSnapshot_t *frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
+
 	frame->first_entity = svs.nextSnapshotEntities;
-	for ( i = 0 ; i < entityNumbers.numSnapshotEntities ; i++ ) {
-		ent = SV_GentityNum(entityNumbers.snapshotEntities[i]);
-		state = &svs.snapshotEntities[svs.nextSnapshotEntities % svs.numSnapshotEntities];
+	frame->num_entities = numEntities;
+	svs.nextSnapshotEntities += numEntities;
+	// this should never hit, map should always be restarted first in SV_Frame
+	if ( svs.nextSnapshotEntities >= 0x7FFFFFFE ) {
+		Com_Error(ERR_FATAL, "svs.nextSnapshotEntities wrapped");
+	}
+}
+
+/*
+=============
+SV_CopySnapshotEntities
+
+Copies the entity states out into the slots reserved for the frame
+=============
+*/
+static void SV_CopySnapshotEntities( client_t *client, const snapshotEntityNumbers_t *entityNumbers ) {
+	clientSnapshot_t	*frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
+	sharedEntity_t		*ent;
+	entityState_t		*state;
+	int					i;
+
+	for ( i = 0 ; i < frame->num_entities ; i++ ) {
+		ent = SV_GentityNum(entityNumbers->snapshotEntities[i]);
+		state = &svs.snapshotEntities[(frame->first_entity + i) % svs.numSnapshotEntities];
 		*state = ent->s;
 #ifdef DEDICATED
 		if (!client->jpPlugin && DuelCull(client->gentity, ent)) {
 			state->solid = 0;
 		}
 #endif
-		svs.nextSnapshotEntities++;
-		// this should never hit, map should always be restarted first in SV_Frame
-		if ( svs.nextSnapshotEntities >= 0x7FFFFFFE ) {
-			Com_Error(ERR_FATAL, "svs.nextSnapshotEntities wrapped");
-		}
-		frame->num_entities++;
 	}
 }
 
+/*
+=============
+SV_BuildClientSnapshot
+=============
+*/
+static void SV_BuildClientSnapshot( client_t *client ) {
+	snapshotEntityNumbers_t		entityNumbers;
+
+	if ( !SV_GatherClientSnapshot( client, &entityNumbers ) ) {
+		return;
+	}
+	SV_ReserveSnapshotEntities( client, entityNumbers.numSnapshotEntities );
+	SV_CopySnapshotEntities( client, &entityNumbers );
+}
+
 
 /*
 ====================
@@ -818,62 +1048,63 @@ void SV_SendMessageToClient( msg_t *msg, client_t *client ) {
 
 /*
 =======================
-SV_SendClientSnapshot
-
-Also called by SV_FinalMessage
+SV_SendGamedirToClient
 
+rww - make sure there is an svc_setgame sent before the first snapshot
 =======================
 */
 extern cvar_t	*fs_gamedirvar;
-void SV_SendClientSnapshot( client_t *client ) {
+static void SV_SendGamedirToClient( client_t *client ) {
 	byte		msg_buf[MAX_MSGLEN];
 	msg_t		msg;
+	int			i = 0;
 
-	if (!client->sentGamedir)
-	{ //rww - if this is the case then make sure there is an svc_setgame sent before this snap
-		int i = 0;
-
-		MSG_Init (&msg, msg_buf, sizeof(msg_buf));
+	MSG_Init (&msg, msg_buf, sizeof(msg_buf));
 
-		//have to include this for each message.
-		MSG_WriteLong( &msg, client->lastClientCommand );
+	//have to include this for each message.
+	MSG_WriteLong( &msg, client->lastClientCommand );
 
-		MSG_WriteByte (&msg, svc_setgame);
+	MSG_WriteByte (&msg, svc_setgame);
 
-		const char *gamedir = FS_GetCurrentGameDir(true);
+	const char *gamedir = FS_GetCurrentGameDir(true);
 
-		while (gamedir[i])
-		{
-			MSG_WriteByte(&msg, gamedir[i]);
-			i++;
-		}
-		MSG_WriteByte(&msg, 0);
+	while (gamedir[i])
+	{
+		MSG_WriteByte(&msg, gamedir[i]);
+		i++;
+	}
+	MSG_WriteByte(&msg, 0);
 
-		// MW - my attempt to fix illegible server message errors caused by
-		// packet fragmentation of initial snapshot.
-		//rww - reusing this code here
-		while(client->state&&client->netchan.unsentFragments)
-		{
-			// send additional message fragments if the last message
-			// was too large to send at once
-			Com_Printf ("[ISM]SV_SendClientGameState() [1] for %s, writing out old fragments\n", client->name);
-			SV_Netchan_TransmitNextFragment(&client->netchan);
-		}
+	// MW - my attempt to fix illegible server message errors caused by
+	// packet fragmentation of initial snapshot.
+	//rww - reusing this code here
+	while(client->state&&client->netchan.unsentFragments)
+	{
+		// send additional message fragments if the last message
+		// was too large to send at once
+		Com_Printf ("[ISM]SV_SendClientGameState() [1] for %s, writing out old fragments\n", client->name);
+		SV_Netchan_TransmitNextFragment(&client->netchan);
+	}
 
-		// record information about the message
-		client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSize = msg.cursize;
-		client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSent = svs.time;
-		client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageAcked = -1;
+	// record information about the message
+	client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSize = msg.cursize;
+	client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageSent = svs.time;
+	client->frames[client->netchan.outgoingSequence & PACKET_MASK].messageAcked = -1;
 
-		// send the datagram
-		SV_Netchan_Transmit( client, &msg );	//msg->cursize, msg->data );
+	// send the datagram
+	SV_Netchan_Transmit( client, &msg );	//msg->cursize, msg->data );
 
-		client->sentGamedir = qtrue;
-	}
+	client->sentGamedir = qtrue;
+}
 
-	// build the snapshot
-	SV_BuildClientSnapshot( client );
+/*
+=======================
+SV_CheckAutoDemo
 
+Starts the automatic demos once a snapshot has been built for the client
+=======================
+*/
+static void SV_CheckAutoDemo( client_t *client ) {
 	if ( !client->demo.demorecording ) { //dont think this needs to be done with singledemo option
 		if (sv_autoDemo->integer == 2) {
 			if (client->netchan.remoteAddress.type == NA_BOT && !Q_stricmp(client->name, "RECORDER")) {
@@ -886,6 +1117,51 @@ void SV_SendClientSnapshot( client_t *client ) {
 			}
 		}
 	}
+}
+
+/*
+=======================
+SV_FinishClientSnapshot
+
+Adds the download data and sends the message written for the client
+=======================
+*/
+static void SV_FinishClientSnapshot( client_t *client, msg_t *msg ) {
+	// Add any download data if the client is downloading
+	SV_WriteDownloadToClient( client, msg );
+
+	// check for overflow
+	if ( msg->overflowed ) {
+		Com_Printf ("WARNING: msg overflowed for %s\n", client->name);
+		MSG_Clear (msg);
+	}
+
+	SV_SendMessageToClient( msg, client );
+}
+
+/*
+=======================
+SV_SendClientSnapshot
+
+Also called by SV_FinalMessage
+
+=======================
+*/
+void SV_SendClientSnapshot( client_t *client ) {
+	byte				msg_buf[MAX_MSGLEN];
+	msg_t				msg;
+	clientSnapshot_t	*oldframe;
+	int					lastframe;
+
+	if (!client->sentGamedir)
+	{
+		SV_SendGamedirToClient( client );
+	}
+
+	// build the snapshot
+	SV_BuildClientSnapshot( client );
+
+	SV_CheckAutoDemo( client );
 
 	// bots need to have their snapshots built, but
 	// they query them directly without needing to be sent
@@ -905,18 +1181,248 @@ void SV_SendClientSnapshot( client_t *client ) {
 
 	// send over all the relevant entityState_t
 	// and the playerState_t
-	SV_WriteSnapshotToClient( client, &msg );
+	oldframe = SV_SnapshotDeltaFrame( client, &lastframe );
+	SV_WriteSnapshotToClient( client, &msg, oldframe, lastframe );
 
-	// Add any download data if the client is downloading
-	SV_WriteDownloadToClient( client, &msg );
+	SV_FinishClientSnapshot( client, &msg );
+}
 
-	// check for overflow
-	if ( msg.overflowed ) {
-		Com_Printf ("WARNING: msg overflowed for %s\n", client->name);
-		MSG_Clear (&msg);
+/*
+=============================================================================
+
+Snapshot worker threads
+
+With sv_snapshotThreads set, SV_SendClientMessages gathers the visible
+entities and writes the messages of all clients due a snapshot on a pool of
+worker threads, the main thread working along.  Anything touching shared
+state runs on the main thread in between: reserving every client's slots in
+the svs.snapshotEntities ring, starting automatic demos and choosing the
+delta frames.  The delta frames are chosen after all the slots of the frame
+have been reserved, so no worker can be reading entities another one is
+overwriting.  Netchan transmission stays on the main thread, in client
+order.
+
+A job's prints and errors are kept with it (Com_BeginDeferredOutput) and only
+printed or raised on the main thread once every worker is done with the
+batch, a Com_Error must never unwind a worker or leave the others running.
+
+=============================================================================
+*/
+
+#define MAX_SNAPSHOT_THREADS	16
+
+typedef struct snapshotJob_s {
+	client_t					*client;
+	qboolean					built;		// SV_GatherClientSnapshot produced a frame
+	qboolean					send;		// bots without a demo only need the frame
+	clientSnapshot_t			*oldframe;
+	int							lastframe;
+	snapshotEntityNumbers_t		entityNumbers;
+	msg_t						msg;
+	byte						msgBuf[MAX_MSGLEN];
+	comDeferredOutput_t			output;		// of the last function run on the job
+} snapshotJob_t;
+
+typedef void (*snapshotJobFunc_t)( snapshotJob_t *job );
+
+static struct snapshotPool_s {
+	std::thread				*threads[MAX_SNAPSHOT_THREADS];
+	int						numThreads;
+	std::mutex				lock;
+	std::condition_variable	wake;
+	std::condition_variable	done;
+	snapshotJobFunc_t		func;
+	snapshotJob_t			*jobs;
+	int						numJobs;
+	std::atomic<int>		nextJob;
+	int						busy;		// workers that haven't finished the current batch
+	int						batch;		// bumped for every batch handed out
+	qboolean				quit;
+} svSnapshotPool;
+
+static snapshotJob_t	svSnapshotJobs[MAX_CLIENTS];
+
+static void SV_RunSnapshotJobs( void ) {
+	snapshotJobFunc_t	func = svSnapshotPool.func;
+	int					job;
+
+	while ( (job = svSnapshotPool.nextJob++) < svSnapshotPool.numJobs ) {
+		snapshotJob_t *j = &svSnapshotPool.jobs[job];
+
+		Com_BeginDeferredOutput( &j->output );
+		try {
+			func( j );
+		} catch ( int ) {
+			// kept in j->output, raised by SV_RunSnapshotJobsParallel
+		}
+		Com_EndDeferredOutput();
+	}
+}
+
+// batch is the last one handed out before the thread was started
+static void SV_SnapshotWorker( int batch ) {
+	std::unique_lock<std::mutex>	l( svSnapshotPool.lock );
+
+	while ( 1 ) {
+		svSnapshotPool.wake.wait( l, [&batch] { return svSnapshotPool.quit || svSnapshotPool.batch != batch; } );
+		if ( svSnapshotPool.quit ) {
+			return;
+		}
+		batch = svSnapshotPool.batch;
+
+		l.unlock();
+		SV_RunSnapshotJobs();
+		l.lock();
+
+		if ( --svSnapshotPool.busy == 0 ) {
+			svSnapshotPool.done.notify_one();
+		}
+	}
+}
+
+/*
+=======================
+SV_RunSnapshotJobsParallel
+
+Runs func on every job, returns when all of them are done.  Then prints what
+they printed, in client order, and raises the first error one of them hit.
+=======================
+*/
+static void SV_RunSnapshotJobsParallel( snapshotJobFunc_t func, snapshotJob_t *jobs, int numJobs ) {
+	{
+		std::lock_guard<std::mutex> l( svSnapshotPool.lock );
+		svSnapshotPool.func = func;
+		svSnapshotPool.jobs = jobs;
+		svSnapshotPool.numJobs = numJobs;
+		svSnapshotPool.nextJob = 0;
+		svSnapshotPool.busy = svSnapshotPool.numThreads;
+		svSnapshotPool.batch++;
 	}
+	svSnapshotPool.wake.notify_all();
 
-	SV_SendMessageToClient( &msg, client );
+	SV_RunSnapshotJobs();
+
+	{
+		std::unique_lock<std::mutex> l( svSnapshotPool.lock );
+		svSnapshotPool.done.wait( l, [] { return svSnapshotPool.busy == 0; } );
+	}
+
+	for ( int i = 0 ; i < numJobs ; i++ ) {
+		Com_RaiseDeferredOutput( &jobs[i].output );
+	}
+}
+
+void SV_ShutdownSnapshotThreads( void ) {
+	int i;
+
+	if ( !svSnapshotPool.numThreads ) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> l( svSnapshotPool.lock );
+		svSnapshotPool.quit = qtrue;
+	}
+	svSnapshotPool.wake.notify_all();
+
+	for ( i = 0 ; i < svSnapshotPool.numThreads ; i++ ) {
+		svSnapshotPool.threads[i]->join();
+		delete svSnapshotPool.threads[i];
+		svSnapshotPool.threads[i] = nullptr;
+	}
+	svSnapshotPool.numThreads = 0;
+	svSnapshotPool.quit = qfalse;
+}
+
+static void SV_StartSnapshotThreads( int numThreads ) {
+	int i;
+
+	SV_ShutdownSnapshotThreads();
+
+	for ( i = 0 ; i < numThreads ; i++ ) {
+		svSnapshotPool.threads[i] = new std::thread( SV_SnapshotWorker, svSnapshotPool.batch );
+	}
+	svSnapshotPool.numThreads = numThreads;
+}
+
+static void SV_GatherSnapshotJob( snapshotJob_t *job ) {
+	job->built = SV_GatherClientSnapshot( job->client, &job->entityNumbers );
+}
+
+static void SV_WriteSnapshotJob( snapshotJob_t *job ) {
+	client_t *client = job->client;
+
+	if ( job->built ) {
+		SV_CopySnapshotEntities( client, &job->entityNumbers );
+	}
+
+	if ( !job->send ) {
+		return;
+	}
+
+	MSG_Init (&job->msg, job->msgBuf, sizeof(job->msgBuf));
+	job->msg.allowoverflow = qtrue;
+
+	// NOTE, MRE: all server->client messages now acknowledge
+	// let the client know which reliable clientCommands we have received
+	MSG_WriteLong( &job->msg, client->lastClientCommand );
+
+	// (re)send any reliable server commands
+	SV_UpdateServerCommandsToClient( client, &job->msg );
+
+	// send over all the relevant entityState_t
+	// and the playerState_t
+	SV_WriteSnapshotToClient( client, &job->msg, job->oldframe, job->lastframe );
+}
+
+/*
+=======================
+SV_SendClientSnapshotsParallel
+
+SV_SendClientSnapshot for all the jobs, see above
+=======================
+*/
+static void SV_SendClientSnapshotsParallel( snapshotJob_t *jobs, int numJobs ) {
+	snapshotJob_t	*job;
+	sharedEntity_t	*ent;
+	int				i;
+
+	// SV_AddEntitiesVisibleFromPoint repairs these, do it before the workers see them
+	for ( i = 0 ; i < sv.num_entities ; i++ ) {
+		ent = SV_GentityNum( i );
+		if ( ent->s.number != i ) {
+			Com_DPrintf ("FIXING ENT->S.NUMBER!!!\n");
+			ent->s.number = i;
+		}
+	}
+
+	SV_RunSnapshotJobsParallel( SV_GatherSnapshotJob, jobs, numJobs );
+
+	for ( i = 0, job = jobs ; i < numJobs ; i++, job++ ) {
+		if ( job->built ) {
+			SV_ReserveSnapshotEntities( job->client, job->entityNumbers.numSnapshotEntities );
+		}
+
+		SV_CheckAutoDemo( job->client );
+
+		// bots need to have their snapshots built, but
+		// they query them directly without needing to be sent
+		job->send = (qboolean)( job->client->netchan.remoteAddress.type != NA_BOT || job->client->demo.demorecording );
+	}
+
+	for ( i = 0, job = jobs ; i < numJobs ; i++, job++ ) {
+		if ( job->send ) {
+			job->oldframe = SV_SnapshotDeltaFrame( job->client, &job->lastframe );
+		}
+	}
+
+	SV_RunSnapshotJobsParallel( SV_WriteSnapshotJob, jobs, numJobs );
+
+	for ( i = 0, job = jobs ; i < numJobs ; i++, job++ ) {
+		if ( job->send ) {
+			SV_FinishClientSnapshot( job->client, &job->msg );
+		}
+	}
 }
 
 
@@ -928,6 +1434,20 @@ SV_SendClientMessages
 void SV_SendClientMessages( void ) {
 	int			i;
 	client_t	*c;
+	int			numThreads;
+	int			numJobs = 0;
+
+	numThreads = Com_Clampi( 0, MAX_SNAPSHOT_THREADS, sv_snapshotThreads->integer );
+	if ( numThreads != svSnapshotPool.numThreads ) {
+		SV_StartSnapshotThreads( numThreads );
+	}
+
+	svVisCacheNumEntries = 0;
+	svVisCacheActive = qtrue;
+	MSG_ClearDeltaEntityCache();
+
+	// everything below goes out with as few syscalls as possible
+	NET_BeginPacketBatch();
 
 	// send a message to each connected client
 	for (i=0, c = svs.clients ; i < sv_maxclients->integer ; i++, c++) {
@@ -948,8 +1468,23 @@ void SV_SendClientMessages( void ) {
 			continue;
 		}
 
-		// generate and send a new message
-		SV_SendClientSnapshot( c );
+		if ( !numThreads ) {
+			// generate and send a new message
+			SV_SendClientSnapshot( c );
+			continue;
+		}
+
+		if ( !c->sentGamedir ) {
+			SV_SendGamedirToClient( c );
+		}
+		svSnapshotJobs[numJobs++].client = c;
+	}
+
+	if ( numJobs ) {
+		SV_SendClientSnapshotsParallel( svSnapshotJobs, numJobs );
 	}
-}
 
+	NET_FlushPacketBatch();
+
+	svVisCacheActive = qfalse;
+}
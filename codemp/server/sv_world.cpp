@@ -62,6 +62,13 @@ the world is carved up with an evenly spaced, axially aligned bsp tree.  Entitie
 are kept in chains either at the final leafs, or at the first node that splits
 them, which prevents having to deal with multiple fragments of a single entity.
 
+With sv_worldIndex 1 a loose uniform grid over x/y is used instead.  Every entity
+is chained in the one cell holding the center of its box, and its box may spill
+half a cell over the edges, so queries look at the cells their box touches after
+growing it by half a cell.  Entities larger than a cell go in a separate chain
+that every query checks.  Cells are leaf worldSector_t so unlinking doesn't care
+which index is used.
+
 ===============================================================================
 */
 
@@ -78,25 +85,57 @@ typedef struct worldSector_s {
 worldSector_t	sv_worldSectors[AREA_NODES];
 int			sv_numworldSectors;
 
+#define	WORLDINDEX_TREE		0
+#define	WORLDINDEX_GRID		1
+
+#define	GRID_MAX_CELLS		64		// per axis
+#define	GRID_MIN_CELL_SIZE	256
+
+typedef struct worldGrid_s {
+	float			origin[2];
+	float			cellSize;
+	int				width, height;
+	worldSector_t	cells[GRID_MAX_CELLS*GRID_MAX_CELLS];
+	worldSector_t	large;			// doesn't fit in a cell
+} worldGrid_t;
+
+static worldGrid_t	sv_worldGrid;
+static int			sv_worldIndexType;
+
 
 /*
 ===============
 SV_SectorList_f
 ===============
 */
+static int SV_SectorCount( const worldSector_t *sec ) {
+	svEntity_t		*ent;
+	int				c = 0;
+
+	for ( ent = sec->entities ; ent ; ent = ent->nextEntityInWorldSector ) {
+		c++;
+	}
+	return c;
+}
+
 void SV_SectorList_f( void ) {
 	int				i, c;
 	worldSector_t	*sec;
-	svEntity_t		*ent;
+
+	if ( sv_worldIndexType == WORLDINDEX_GRID ) {
+		for ( i = 0 ; i < sv_worldGrid.width * sv_worldGrid.height ; i++ ) {
+			c = SV_SectorCount( &sv_worldGrid.cells[i] );
+			if ( c ) {
+				Com_Printf( "cell %i,%i: %i entities\n", i % sv_worldGrid.width, i / sv_worldGrid.width, c );
+			}
+		}
+		Com_Printf( "large: %i entities\n", SV_SectorCount( &sv_worldGrid.large ) );
+		return;
+	}
 
 	for ( i = 0 ; i < AREA_NODES ; i++ ) {
 		sec = &sv_worldSectors[i];
-
-		c = 0;
-		for ( ent = sec->entities ; ent ; ent = ent->nextEntityInWorldSector ) {
-			c++;
-		}
-		Com_Printf( "sector %i: %i entities\n", i, c );
+		Com_Printf( "sector %i: %i entities\n", i, SV_SectorCount( sec ) );
 	}
 }
 
@@ -148,7 +187,60 @@ SV_ClearWorld
 
 ===============
 */
-void SV_ClearWorld( void ) {
+/*
+===============
+SV_CreateWorldGrid
+
+Sizes the grid so the map is covered by at most GRID_MAX_CELLS cells along
+its longer side, without making cells smaller than GRID_MIN_CELL_SIZE
+===============
+*/
+static void SV_CreateWorldGrid( const vec3_t mins, const vec3_t maxs ) {
+	float	size;
+
+	Com_Memset( &sv_worldGrid, 0, sizeof(sv_worldGrid) );
+
+	size = Q_max( maxs[0] - mins[0], maxs[1] - mins[1] );
+	sv_worldGrid.cellSize = Q_max( size / GRID_MAX_CELLS, (float)GRID_MIN_CELL_SIZE );
+	sv_worldGrid.origin[0] = mins[0];
+	sv_worldGrid.origin[1] = mins[1];
+	sv_worldGrid.width = Com_Clampi( 1, GRID_MAX_CELLS, (int)ceilf( (maxs[0] - mins[0]) / sv_worldGrid.cellSize ) );
+	sv_worldGrid.height = Com_Clampi( 1, GRID_MAX_CELLS, (int)ceilf( (maxs[1] - mins[1]) / sv_worldGrid.cellSize ) );
+
+	sv_worldGrid.large.axis = -1;
+	for ( int i = 0 ; i < GRID_MAX_CELLS*GRID_MAX_CELLS ; i++ ) {
+		sv_worldGrid.cells[i].axis = -1;
+	}
+}
+
+static int SV_GridCoord( float v, int axis ) {
+	const int size = axis ? sv_worldGrid.height : sv_worldGrid.width;
+
+	return Com_Clampi( 0, size - 1, (int)floorf( (v - sv_worldGrid.origin[axis]) / sv_worldGrid.cellSize ) );
+}
+
+/*
+===============
+SV_GridSectorForBox
+
+The loose cell for an absmin/absmax box
+===============
+*/
+static worldSector_t *SV_GridSectorForBox( const vec3_t absmin, const vec3_t absmax ) {
+	if ( absmax[0] - absmin[0] > sv_worldGrid.cellSize || absmax[1] - absmin[1] > sv_worldGrid.cellSize ) {
+		return &sv_worldGrid.large;
+	}
+
+	return &sv_worldGrid.cells[SV_GridCoord( 0.5f * (absmin[1] + absmax[1]), 1 ) * sv_worldGrid.width
+		+ SV_GridCoord( 0.5f * (absmin[0] + absmax[0]), 0 )];
+}
+
+/*
+===============
+SV_BuildWorldIndex
+===============
+*/
+static void SV_BuildWorldIndex( int type ) {
 	clipHandle_t	h;
 	vec3_t			mins, maxs;
 
@@ -159,8 +251,55 @@ void SV_ClearWorld( void ) {
 	h = CM_InlineModel( 0 );
 	CM_ModelBounds( h, mins, maxs );
 	SV_CreateworldSector( 0, mins, maxs );
+
+	if ( type == WORLDINDEX_GRID ) {
+		SV_CreateWorldGrid( mins, maxs );
+	}
+
+	sv_worldIndexType = type;
 }
 
+/*
+===============
+SV_ClearWorld
+
+===============
+*/
+void SV_ClearWorld( void ) {
+	SV_BuildWorldIndex( sv_worldIndex->integer == WORLDINDEX_GRID ? WORLDINDEX_GRID : WORLDINDEX_TREE );
+}
+
+
+/*
+===============
+SV_SectorForBox
+
+The sector an entity with this absmin/absmax is chained in
+===============
+*/
+static worldSector_t *SV_SectorForBox( const vec3_t absmin, const vec3_t absmax ) {
+	worldSector_t	*node;
+
+	if ( sv_worldIndexType == WORLDINDEX_GRID ) {
+		return SV_GridSectorForBox( absmin, absmax );
+	}
+
+	// find the first world sector node that the ent's box crosses
+	node = sv_worldSectors;
+	while (1)
+	{
+		if (node->axis == -1)
+			break;
+		if ( absmin[node->axis] > node->dist)
+			node = node->children[0];
+		else if ( absmax[node->axis] < node->dist)
+			node = node->children[1];
+		else
+			break;		// crosses the node
+	}
+
+	return node;
+}
 
 /*
 ===============
@@ -343,21 +482,8 @@ void SV_LinkEntity( sharedEntity_t *gEnt ) {
 
 	gEnt->r.linkcount++;
 
-	// find the first world sector node that the ent's box crosses
-	node = sv_worldSectors;
-	while (1)
-	{
-		if (node->axis == -1)
-			break;
-		if ( gEnt->r.absmin[node->axis] > node->dist)
-			node = node->children[0];
-		else if ( gEnt->r.absmax[node->axis] < node->dist)
-			node = node->children[1];
-		else
-			break;		// crosses the node
-	}
-
 	// link it in
+	node = SV_SectorForBox( gEnt->r.absmin, gEnt->r.absmax );
 	ent->worldSector = node;
 	ent->nextEntityInWorldSector = node->entities;
 	node->entities = ent;
@@ -429,6 +555,29 @@ void SV_AreaEntities_r( worldSector_t *node, areaParms_t *ap ) {
 	}
 }
 
+/*
+================
+SV_AreaEntitiesGrid
+================
+*/
+static void SV_AreaEntitiesGrid( areaParms_t *ap ) {
+	const float	loose = 0.5f * sv_worldGrid.cellSize;
+	int			x, y, x0, x1, y0, y1;
+
+	SV_AreaEntities_r( &sv_worldGrid.large, ap );
+
+	x0 = SV_GridCoord( ap->mins[0] - loose, 0 );
+	x1 = SV_GridCoord( ap->maxs[0] + loose, 0 );
+	y0 = SV_GridCoord( ap->mins[1] - loose, 1 );
+	y1 = SV_GridCoord( ap->maxs[1] + loose, 1 );
+
+	for ( y = y0 ; y <= y1 ; y++ ) {
+		for ( x = x0 ; x <= x1 ; x++ ) {
+			SV_AreaEntities_r( &sv_worldGrid.cells[y * sv_worldGrid.width + x], ap );
+		}
+	}
+}
+
 /*
 ================
 SV_AreaEntities
@@ -443,11 +592,106 @@ int SV_AreaEntities( const vec3_t mins, const vec3_t maxs, int *entityList, int
 	ap.count = 0;
 	ap.maxcount = maxcount;
 
-	SV_AreaEntities_r( sv_worldSectors, &ap );
+	if ( sv_worldIndexType == WORLDINDEX_GRID ) {
+		SV_AreaEntitiesGrid( &ap );
+	} else {
+		SV_AreaEntities_r( sv_worldSectors, &ap );
+	}
 
 	return ap.count;
 }
 
+/*
+================
+SV_RelinkWorldIndex
+
+Moves everything that is linked into a freshly built index, the
+entities keep their absmin/absmax and clusters
+================
+*/
+static void SV_RelinkWorldIndex( int type ) {
+	svEntity_t		*linked[MAX_GENTITIES];
+	sharedEntity_t	*gEnt;
+	worldSector_t	*node;
+	int				i, num = 0;
+
+	for ( i = 0 ; i < sv.num_entities ; i++ ) {
+		if ( sv.svEntities[i].worldSector ) {
+			linked[num++] = &sv.svEntities[i];
+		}
+	}
+
+	SV_BuildWorldIndex( type );
+
+	for ( i = 0 ; i < num ; i++ ) {
+		gEnt = SV_GEntityForSvEntity( linked[i] );
+		node = SV_SectorForBox( gEnt->r.absmin, gEnt->r.absmax );
+		linked[i]->worldSector = node;
+		linked[i]->nextEntityInWorldSector = node->entities;
+		node->entities = linked[i];
+	}
+}
+
+/*
+================
+SV_WorldBench_f
+
+Times SV_AreaEntities with the sector tree and the grid on the current map:
+a small box around every linked entity (movement, touch checks) and a long
+box from it along x and y (shots).  Usage: worldbench [iterations]
+================
+*/
+void SV_WorldBench_f( void ) {
+	static int		list[MAX_GENTITIES];
+	const int		savedType = sv_worldIndexType;
+	const char		*names[2] = { "tree", "grid" };
+	int				iterations, type, it, i, found, queries, start, msec;
+	sharedEntity_t	*gEnt;
+	vec3_t			mins, maxs;
+
+	if ( !com_sv_running->integer ) {
+		Com_Printf( "Server is not running.\n" );
+		return;
+	}
+
+	iterations = Cmd_Argc() > 1 ? atoi( Cmd_Argv( 1 ) ) : 100;
+	if ( iterations < 1 ) {
+		iterations = 1;
+	}
+
+	for ( type = WORLDINDEX_TREE ; type <= WORLDINDEX_GRID ; type++ ) {
+		SV_RelinkWorldIndex( type );
+
+		found = queries = 0;
+		start = Sys_Milliseconds();
+		for ( it = 0 ; it < iterations ; it++ ) {
+			for ( i = 0 ; i < sv.num_entities ; i++ ) {
+				if ( !sv.svEntities[i].worldSector ) {
+					continue;
+				}
+				gEnt = SV_GentityNum( i );
+
+				VectorSet( mins, gEnt->r.absmin[0] - 64, gEnt->r.absmin[1] - 64, gEnt->r.absmin[2] - 64 );
+				VectorSet( maxs, gEnt->r.absmax[0] + 64, gEnt->r.absmax[1] + 64, gEnt->r.absmax[2] + 64 );
+				found += SV_AreaEntities( mins, maxs, list, MAX_GENTITIES );
+
+				VectorCopy( gEnt->r.currentOrigin, mins );
+				VectorCopy( gEnt->r.currentOrigin, maxs );
+				maxs[(i & 1)] += 4096;
+				found += SV_AreaEntities( mins, maxs, list, MAX_GENTITIES );
+
+				queries += 2;
+			}
+		}
+		msec = Sys_Milliseconds() - start;
+
+		Com_Printf( "%s: %i queries in %i msec (%.3f usec each), %i entities found\n",
+			names[type], queries, msec, queries ? msec * 1000.0f / queries : 0.0f, found );
+	}
+
+	SV_RelinkWorldIndex( savedType );
+}
+
 
 
 //===========================================================================
@@ -470,6 +714,8 @@ Ghoul2 Insert Start
 
 	int			traceFlags;
 	int			useLod;
+	const traceRewind_t *rewind;
+	int			numRewind;
 	trace_t		trace;			// make sure nothing goes under here for Ghoul2 collision purposes
 /*
 Ghoul2 Insert End
@@ -535,7 +781,108 @@ static float VectorDistance(vec3_t p1, vec3_t p2)
 }
 #endif
 
-static void SV_ClipMoveToEntities( moveclip_t *clip ) {
+/*
+====================
+SV_FilterAreaEntities
+
+What SV_AreaEntities would return for mins/maxs, taken from the result of a
+query that enclosed it.  Keeps the order, so ties between entities resolve the same.
+====================
+*/
+static int SV_FilterAreaEntities( const int *gathered, int numGathered, const vec3_t mins, const vec3_t maxs, int *touchlist ) {
+	sharedEntity_t	*gcheck;
+	int				i, num = 0;
+
+	for ( i=0 ; i<numGathered ; i++ ) {
+		gcheck = SV_GentityNum( gathered[i] );
+
+		if ( gcheck->r.absmin[0] > maxs[0]
+		|| gcheck->r.absmin[1] > maxs[1]
+		|| gcheck->r.absmin[2] > maxs[2]
+		|| gcheck->r.absmax[0] < mins[0]
+		|| gcheck->r.absmax[1] < mins[1]
+		|| gcheck->r.absmax[2] < mins[2]) {
+			continue;
+		}
+
+		touchlist[num++] = gathered[i];
+	}
+
+	return num;
+}
+
+/*
+====================
+SV_RewindForEntity
+
+Returns the historical placement the trace should use for this entity, if any
+====================
+*/
+static const traceRewind_t *SV_RewindForEntity( const moveclip_t *clip, const sharedEntity_t *touch ) {
+	int i;
+
+	if ( touch->r.bmodel ) {
+		return NULL;
+	}
+
+	for ( i=0 ; i<clip->numRewind ; i++ ) {
+		if ( clip->rewind[i].entityNum == touch->s.number ) {
+			return &clip->rewind[i];
+		}
+	}
+
+	return NULL;
+}
+
+/*
+====================
+SV_AddRewoundEntities
+
+Rewound entities can be outside the sectors they are linked in, so
+add the ones whose historical bounds touch the move to the list
+====================
+*/
+static int SV_AddRewoundEntities( const moveclip_t *clip, int *touchlist, int num, int maxcount ) {
+	const traceRewind_t *rewind;
+	sharedEntity_t *touch;
+	int			i, j;
+
+	for ( i=0 ; i<clip->numRewind ; i++ ) {
+		rewind = &clip->rewind[i];
+
+		if ( rewind->entityNum < 0 || rewind->entityNum >= sv.num_entities ) {
+			continue;
+		}
+		touch = SV_GentityNum( rewind->entityNum );
+		if ( !touch->r.linked || touch->r.bmodel ) {
+			continue;
+		}
+
+		// same as the absmin/absmax SV_LinkEntity would give it
+		for ( j=0 ; j<3 ; j++ ) {
+			if ( rewind->origin[j] + rewind->mins[j] - 1 > clip->boxmaxs[j]
+				|| rewind->origin[j] + rewind->maxs[j] + 1 < clip->boxmins[j] ) {
+				break;
+			}
+		}
+		if ( j != 3 ) {
+			continue;
+		}
+
+		for ( j=0 ; j<num ; j++ ) {
+			if ( touchlist[j] == rewind->entityNum ) {
+				break;
+			}
+		}
+		if ( j == num && num < maxcount ) {
+			touchlist[num++] = rewind->entityNum;
+		}
+	}
+
+	return num;
+}
+
+static void SV_ClipMoveToEntities( moveclip_t *clip, const int *gathered, int numGathered ) {
 	static int	touchlist[MAX_GENTITIES];
 	int			i, num;
 	sharedEntity_t *touch;
@@ -544,8 +891,17 @@ static void SV_ClipMoveToEntities( moveclip_t *clip ) {
 	clipHandle_t	clipHandle;
 	float		*origin, *angles;
 	int			thisOwnerShared = 1;
+	const traceRewind_t *rewind;
+
+	if ( gathered ) {
+		num = SV_FilterAreaEntities( gathered, numGathered, clip->boxmins, clip->boxmaxs, touchlist );
+	} else {
+		num = SV_AreaEntities( clip->boxmins, clip->boxmaxs, touchlist, MAX_GENTITIES);
+	}
 
-	num = SV_AreaEntities( clip->boxmins, clip->boxmaxs, touchlist, MAX_GENTITIES);
+	if ( clip->numRewind ) {
+		num = SV_AddRewoundEntities( clip, touchlist, num, MAX_GENTITIES );
+	}
 
 	if ( clip->passEntityNum != ENTITYNUM_NONE ) {
 		passOwnerNum = ( SV_GentityNum( clip->passEntityNum ) )->r.ownerNum;
@@ -616,9 +972,14 @@ static void SV_ClipMoveToEntities( moveclip_t *clip ) {
 		}
 
 		// might intersect, so do an exact clip
-		clipHandle = SV_ClipHandleForEntity (touch);
-
-		origin = touch->r.currentOrigin;
+		rewind = clip->numRewind ? SV_RewindForEntity( clip, touch ) : NULL;
+		if ( rewind ) {
+			clipHandle = CM_TempBoxModel( rewind->mins, rewind->maxs, (touch->r.svFlags & SVF_CAPSULE) ? qtrue : qfalse );
+			origin = (float *)rewind->origin;
+		} else {
+			clipHandle = SV_ClipHandleForEntity (touch);
+			origin = touch->r.currentOrigin;
+		}
 		angles = touch->r.currentAngles;
 
 
@@ -744,6 +1105,10 @@ Ghoul2 Insert Start
 			{
 				VectorCopy(touch->r.currentAngles, angles);
 			}
+			if (rewind)
+			{
+				angles[YAW] = rewind->yaw;
+			}
 			angles[ROLL] = angles[PITCH] = 0;
 
 			//I would think that you could trace from trace.endpos instead of clip->start, but that causes it to miss sometimes.. Not sure what it's off, but if it could be done like that, it would probably
@@ -761,11 +1126,11 @@ Ghoul2 Insert Start
 				touch->s.NPC_class == CLASS_VEHICLE &&
 				touch->m_pVehicle)
 			{ //for vehicles cache the transform data.
-				re->G2API_CollisionDetectCache(G2Trace, *((CGhoul2Info_v *)touch->ghoul2), angles, touch->r.currentOrigin, sv.time, touch->s.number, clip->start, clip->end, touch->modelScale, G2VertSpaceServer, 0, clip->useLod, fRadius);
+				re->G2API_CollisionDetectCache(G2Trace, *((CGhoul2Info_v *)touch->ghoul2), angles, origin, sv.time, touch->s.number, clip->start, clip->end, touch->modelScale, G2VertSpaceServer, 0, clip->useLod, fRadius);
 			}
 			else
 			{
-				re->G2API_CollisionDetect(G2Trace, *((CGhoul2Info_v *)touch->ghoul2), angles, touch->r.currentOrigin, sv.time, touch->s.number, clip->start, clip->end, touch->modelScale, G2VertSpaceServer, 0, clip->useLod, fRadius);
+				re->G2API_CollisionDetect(G2Trace, *((CGhoul2Info_v *)touch->ghoul2), angles, origin, sv.time, touch->s.number, clip->start, clip->end, touch->modelScale, G2VertSpaceServer, 0, clip->useLod, fRadius);
 			}
 
 			tN = 0;
@@ -819,7 +1184,7 @@ passEntityNum and entities owned by passEntityNum are explicitly not checked.
 /*
 Ghoul2 Insert Start
 */
-void SV_Trace( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule, int traceFlags, int useLod ) {
+static void SV_TraceInternal( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule, int traceFlags, int useLod, const traceRewind_t *rewind, int numRewind, const int *gathered, int numGathered ) {
 /*
 Ghoul2 Insert End
 */
@@ -859,6 +1224,8 @@ Ghoul2 Insert End
 	clip.maxs = maxs;
 	clip.passEntityNum = passEntityNum;
 	clip.capsule = capsule;
+	clip.rewind = rewind;
+	clip.numRewind = numRewind;
 
 	// create the bounding box of the entire move
 	// we can limit it to the part of the move not
@@ -875,11 +1242,100 @@ Ghoul2 Insert End
 	}
 
 	// clip to other solid entities
-	SV_ClipMoveToEntities ( &clip );
+	SV_ClipMoveToEntities ( &clip, gathered, numGathered );
 
 	*results = clip.trace;
 }
 
+void SV_Trace( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule, int traceFlags, int useLod ) {
+	SV_TraceInternal( results, start, mins, maxs, end, passEntityNum, contentmask, capsule, traceFlags, useLod, NULL, 0, NULL, 0 );
+}
+
+/*
+==================
+SV_TraceRewound
+
+Lag compensation for a single trace: the entities in rewind are clipped where
+they were instead of where they are, without unlinking and relinking them.
+==================
+*/
+void SV_TraceRewound( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule, int traceFlags, int useLod, const traceRewind_t *rewind, int numRewind ) {
+	if ( numRewind < 0 || !rewind ) {
+		numRewind = 0;
+	}
+	SV_TraceInternal( results, start, mins, maxs, end, passEntityNum, contentmask, capsule, traceFlags, useLod, rewind, numRewind, NULL, 0 );
+}
+
+/*
+==================
+SV_TraceBatch
+
+Consecutive requests whose moves fit together in TRACEBATCH_REGION units (or the
+size of the first move along an axis where it is larger) are traced against
+one shared SV_AreaEntities result, each one only looks at the
+entities that touch its own move.  The results are the same as calling SV_Trace
+for every request.
+==================
+*/
+#define	TRACEBATCH_REGION	2048
+
+static void SV_TraceRequestBounds( const traceRequest_t *request, vec3_t mins, vec3_t maxs ) {
+	int i;
+
+	// same box SV_Trace limits the entity lookup to
+	for ( i=0 ; i<3 ; i++ ) {
+		if ( request->end[i] > request->start[i] ) {
+			mins[i] = request->start[i] + request->mins[i] - 1;
+			maxs[i] = request->end[i] + request->maxs[i] + 1;
+		} else {
+			mins[i] = request->end[i] + request->mins[i] - 1;
+			maxs[i] = request->start[i] + request->maxs[i] + 1;
+		}
+	}
+}
+
+void SV_TraceBatch( const traceRequest_t *requests, trace_t *results, int numRequests ) {
+	static int	gathered[MAX_GENTITIES];
+	vec3_t		mins, maxs, boxmins, boxmaxs, region;
+	int			first, last, i, j, numGathered;
+
+	for ( first=0 ; first<numRequests ; first=last ) {
+		SV_TraceRequestBounds( &requests[first], mins, maxs );
+		for ( j=0 ; j<3 ; j++ ) {
+			region[j] = Q_max( maxs[j] - mins[j], (float)TRACEBATCH_REGION );
+		}
+
+		// grow the group while everything still fits in the region
+		for ( last=first+1 ; last<numRequests ; last++ ) {
+			SV_TraceRequestBounds( &requests[last], boxmins, boxmaxs );
+			for ( j=0 ; j<3 ; j++ ) {
+				if ( Q_max( maxs[j], boxmaxs[j] ) - Q_min( mins[j], boxmins[j] ) > region[j] ) {
+					break;
+				}
+			}
+			if ( j != 3 ) {
+				break;
+			}
+			for ( j=0 ; j<3 ; j++ ) {
+				mins[j] = Q_min( mins[j], boxmins[j] );
+				maxs[j] = Q_max( maxs[j], boxmaxs[j] );
+			}
+		}
+
+		if ( last - first == 1 ) {
+			SV_TraceInternal( &results[first], requests[first].start, requests[first].mins, requests[first].maxs, requests[first].end,
+				requests[first].passEntityNum, requests[first].contentmask, requests[first].capsule, requests[first].traceFlags, requests[first].useLod, NULL, 0, NULL, 0 );
+			continue;
+		}
+
+		numGathered = SV_AreaEntities( mins, maxs, gathered, MAX_GENTITIES );
+		for ( i=first ; i<last ; i++ ) {
+			SV_TraceInternal( &results[i], requests[i].start, requests[i].mins, requests[i].maxs, requests[i].end,
+				requests[i].passEntityNum, requests[i].contentmask, requests[i].capsule, requests[i].traceFlags, requests[i].useLod, NULL, 0, gathered, numGathered );
+		}
+	}
+}
+
 
 
 /*
@@ -278,6 +278,23 @@ time_t Sys_FileTime( const char *path )
 	return buf.st_mtime;
 }
 
+/*
+============
+Sys_FileSize
+
+returns -1 if not present
+============
+*/
+int64_t Sys_FileSize( const char *path )
+{
+	struct stat buf;
+
+	if ( stat( path, &buf ) == -1 )
+		return -1;
+
+	return (int64_t)buf.st_size;
+}
+
 /*
 =================
 Sys_UnloadDll
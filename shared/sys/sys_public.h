@@ -153,6 +153,10 @@ void	Sys_FreeFileList( char **fileList );
 //rwwRMG - changed to fileList to not conflict with list type
 
 time_t Sys_FileTime( const char *path );
+int64_t Sys_FileSize( const char *path );
+
+void	*Sys_MapFile( const char *path, size_t *size );
+void	Sys_UnmapFile( void *data, size_t size );
 
 qboolean Sys_LowPhysicalMemory();
 
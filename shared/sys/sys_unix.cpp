@@ -27,6 +27,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <pwd.h>
 #include <libgen.h>
@@ -420,6 +421,46 @@ char *Sys_Cwd( void )
 	return cwd;
 }
 
+/*
+==================
+Sys_MapFile
+
+Maps a whole file into memory. The view is copy-on-write so callers may patch
+the data in place without touching the file on disk.
+==================
+*/
+void *Sys_MapFile( const char *path, size_t *size )
+{
+	struct stat st;
+	void *data;
+	int fd = open( path, O_RDONLY );
+
+	*size = 0;
+	if ( fd == -1 )
+		return NULL;
+
+	if ( fstat( fd, &st ) == -1 || st.st_size <= 0 )
+	{
+		close( fd );
+		return NULL;
+	}
+
+	data = mmap( NULL, (size_t)st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0 );
+	close( fd );
+
+	if ( data == MAP_FAILED )
+		return NULL;
+
+	*size = (size_t)st.st_size;
+	return data;
+}
+
+void Sys_UnmapFile( void *data, size_t size )
+{
+	if ( data )
+		munmap( data, size );
+}
+
 /* Resolves path names and determines if they are the same */
 /* For use with full OS paths not quake paths */
 /* Returns true if resulting paths are valid and the same, otherwise false */
@@ -370,6 +370,49 @@ char *Sys_Cwd( void ) {
 	return cwd;
 }
 
+/*
+==================
+Sys_MapFile
+
+Maps a whole file into memory. The view is copy-on-write so callers may patch
+the data in place without touching the file on disk.
+==================
+*/
+void *Sys_MapFile( const char *path, size_t *size ) {
+	HANDLE file, mapping;
+	LARGE_INTEGER fileSize;
+	void *data;
+
+	*size = 0;
+	file = CreateFile( path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if ( file == INVALID_HANDLE_VALUE )
+		return NULL;
+
+	if ( !GetFileSizeEx( file, &fileSize ) || fileSize.QuadPart <= 0 || (ULONGLONG)fileSize.QuadPart > (ULONGLONG)(SIZE_MAX) ) {
+		CloseHandle( file );
+		return NULL;
+	}
+
+	mapping = CreateFileMapping( file, NULL, PAGE_WRITECOPY, 0, 0, NULL );
+	CloseHandle( file );
+	if ( !mapping )
+		return NULL;
+
+	// the view keeps the mapping object alive
+	data = MapViewOfFile( mapping, FILE_MAP_COPY, 0, 0, 0 );
+	CloseHandle( mapping );
+	if ( !data )
+		return NULL;
+
+	*size = (size_t)fileSize.QuadPart;
+	return data;
+}
+
+void Sys_UnmapFile( void *data, size_t size ) {
+	if ( data )
+		UnmapViewOfFile( data );
+}
+
 /* Resolves path names and determines if they are the same */
 /* For use with full OS paths not quake paths */
 /* Returns true if resulting paths are valid and the same, otherwise false */
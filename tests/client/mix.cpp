@@ -0,0 +1,548 @@
+#include "client/snd_mixkernels.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// The mixer of snd_mix.cpp has to paint and clip the same bits with every
+// kernel as the per sample loops it had before them.
+//
+// The replay and benchmark cases mix a capture of S_PaintChannels, made with
+// s_mixrecord in game and passed in through the MIX_RECORDING environment
+// variable. Without one they mix the built in fight below, put together the
+// way S_PaintChannels would have painted it.
+
+namespace
+{
+	const int paintSamples = 1024;	// PAINTBUFFER_SIZE
+	const int dmaSamples = 16384;	// in values, a left and a right per sample
+
+	struct Recording
+	{
+		struct Record
+		{
+			sndMixRecord_t rec;
+			std::vector<short> samples;	// SNDMIXREC_CHANNEL
+			std::vector<int> raw;		// SNDMIXREC_BEGIN
+		};
+		std::vector<Record> records;
+		int channelSamples = 0;
+
+		void Add( const Record &r )
+		{
+			records.push_back( r );
+			if( r.rec.type == SNDMIXREC_CHANNEL )
+			{
+				channelSamples += r.rec.count;
+			}
+		}
+
+		bool Load( const char *path )
+		{
+			FILE *f = fopen( path, "rb" );
+			int ident = 0;
+			Record r;
+
+			if( !f )
+			{
+				return false;
+			}
+			if( fread( &ident, sizeof( ident ), 1, f ) != 1 || ident != SNDMIX_RECORD_IDENT )
+			{
+				fclose( f );
+				return false;
+			}
+			while( fread( &r.rec, sizeof( r.rec ), 1, f ) == 1 )
+			{
+				r.samples.clear();
+				r.raw.clear();
+				if( r.rec.type == SNDMIXREC_BEGIN )
+				{
+					r.raw.resize( r.rec.numData );
+					if( r.rec.numData && fread( r.raw.data(), sizeof( int ), r.rec.numData, f ) != (size_t)r.rec.numData )
+					{
+						break;
+					}
+				}
+				else if( r.rec.type == SNDMIXREC_CHANNEL )
+				{
+					r.samples.resize( r.rec.numData );
+					if( r.rec.numData && fread( r.samples.data(), sizeof( short ), r.rec.numData, f ) != (size_t)r.rec.numData )
+					{
+						break;
+					}
+				}
+				Add( r );
+			}
+			fclose( f );
+			return !records.empty();
+		}
+	};
+
+	// a sound of the fight, with the channel playing it
+	struct Sound
+	{
+		std::vector<short> data;
+		int length;				// iSoundLengthInSamples, the doppler loop may read past it as in game
+		int startSample;
+		bool loop;
+		int leftVol, rightVol;	// ch->leftvol/rightvol times snd_vol
+		float dopplerScale;		// 1 or less goes through the kernel
+	};
+
+	Sound MakeSound( int length, int startSample, bool loop, int leftVol, int rightVol, float dopplerScale, short ( *wave )( int ) )
+	{
+		Sound s;
+		s.data.resize( length * 3 );
+		for( int i = 0; i < (int)s.data.size(); i++ )
+		{
+			s.data[i] = wave( i % length );
+		}
+		s.length = length;
+		s.startSample = startSample;
+		s.loop = loop;
+		s.leftVol = leftVol;
+		s.rightVol = rightVol;
+		s.dopplerScale = dopplerScale;
+		return s;
+	}
+
+	short SaberHum( int i ) { return (short)( ( i % 90 < 45 ? i % 90 : 90 - i % 90 ) * 400 - 9000 ); }
+	short Blaster( int i ) { return (short)( ( ( i / 23 ) & 1 ? 32767 : -32768 ) * ( 7001 - i ) / 7001 ); }
+	short Explosion( int i ) { return (short)( ( i * 1103515245u + 12345u ) >> 16 ); }
+	short Rocket( int i ) { return (short)( ( i * 311 ) % 65536 - 32768 ); }
+	short Footstep( int i ) { return (short)( i & 1 ? 12000 - i * 30 : i * 30 - 12000 ); }
+	short Voice( int i ) { return (short)( sinf( i * 0.031f ) * sinf( i * 0.0021f ) * 26000.0f ); }
+
+	// a few seconds of saber fighting at 22kHz, snd_vol 204 and voices at 230,
+	// with paint passes of the odd sizes S_Update_ asks for
+	Recording MakeFight()
+	{
+		const int normal = 204, voice = 230;
+		std::vector<Sound> sounds;
+		sounds.push_back( MakeSound( 2205, 0, true, 180 * normal, 140 * normal, 1.0f, SaberHum ) );
+		sounds.push_back( MakeSound( 2205, 0, true, 60 * normal, 200 * normal, 1.0f, SaberHum ) );
+		for( int i = 0; i < 6; i++ )
+		{
+			// back to back shots, loud enough to clip once they pile up
+			sounds.push_back( MakeSound( 7001, 1500 + i * 2311, false, 255 * normal, ( 255 - i * 30 ) * normal, 1.0f, Blaster ) );
+		}
+		sounds.push_back( MakeSound( 22050, 9000, false, 255 * normal, 200 * normal, 1.0f, Explosion ) );
+		sounds.push_back( MakeSound( 11025, 4000, false, 120 * normal, 60 * normal, 1.35f, Rocket ) );
+		sounds.push_back( MakeSound( 11025, 6000, false, 80 * normal, 140 * normal, 0.8f, Rocket ) );	// doppler, but slowing down
+		sounds.push_back( MakeSound( 333, 100, true, 90 * normal, 110 * normal, 1.0f, Footstep ) );
+		sounds.push_back( MakeSound( 15000, 3000, false, 200 * voice, 200 * voice, 1.0f, Voice ) );
+
+		const int passSizes[] = { 1024, 735, 367, 1, 512, 1023, 130, 997 };
+		Recording fight;
+		Recording::Record r = {};
+		int paintedTime = 0;
+
+		for( int pass = 0; paintedTime < 40000; pass++ )
+		{
+			const int count = passSizes[pass % 8];
+			const int end = paintedTime + count;
+
+			r.rec = sndMixRecord_t();
+			r.rec.type = SNDMIXREC_BEGIN;
+			r.rec.count = count;
+			r.rec.bufferOffset = paintedTime;
+			r.rec.dopplerScale = 1.0f;
+			r.rec.numData = count * 2;
+			r.raw.assign( count * 2, 0 );
+			if( pass & 2 )
+			{
+				// some music streaming underneath
+				for( int i = 0; i < count * 2; i++ )
+				{
+					r.raw[i] = (int)( sinf( ( paintedTime + i / 2 ) * 0.05f ) * 8000.0f ) * 256;
+				}
+			}
+			r.samples.clear();
+			fight.Add( r );
+			r.raw.clear();
+
+			// the channel loop of S_PaintChannels
+			for( const Sound &s : sounds )
+			{
+				int ltime = paintedTime;
+
+				do
+				{
+					const int sampleOffset = s.loop ? ltime % s.length : ltime - s.startSample;
+					int n = end - ltime;
+
+					if( sampleOffset < 0 )
+					{
+						break;	// not started yet
+					}
+					if( sampleOffset + n > s.length )
+					{
+						n = s.length - sampleOffset;
+					}
+					if( n <= 0 )
+					{
+						break;
+					}
+
+					r.rec = sndMixRecord_t();
+					r.rec.type = SNDMIXREC_CHANNEL;
+					r.rec.count = n;
+					r.rec.bufferOffset = ltime - paintedTime;
+					r.rec.leftVol = s.leftVol;
+					r.rec.rightVol = s.rightVol;
+					r.rec.sampleOffset = sampleOffset;
+					r.rec.dopplerScale = s.dopplerScale > 1.0f ? s.dopplerScale : 1.0f;
+
+					float ofst = sampleOffset;
+					for( int i = 1; i < n; i++ )
+					{
+						ofst += r.rec.dopplerScale;
+					}
+					r.rec.numData = (int)ofst - sampleOffset + 1;
+					r.samples.assign( s.data.begin() + sampleOffset, s.data.begin() + sampleOffset + r.rec.numData );
+					fight.Add( r );
+
+					ltime += n;
+				} while( ltime < end && s.loop );
+			}
+
+			r.rec = sndMixRecord_t();
+			r.rec.type = SNDMIXREC_TRANSFER;
+			r.rec.count = count;
+			r.rec.bufferOffset = paintedTime;
+			r.rec.dopplerScale = 1.0f;
+			r.samples.clear();
+			fight.Add( r );
+
+			paintedTime = end;
+		}
+		return fight;
+	}
+
+	const Recording &Workload()
+	{
+		static Recording work;
+
+		if( work.records.empty() )
+		{
+			const char *path = getenv( "MIX_RECORDING" );
+			if( path && work.Load( path ) )
+			{
+				BOOST_TEST_MESSAGE( "mixing " << path );
+			}
+			else
+			{
+				work = MakeFight();
+			}
+		}
+		return work;
+	}
+
+	// S_PaintChannelFrom16 and S_WriteLinearBlastStereo16 before the kernels,
+	// doppler check in the loop
+	void OldPaintChannel( int *paint, const short *data, int count, int sampleOffset, int leftVol, int rightVol, bool doppler, float dopplerScale )
+	{
+		float ofst = sampleOffset;
+
+		for( int i = 0; i < count; i++ )
+		{
+			const int iData = data[(int)ofst - sampleOffset];
+
+			paint[i * 2 + 0] += ( iData * leftVol ) >> 8;
+			paint[i * 2 + 1] += ( iData * rightVol ) >> 8;
+			if( doppler && dopplerScale > 1 )
+			{
+				ofst += 1 * dopplerScale;
+			}
+			else
+			{
+				ofst++;
+			}
+		}
+	}
+
+	void OldClip16( short *out, const int *in, int count )
+	{
+		for( int i = 0; i < count; i++ )
+		{
+			const int val = in[i] >> 8;
+			if( val > 0x7fff )
+				out[i] = 0x7fff;
+			else if( val < (short)0x8000 )
+				out[i] = (short)0x8000;
+			else
+				out[i] = val;
+		}
+	}
+
+	// S_PaintChannelFrom16 now, a NULL funcs is the old mixer
+	void PaintChannel( const sndMixFuncs_t *funcs, int *paint, const short *data, int count, int sampleOffset, int leftVol, int rightVol, bool doppler, float dopplerScale )
+	{
+		if( !funcs )
+		{
+			OldPaintChannel( paint, data, count, sampleOffset, leftVol, rightVol, doppler, dopplerScale );
+		}
+		else if( !doppler || !( dopplerScale > 1 ) )
+		{
+			funcs->paint16( paint, data, count, leftVol, rightVol );
+		}
+		else
+		{
+			// still the per sample loop
+			OldPaintChannel( paint, data, count, sampleOffset, leftVol, rightVol, doppler, dopplerScale );
+		}
+	}
+
+	// what came out of replaying a recording: every pass of the paint buffer, and the dma buffer at the end
+	struct Output
+	{
+		std::vector<int> painted;
+		std::vector<short> dma;
+	};
+
+	void Replay( const Recording &work, const sndMixFuncs_t *funcs, Output &out )
+	{
+		std::vector<int> paint( paintSamples * 2 );
+
+		out.painted.clear();
+		out.dma.assign( dmaSamples, 0x5555 );
+		for( const Recording::Record &r : work.records )
+		{
+			switch( r.rec.type )
+			{
+			case SNDMIXREC_BEGIN:
+				std::fill( paint.begin(), paint.end(), 0 );
+				std::copy( r.raw.begin(), r.raw.end(), paint.begin() );
+				break;
+
+			case SNDMIXREC_CHANNEL:
+				PaintChannel( funcs, paint.data() + r.rec.bufferOffset * 2, r.samples.data(), r.rec.count, r.rec.sampleOffset,
+					r.rec.leftVol, r.rec.rightVol, r.rec.dopplerScale != 1.0f, r.rec.dopplerScale );
+				break;
+
+			case SNDMIXREC_TRANSFER:
+				// S_TransferStereo16, into a dma buffer nothing plays
+				for( int done = 0; done < r.rec.count; )
+				{
+					const int pos = ( r.rec.bufferOffset + done ) & ( dmaSamples / 2 - 1 );
+					const int n = std::min( dmaSamples / 2 - pos, r.rec.count - done );
+
+					if( funcs )
+						funcs->clip16( out.dma.data() + pos * 2, paint.data() + done * 2, n * 2 );
+					else
+						OldClip16( out.dma.data() + pos * 2, paint.data() + done * 2, n * 2 );
+					done += n;
+				}
+				out.painted.insert( out.painted.end(), paint.begin(), paint.begin() + r.rec.count * 2 );
+				break;
+			}
+		}
+	}
+
+	bool SameOutput( const Output &a, const Output &b )
+	{
+		return a.painted == b.painted && a.dma == b.dma;
+	}
+
+	const char *kernelNames[SNDMIX_NUM_KERNELS] = { "scalar", "sse2" };
+}
+
+BOOST_AUTO_TEST_SUITE( client_mix )
+
+BOOST_AUTO_TEST_CASE( replay )
+{
+	const Recording &work = Workload();
+	Output expected;
+	Replay( work, NULL, expected );
+
+	for( int kernel = 0; kernel < SNDMIX_NUM_KERNELS; kernel++ )
+	{
+		const sndMixFuncs_t *funcs = S_GetMixKernel( (sndMixKernel_t)kernel );
+		if( !funcs )
+		{
+			continue;
+		}
+
+		Output out;
+		Replay( work, funcs, out );
+		BOOST_TEST_CONTEXT( kernelNames[kernel] << " kernel" )
+		{
+			BOOST_CHECK( SameOutput( out, expected ) );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( clipping )
+{
+	// paint buffer values either side of the short range once shifted down, and what must come out
+	const int in[] = { 0x7fffffff, INT_MIN, 0x007fff00, 0x007fffff, 0x00800000, -0x00800000, -0x00800001, -1, 255, 256, -256, -257, 0, 0x12345678, -0x12345678 };
+	const short expected[] = { 0x7fff, (short)0x8000, 0x7fff, 0x7fff, 0x7fff, (short)0x8000, (short)0x8000, -1, 0, 1, -1, -2, 0, 0x7fff, (short)0x8000 };
+	const int numValues = sizeof( in ) / sizeof( in[0] );
+
+	for( int kernel = 0; kernel < SNDMIX_NUM_KERNELS; kernel++ )
+	{
+		const sndMixFuncs_t *funcs = S_GetMixKernel( (sndMixKernel_t)kernel );
+		if( !funcs )
+		{
+			continue;
+		}
+
+		BOOST_TEST_CONTEXT( kernelNames[kernel] << " kernel" )
+		{
+			// every value at every lane of the vector loop and in the tail after it
+			for( int shift = 0; shift < 8; shift++ )
+			{
+				int rotated[numValues * 2];
+				short out[numValues * 2];
+				for( int i = 0; i < numValues * 2; i++ )
+				{
+					rotated[i] = in[( i + shift ) % numValues];
+				}
+				funcs->clip16( out, rotated, numValues * 2 );
+				for( int i = 0; i < numValues * 2; i++ )
+				{
+					BOOST_CHECK_EQUAL( out[i], expected[( i + shift ) % numValues] );
+				}
+			}
+
+			// eight full scale channels at the loudest snd_vol pile up past the clamp
+			std::vector<short> loud( 64, 32767 );
+			std::vector<int> paint( 64 * 2, 0 );
+			std::vector<short> dma( 64 * 2 );
+			for( int ch = 0; ch < 8; ch++ )
+			{
+				funcs->paint16( paint.data(), loud.data(), 64, 255 * 256, 255 * 256 );
+			}
+			funcs->clip16( dma.data(), paint.data(), 64 * 2 );
+			BOOST_CHECK_EQUAL( paint[0], 8 * ( ( 32767 * 255 * 256 ) >> 8 ) );
+			BOOST_CHECK( std::count( dma.begin(), dma.end(), 0x7fff ) == (int)dma.size() );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( doppler )
+{
+	// only a doppler channel speeding up keeps the per sample loop, the rest go through the kernel
+	std::vector<short> data( 4096 );
+	for( int i = 0; i < (int)data.size(); i++ )
+	{
+		data[i] = Rocket( i );
+	}
+	const float scales[] = { 0.5f, 1.0f, 1.0001f, 1.35f, 2.0f };
+
+	for( int kernel = 0; kernel < SNDMIX_NUM_KERNELS; kernel++ )
+	{
+		const sndMixFuncs_t *funcs = S_GetMixKernel( (sndMixKernel_t)kernel );
+		if( !funcs )
+		{
+			continue;
+		}
+
+		for( float scale : scales )
+		{
+			for( bool doppler : { false, true } )
+			{
+				// far enough in that the float offset can't step exactly
+				const int sampleOffset = 1234567;
+				const int count = 997;
+				std::vector<int> expected( count * 2, 77 ), paint( count * 2, 77 );
+
+				OldPaintChannel( expected.data(), data.data(), count, sampleOffset, 200 * 204, 90 * 204, doppler, scale );
+				PaintChannel( funcs, paint.data(), data.data(), count, sampleOffset, 200 * 204, 90 * 204, doppler, scale );
+				BOOST_TEST_CONTEXT( kernelNames[kernel] << " kernel, doppler " << doppler << ", scale " << scale )
+				{
+					BOOST_CHECK( paint == expected );
+				}
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( odd_counts )
+{
+	// counts short of, at and past the vector width, from any alignment, must not touch the values around them
+	const int guard = 0x13579bd;
+	std::vector<short> data( 64 );
+	for( int i = 0; i < (int)data.size(); i++ )
+	{
+		data[i] = Footstep( i * 7 );
+	}
+
+	for( int kernel = 0; kernel < SNDMIX_NUM_KERNELS; kernel++ )
+	{
+		const sndMixFuncs_t *funcs = S_GetMixKernel( (sndMixKernel_t)kernel );
+		if( !funcs )
+		{
+			continue;
+		}
+
+		for( int count = 0; count <= 21; count++ )
+		{
+			for( int align = 0; align < 4; align++ )
+			{
+				std::vector<int> expected( 2 + 64 * 2 + 2, guard ), paint( expected );
+				OldPaintChannel( expected.data() + 2 + align * 2, data.data() + align, count, 0, 150 * 256, 77 * 256, false, 1.0f );
+				funcs->paint16( paint.data() + 2 + align * 2, data.data() + align, count, 150 * 256, 77 * 256 );
+
+				std::vector<short> expectedDma( 2 + 64 + 2, -2 ), dma( expectedDma );
+				OldClip16( expectedDma.data() + 2 + align, expected.data() + 2, count );
+				funcs->clip16( dma.data() + 2 + align, expected.data() + 2, count );
+
+				BOOST_TEST_CONTEXT( kernelNames[kernel] << " kernel, " << count << " samples from " << align )
+				{
+					BOOST_CHECK( paint == expected );
+					BOOST_CHECK( dma == expectedDma );
+				}
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( benchmark )
+{
+	typedef std::chrono::steady_clock clock;
+	const Recording &work = Workload();
+	const int passes = 20;
+	Output scalarOut;
+
+	for( int kernel = 0; kernel < SNDMIX_NUM_KERNELS; kernel++ )
+	{
+		const sndMixFuncs_t *funcs = S_GetMixKernel( (sndMixKernel_t)kernel );
+		if( !funcs )
+		{
+			continue;
+		}
+
+		Output out;
+		const clock::time_point start = clock::now();
+		for( int pass = 0; pass < passes; pass++ )
+		{
+			Replay( work, funcs, out );
+		}
+		const double ms = std::chrono::duration<double, std::milli>( clock::now() - start ).count() / passes;
+		BOOST_TEST_MESSAGE( kernelNames[kernel] << ": " << ms << "ms for " << work.channelSamples << " channel samples" );
+
+		// the timed mix has to be the scalar one
+		if( kernel == SNDMIX_SCALAR )
+		{
+			scalarOut = out;
+		}
+		else
+		{
+			BOOST_TEST_CONTEXT( kernelNames[kernel] << " kernel" )
+			{
+				BOOST_CHECK( SameOutput( out, scalarOut ) );
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
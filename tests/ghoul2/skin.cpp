@@ -0,0 +1,335 @@
+#include "ghoul2/G2_skin.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+// The skinning kernels of G2_skin.cpp must give the same bits as the loop in
+// R_TransformEachSurface, whatever the weight counts, block padding and scale.
+
+namespace
+{
+	struct Vert
+	{
+		float xyz[3];
+		int numWeights;
+		int bones[iMAX_G2_BONEWEIGHTS_PER_VERT];
+		int weights[iMAX_G2_BONEWEIGHTS_PER_VERT - 1];	// 10 bits each, the last weight is whatever is left
+	};
+
+	// packs verts into a surface laid out as in a .glm
+	std::vector<int> MakeSurface( const std::vector<Vert> &verts, int numBoneRefs )
+	{
+		const int ofsBoneReferences = sizeof( mdxmSurface_t );
+		const int ofsVerts = ofsBoneReferences + numBoneRefs * sizeof( int );
+		const int size = ofsVerts + verts.size() * ( sizeof( mdxmVertex_t ) + sizeof( mdxmVertexTexCoord_t ) );
+		std::vector<int> data( ( size + sizeof( int ) - 1 ) / sizeof( int ), 0 );
+
+		mdxmSurface_t *surf = (mdxmSurface_t *)data.data();
+		surf->numVerts = verts.size();
+		surf->ofsVerts = ofsVerts;
+		surf->numBoneReferences = numBoneRefs;
+		surf->ofsBoneReferences = ofsBoneReferences;
+		surf->ofsEnd = size;
+
+		int *refs = (int *)( (byte *)surf + ofsBoneReferences );
+		for( int i = 0; i < numBoneRefs; i++ )
+		{
+			refs[i] = i;
+		}
+
+		mdxmVertex_t *v = (mdxmVertex_t *)( (byte *)surf + ofsVerts );
+		for( const Vert &in : verts )
+		{
+			memcpy( v->vertCoords, in.xyz, sizeof( in.xyz ) );
+			v->uiNmWeightsAndBoneIndexes = ( in.numWeights - 1 ) << 30;
+			for( int k = 0; k < in.numWeights; k++ )
+			{
+				v->uiNmWeightsAndBoneIndexes |= in.bones[k] << ( iG2_BITS_PER_BONEREF * k );
+				if( k < in.numWeights - 1 )
+				{
+					v->BoneWeightings[k] = in.weights[k] & 0xff;
+					v->uiNmWeightsAndBoneIndexes |= ( in.weights[k] >> 8 ) << ( iG2_BONEWEIGHT_TOPBITS_SHIFT + 8 + k * 2 );
+				}
+			}
+			v++;
+		}
+		return data;
+	}
+
+	// deterministic verts cycling through every weight count, so the blocks
+	// of each count end up with ragged tails
+	std::vector<Vert> MakeVerts( int numVerts, int numBoneRefs )
+	{
+		std::vector<Vert> verts( numVerts );
+
+		for( int j = 0; j < numVerts; j++ )
+		{
+			Vert &v = verts[j];
+			int left = 1023;
+
+			v.xyz[0] = 37.5f - j * 1.75f;
+			v.xyz[1] = ( j % 13 ) * 3.125f - 20.0f;
+			v.xyz[2] = ( j * 7 % 19 ) * 2.5f - 11.0f;
+			v.numWeights = 1 + ( j * 5 + j / 3 ) % iMAX_G2_BONEWEIGHTS_PER_VERT;
+			for( int k = 0; k < v.numWeights; k++ )
+			{
+				v.bones[k] = ( j + k * 3 ) % numBoneRefs;
+				if( k < v.numWeights - 1 )
+				{
+					v.weights[k] = left * ( 3 + ( j + k ) % 5 ) / 10;
+					left -= v.weights[k];
+				}
+			}
+		}
+		return verts;
+	}
+
+	std::vector<mdxaBone_t> MakeBones( int count )
+	{
+		std::vector<mdxaBone_t> bones( count );
+
+		for( int i = 0; i < count; i++ )
+		{
+			// yaw then pitch, with a translation
+			const float yaw = i * 0.7f - 2.0f, pitch = 1.1f - i * 0.35f;
+			const float cy = cosf( yaw ), sy = sinf( yaw ), cp = cosf( pitch ), sp = sinf( pitch );
+			const float rotation[3][3] = {
+				{ cy * cp, -sy, cy * sp },
+				{ sy * cp, cy, sy * sp },
+				{ -sp, 0.0f, cp } };
+
+			for( int r = 0; r < 3; r++ )
+			{
+				for( int c = 0; c < 3; c++ )
+				{
+					bones[i].matrix[r][c] = rotation[r][c];
+				}
+				bones[i].matrix[r][3] = ( i * 11 % 7 ) * 4.0f - 12.0f + r;
+			}
+		}
+		return bones;
+	}
+
+	// the loop in R_TransformEachSurface
+	void Reference( const mdxmSurface_t *surface, const mdxaBone_t *bones, const vec3_t scale, float *out )
+	{
+		const mdxmVertex_t *v = (mdxmVertex_t *)( (byte *)surface + surface->ofsVerts );
+		const bool scaled = scale[0] != 1.0f || scale[1] != 1.0f || scale[2] != 1.0f;
+
+		for( int j = 0; j < surface->numVerts; j++, v++ )
+		{
+			vec3_t tempVert = { 0.0f, 0.0f, 0.0f };
+
+			const int iNumWeights = G2_GetVertWeights( v );
+			float fTotalWeight = 0.0f;
+			for( int k = 0; k < iNumWeights; k++ )
+			{
+				int iBoneIndex = G2_GetVertBoneIndex( v, k );
+				float fBoneWeight = G2_GetVertBoneWeight( v, k, fTotalWeight, iNumWeights );
+				const mdxaBone_t &bone = bones[iBoneIndex];
+
+				// DotProduct() spelled out
+				for( int r = 0; r < 3; r++ )
+				{
+					const float dot = bone.matrix[r][0] * v->vertCoords[0] + bone.matrix[r][1] * v->vertCoords[1] + bone.matrix[r][2] * v->vertCoords[2];
+					tempVert[r] += fBoneWeight * ( dot + bone.matrix[r][3] );
+				}
+			}
+			for( int i = 0; i < 3; i++ )
+			{
+				out[j * 5 + i] = scaled ? tempVert[i] * scale[i] : tempVert[i];
+			}
+		}
+	}
+
+	const char *kernelNames[G2SKIN_NUM_KERNELS] = { "scalar", "sse2", "avx" };
+	const float untouched = -12345.0f;	// st of the transformed verts, and the floats past the last one
+
+	// skins the surface with every kernel there is, each must match Reference
+	// and leave the st slots and whatever follows the last vert alone
+	void CheckKernels( const std::vector<int> &surfaceData, const mdxaBone_t *bones, const vec3_t scale )
+	{
+		const mdxmSurface_t *surface = (const mdxmSurface_t *)surfaceData.data();
+		const int numFloats = surface->numVerts * 5;
+		std::vector<int> mem( ( G2_SkinVertsSize( surface ) + sizeof( int ) - 1 ) / sizeof( int ) );
+		BOOST_REQUIRE( !mem.empty() );
+		const g2SkinVerts_t *skin = G2_BuildSkinVerts( surface, mem.data() );
+
+		std::vector<float> expected( numFloats + G2_SKIN_BLOCK * 5, untouched );
+		Reference( surface, bones, scale, expected.data() );
+
+		for( int kernel = 0; kernel < G2SKIN_NUM_KERNELS; kernel++ )
+		{
+			g2SkinFunc_t func = G2_GetSkinKernel( (g2SkinKernel_t)kernel );
+			if( !func )
+			{
+				continue;
+			}
+
+			std::vector<float> out( expected.size(), untouched );
+			func( skin, bones, scale, out.data() );
+			BOOST_TEST_CONTEXT( kernelNames[kernel] << " kernel, " << surface->numVerts << " verts" )
+			{
+				BOOST_CHECK( memcmp( out.data(), expected.data(), out.size() * sizeof( float ) ) == 0 );
+			}
+		}
+	}
+
+	const vec3_t unitScale = { 1.0f, 1.0f, 1.0f };
+}
+
+BOOST_AUTO_TEST_SUITE( ghoul2_skin )
+
+BOOST_AUTO_TEST_CASE( partial_blocks )
+{
+	// every padding a block of each weight count can end up with
+	const std::vector<mdxaBone_t> bones = MakeBones( 8 );
+	for( int numVerts = 1; numVerts <= G2_SKIN_BLOCK * iMAX_G2_BONEWEIGHTS_PER_VERT * 2 + 1; numVerts++ )
+	{
+		CheckKernels( MakeSurface( MakeVerts( numVerts, 8 ), 8 ), bones.data(), unitScale );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( single_weight_count )
+{
+	// one block run per surface, the kernels' other weight count paths never start
+	const std::vector<mdxaBone_t> bones = MakeBones( 6 );
+	for( int numWeights = 1; numWeights <= iMAX_G2_BONEWEIGHTS_PER_VERT; numWeights++ )
+	{
+		std::vector<Vert> verts = MakeVerts( G2_SKIN_BLOCK * 3 - 1, 6 );
+		for( Vert &v : verts )
+		{
+			v.numWeights = numWeights;
+		}
+		CheckKernels( MakeSurface( verts, 6 ), bones.data(), unitScale );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( negative_last_weight )
+{
+	// the stored weights of some exported models add up past 1, leaving a negative last one
+	const std::vector<mdxaBone_t> bones = MakeBones( 4 );
+	std::vector<Vert> verts = MakeVerts( 37, 4 );
+	for( Vert &v : verts )
+	{
+		for( int k = 0; k < v.numWeights - 1; k++ )
+		{
+			v.weights[k] = 700 + k * 100;
+		}
+	}
+	CheckKernels( MakeSurface( verts, 4 ), bones.data(), unitScale );
+}
+
+BOOST_AUTO_TEST_CASE( model_scale )
+{
+	// scaling only happens when some axis isn't 1, a negative one mirrors the model
+	const std::vector<mdxaBone_t> bones = MakeBones( 12 );
+	const std::vector<int> surface = MakeSurface( MakeVerts( 45, 12 ), 12 );
+	const vec3_t scales[] = {
+		{ 1.25f, 1.25f, 1.25f },
+		{ 1.0f, 1.0f, 0.5f },
+		{ 1.25f, 0.8f, -1.1f } };
+
+	for( const vec3_t &scale : scales )
+	{
+		CheckKernels( surface, bones.data(), scale );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( unused_bones_not_read )
+{
+	// G2_TransformGhoulBones only builds the bones some surface is weighted to
+	const int numBoneRefs = 16;
+	std::vector<mdxaBone_t> bones = MakeBones( numBoneRefs );
+	std::vector<Vert> verts = MakeVerts( 29, numBoneRefs / 2 );
+	for( Vert &v : verts )
+	{
+		for( int k = 0; k < v.numWeights; k++ )
+		{
+			v.bones[k] *= 2;
+		}
+	}
+	for( int i = 1; i < numBoneRefs; i += 2 )
+	{
+		for( int r = 0; r < 3; r++ )
+		{
+			for( int c = 0; c < 4; c++ )
+			{
+				bones[i].matrix[r][c] = std::numeric_limits<float>::quiet_NaN();
+			}
+		}
+	}
+	CheckKernels( MakeSurface( verts, numBoneRefs ), bones.data(), unitScale );
+}
+
+BOOST_AUTO_TEST_CASE( bad_bone_reference )
+{
+	// a bone index past the references can't be decoded
+	std::vector<int> data = MakeSurface( MakeVerts( 16, 32 ), 32 );
+	( (mdxmSurface_t *)data.data() )->numBoneReferences = 4;
+	BOOST_CHECK_EQUAL( G2_SkinVertsSize( (mdxmSurface_t *)data.data() ), 0 );
+}
+
+BOOST_AUTO_TEST_CASE( benchmark )
+{
+	typedef std::chrono::steady_clock clock;
+	const int passes = 200;
+
+	// about the size of the humanoid lod 0 meshes: a few thousand verts over 20 odd surfaces
+	const std::vector<mdxaBone_t> bones = MakeBones( 16 );
+	std::vector<std::vector<int>> surfaces, mems;
+	std::vector<const g2SkinVerts_t *> skins;
+	int totalVerts = 0;
+	for( int i = 0; i < 24; i++ )
+	{
+		surfaces.push_back( MakeSurface( MakeVerts( 60 + i * 13, 16 ), 16 ) );
+		const mdxmSurface_t *surface = (const mdxmSurface_t *)surfaces.back().data();
+		mems.emplace_back( ( G2_SkinVertsSize( surface ) + sizeof( int ) - 1 ) / sizeof( int ) );
+		skins.push_back( G2_BuildSkinVerts( surface, mems.back().data() ) );
+		totalVerts += surface->numVerts;
+	}
+
+	std::vector<float> scalarOut;
+	for( int kernel = 0; kernel < G2SKIN_NUM_KERNELS; kernel++ )
+	{
+		g2SkinFunc_t func = G2_GetSkinKernel( (g2SkinKernel_t)kernel );
+		if( !func )
+		{
+			continue;
+		}
+
+		std::vector<float> out( totalVerts * 5, untouched );
+		const clock::time_point start = clock::now();
+		for( int pass = 0; pass < passes; pass++ )
+		{
+			float *o = out.data();
+			for( const g2SkinVerts_t *skin : skins )
+			{
+				func( skin, bones.data(), unitScale, o );
+				o += skin->numVerts * 5;
+			}
+		}
+		const double us = std::chrono::duration<double, std::micro>( clock::now() - start ).count() / passes;
+		BOOST_TEST_MESSAGE( kernelNames[kernel] << ": " << us << "us for " << totalVerts << " verts" );
+
+		// the timed runs have to give what the scalar kernel did
+		if( kernel == G2SKIN_SCALAR )
+		{
+			scalarOut = out;
+		}
+		else
+		{
+			BOOST_TEST_CONTEXT( kernelNames[kernel] << " kernel" )
+			{
+				BOOST_CHECK( memcmp( out.data(), scalarOut.data(), out.size() * sizeof( float ) ) == 0 );
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
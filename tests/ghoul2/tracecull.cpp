@@ -0,0 +1,381 @@
+#include "ghoul2/G2_tracecull.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <vector>
+
+// Culling surfaces with G2_TraceCullBounds before a trace must not change what
+// the trace hits: the point and radius poly tests of G2_misc.cpp have to give
+// the same collision records with and without the cull.
+
+namespace
+{
+	const int numBones = 8;
+	const int frontFace = 1, backFace = 0;	// G2_FRONTFACE, G2_BACKFACE
+
+	struct Vert
+	{
+		vec3_t xyz;
+		int numWeights;
+		int boneRefs[3];
+		float weights[3];
+	};
+
+	struct Surface
+	{
+		std::vector<int> boneRefs;		// into the model bones
+		std::vector<Vert> verts;
+		std::vector<int> indexes;		// 3 per tri
+		std::vector<g2BoneBounds_t> bounds;
+	};
+
+	struct Hit
+	{
+		int surface;
+		int poly;
+		int flags;
+		float distance;
+
+		bool operator==( const Hit &other ) const
+		{
+			return surface == other.surface && poly == other.poly && flags == other.flags && distance == other.distance;
+		}
+		bool operator!=( const Hit &other ) const
+		{
+			return !( *this == other );
+		}
+	};
+
+	std::ostream &operator<<( std::ostream &os, const Hit &hit )
+	{
+		return os << "surface " << hit.surface << " poly " << hit.poly << " flags " << hit.flags << " distance " << hit.distance;
+	}
+
+	// a bent grid of tris around center, each vert weighted to one to three of
+	// the surface bone references
+	Surface MakeSurface( int index, const vec3_t center, int gridSize )
+	{
+		Surface surf;
+
+		for( int i = 0; i < 3; i++ )
+		{
+			surf.boneRefs.push_back( ( index * 3 + i * 5 ) % numBones );
+		}
+		for( int y = 0; y < gridSize; y++ )
+		{
+			for( int x = 0; x < gridSize; x++ )
+			{
+				Vert v;
+				const int j = y * gridSize + x;
+
+				v.xyz[0] = center[0] + x * 2.5f - gridSize;
+				v.xyz[1] = center[1] + y * 2.0f - gridSize;
+				v.xyz[2] = center[2] + ( ( x * 7 + y * 3 + index ) % 5 ) * 0.75f;
+				v.numWeights = 1 + ( j + index ) % 3;
+				v.weights[0] = v.numWeights == 1 ? 1.0f : v.numWeights == 2 ? 0.625f : 0.5f;
+				v.weights[1] = v.numWeights == 2 ? 0.375f : 0.25f;
+				v.weights[2] = 0.25f;
+				for( int k = 0; k < v.numWeights; k++ )
+				{
+					v.boneRefs[k] = ( j + k ) % surf.boneRefs.size();
+				}
+				surf.verts.push_back( v );
+			}
+		}
+		for( int y = 0; y < gridSize - 1; y++ )
+		{
+			for( int x = 0; x < gridSize - 1; x++ )
+			{
+				const int a = y * gridSize + x;
+				surf.indexes.insert( surf.indexes.end(), { a, a + 1, a + gridSize, a + 1, a + gridSize + 1, a + gridSize } );
+			}
+		}
+
+		// as R_BuildG2TraceData
+		surf.bounds.resize( surf.boneRefs.size() );
+		for( g2BoneBounds_t &b : surf.bounds )
+		{
+			ClearBounds( b.mins, b.maxs );
+		}
+		for( const Vert &v : surf.verts )
+		{
+			for( int k = 0; k < v.numWeights; k++ )
+			{
+				AddPointToBounds( v.xyz, surf.bounds[v.boneRefs[k]].mins, surf.bounds[v.boneRefs[k]].maxs );
+			}
+		}
+		return surf;
+	}
+
+	std::vector<Surface> MakeModel()
+	{
+		std::vector<Surface> model;
+
+		for( int i = 0; i < 16; i++ )
+		{
+			const vec3_t center = {
+				( i % 4 ) * 18.0f - 27.0f,
+				( i / 4 ) * 16.0f - 24.0f,
+				( i * 5 % 7 ) * 6.0f - 18.0f };
+			model.push_back( MakeSurface( i, center, 3 + i % 4 ) );
+		}
+		// one surface with a bone reference no vert is weighted to
+		const vec3_t center = { 4.0f, -6.0f, 30.0f };
+		Surface surf = MakeSurface( 16, center, 4 );
+		surf.boneRefs.push_back( 7 );
+		surf.bounds.emplace_back();
+		ClearBounds( surf.bounds.back().mins, surf.bounds.back().maxs );
+		model.push_back( surf );
+		return model;
+	}
+
+	std::vector<mdxaBone_t> MakePose( int pose )
+	{
+		std::vector<mdxaBone_t> bones( numBones );
+
+		for( int i = 0; i < numBones; i++ )
+		{
+			vec3_t angles = { pose * 23.0f - i * 17.0f, i * 41.0f + pose * 9.0f, ( i + pose ) * 13.0f };
+			matrix3_t axis;
+			AnglesToAxis( angles, axis );
+
+			for( int r = 0; r < 3; r++ )
+			{
+				for( int c = 0; c < 3; c++ )
+				{
+					bones[i].matrix[r][c] = axis[c][r];
+				}
+				bones[i].matrix[r][3] = ( ( i * 11 + pose * 3 ) % 7 ) * 3.0f - 9.0f + r;
+			}
+		}
+		return bones;
+	}
+
+	// the skinning loop of R_TransformEachSurface, xyz only
+	std::vector<float> Skin( const Surface &surf, const std::vector<mdxaBone_t> &bones, const vec3_t scale )
+	{
+		std::vector<float> out( surf.verts.size() * 3 );
+
+		for( size_t j = 0; j < surf.verts.size(); j++ )
+		{
+			const Vert &v = surf.verts[j];
+			vec3_t tempVert = { 0.0f, 0.0f, 0.0f };
+
+			for( int k = 0; k < v.numWeights; k++ )
+			{
+				const mdxaBone_t &bone = bones[surf.boneRefs[v.boneRefs[k]]];
+
+				tempVert[0] += v.weights[k] * ( DotProduct( bone.matrix[0], v.xyz ) + bone.matrix[0][3] );
+				tempVert[1] += v.weights[k] * ( DotProduct( bone.matrix[1], v.xyz ) + bone.matrix[1][3] );
+				tempVert[2] += v.weights[k] * ( DotProduct( bone.matrix[2], v.xyz ) + bone.matrix[2][3] );
+			}
+			for( int i = 0; i < 3; i++ )
+			{
+				out[j * 3 + i] = tempVert[i] * scale[i];
+			}
+		}
+		return out;
+	}
+
+	// G2_TracePolys
+	void TracePolys( int surfIndex, const Surface &surf, const std::vector<float> &verts, const vec3_t rayStart, const vec3_t rayEnd, std::vector<Hit> &hits )
+	{
+		for( size_t j = 0; j < surf.indexes.size() / 3; j++ )
+		{
+			const float *point1 = &verts[surf.indexes[j * 3 + 0] * 3];
+			const float *point2 = &verts[surf.indexes[j * 3 + 1] * 3];
+			const float *point3 = &verts[surf.indexes[j * 3 + 2] * 3];
+			vec3_t hitPoint, normal, distVect;
+			float face;
+
+			if( G2_SegmentTriangleTest( rayStart, rayEnd, point1, point2, point3, qtrue, qtrue, hitPoint, normal, &face ) )
+			{
+				VectorSubtract( hitPoint, rayStart, distVect );
+				hits.push_back( { surfIndex, (int)j, face > 0 ? frontFace : backFace, VectorLength( distVect ) } );
+			}
+		}
+	}
+
+	// G2_RadiusTracePolys
+	void RadiusTracePolys( int surfIndex, const Surface &surf, const std::vector<float> &verts, const vec3_t rayStart, const vec3_t rayEnd, float radius, std::vector<Hit> &hits )
+	{
+		vec3_t saxis, taxis, rayDir;
+		G2_RadiusTraceAxes( rayStart, rayEnd, radius, saxis, taxis, rayDir );
+
+		std::vector<int> vertFlags( surf.verts.size() );
+		int flags = 63;
+		for( size_t j = 0; j < surf.verts.size(); j++ )
+		{
+			vertFlags[j] = ~G2_RadiusTraceFlags( &verts[j * 3], rayStart, saxis, taxis, rayDir );
+			flags &= vertFlags[j];
+		}
+		if( flags )
+		{
+			return;
+		}
+
+		for( size_t j = 0; j < surf.indexes.size() / 3; j++ )
+		{
+			const int *tri = &surf.indexes[j * 3];
+			if( 63 & vertFlags[tri[0]] & vertFlags[tri[1]] & vertFlags[tri[2]] )
+			{
+				continue;
+			}
+
+			const float *A = &verts[tri[0] * 3];
+			const float *B = &verts[tri[1] * 3];
+			const float *C = &verts[tri[2] * 3];
+			vec3_t normal, edgeAC, edgeBA, distVect, hitPoint;
+
+			VectorSubtract( C, A, edgeAC );
+			VectorSubtract( B, A, edgeBA );
+			CrossProduct( edgeBA, edgeAC, normal );
+
+			const float third = -( A[0] * ( B[1] * C[2] - C[1] * B[2] ) + B[0] * ( C[1] * A[2] - A[1] * C[2] ) + C[0] * ( A[1] * B[2] - B[1] * A[2] ) );
+			VectorSubtract( rayEnd, rayStart, distVect );
+			const float side = normal[0] * rayStart[0] + normal[1] * rayStart[1] + normal[2] * rayStart[2] + third;
+			const float side2 = normal[0] * distVect[0] + normal[1] * distVect[1] + normal[2] * distVect[2];
+			VectorMA( rayStart, -( side / side2 ), distVect, hitPoint );
+			VectorSubtract( hitPoint, rayStart, distVect );
+			hits.push_back( { surfIndex, (int)j, frontFace, VectorLength( distVect ) } );
+		}
+	}
+
+	struct TraceCounts
+	{
+		int traces = 0;
+		int hits = 0;
+		int surfaces = 0;
+		int culled = 0;
+	};
+
+	// traces the ray through every surface, skipping the ones the cull rejects when asked to,
+	// as G2_TraceSurfaces skips the surfaces G2_TransformModelForTrace didn't skin
+	std::vector<Hit> Trace( const std::vector<Surface> &model, const std::vector<mdxaBone_t> &bones, const vec3_t scale,
+		const vec3_t rayStart, const vec3_t rayEnd, float radius, bool useCull, TraceCounts &counts )
+	{
+		std::vector<Hit> hits;
+		g2TraceCull_t cull;
+		const bool culling = useCull && G2_TraceCullInit( &cull, rayStart, rayEnd, radius );
+
+		for( size_t i = 0; i < model.size(); i++ )
+		{
+			const Surface &surf = model[i];
+			if( culling )
+			{
+				std::vector<mdxaBone_t> surfBones( surf.boneRefs.size() );
+				for( size_t k = 0; k < surf.boneRefs.size(); k++ )
+				{
+					surfBones[k] = bones[surf.boneRefs[k]];
+				}
+				counts.surfaces++;
+				if( !G2_TraceCullBounds( &cull, surf.bounds.data(), surf.bounds.size(), surfBones.data(), scale ) )
+				{
+					counts.culled++;
+					continue;
+				}
+			}
+
+			const std::vector<float> verts = Skin( surf, bones, scale );
+			if( fabs( radius ) < 0.1 )
+			{
+				TracePolys( i, surf, verts, rayStart, rayEnd, hits );
+			}
+			else
+			{
+				RadiusTracePolys( i, surf, verts, rayStart, rayEnd, radius, hits );
+			}
+		}
+		return hits;
+	}
+
+	// rays from all around the model, some through it, some past it and some stopping inside it
+	void CheckTraces( float radius, TraceCounts &counts )
+	{
+		const std::vector<Surface> model = MakeModel();
+		const vec3_t scales[] = { { 1.0f, 1.0f, 1.0f }, { 1.25f, 0.75f, 1.5f }, { -1.0f, 1.0f, 0.5f } };
+
+		for( int pose = 0; pose < 4; pose++ )
+		{
+			const std::vector<mdxaBone_t> bones = MakePose( pose );
+
+			for( const vec3_t &scale : scales )
+			{
+				for( int r = 0; r < 96; r++ )
+				{
+					vec3_t angles = { r * 37.0f, r * 71.0f + pose * 11.0f, 0.0f };
+					vec3_t forward, aim, rayStart, rayEnd;
+					AngleVectors( angles, forward, NULL, NULL );
+					VectorScale( forward, -120.0f, rayStart );
+					aim[0] = ( r % 9 ) * 7.0f - 28.0f;
+					aim[1] = ( r * 5 % 11 ) * 6.0f - 30.0f;
+					aim[2] = ( r * 3 % 7 ) * 6.0f - 18.0f;
+					VectorSubtract( aim, rayStart, rayEnd );
+					VectorMA( rayStart, ( r % 4 ) ? 2.0f : 1.0f, rayEnd, rayEnd );
+
+					TraceCounts ignored;
+					const std::vector<Hit> expected = Trace( model, bones, scale, rayStart, rayEnd, radius, false, ignored );
+					const std::vector<Hit> culled = Trace( model, bones, scale, rayStart, rayEnd, radius, true, counts );
+
+					BOOST_TEST_CONTEXT( "pose " << pose << ", scale " << scale[0] << " " << scale[1] << " " << scale[2] << ", ray " << r )
+					{
+						BOOST_CHECK_EQUAL_COLLECTIONS( culled.begin(), culled.end(), expected.begin(), expected.end() );
+					}
+					counts.traces++;
+					counts.hits += expected.size();
+				}
+			}
+		}
+		BOOST_TEST_MESSAGE( counts.traces << " traces, " << counts.hits << " hits, " << counts.culled << " of " << counts.surfaces << " surfaces culled" );
+	}
+}
+
+BOOST_AUTO_TEST_SUITE( ghoul2_tracecull )
+
+BOOST_AUTO_TEST_CASE( point_traces )
+{
+	TraceCounts counts;
+	CheckTraces( 0.0f, counts );
+	// or the test proves nothing
+	BOOST_CHECK( counts.hits > 0 );
+	BOOST_CHECK( counts.culled > 0 && counts.culled < counts.surfaces );
+}
+
+BOOST_AUTO_TEST_CASE( radius_traces )
+{
+	for( const float radius : { 2.0f, 12.0f } )
+	{
+		BOOST_TEST_CONTEXT( "radius " << radius )
+		{
+			TraceCounts counts;
+			CheckTraces( radius, counts );
+			BOOST_CHECK( counts.hits > 0 );
+			BOOST_CHECK( counts.culled > 0 && counts.culled < counts.surfaces );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( empty_bounds )
+{
+	g2TraceCull_t cull;
+	const vec3_t start = { -10.0f, 0.0f, 0.0f }, end = { 10.0f, 0.0f, 0.0f }, scale = { 1.0f, 1.0f, 1.0f };
+	BOOST_REQUIRE( G2_TraceCullInit( &cull, start, end, 0.0f ) );
+
+	g2BoneBounds_t bounds[2];
+	ClearBounds( bounds[0].mins, bounds[0].maxs );
+	ClearBounds( bounds[1].mins, bounds[1].maxs );
+	mdxaBone_t bones[2] = {};
+	BOOST_CHECK( !G2_TraceCullBounds( &cull, bounds, 2, bones, scale ) );
+}
+
+BOOST_AUTO_TEST_CASE( radius_trace_without_direction )
+{
+	// G2_RadiusTraceAxes has no frame for a zero length ray, so it can't be culled
+	g2TraceCull_t cull;
+	const vec3_t start = { 4.0f, 5.0f, 6.0f };
+	BOOST_CHECK( !G2_TraceCullInit( &cull, start, start, 8.0f ) );
+	BOOST_CHECK( G2_TraceCullInit( &cull, start, start, 0.0f ) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,171 @@
+#include "qcommon/qcommon.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <functional>
+#include <random>
+#include <vector>
+
+// Checks the table driven coder of huffman.cpp against the tree walking one
+// it replaces in MSG_WriteBits and MSG_ReadBits.
+
+namespace
+{
+	struct Tree
+	{
+		huffman_t huff;
+		huffCodes_t codes[2];
+
+		// like MSG_initHuffman with a made up frequency table
+		explicit Tree( std::mt19937 &rng, int skew )
+		{
+			std::uniform_int_distribution<int> weight( 1, 64 );
+
+			Huff_Init( &huff );
+			for( int i = 0; i < 256; i++ )
+			{
+				// a steep falloff gives codes too long for the lookup table
+				int count = weight( rng );
+				if( skew )
+				{
+					const int shift = ( 255 - i ) / skew;
+					count = shift < 12 ? 1 << shift : 4096;
+				}
+				for( int j = 0; j < count; j++ )
+				{
+					Huff_addRef( &huff.compressor, (byte)i );
+					Huff_addRef( &huff.decompressor, (byte)i );
+				}
+			}
+			Huff_BuildCodes( &huff.compressor, &codes[0] );
+			Huff_BuildCodes( &huff.decompressor, &codes[1] );
+		}
+	};
+
+	const int bufferSize = 1 << 16;
+}
+
+BOOST_AUTO_TEST_SUITE( huffman )
+
+BOOST_AUTO_TEST_CASE( roundtrip )
+{
+	std::mt19937 rng( 1234 );
+	std::uniform_int_distribution<int> symbol( 0, 255 );
+	std::uniform_int_distribution<int> rawBits( 0, 7 );
+	std::vector<byte> tree( bufferSize ), table( bufferSize );
+
+	for( int skew = 0; skew < 12; skew++ )
+	{
+		Tree t( rng, skew );
+
+		for( int round = 0; round < 4; round++ )
+		{
+			std::vector<int> symbols, raw;
+			int treeBit = 0, tableBit = 0;
+
+			std::fill( tree.begin(), tree.end(), 0xaa );
+			std::fill( table.begin(), table.end(), 0x55 );
+
+			// mix raw bits in between like MSG_WriteBits does for odd sizes
+			while( treeBit < ( bufferSize - 64 ) * 8 )
+			{
+				int ch = symbol( rng );
+				int n = rawBits( rng );
+				int value = symbol( rng ) & ( ( 1 << n ) - 1 );
+
+				symbols.push_back( ch );
+				raw.push_back( n | value << 8 );
+
+				for( int i = 0; i < n; i++ )
+				{
+					Huff_putBit( ( value >> i ) & 1, tree.data(), &treeBit );
+				}
+				Huff_offsetTransmit( &t.huff.compressor, ch, tree.data(), &treeBit );
+
+				Huff_putBits( value, n, table.data(), &tableBit );
+				Huff_offsetTransmitCodes( &t.codes[0], &t.huff.compressor, ch, table.data(), &tableBit );
+			}
+
+			BOOST_REQUIRE_EQUAL( treeBit, tableBit );
+			BOOST_REQUIRE( std::equal( tree.begin(), tree.begin() + ( treeBit + 7 ) / 8, table.begin() ) );
+
+			int treeRead = 0, tableRead = 0;
+			for( size_t i = 0; i < symbols.size(); i++ )
+			{
+				int n = raw[i] & 0xff;
+				int treeValue = 0, ch = 0;
+
+				for( int b = 0; b < n; b++ )
+				{
+					treeValue |= Huff_getBit( tree.data(), &treeRead ) << b;
+				}
+				Huff_offsetReceive( t.huff.decompressor.tree, &ch, tree.data(), &treeRead );
+
+				int tableValue = Huff_getBits( table.data(), n, &tableRead );
+				int tableCh = Huff_offsetReceiveCodes( &t.codes[1], table.data(), &tableRead, bufferSize * 8 );
+
+				BOOST_REQUIRE_EQUAL( treeValue, raw[i] >> 8 );
+				BOOST_REQUIRE_EQUAL( tableValue, raw[i] >> 8 );
+				BOOST_REQUIRE_EQUAL( ch, symbols[i] );
+				BOOST_REQUIRE_EQUAL( tableCh, symbols[i] );
+				BOOST_REQUIRE_EQUAL( treeRead, tableRead );
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( benchmark )
+{
+	typedef std::chrono::steady_clock clock;
+	std::mt19937 rng( 5678 );
+	std::uniform_int_distribution<int> symbol( 0, 255 );
+	std::vector<byte> buffer( bufferSize );
+	std::vector<int> symbols( 32768 );
+	Tree t( rng, 0 );
+	int end = 0, sink = 0;
+
+	for( int &ch : symbols )
+	{
+		ch = symbol( rng );
+	}
+
+	auto time = [&]( const char *name, std::function<void()> f ) {
+		auto start = clock::now();
+		for( int i = 0; i < 20; i++ )
+		{
+			f();
+		}
+		auto us = std::chrono::duration_cast<std::chrono::microseconds>( clock::now() - start ).count();
+		BOOST_TEST_MESSAGE( name << ": " << us / 20 << "us for " << symbols.size() << " symbols" );
+	};
+
+	time( "encode, tree", [&] {
+		int bit = 0;
+		for( int ch : symbols ) Huff_offsetTransmit( &t.huff.compressor, ch, buffer.data(), &bit );
+		end = bit;
+	} );
+	time( "encode, table", [&] {
+		int bit = 0;
+		for( int ch : symbols ) Huff_offsetTransmitCodes( &t.codes[0], &t.huff.compressor, ch, buffer.data(), &bit );
+		BOOST_REQUIRE_EQUAL( bit, end );
+	} );
+	time( "decode, tree", [&] {
+		int bit = 0, ch;
+		for( size_t i = 0; i < symbols.size(); i++ )
+		{
+			Huff_offsetReceive( t.huff.decompressor.tree, &ch, buffer.data(), &bit );
+			sink += ch;
+		}
+	} );
+	time( "decode, table", [&] {
+		int bit = 0;
+		for( size_t i = 0; i < symbols.size(); i++ )
+		{
+			sink += Huff_offsetReceiveCodes( &t.codes[1], buffer.data(), &bit, bufferSize * 8 );
+		}
+	} );
+	BOOST_CHECK( sink != 0 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()